@@ -31,6 +31,7 @@
 #include <sigutils/detect.h>
 
 #include "analyzer.h"
+#include "remote.h"
 
 #include "mq.h"
 #include "msg.h"
@@ -79,15 +80,422 @@ suscan_analyzer_process_end(suscan_analyzer_t *analyzer)
   }
 }
 
-/************************ Source worker callback *****************************/
-#ifdef SUSCAN_DEBUG_THROTTLE
-SUBOOL   dbg_rate_set;
-struct timespec dbg_rate_source_start;
-SUSCOUNT dbg_rate_counter;
-SUFLOAT  dbg_rate_mean;
-SUSCOUNT dbg_rate_last_second;
-#endif
+uint64_t
+suscan_analyzer_get_run_time_ns(const suscan_analyzer_t *analyzer)
+{
+  struct timespec now, start, sub;
+
+  start = analyzer->run_start;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+  timespecsub(&now, &start, &sub);
+
+  return sub.tv_sec * 1000000000ull + sub.tv_nsec;
+}
+
+/* Samples per second read from the source since the analyzer started */
+SUFLOAT
+suscan_analyzer_get_read_rate(const suscan_analyzer_t *analyzer)
+{
+  uint64_t elapsed = suscan_analyzer_get_run_time_ns(analyzer);
+
+  if (elapsed == 0)
+    return 0;
+
+  return 1e9 * __atomic_load_n(&analyzer->samp_total, __ATOMIC_RELAXED)
+      / (SUFLOAT) elapsed;
+}
+
+SUPRIVATE void
+suscan_analyzer_report_read_rate(const suscan_analyzer_t *analyzer)
+{
+  SUFLOAT rate = suscan_analyzer_get_read_rate(analyzer);
+
+  SU_INFO(
+      "Read %llu samples in %.3lf s: %lg samples per second (%.1lfx real time)\n",
+      (unsigned long long) analyzer->samp_total,
+      1e-9 * suscan_analyzer_get_run_time_ns(analyzer),
+      rate,
+      rate / su_channel_detector_get_fs(analyzer->source.detector));
+}
+
+/************************ Source detector updates ****************************/
+SUPRIVATE void
+suscan_analyzer_source_update_destroy(
+    struct suscan_analyzer_source_update *update)
+{
+  if (update->detector != NULL)
+    su_channel_detector_destroy(update->detector);
+
+  free(update);
+}
+
+/* Source worker side. Never blocks, never frees */
+SUPRIVATE void
+suscan_analyzer_source_apply_update(struct suscan_analyzer_source *source)
+{
+  struct suscan_analyzer_source_update *update;
+  su_channel_detector_t *old;
+
+  if ((update = __atomic_exchange_n(
+      &source->pending_update,
+      NULL,
+      __ATOMIC_ACQ_REL)) == NULL)
+    return;
+
+  old = source->detector;
+  source->detector = update->detector;
+
+  source->per_cnt_channels  = 0;
+  source->per_cnt_psd       = 0;
+
+  source->interval_channels = update->interval_channels;
+  source->interval_psd      = update->interval_psd;
+  source->interval_stats    = update->interval_stats;
+  source->psd_width         = update->psd_width;
+
+  if (source->throttled && update->replay_speed != source->throttle.speed)
+    suscan_throttle_set_speed(&source->throttle, update->replay_speed);
+
+  /* Hand the old detector back to the analyzer thread */
+  update->detector = old;
+  update->next = __atomic_load_n(&source->retired_list, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(
+      &source->retired_list,
+      &update->next,
+      update,
+      SU_TRUE,
+      __ATOMIC_RELEASE,
+      __ATOMIC_RELAXED));
+}
+
+/* Analyzer thread side: destroy detectors the source worker let go */
+SUPRIVATE void
+suscan_analyzer_source_collect_retired(struct suscan_analyzer_source *source)
+{
+  struct suscan_analyzer_source_update *list, *next;
+
+  list = __atomic_exchange_n(&source->retired_list, NULL, __ATOMIC_ACQUIRE);
+
+  while (list != NULL) {
+    next = list->next;
+    suscan_analyzer_source_update_destroy(list);
+    list = next;
+  }
+}
+
+/*
+ * Build the new detector here, in the analyzer thread, so the source
+ * worker only has to swap a pointer. An update that was not picked up
+ * yet is simply replaced.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_source_publish_update(
+    struct suscan_analyzer_source *source,
+    const struct suscan_analyzer_params *params)
+{
+  struct suscan_analyzer_source_update *update = NULL;
+  struct sigutils_channel_detector_params det_params = source->det_params;
+
+  suscan_analyzer_source_collect_retired(source);
+
+  suscan_analyzer_params_to_detector_params(&det_params, params);
+
+  SU_TRYCATCH(
+      update = calloc(1, sizeof(struct suscan_analyzer_source_update)),
+      goto fail);
+
+  SU_TRYCATCH(
+      update->detector = su_channel_detector_new(&det_params),
+      goto fail);
+
+  update->interval_channels = params->channel_update_int;
+  update->interval_psd      = params->psd_update_int;
+  update->interval_stats    = params->stats_update_int;
+  update->psd_width         = params->psd_width;
+  update->replay_speed      = params->replay_speed;
+
+  source->det_params = det_params;
+
+  if ((update = __atomic_exchange_n(
+      &source->pending_update,
+      update,
+      __ATOMIC_ACQ_REL)) != NULL)
+    suscan_analyzer_source_update_destroy(update);
+
+  return SU_TRUE;
+
+fail:
+  if (update != NULL)
+    suscan_analyzer_source_update_destroy(update);
+
+  return SU_FALSE;
+}
+
+/************************* Source read-ahead stage ***************************/
+SUPRIVATE void *
+suscan_analyzer_reader_thread(void *data)
+{
+  suscan_analyzer_t *analyzer = (suscan_analyzer_t *) data;
+  struct suscan_analyzer_source *source = &analyzer->source;
+  struct suscan_sample_buffer *buffer;
+  SUSDIFF got = SU_BLOCK_PORT_READ_END_OF_STREAM;
+
+  while (!__atomic_load_n(&source->reader_halt, __ATOMIC_ACQUIRE)) {
+    if ((buffer = suscan_sample_buffer_pool_acquire(analyzer->buffer_pool))
+        == NULL) {
+      got = SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+      break;
+    }
+
+    if ((got = su_block_port_read(
+        &source->port,
+        buffer->data,
+        analyzer->read_size)) <= 0) {
+      suscan_sample_buffer_unref(buffer);
+      break;
+    }
+
+    buffer->size = got;
+
+    /* Sweep mode: retune as soon as possible, drop settling reads */
+    if (source->sweep != NULL
+        && !suscan_sweep_tuner_advance(
+            source->sweep,
+            got,
+            &buffer->sweep_seq)) {
+      suscan_sample_buffer_unref(buffer);
+      continue;
+    }
+
+    /* Processing fell too far behind: drop this read */
+    if (suscan_ring_write(&source->read_ring, &buffer, 1) == 0) {
+      __atomic_add_fetch(&source->ring_overruns, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&source->ring_lost, got, __ATOMIC_RELAXED);
+      suscan_sample_buffer_unref(buffer);
+    }
+  }
+
+  /* Published by the ring close */
+  source->reader_status = got;
+  suscan_ring_close(&source->read_ring);
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_source_start_reader(suscan_analyzer_t *analyzer)
+{
+  struct suscan_analyzer_source *source = &analyzer->source;
+  struct suscan_analyzer_params params;
+  pthread_attr_t attr;
+  SUBOOL attr_init = SU_FALSE;
+
+  SU_TRYCATCH(pthread_attr_init(&attr) == 0, goto fail);
+  attr_init = SU_TRUE;
+
+  /* The reader does the source's blocking reads: keep it in its CPU set */
+  suscan_analyzer_get_params(analyzer, &params);
+  if (params.source_cpu_mask != 0)
+    (void) suscan_worker_attr_set_affinity(&attr, params.source_cpu_mask);
+
+  SU_TRYCATCH(
+      suscan_ring_init(
+          &source->read_ring,
+          sizeof(struct suscan_sample_buffer *),
+          SUSCAN_ANALYZER_READ_AHEAD_BUFFERS),
+      goto fail);
+
+  if (pthread_create(
+      &source->reader,
+      &attr,
+      suscan_analyzer_reader_thread,
+      analyzer) != 0) {
+    suscan_ring_finalize(&source->read_ring);
+    goto fail;
+  }
+
+  pthread_attr_destroy(&attr);
+
+  source->reader_running = SU_TRUE;
+
+  return SU_TRUE;
+
+fail:
+  if (attr_init)
+    pthread_attr_destroy(&attr);
+
+  SU_WARNING("Cannot start source reader, reading from the source worker\n");
+  source->read_ahead = SU_FALSE;
+
+  return SU_FALSE;
+}
+
+/* The source must be in EOS, or the reader may never return */
+SUPRIVATE void
+suscan_analyzer_source_stop_reader(struct suscan_analyzer_source *source)
+{
+  struct suscan_sample_buffer *buffer;
+
+  if (!source->reader_running)
+    return;
+
+  __atomic_store_n(&source->reader_halt, SU_TRUE, __ATOMIC_RELEASE);
+  pthread_join(source->reader, NULL);
+
+  while (suscan_ring_read(&source->read_ring, &buffer, 1, 0) == 1)
+    suscan_sample_buffer_unref(buffer);
+
+  suscan_ring_finalize(&source->read_ring);
+  source->reader_running = SU_FALSE;
+}
+
+/*
+ * Takes the next buffer from the reader. Returns 0 if none arrived in
+ * time, so the worker gets a chance to attend halt requests.
+ */
+SUPRIVATE SUSDIFF
+suscan_analyzer_source_read_ahead(
+    struct suscan_analyzer_source *source,
+    struct suscan_sample_buffer **buffer)
+{
+  if (suscan_ring_read(
+      &source->read_ring,
+      buffer,
+      1,
+      SUSCAN_ANALYZER_READ_AHEAD_POLL_MS) == 1)
+    return (*buffer)->size;
+
+  if (!suscan_ring_is_closed(&source->read_ring))
+    return 0;
+
+  /* Closed. Something may have been written right before */
+  if (suscan_ring_read(&source->read_ring, buffer, 1, 0) == 1)
+    return (*buffer)->size;
+
+  *buffer = NULL;
 
+  return source->reader_status;
+}
+
+/*
+ * Regular processing: inspectors, detector, channel and spectrum
+ * updates. *frames receives the channelizer output, to be released by
+ * the caller.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_feed_detector(
+    suscan_analyzer_t *analyzer,
+    struct suscan_sample_buffer *buffer,
+    struct suscan_sample_buffer **frames)
+{
+  struct suscan_analyzer_source *source = &analyzer->source;
+  SUSCOUNT got = buffer->size;
+  uint64_t start;
+
+  /* Split the band once for all channelized inspectors */
+  SU_TRYCATCH(
+      suscan_channelizer_feed(
+          analyzer->channelizer,
+          buffer->data,
+          got,
+          frames),
+      return SU_FALSE);
+
+  /*
+   * Share this buffer with all inspectors before feeding the detector,
+   * so consumers start working on it right away. Non-real time sources
+   * wait for slow inspectors instead of dropping samples.
+   */
+  SU_TRYCATCH(
+      suscan_analyzer_publish_buffer(
+          analyzer,
+          buffer,
+          *frames,
+          !source->config->source->real_time),
+      return SU_FALSE);
+
+  start = suscan_stats_now_ns();
+
+  SU_TRYCATCH(
+      su_channel_detector_feed_bulk(
+          source->detector,
+          buffer->data,
+          got) == got,
+      return SU_FALSE);
+
+  suscan_stats_histogram_add(
+      &analyzer->feed_hist,
+      suscan_stats_now_ns() - start);
+
+  source->per_cnt_channels += got;
+  source->per_cnt_psd += got;
+
+  /* Check channel update */
+  if (source->interval_channels > 0) {
+    if (source->per_cnt_channels
+        >= source->interval_channels * source->detector->params.samp_rate) {
+      source->per_cnt_channels = 0;
+
+      SU_TRYCATCH(
+          suscan_analyzer_send_detector_channels(analyzer, source->detector),
+          return SU_FALSE);
+    }
+  }
+
+  /* Check spectrum update */
+  if (source->interval_psd > 0) {
+    if (source->per_cnt_psd
+        >= source->interval_psd * source->detector->params.samp_rate) {
+      source->per_cnt_psd = 0;
+
+      start = suscan_stats_now_ns();
+
+      SU_TRYCATCH(
+          suscan_analyzer_send_psd(analyzer, source->detector),
+          return SU_FALSE);
+
+      suscan_stats_histogram_add(
+          &analyzer->psd_hist,
+          suscan_stats_now_ns() - start);
+    }
+  }
+
+  return SU_TRUE;
+}
+
+/* Sweep mode: inspectors and detector are bypassed */
+SUPRIVATE SUBOOL
+suscan_analyzer_feed_sweep(
+    suscan_analyzer_t *analyzer,
+    struct suscan_sample_buffer *buffer)
+{
+  struct suscan_analyzer_source *source = &analyzer->source;
+  uint64_t start = suscan_stats_now_ns();
+  SUBOOL complete;
+
+  SU_TRYCATCH(
+      suscan_sweep_feed(
+          source->sweep,
+          buffer->sweep_seq,
+          buffer->data,
+          buffer->size,
+          &complete),
+      return SU_FALSE);
+
+  suscan_stats_histogram_add(
+      &analyzer->feed_hist,
+      suscan_stats_now_ns() - start);
+
+  if (complete)
+    SU_TRYCATCH(
+        suscan_analyzer_send_sweep(analyzer, source->sweep),
+        return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+/************************ Source worker callback *****************************/
 SUPRIVATE SUBOOL
 suscan_source_wk_cb(
     struct suscan_mq *mq_out,
@@ -97,19 +505,19 @@ suscan_source_wk_cb(
   suscan_analyzer_t *analyzer = (suscan_analyzer_t *) wk_private;
   struct suscan_analyzer_source *source =
       (struct suscan_analyzer_source *) cb_private;
+  struct suscan_sample_buffer *buffer = NULL;
+  struct suscan_sample_buffer *frames = NULL;
   SUSDIFF got;
   SUSCOUNT read_size;
-  SUBOOL mutex_acquired = SU_FALSE;
+  uint64_t lost;
   SUBOOL restart = SU_FALSE;
-#ifdef SUSCAN_DEBUG_THROTTLE
-  struct timespec sub;
-#endif
+  uint64_t start;
 
-  SU_TRYCATCH(pthread_mutex_lock(&source->det_mutex) != -1, goto done);
-  mutex_acquired = SU_TRUE;
+  /* Between reads: pick up the new detector, if any */
+  suscan_analyzer_source_apply_update(source);
 
   /* With non-real time sources, use throttle to control CPU usage */
-  if (source->config->source->real_time)
+  if (!source->throttled)
     read_size = analyzer->read_size;
   else
     read_size = suscan_throttle_get_portion(
@@ -119,62 +527,92 @@ suscan_source_wk_cb(
   /* Ready to read */
   suscan_analyzer_read_start(analyzer);
 
-#ifdef SUSCAN_DEBUG_THROTTLE
-  if (!dbg_rate_set) {
-    dbg_rate_set = SU_TRUE;
-    dbg_rate_source_start = analyzer->read_start;
+  if (source->read_ahead && !source->reader_running)
+    (void) suscan_analyzer_source_start_reader(analyzer);
+
+  if (source->read_ahead) {
+    /* Nothing yet, try again */
+    if ((got = suscan_analyzer_source_read_ahead(source, &buffer)) == 0) {
+      restart = SU_TRUE;
+      goto done;
+    }
+  } else {
+    SU_TRYCATCH(
+        buffer = suscan_sample_buffer_pool_acquire(analyzer->buffer_pool),
+        goto done);
+
+    got = su_block_port_read(&source->port, buffer->data, read_size);
+
+    /* Settling reads are dropped here too */
+    if (got > 0
+        && source->sweep != NULL
+        && !suscan_sweep_tuner_advance(
+            source->sweep,
+            got,
+            &buffer->sweep_seq)) {
+      restart = SU_TRUE;
+      goto done;
+    }
   }
-#endif
 
-  if ((got = su_block_port_read(
-      &source->port,
-      analyzer->read_buf,
-      read_size)) > 0) {
+  if (got > 0) {
     suscan_analyzer_process_start(analyzer);
-#ifdef SUSCAN_DEBUG_THROTTLE
-    dbg_rate_counter += got;
-#endif
 
-    if (!source->config->source->real_time)
+    suscan_stats_histogram_add(
+        &analyzer->read_hist,
+        suscan_stats_timespec_to_ns(&analyzer->process_start)
+        - suscan_stats_timespec_to_ns(&analyzer->read_start));
+
+    if (source->throttled)
       suscan_throttle_advance(&source->throttle, got);
 
-    SU_TRYCATCH(
-        su_channel_detector_feed_bulk(
-            source->detector,
-            analyzer->read_buf,
-            got) == got,
-        goto done);
+    __atomic_add_fetch(&analyzer->samp_total, got, __ATOMIC_RELAXED);
 
-    source->per_cnt_channels += got;
-    source->per_cnt_psd += got;
+    buffer->size = got;
 
-    /* Check channel update */
-    if (source->interval_channels > 0) {
-      if (source->per_cnt_channels
-          >= source->interval_channels * source->detector->params.samp_rate) {
-        source->per_cnt_channels = 0;
+    /* Only copies: the recorder writes from its own thread */
+    suscan_recorder_slot_write(&analyzer->recorder_slot, buffer->data, got);
 
+    /* Counters are updated from the source's and the reader's threads */
+    if (source->samples_lost != NULL || source->read_ahead) {
+      lost = __atomic_load_n(&source->ring_lost, __ATOMIC_RELAXED);
+      if (source->samples_lost != NULL)
+        lost += __atomic_load_n(source->samples_lost, __ATOMIC_RELAXED);
+
+      if (lost != source->samples_lost_reported) {
         SU_TRYCATCH(
-            suscan_analyzer_send_detector_channels(analyzer, source->detector),
+            suscan_analyzer_send_samples_lost(
+                analyzer,
+                lost - source->samples_lost_reported,
+                lost),
             goto done);
+        source->samples_lost_reported = lost;
       }
     }
 
-    /* Check spectrum update */
-    if (source->interval_psd > 0) {
-      if (source->per_cnt_psd
-          >= source->interval_psd * source->detector->params.samp_rate) {
-        source->per_cnt_psd = 0;
+    if (source->sweep != NULL) {
+      SU_TRYCATCH(suscan_analyzer_feed_sweep(analyzer, buffer), goto done);
+    } else {
+      SU_TRYCATCH(
+          suscan_analyzer_feed_detector(analyzer, buffer, &frames),
+          goto done);
+    }
 
-        SU_TRYCATCH(
-            suscan_analyzer_send_psd(analyzer, source->detector),
-            goto done);
+    /* Check stats update. Wall clock based, even if unthrottled */
+    if (source->interval_stats > 0) {
+      start = suscan_stats_now_ns();
+      if (start - source->last_stats >= 1e9 * source->interval_stats) {
+        source->last_stats = start;
+
+        SU_TRYCATCH(suscan_analyzer_send_stats(analyzer), goto done);
       }
     }
   } else {
     analyzer->eos = SU_TRUE;
     analyzer->cpu_usage = 0;
 
+    suscan_analyzer_report_read_rate(analyzer);
+
     switch (got) {
       case SU_BLOCK_PORT_READ_END_OF_STREAM:
         suscan_analyzer_send_status(
@@ -201,6 +639,7 @@ suscan_source_wk_cb(
         break;
 
       case SU_BLOCK_PORT_READ_ERROR_PORT_DESYNC:
+        ++analyzer->desyncs;
         suscan_analyzer_send_status(
             analyzer,
             SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
@@ -222,21 +661,15 @@ suscan_source_wk_cb(
   /* Finish processing */
   suscan_analyzer_process_end(analyzer);
 
-#ifdef SUSCAN_DEBUG_THROTTLE
-    timespecsub(&analyzer->process_end, &dbg_rate_source_start, &sub);
-
-    if (sub.tv_sec != dbg_rate_last_second) {
-      dbg_rate_mean += ((SUFLOAT) dbg_rate_counter / (SUFLOAT) sub.tv_sec - dbg_rate_mean);
-      SU_INFO("Current read rate: %lg\n", dbg_rate_mean);
-      dbg_rate_last_second = sub.tv_sec;
-    }
-#endif
 
   restart = SU_TRUE;
 
 done:
-  if (mutex_acquired)
-    (void) pthread_mutex_unlock(&source->det_mutex);
+  if (buffer != NULL)
+    suscan_sample_buffer_unref(buffer);
+
+  if (frames != NULL)
+    suscan_sample_buffer_unref(frames);
 
   return restart;
 }
@@ -285,15 +718,11 @@ SUPRIVATE void *
 suscan_analyzer_thread(void *data)
 {
   suscan_analyzer_t *analyzer = (suscan_analyzer_t *) data;
-  su_channel_detector_t *new_detector = NULL;
-  struct sigutils_channel_detector_params new_det_params;
-  const struct suscan_analyzer_params *new_params;
   void *private = NULL;
   uint32_t type;
-  SUBOOL mutex_acquired = SU_FALSE;
   SUBOOL halt_acked = SU_FALSE;
 
-  if (!suscan_worker_push(
+  if (!suscan_worker_push_persistent(
       analyzer->source_wk,
       suscan_source_wk_cb,
       &analyzer->source)) {
@@ -312,10 +741,27 @@ suscan_analyzer_thread(void *data)
       SUSCAN_ANALYZER_INIT_SUCCESS,
       NULL);
 
+  /* Captures can be drawn whole before a single sample is read */
+  if (analyzer->source.capture != NULL
+      && !suscan_analyzer_send_overview(analyzer, analyzer->source.capture))
+    SU_WARNING("Cannot send capture overview\n");
+
   /* Pop all messages from queue before reading from the source */
   for (;;) {
-    /* First read: blocks */
-    private = suscan_mq_read(&analyzer->mq_in, &type);
+    /*
+     * First read: blocks. Consumers may be done with closed inspectors
+     * long before the next request, so do not wait for it to free them.
+     */
+    if (analyzer->halted_inspector_count == 0)
+      private = suscan_mq_read(&analyzer->mq_in, &type);
+    else if (!suscan_mq_poll_timeout(
+        &analyzer->mq_in,
+        &type,
+        &private,
+        SUSCAN_ANALYZER_COLLECT_INTERVAL_MS)) {
+      suscan_analyzer_collect_halted_inspectors(analyzer);
+      continue;
+    }
 
     do {
       switch (type) {
@@ -353,48 +799,17 @@ suscan_analyzer_thread(void *data)
 
         case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
           /*
-           * Parameter messages affect the source worker, that must get their
-           * objects updated. In order to do that, we protect their access
-           * through the source's params_mutex
+           * Parameter messages affect the source worker. A new detector
+           * is prepared here and swapped in by the source worker between
+           * reads, so it never waits for us.
            */
-
           SU_TRYCATCH(
-              pthread_mutex_lock(&analyzer->source.det_mutex) != -1,
+              suscan_analyzer_source_publish_update(
+                  &analyzer->source,
+                  (const struct suscan_analyzer_params *) private),
               goto done);
-          mutex_acquired = SU_TRUE;
-
-          /* vvvvvvvvvvvvvvv Source parameters update start vvvvvvvvvvvvv */
-          new_params = (const struct suscan_analyzer_params *) private;
-
-          /* Attempt to update detector parameters */
-          new_det_params = analyzer->source.detector->params;
-          suscan_analyzer_params_to_detector_params(
-              &new_det_params,
-              new_params);
-
-          if (!su_channel_detector_set_params(
-              analyzer->source.detector,
-              &new_det_params)) {
-            /* If not possibe, re-create detector object */
-            SU_TRYCATCH(
-                new_detector = su_channel_detector_new(&new_det_params),
-                goto done);
-
-            su_channel_detector_destroy(analyzer->source.detector);
-            analyzer->source.detector = new_detector;
-          }
 
-          analyzer->source.per_cnt_channels  = 0;
-          analyzer->source.per_cnt_psd       = 0;
-
-          analyzer->source.interval_channels = new_params->channel_update_int;
-          analyzer->source.interval_psd      = new_params->psd_update_int;
-          /* ^^^^^^^^^^^^^ Source parameters update end ^^^^^^^^^^^^^^^^^  */
-
-          SU_TRYCATCH(
-              pthread_mutex_unlock(&analyzer->source.det_mutex) != -1,
-              goto done);
-          mutex_acquired = SU_FALSE;
+          suscan_param_slot_publish(&analyzer->params_slot, private);
 
           break;
       }
@@ -406,12 +821,13 @@ suscan_analyzer_thread(void *data)
 
       /* Next reads: until message queue is empty */
     } while (suscan_mq_poll(&analyzer->mq_in, &type, &private));
+
+    /* Closed inspectors whose consumers were still busy with them */
+    if (analyzer->halted_inspector_count > 0)
+      suscan_analyzer_collect_halted_inspectors(analyzer);
   }
 
 done:
-  if (mutex_acquired)
-    (void) pthread_mutex_unlock(&analyzer->source.det_mutex);
-
   if (private != NULL)
     suscan_analyzer_dispose_message(type, private);
 
@@ -443,6 +859,9 @@ suscan_analyzer_read_inspector_msg(suscan_analyzer_t *analyzer)
 SUBOOL
 suscan_analyzer_write(suscan_analyzer_t *analyzer, uint32_t type, void *priv)
 {
+  if (analyzer->remote != NULL)
+    return suscan_remote_link_write(analyzer->remote, type, priv);
+
   return suscan_mq_write(&analyzer->mq_in, type, priv);
 }
 
@@ -490,13 +909,22 @@ suscan_analyzer_source_finalize(struct suscan_analyzer_source *source)
 {
   su_block_port_unplug(&source->port);
 
+  /* Workers are gone: no more swaps */
+  if (source->pending_update != NULL)
+    suscan_analyzer_source_update_destroy(source->pending_update);
+
+  suscan_analyzer_source_collect_retired(source);
+
   if (source->detector != NULL)
     su_channel_detector_destroy(source->detector);
 
+  suscan_channel_tracker_finalize(&source->tracker);
+
+  if (source->sweep != NULL)
+    suscan_sweep_destroy(source->sweep);
+
   if (source->block != NULL)
     su_block_destroy(source->block);
-
-  pthread_mutex_destroy(&source->det_mutex);
 }
 
 SUPRIVATE SUBOOL
@@ -506,6 +934,7 @@ suscan_analyzer_source_init_from_block_properties(
 {
   const uint64_t *samp_rate;
   const uint64_t *fc;
+  suscan_capture_t **capture;
 
   /* Retrieve sample rate. All source blocks must expose this property */
   if ((samp_rate = su_block_get_property_ref(
@@ -525,6 +954,31 @@ suscan_analyzer_source_init_from_block_properties(
       "fc")) != NULL)
     source->fc = *fc;
 
+  /* Sources that may drop samples expose an overrun counter */
+  source->samples_lost = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samples_lost");
+  source->samples_lost_reported = 0;
+
+  /* Tunable sources accept retune requests from the sweep */
+  source->fc_request = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc_request");
+
+  /* Indexed captures expose their index and accept seeks */
+  if ((capture = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_OBJECT,
+      "capture")) != NULL)
+    source->capture = *capture;
+
+  source->seek_request = su_block_get_property_ref(
+      source->block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "seek_request");
+
   return SU_TRUE;
 }
 
@@ -570,8 +1024,11 @@ suscan_analyzer_source_init(
 
   source->interval_channels = analyzer_params->channel_update_int;
   source->interval_psd      = analyzer_params->psd_update_int;
+  source->psd_width         = analyzer_params->psd_width;
+  source->interval_stats    = analyzer_params->stats_update_int;
+  source->last_stats        = suscan_stats_now_ns();
 
-  (void) pthread_mutex_init(&source->det_mutex, NULL); /* Always succeeds */
+  suscan_channel_tracker_init(&source->tracker);
 
   SU_TRYCATCH(source->block = (config->source->ctor)(config), goto done);
 
@@ -590,6 +1047,24 @@ suscan_analyzer_source_init(
       source->detector = su_channel_detector_new(&params),
       goto done);
 
+  source->det_params = params;
+
+  if (analyzer_params->sweep) {
+    if (source->fc_request == NULL) {
+      SU_ERROR("Sweep mode requires a tunable source\n");
+      goto done;
+    }
+
+    /* Same resolution as the regular spectrum */
+    SU_TRYCATCH(
+        source->sweep = suscan_sweep_new(
+            &analyzer_params->sweep_params,
+            params.samp_rate,
+            params.window_size,
+            source->fc_request),
+        goto done);
+  }
+
   SU_TRYCATCH(
       su_block_port_plug(&source->port, source->block, 0),
       goto done);
@@ -614,6 +1089,9 @@ suscan_analyzer_source_init(
     SU_TRYCATCH(
         su_block_set_master_port(source->block, 0, &source->port),
         goto done);
+
+    /* Reader thread started by the source worker */
+    source->read_ahead = SU_TRUE;
   } else {
     /*
      * If source is not realtime (e.g. iqfile or wavfile) we can afford
@@ -631,9 +1109,16 @@ suscan_analyzer_source_init(
     /*
      * To avoid CPU hogging by unlimited input rate, we setup a throttle
      * object to deliver samples at a constat rate specified by the
-     * sample rate;
+     * sample rate. Offline analysis may ask for no throttling: the source
+     * is then limited only by how fast inspectors consume samples.
      */
-    suscan_throttle_init(&source->throttle, params.samp_rate);
+    if (!analyzer_params->unthrottled) {
+      suscan_throttle_init(&source->throttle, params.samp_rate);
+      suscan_throttle_set_speed(
+          &source->throttle,
+          analyzer_params->replay_speed);
+      source->throttled = SU_TRUE;
+    }
   }
 
   ok = SU_TRUE;
@@ -643,47 +1128,20 @@ done:
 }
 
 /********************** Suscan analyzer public API ***************************/
-SUPRIVATE unsigned int
-suscan_get_min_consumer_workers(void)
-{
-  long count;
-
-  if ((count = sysconf(_SC_NPROCESSORS_ONLN)) < 2)
-    count = 2;
-
-  return count - 1;
-}
-
-SUBOOL
-suscan_analyzer_push_task(
-    suscan_analyzer_t *analyzer,
-    SUBOOL (*func) (
-          struct suscan_mq *mq_out,
-          void *wk_private,
-          void *cb_private),
-    void *private)
-{
-  if (!suscan_consumer_push_task(
-      analyzer->consumer_list[analyzer->next_consumer],
-      func,
-      private))
-    return SU_FALSE;
-
-  /* Increment next consumer counter */
-  analyzer->next_consumer =
-      (analyzer->next_consumer + 1) % analyzer->consumer_count;
-
-  return SU_TRUE;
-}
-
 void
 suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
 {
+  suscan_inspector_t *insp;
   uint32_t type;
   unsigned int i;
 
   void *private;
 
+  if (analyzer->remote != NULL) {
+    suscan_analyzer_destroy_remote(analyzer);
+    return;
+  }
+
   if (analyzer->running) {
     if (!analyzer->halt_requested) {
       suscan_analyzer_req_halt(analyzer);
@@ -706,46 +1164,107 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
   if (analyzer->source.block != NULL)
     su_block_force_eos(analyzer->source.block, 0);
 
+  /* Source worker may be waiting for inspectors to take its buffer */
+  suscan_analyzer_sched_halt(analyzer);
+
   if (analyzer->source_wk != NULL)
     if (!suscan_analyzer_halt_worker(analyzer->source_wk)) {
       SU_ERROR("Source worker destruction failed, memory leak ahead\n");
       return;
     }
 
-  for (i = 0; i < analyzer->consumer_count; ++i)
-    if (analyzer->consumer_list[i] != NULL)
-      if (!suscan_consumer_destroy(analyzer->consumer_list[i])) {
-        SU_ERROR("Consumer worker destruction failed, memory leak ahead\n");
-        return;
-      }
+  /* Buffers still in the read-ahead ring go back to the pool */
+  suscan_analyzer_source_stop_reader(&analyzer->source);
+
+  /* Consumers may be shared: wait until they let go of our inspectors */
+  suscan_analyzer_sched_drain(analyzer);
+
+  if (analyzer->consumer_pool != NULL)
+    suscan_consumer_pool_detach(analyzer->consumer_pool, analyzer);
 
   /* Consume any pending messages */
   suscan_analyzer_consume_mq(&analyzer->mq_in);
 
-  /* All workers destroyed, it's safe now to delete the worker list */
-  if (analyzer->consumer_list != NULL)
-    free(analyzer->consumer_list);
+  /* Remove all channel analyzers */
+  for (i = 0; i < analyzer->inspector_table.entry_count; ++i)
+    if ((insp = suscan_handle_table_at(&analyzer->inspector_table, i))
+        != NULL)
+      suscan_inspector_destroy(insp);
 
-  /* Free read buffer */
-  if (analyzer->read_buf != NULL)
-    free(analyzer->read_buf);
+  suscan_handle_table_finalize(&analyzer->inspector_table);
 
-  /* Remove all channel analyzers */
-  for (i = 0; i < analyzer->inspector_count; ++i)
-    if (analyzer->inspector_list[i] != NULL)
-      suscan_inspector_destroy(analyzer->inspector_list[i]);
+  for (i = 0; i < analyzer->halted_inspector_count; ++i)
+    if (analyzer->halted_inspector_list[i] != NULL)
+      suscan_inspector_destroy(analyzer->halted_inspector_list[i]);
+
+  if (analyzer->halted_inspector_list != NULL)
+    free(analyzer->halted_inspector_list);
+
+  if (analyzer->sched_inspector_list != NULL)
+    free(analyzer->sched_inspector_list);
+
+  /* Inspector queues are empty, no one is borrowing read buffers anymore */
+  if (analyzer->buffer_pool != NULL)
+    suscan_sample_buffer_pool_destroy(analyzer->buffer_pool);
 
-  if (analyzer->inspector_list != NULL)
-    free(analyzer->inspector_list);
+  if (analyzer->channelizer != NULL)
+    suscan_channelizer_destroy(analyzer->channelizer);
+
+  /* Both pools are gone, their buffers can go too */
+  if (analyzer->arena != NULL)
+    suscan_arena_destroy(analyzer->arena);
+
+  /* Frames still in the output queue keep the pool alive */
+  if (analyzer->psd_pool != NULL)
+    suscan_analyzer_psd_pool_release(analyzer->psd_pool);
+
+  pthread_mutex_destroy(&analyzer->sched_mutex);
 
   /* Delete source information */
   suscan_analyzer_source_finalize(&analyzer->source);
 
   suscan_mq_finalize(&analyzer->mq_in);
 
+  suscan_param_slot_finalize(&analyzer->params_slot);
+
+  suscan_recorder_slot_finalize(&analyzer->recorder_slot);
+
   free(analyzer);
 }
 
+/*
+ * Parameters currently in effect. Threads polling this often should keep
+ * the slot generation and use suscan_param_slot_changed instead.
+ */
+void
+suscan_analyzer_get_params(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_params *params)
+{
+  (void) suscan_param_slot_fetch(&analyzer->params_slot, params);
+}
+
+/*
+ * Taken by the source on its next read. Playback resumes from the last
+ * keyframe before time, where the averages kept in the index start over.
+ */
+SUBOOL
+suscan_analyzer_seek(suscan_analyzer_t *analyzer, uint64_t time)
+{
+  if (analyzer->source.seek_request == NULL) {
+    SU_ERROR("Source does not support seeking\n");
+    return SU_FALSE;
+  }
+
+  /* 0 means no request: the start of the capture is as early as it gets */
+  __atomic_store_n(
+      analyzer->source.seek_request,
+      SU_MAX(time, 1),
+      __ATOMIC_RELEASE);
+
+  return SU_TRUE;
+}
+
 suscan_analyzer_t *
 suscan_analyzer_new(
     const struct suscan_analyzer_params *params,
@@ -753,26 +1272,59 @@ suscan_analyzer_new(
     struct suscan_mq *mq)
 {
   suscan_analyzer_t *analyzer = NULL;
-  suscan_consumer_t *consumer;
-  unsigned int worker_count;
-  unsigned int i;
+  suscan_consumer_pool_t *pool;
+  SUBOOL ok;
 
   if ((analyzer = calloc(1, sizeof (suscan_analyzer_t))) == NULL) {
     SU_ERROR("Cannot allocate analyzer\n");
     goto fail;
   }
 
-  /* Allocate read buffer */
-  if ((analyzer->read_buf = malloc(config->bufsiz * sizeof(SUCOMPLEX)))
-      == NULL) {
-    SU_ERROR("Failed to allocate read buffer\n");
+  suscan_handle_table_init(&analyzer->inspector_table);
+
+  /* Initialize scheduler. Destroy takes its lock, even on early failure */
+  (void) pthread_mutex_init(&analyzer->sched_mutex, NULL);
+  analyzer->sched_priority = SU_MAX(params->consumer_priority, 1);
+
+  if (!suscan_param_slot_init(
+      &analyzer->params_slot,
+      sizeof(struct suscan_analyzer_params),
+      params)) {
+    SU_ERROR("Cannot initialize analyzer params\n");
+    goto fail;
+  }
+
+  if (!suscan_recorder_slot_init(&analyzer->recorder_slot)) {
+    SU_ERROR("Cannot initialize recorder slot\n");
+    goto fail;
+  }
+
+  /* Sample buffers for the source and the channelizer */
+  if ((analyzer->arena = suscan_arena_new(
+      SUSCAN_ARENA_CHUNK_BUFFERS * config->bufsiz * sizeof(SUCOMPLEX),
+      params->huge_pages)) == NULL) {
+    SU_ERROR("Cannot create sample buffer arena\n");
+    goto fail;
+  }
+
+  /* Allocate read buffer pool */
+  if ((analyzer->buffer_pool = suscan_sample_buffer_pool_new(
+      config->bufsiz,
+      analyzer->arena)) == NULL) {
+    SU_ERROR("Failed to allocate read buffer pool\n");
     goto fail;
   }
 
   analyzer->read_size = config->bufsiz;
 
+  /* Allocate spectrum frame pool */
+  if ((analyzer->psd_pool = suscan_analyzer_psd_pool_new()) == NULL) {
+    SU_ERROR("Failed to allocate spectrum frame pool\n");
+    goto fail;
+  }
+
   /* Create input message queue */
-  if (!suscan_mq_init(&analyzer->mq_in)) {
+  if (!suscan_mq_init_ring(&analyzer->mq_in, SUSCAN_MQ_DEFAULT_RING_SIZE)) {
     SU_ERROR("Cannot allocate input MQ\n");
     goto fail;
   }
@@ -783,30 +1335,46 @@ suscan_analyzer_new(
     goto fail;
   }
 
+  /* Idle until the first channelized inspector is opened */
+  if ((analyzer->channelizer = suscan_channelizer_new(
+      analyzer->source.det_params.samp_rate,
+      config->bufsiz,
+      analyzer->arena)) == NULL) {
+    SU_ERROR("Failed to create channelizer\n");
+    goto fail;
+  }
+
   /* Create source worker */
-  if ((analyzer->source_wk = suscan_worker_new(&analyzer->mq_in, analyzer))
-      == NULL) {
+  if ((analyzer->source_wk = suscan_worker_new_with_affinity(
+      &analyzer->mq_in,
+      analyzer,
+      params->source_cpu_mask)) == NULL) {
     SU_ERROR("Cannot create source worker thread\n");
     goto fail;
   }
 
-  /* Create consumer workers */
-  worker_count = suscan_get_min_consumer_workers();
-  for (i = 0; i < worker_count; ++i) {
-    if ((consumer = suscan_consumer_new(analyzer)) == NULL) {
-      SU_ERROR("Failed to create consumer object\n");
-      goto fail;
-    }
+  /* Attach to consumer workers, creating our own if none were given */
+  if ((pool = params->consumer_pool) == NULL
+      && (pool = suscan_consumer_pool_new(params)) == NULL) {
+    SU_ERROR("Cannot create consumer pool\n");
+    goto fail;
+  }
 
-    if (PTR_LIST_APPEND_CHECK(analyzer->consumer, consumer) == -1) {
-      SU_ERROR("Cannot append consumer to list\n");
-      suscan_consumer_destroy(consumer);
-      goto fail;
-    }
+  ok = suscan_consumer_pool_attach(pool, analyzer);
+
+  /* Private pool: the analyzer reference is the only one */
+  if (params->consumer_pool == NULL)
+    suscan_consumer_pool_release(pool);
+
+  if (!ok) {
+    SU_ERROR("Cannot attach to consumer pool\n");
+    goto fail;
   }
 
   analyzer->mq_out = mq;
 
+  clock_gettime(CLOCK_MONOTONIC_RAW, &analyzer->run_start);
+
   if (pthread_create(
       &analyzer->thread,
       NULL,
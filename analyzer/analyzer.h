@@ -30,37 +30,156 @@
 #include "throttle.h"
 #include "inspector.h"
 #include "consumer.h"
+#include "buffer.h"
+#include "stats.h"
+#include "channelizer.h"
+#include "slot.h"
+#include "recorder.h"
+#include "chanset.h"
+#include "handle.h"
+#include "ring.h"
+#include "sweep.h"
+
+#define SUSCAN_ANALYZER_MAX_CONSUMERS 32
+
+/* Read-ahead stage of real time sources */
+#define SUSCAN_ANALYZER_READ_AHEAD_BUFFERS 64
+#define SUSCAN_ANALYZER_READ_AHEAD_POLL_MS 100
+
+/* How often closed inspectors are retried while the analyzer is idle */
+#define SUSCAN_ANALYZER_COLLECT_INTERVAL_MS 100
+
+/* Recording handle for the raw source stream */
+#define SUSCAN_ANALYZER_SOURCE_HANDLE -1
 
 struct suscan_analyzer_params {
   struct sigutils_channel_detector_params detector_params;
   SUFLOAT  channel_update_int;
   SUFLOAT  psd_update_int;
+  SUBOOL   unthrottled; /* Non real time sources: read as fast as possible */
+  SUFLOAT  replay_speed; /* Non real time sources: .5 to 100, 1 is real time */
+  SUSCOUNT psd_width;   /* Decimate spectrum updates to this size, 0: off */
+  SUFLOAT  stats_update_int; /* Seconds between stats messages, 0: off */
+
+  /*
+   * Thread layout, only taken into account when the analyzer is created.
+   * CPU masks have bit n set if the thread may run on CPU n, 0 means any.
+   * Consumer i uses consumer_cpu_mask[i % consumer_cpu_mask_count].
+   */
+  unsigned int consumer_count;  /* 0: one per CPU but one */
+  uint64_t     source_cpu_mask; /* Source worker CPU set */
+  unsigned int consumer_cpu_mask_count;
+  uint64_t     consumer_cpu_mask[SUSCAN_ANALYZER_MAX_CONSUMERS];
+
+  /*
+   * Consumers shared with other analyzers, NULL: a private pool is
+   * created from the thread layout above. Priority sets the share of
+   * the pool this analyzer gets, relative to the others.
+   */
+  suscan_consumer_pool_t *consumer_pool;
+  unsigned int consumer_priority;
+
+  /* Back sample buffers with huge pages. Creation time only, too */
+  SUBOOL       huge_pages;
+
+  /*
+   * Wideband sweep, creation time only. The source is retuned across
+   * the band and the stitched spectrum replaces the detector output.
+   * Requires a source exposing fc_request.
+   */
+  SUBOOL       sweep;
+  struct suscan_sweep_params sweep_params;
 };
 
 #define suscan_analyzer_params_INITIALIZER {                                \
   sigutils_channel_detector_params_INITIALIZER, /* detector_params */       \
   .1,                                           /* channel_update_int */    \
-  .04                                           /* psd_update_int */        \
+  .04,                                          /* psd_update_int */        \
+  SU_FALSE,                                     /* unthrottled */           \
+  1.,                                           /* replay_speed */          \
+  0,                                            /* psd_width */             \
+  1.,                                           /* stats_update_int */      \
+  0,                                            /* consumer_count */        \
+  0,                                            /* source_cpu_mask */       \
+  0,                                            /* consumer_cpu_mask_count */ \
+  {0},                                          /* consumer_cpu_mask */     \
+  NULL,                                         /* consumer_pool */         \
+  1,                                            /* consumer_priority */     \
+  SU_FALSE,                                     /* huge_pages */            \
+  SU_FALSE,                                     /* sweep */                 \
+  {0, 0, .05, .01}                              /* sweep_params */          \
 }
 
+/*
+ * Detector reconfiguration. The analyzer thread builds the new detector
+ * and publishes it through pending_update. The source worker swaps it
+ * in between reads, and hands the old detector back through the retired
+ * list, to be destroyed by the analyzer thread.
+ */
+struct suscan_analyzer_source_update {
+  su_channel_detector_t *detector;
+  SUFLOAT interval_channels;
+  SUFLOAT interval_psd;
+  SUFLOAT interval_stats;
+  SUSCOUNT psd_width;
+  SUFLOAT replay_speed;
+
+  struct suscan_analyzer_source_update *next; /* In retired list */
+};
+
 struct suscan_analyzer_source {
   struct suscan_source_config *config;
   su_block_t *block;
   su_block_port_t port; /* Master reading port */
   suscan_throttle_t throttle; /* Throttle object */
+  SUBOOL throttled; /* Reads are paced at the nominal sample rate */
   struct xsig_source *instance;
 
-  pthread_mutex_t det_mutex;
-  su_channel_detector_t *detector; /* Channel detector */
+  su_channel_detector_t *detector; /* Channel detector, source worker only */
+  struct suscan_analyzer_source_update *pending_update;
+  struct suscan_analyzer_source_update *retired_list;
+  struct sigutils_channel_detector_params det_params; /* Last published */
+  struct suscan_channel_tracker tracker; /* Turns detections into deltas */
   SUFLOAT interval_channels;
   SUFLOAT interval_psd;
+  SUSCOUNT psd_width; /* Display width requested for spectrum updates */
+  SUFLOAT interval_stats; /* In seconds of wall clock time */
+  uint64_t last_stats; /* Time of the last stats message (ns) */
 
   SUSCOUNT per_cnt_channels;
   SUSCOUNT per_cnt_psd;
   uint64_t fc; /* Center frequency of source */
+
+  /* Overrun counter exposed by real time sources, if any */
+  const uint64_t *samples_lost;
+  uint64_t samples_lost_reported;
+
+  /* Sweep mode. Tuner side runs in the reader, if there is one */
+  uint64_t *fc_request; /* Retune property of the source, if any */
+  suscan_sweep_t *sweep;
+
+  /* Indexed captures: the index, and the seek property of the source */
+  suscan_capture_t *capture;
+  uint64_t *seek_request;
+
+  /*
+   * Read-ahead stage. With real time sources, a reader thread drains
+   * the device into read_ring, so detector and PSD spikes are absorbed
+   * by the ring instead of delaying device reads.
+   */
+  SUBOOL read_ahead;
+  struct suscan_ring read_ring; /* Filled sample buffers */
+  pthread_t reader;
+  SUBOOL reader_running;
+  SUBOOL reader_halt;
+  SUSDIFF reader_status;  /* Read result that stopped the reader */
+  uint64_t ring_overruns; /* Reads dropped because the ring was full */
+  uint64_t ring_lost;     /* Samples in those reads */
 };
 
 struct suscan_analyzer;
+struct suscan_remote_link;
+struct suscan_remote_params;
 
 struct suscan_analyzer {
   struct suscan_mq mq_in;   /* To-thread messages */
@@ -75,22 +194,53 @@ struct suscan_analyzer {
   struct timespec process_start;
   struct timespec process_end;
 
+  /* Overall read rate */
+  struct timespec run_start;
+  uint64_t samp_total; /* Samples read since run_start */
+
+  /* Source worker stage timings, written by the source worker only */
+  struct suscan_stats_histogram read_hist; /* Source read */
+  struct suscan_stats_histogram feed_hist; /* Channel detector feed */
+  struct suscan_stats_histogram psd_hist;  /* Spectrum update */
+  uint64_t desyncs;
+
+  /* Last accepted analyzer params, readable from any thread */
+  struct suscan_param_slot params_slot;
+
+  /* Raw source stream recorder, if any */
+  struct suscan_recorder_slot recorder_slot;
+
   /* Source worker objects */
   struct suscan_analyzer_source source;
   suscan_worker_t *source_wk; /* Used by one source only */
-  SUCOMPLEX *read_buf;
+  suscan_arena_t *arena; /* Sample buffers of the pools below */
+  struct suscan_sample_buffer_pool *buffer_pool; /* Shared read buffers */
+  struct suscan_analyzer_psd_pool *psd_pool; /* Main spectrum frames */
+  suscan_channelizer_t *channelizer; /* Shared front-end for inspectors */
   SUSCOUNT   read_size;
 
-  /* Inspector objects */
-  PTR_LIST(suscan_inspector_t, inspector);
+  /* Inspector objects, by handle. Only touched by the analyzer thread */
+  struct suscan_handle_table inspector_table;
+  PTR_LIST(suscan_inspector_t, halted_inspector); /* Closed, still in use */
+
+  /* Consumer workers, possibly shared with other analyzers */
+  suscan_consumer_pool_t *consumer_pool;
 
-  /* Consumer workers (initially idle) */
-  PTR_LIST(suscan_consumer_t, consumer);
+  /* Inspector scheduler */
+  pthread_mutex_t sched_mutex; /* Protects the scheduled inspector list */
+  PTR_LIST(suscan_inspector_t, sched_inspector);
+  SUBOOL sched_halt; /* Source must not wait for inspectors anymore */
 
-  unsigned int next_consumer; /* Next consumer worker to use */
+  /* Fair share of the consumer pool */
+  unsigned int sched_priority; /* At least 1 */
+  uint64_t sched_pass;         /* Consumer time used (ns) / priority */
+  unsigned int sched_active;   /* Inspectors ready or running */
 
   /* Analyzer thread */
   pthread_t thread;
+
+  /* Server connection. Remote analyzers have no local workers */
+  struct suscan_remote_link *remote;
 };
 
 typedef struct suscan_analyzer suscan_analyzer_t;
@@ -106,18 +256,55 @@ void suscan_analyzer_consume_mq(struct suscan_mq *mq);
 void suscan_analyzer_dispose_message(uint32_t type, void *ptr);
 void suscan_analyzer_destroy(suscan_analyzer_t *analyzer);
 void suscan_analyzer_req_halt(suscan_analyzer_t *analyzer);
+SUFLOAT suscan_analyzer_get_read_rate(const suscan_analyzer_t *analyzer);
+uint64_t suscan_analyzer_get_run_time_ns(const suscan_analyzer_t *analyzer);
+void suscan_analyzer_get_params(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_params *params);
+
+/* Indexed captures only: go to a wall clock time (ns) of the recording */
+SUBOOL suscan_analyzer_seek(suscan_analyzer_t *analyzer, uint64_t time);
 SUBOOL suscan_analyzer_halt_worker(suscan_worker_t *worker);
 suscan_analyzer_t *suscan_analyzer_new(
     const struct suscan_analyzer_params *params,
     struct suscan_source_config *config,
     struct suscan_mq *mq);
-SUBOOL suscan_analyzer_push_task(
+
+/* Implemented in remote-client.c */
+suscan_analyzer_t *suscan_analyzer_connect(
+    const struct suscan_remote_params *params,
+    struct suscan_mq *mq);
+void suscan_analyzer_destroy_remote(suscan_analyzer_t *analyzer);
+
+/* Inspector scheduler, implemented in consumer.c */
+SUBOOL suscan_analyzer_attach_inspector(
     suscan_analyzer_t *analyzer,
-    SUBOOL (*func) (
-          struct suscan_mq *mq_out,
-          void *wk_private,
-          void *cb_private),
-    void *private);
+    suscan_inspector_t *insp);
+void suscan_analyzer_detach_inspector(
+    suscan_analyzer_t *analyzer,
+    suscan_inspector_t *insp);
+SUBOOL suscan_analyzer_inspector_is_released(
+    suscan_analyzer_t *analyzer,
+    suscan_inspector_t *insp);
+SUBOOL suscan_analyzer_publish_buffer(
+    suscan_analyzer_t *analyzer,
+    struct suscan_sample_buffer *buffer,
+    struct suscan_sample_buffer *frames,
+    SUBOOL wait);
+void suscan_analyzer_sched_halt(suscan_analyzer_t *analyzer);
+void suscan_analyzer_sched_drain(suscan_analyzer_t *analyzer);
+
+struct suscan_analyzer_inspector_stats;
+
+SUBOOL suscan_analyzer_get_inspector_stats(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_stats **stats_list,
+    unsigned int *stats_count);
+
+/* Implemented in insp-server.c */
+SUBOOL suscan_inspector_process_buffer(
+    suscan_inspector_t *insp,
+    const struct suscan_sample_buffer *buffer);
 
 
 SUBOOL suscan_analyzer_set_params_async(
@@ -159,4 +346,29 @@ SUBOOL suscan_analyzer_set_inspector_params_async(
     const struct suscan_inspector_params *params,
     uint32_t req_id);
 
+/*
+ * Recording. handle is either an inspector handle, whose symbols are
+ * recorded, or SUSCAN_ANALYZER_SOURCE_HANDLE, for the raw source stream.
+ * Starting a recording on a handle that is already recording replaces it.
+ */
+SUBOOL suscan_analyzer_start_recording_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const struct suscan_recorder_params *params,
+    uint32_t req_id);
+
+SUBOOL suscan_analyzer_start_recording(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const struct suscan_recorder_params *params);
+
+SUBOOL suscan_analyzer_stop_recording_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    uint32_t req_id);
+
+SUBOOL suscan_analyzer_stop_recording(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle);
+
 #endif /* _ANALYZER_H */
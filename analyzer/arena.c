@@ -0,0 +1,181 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#define SU_LOG_DOMAIN "arena"
+
+#include "arena.h"
+
+SUPRIVATE void
+suscan_arena_chunk_destroy(struct suscan_arena_chunk *chunk)
+{
+  if (chunk->base != NULL) {
+    if (chunk->mapped)
+      munmap(chunk->base, chunk->size);
+    else
+      free(chunk->base);
+  }
+
+  free(chunk);
+}
+
+SUPRIVATE struct suscan_arena_chunk *
+suscan_arena_chunk_new(size_t size, SUBOOL huge)
+{
+  struct suscan_arena_chunk *new = NULL;
+  void *base;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct suscan_arena_chunk)), goto fail);
+
+  if (huge) {
+    size = (size + SUSCAN_ARENA_HUGE_PAGE_SIZE - 1)
+        & ~(size_t) (SUSCAN_ARENA_HUGE_PAGE_SIZE - 1);
+
+    base = mmap(
+        NULL,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+        -1,
+        0);
+
+    /* No huge pages reserved: ask for transparent ones instead */
+    if (base == MAP_FAILED) {
+      base = mmap(
+          NULL,
+          size,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS,
+          -1,
+          0);
+
+      if (base != MAP_FAILED)
+        (void) madvise(base, size, MADV_HUGEPAGE);
+    }
+
+    if (base != MAP_FAILED) {
+      new->base = base;
+      new->mapped = SU_TRUE;
+    }
+  }
+
+  if (new->base == NULL) {
+    size = (size + SUSCAN_ARENA_PAGE_SIZE - 1)
+        & ~(size_t) (SUSCAN_ARENA_PAGE_SIZE - 1);
+
+    SU_TRYCATCH(
+        posix_memalign(&base, SUSCAN_ARENA_PAGE_SIZE, size) == 0,
+        goto fail);
+
+    new->base = base;
+  }
+
+  new->size = size;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_arena_chunk_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_arena_destroy(suscan_arena_t *arena)
+{
+  struct suscan_arena_chunk *this;
+
+  while ((this = arena->chunk_list) != NULL) {
+    arena->chunk_list = this->next;
+    suscan_arena_chunk_destroy(this);
+  }
+
+  pthread_mutex_destroy(&arena->mutex);
+
+  free(arena);
+}
+
+suscan_arena_t *
+suscan_arena_new(size_t chunk_size, SUBOOL huge)
+{
+  suscan_arena_t *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_arena_t)), return NULL);
+
+  if (pthread_mutex_init(&new->mutex, NULL) != 0) {
+    free(new);
+    return NULL;
+  }
+
+  new->chunk_size = chunk_size;
+  new->huge = huge;
+
+  return new;
+}
+
+void *
+suscan_arena_alloc(suscan_arena_t *arena, size_t size)
+{
+  struct suscan_arena_chunk *chunk;
+  void *ptr = NULL;
+
+  size = suscan_arena_align(size);
+
+  pthread_mutex_lock(&arena->mutex);
+
+  chunk = arena->chunk_list;
+
+  if (chunk == NULL || chunk->size - chunk->used < size) {
+    /* Oversized requests get a chunk of their own */
+    SU_TRYCATCH(
+        chunk = suscan_arena_chunk_new(
+            SU_MAX(size, arena->chunk_size),
+            arena->huge),
+        goto done);
+
+    if (arena->chunk_list != NULL
+        && chunk->size - size < arena->chunk_list->size
+            - arena->chunk_list->used) {
+      /* Keep bumping from the current one, it has more room left */
+      chunk->next = arena->chunk_list->next;
+      arena->chunk_list->next = chunk;
+    } else {
+      chunk->next = arena->chunk_list;
+      arena->chunk_list = chunk;
+    }
+
+    arena->allocated += chunk->size;
+  }
+
+  ptr = chunk->base + chunk->used;
+  chunk->used += size;
+  arena->used += size;
+
+done:
+  pthread_mutex_unlock(&arena->mutex);
+
+  return ptr;
+}
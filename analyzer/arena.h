@@ -0,0 +1,79 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Bump allocator for long-lived DSP buffers. Memory is taken from large
+ * chunks and handed out aligned to SUSCAN_ARENA_ALIGNMENT. Nothing is
+ * freed before the arena itself, so allocations must come from objects
+ * that recycle their buffers (like sample buffer pools) and are destroyed
+ * before the arena is.
+ *
+ * With huge pages, chunks are rounded up to SUSCAN_ARENA_HUGE_PAGE_SIZE
+ * and backed by explicit huge pages if the system has them reserved, or
+ * transparent huge pages otherwise.
+ */
+#define SUSCAN_ARENA_ALIGNMENT      64        /* Cache line, any SIMD width */
+#define SUSCAN_ARENA_PAGE_SIZE      4096
+#define SUSCAN_ARENA_HUGE_PAGE_SIZE (2 << 20)
+#define SUSCAN_ARENA_CHUNK_BUFFERS  16        /* Source buffers per chunk */
+
+struct suscan_arena_chunk {
+  struct suscan_arena_chunk *next;
+  uint8_t *base;
+  size_t   size;
+  size_t   used;
+  SUBOOL   mapped; /* mmap'ed, as opposed to posix_memalign'ed */
+};
+
+struct suscan_arena {
+  pthread_mutex_t mutex;
+  size_t chunk_size;
+  SUBOOL huge;
+
+  struct suscan_arena_chunk *chunk_list; /* Current chunk first */
+  size_t allocated; /* Bytes in chunks */
+  size_t used;      /* Bytes handed out, padding included */
+};
+
+typedef struct suscan_arena suscan_arena_t;
+
+SUINLINE size_t
+suscan_arena_align(size_t size)
+{
+  return (size + SUSCAN_ARENA_ALIGNMENT - 1)
+      & ~(size_t) (SUSCAN_ARENA_ALIGNMENT - 1);
+}
+
+suscan_arena_t *suscan_arena_new(size_t chunk_size, SUBOOL huge);
+
+/* Aligned, uninitialized. Safe to call from any thread */
+void *suscan_arena_alloc(suscan_arena_t *arena, size_t size);
+
+void suscan_arena_destroy(suscan_arena_t *arena);
+
+#endif /* _ARENA_H */
@@ -0,0 +1,165 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define SU_LOG_DOMAIN "buffer"
+
+#include <sigutils/sigutils.h>
+
+#include "buffer.h"
+
+SUPRIVATE void
+suscan_sample_buffer_destroy(struct suscan_sample_buffer *buffer)
+{
+  if (buffer->data != NULL && buffer->pool->arena == NULL)
+    free(buffer->data);
+
+  free(buffer);
+}
+
+SUPRIVATE struct suscan_sample_buffer *
+suscan_sample_buffer_new(struct suscan_sample_buffer_pool *pool)
+{
+  struct suscan_sample_buffer *new = NULL;
+  size_t size = pool->buffer_size * sizeof(SUCOMPLEX);
+  void *data;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_sample_buffer)),
+      goto fail);
+
+  new->alloc = pool->buffer_size;
+  new->pool = pool;
+
+  if (pool->arena != NULL) {
+    SU_TRYCATCH(data = suscan_arena_alloc(pool->arena, size), goto fail);
+  } else {
+    SU_TRYCATCH(
+        posix_memalign(
+            &data,
+            SUSCAN_ARENA_ALIGNMENT,
+            suscan_arena_align(size)) == 0,
+        goto fail);
+  }
+
+  new->data = data;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_sample_buffer_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_sample_buffer_ref(struct suscan_sample_buffer *buffer)
+{
+  __atomic_add_fetch(&buffer->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+void
+suscan_sample_buffer_unref(struct suscan_sample_buffer *buffer)
+{
+  struct suscan_sample_buffer_pool *pool = buffer->pool;
+
+  if (__atomic_sub_fetch(&buffer->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+    return;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  buffer->size = 0;
+  buffer->next = pool->free_list;
+  pool->free_list = buffer;
+  ++pool->free_count;
+
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+struct suscan_sample_buffer *
+suscan_sample_buffer_pool_acquire(struct suscan_sample_buffer_pool *pool)
+{
+  struct suscan_sample_buffer *buffer;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if ((buffer = pool->free_list) != NULL) {
+    pool->free_list = buffer->next;
+    --pool->free_count;
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (buffer == NULL) {
+    SU_TRYCATCH(buffer = suscan_sample_buffer_new(pool), return NULL);
+    __atomic_add_fetch(&pool->allocated, 1, __ATOMIC_RELAXED);
+  }
+
+  buffer->next = NULL;
+  buffer->size = 0;
+  buffer->refcnt = 1;
+
+  return buffer;
+}
+
+/* All buffers must have been released by now */
+void
+suscan_sample_buffer_pool_destroy(struct suscan_sample_buffer_pool *pool)
+{
+  struct suscan_sample_buffer *this;
+
+  if (pool->free_count != pool->allocated)
+    SU_WARNING(
+        "%d sample buffers still in use, memory leak ahead\n",
+        pool->allocated - pool->free_count);
+
+  while ((this = pool->free_list) != NULL) {
+    pool->free_list = this->next;
+    suscan_sample_buffer_destroy(this);
+  }
+
+  pthread_mutex_destroy(&pool->mutex);
+
+  free(pool);
+}
+
+struct suscan_sample_buffer_pool *
+suscan_sample_buffer_pool_new(SUSCOUNT buffer_size, suscan_arena_t *arena)
+{
+  struct suscan_sample_buffer_pool *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_sample_buffer_pool)),
+      return NULL);
+
+  if (pthread_mutex_init(&new->mutex, NULL) == -1) {
+    free(new);
+    return NULL;
+  }
+
+  new->buffer_size = buffer_size;
+  new->arena = arena;
+
+  return new;
+}
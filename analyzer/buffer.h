@@ -0,0 +1,87 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _BUFFER_H
+#define _BUFFER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sigutils/sigutils.h>
+
+#include "arena.h"
+
+/*
+ * Reference-counted sample buffers. The source worker fills one buffer per
+ * read and publishes it to every consumer, which borrow it read-only.
+ * Once the last holder releases it, the buffer goes back to its pool.
+ * Data is always aligned to SUSCAN_ARENA_ALIGNMENT. If the pool has an
+ * arena, buffer data is taken from it and lives as long as the arena.
+ */
+struct suscan_sample_buffer_pool;
+
+struct suscan_sample_buffer {
+  struct suscan_sample_buffer_pool *pool;
+  struct suscan_sample_buffer *next; /* Next free buffer */
+  unsigned int refcnt;
+
+  SUCOMPLEX *data;
+  SUSCOUNT   size;  /* Valid samples */
+  SUSCOUNT   alloc; /* Allocated samples */
+  uint64_t   seq;   /* Stream position of the first element, if relevant */
+  unsigned int sweep_seq; /* Sweep step they were read at, if relevant */
+};
+
+struct suscan_sample_buffer_pool {
+  pthread_mutex_t mutex;
+  SUSCOUNT buffer_size;
+  suscan_arena_t *arena; /* May be NULL */
+
+  struct suscan_sample_buffer *free_list;
+  unsigned int free_count;
+  unsigned int allocated;
+};
+
+SUINLINE const SUCOMPLEX *
+suscan_sample_buffer_data(const struct suscan_sample_buffer *buffer)
+{
+  return buffer->data;
+}
+
+SUINLINE SUSCOUNT
+suscan_sample_buffer_size(const struct suscan_sample_buffer *buffer)
+{
+  return buffer->size;
+}
+
+void suscan_sample_buffer_ref(struct suscan_sample_buffer *buffer);
+
+void suscan_sample_buffer_unref(struct suscan_sample_buffer *buffer);
+
+struct suscan_sample_buffer *suscan_sample_buffer_pool_acquire(
+    struct suscan_sample_buffer_pool *pool);
+
+void suscan_sample_buffer_pool_destroy(struct suscan_sample_buffer_pool *pool);
+
+/* arena, if not NULL, must outlive the pool */
+struct suscan_sample_buffer_pool *suscan_sample_buffer_pool_new(
+    SUSCOUNT buffer_size,
+    suscan_arena_t *arena);
+
+#endif /* _BUFFER_H */
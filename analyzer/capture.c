@@ -0,0 +1,789 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <endian.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define SU_LOG_DOMAIN "capture"
+
+#include "capture.h"
+
+#define SUSCAN_CAPTURE_MAGIC         "SUSCAPTR"
+#define SUSCAN_CAPTURE_INDEX_MAGIC   "SUSCAPIX"
+#define SUSCAN_CAPTURE_FORMAT_CF32LE 1
+#define SUSCAN_CAPTURE_SAMPLE_SIZE   sizeof(float complex)
+
+/******************************* Encoding ************************************/
+SUPRIVATE void
+suscan_capture_put_u32(uint8_t *p, uint32_t val)
+{
+  val = htole32(val);
+  memcpy(p, &val, sizeof(uint32_t));
+}
+
+SUPRIVATE void
+suscan_capture_put_u64(uint8_t *p, uint64_t val)
+{
+  val = htole64(val);
+  memcpy(p, &val, sizeof(uint64_t));
+}
+
+SUPRIVATE void
+suscan_capture_put_float(uint8_t *p, SUFLOAT val)
+{
+  float f = val;
+  uint32_t u;
+
+  memcpy(&u, &f, sizeof(uint32_t));
+  suscan_capture_put_u32(p, u);
+}
+
+SUPRIVATE uint32_t
+suscan_capture_get_u32(const uint8_t *p)
+{
+  uint32_t val;
+
+  memcpy(&val, p, sizeof(uint32_t));
+  return le32toh(val);
+}
+
+SUPRIVATE uint64_t
+suscan_capture_get_u64(const uint8_t *p)
+{
+  uint64_t val;
+
+  memcpy(&val, p, sizeof(uint64_t));
+  return le64toh(val);
+}
+
+SUPRIVATE SUFLOAT
+suscan_capture_get_float(const uint8_t *p)
+{
+  uint32_t u = suscan_capture_get_u32(p);
+  float f;
+
+  memcpy(&f, &u, sizeof(float));
+  return f;
+}
+
+SUPRIVATE SUBOOL
+suscan_capture_write_all(int fd, const uint8_t *data, size_t size)
+{
+  ssize_t ret;
+
+  while (size > 0) {
+    if ((ret = write(fd, data, size)) < 0) {
+      if (errno == EINTR)
+        continue;
+
+      SU_ERROR("Capture write failed: %s\n", strerror(errno));
+      return SU_FALSE;
+    }
+
+    data += ret;
+    size -= ret;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_capture_read_all(int fd, uint8_t *data, size_t size, uint64_t offset)
+{
+  ssize_t ret;
+
+  while (size > 0) {
+    if ((ret = pread(fd, data, size, offset)) <= 0) {
+      if (ret < 0 && errno == EINTR)
+        continue;
+
+      return SU_FALSE;
+    }
+
+    data   += ret;
+    size   -= ret;
+    offset += ret;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_capture_level_append(
+    struct suscan_capture_level *level,
+    const SUFLOAT *line,
+    unsigned int size)
+{
+  SUFLOAT *tmp;
+  uint32_t alloc;
+
+  if (level->line_count == level->line_alloc) {
+    alloc = level->line_alloc == 0 ? 64 : 2 * level->line_alloc;
+
+    SU_TRYCATCH(
+        tmp = realloc(level->lines, alloc * size * sizeof(SUFLOAT)),
+        return SU_FALSE);
+
+    level->lines = tmp;
+    level->line_alloc = alloc;
+  }
+
+  memcpy(
+      level->lines + level->line_count * size,
+      line,
+      size * sizeof(SUFLOAT));
+  ++level->line_count;
+
+  return SU_TRUE;
+}
+
+/******************************** Writer *************************************/
+void
+suscan_capture_writer_destroy(suscan_capture_writer_t *writer)
+{
+  unsigned int i;
+
+  if (writer->plan != NULL)
+    SU_FFTW(_destroy_plan)(writer->plan);
+
+  if (writer->fft != NULL)
+    SU_FFTW(_free)(writer->fft);
+
+  if (writer->window != NULL)
+    free(writer->window);
+
+  if (writer->line != NULL)
+    free(writer->line);
+
+  if (writer->avg != NULL)
+    free(writer->avg);
+
+  for (i = 0; i < SUSCAN_CAPTURE_MAX_LEVELS; ++i)
+    if (writer->level[i].lines != NULL)
+      free(writer->level[i].lines);
+
+  for (i = 0; i < writer->keyframe_count; ++i)
+    free(writer->keyframe_list[i].spect);
+
+  if (writer->keyframe_list != NULL)
+    free(writer->keyframe_list);
+
+  free(writer);
+}
+
+suscan_capture_writer_t *
+suscan_capture_writer_new(uint64_t samp_rate, uint64_t fc)
+{
+  suscan_capture_writer_t *new = NULL;
+  struct timespec ts;
+  unsigned int size;
+  unsigned int i;
+
+  SU_TRYCATCH(samp_rate > 0, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_capture_writer_t)), goto fail);
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  size = SUSCAN_CAPTURE_PSD_SIZE;
+
+  new->info.samp_rate      = samp_rate;
+  new->info.fc             = fc;
+  new->info.start_time     = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  new->info.psd_size       = size;
+  new->info.line_samples   = SU_MAX(samp_rate / SUSCAN_CAPTURE_LINE_RATE, size);
+  new->info.keyframe_lines = SUSCAN_CAPTURE_KEYFRAME_LINES;
+
+  SU_TRYCATCH(new->window = malloc(size * sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->line = calloc(size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->avg = calloc(size, sizeof(SUFLOAT)), goto fail);
+
+  for (i = 0; i < size; ++i)
+    new->window[i] = .5 - .5 * cos(2 * M_PI * i / (size - 1));
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(size * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->plan = SU_FFTW(_plan_dft_1d)(
+          size,
+          (SU_FFTW(_complex) *) new->fft,
+          (SU_FFTW(_complex) *) new->fft,
+          FFTW_FORWARD,
+          FFTW_ESTIMATE),
+      goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_capture_writer_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_capture_writer_get_header(
+    const suscan_capture_writer_t *writer,
+    uint8_t *header)
+{
+  memset(header, 0, SUSCAN_CAPTURE_HEADER_SIZE);
+
+  memcpy(header, SUSCAN_CAPTURE_MAGIC, 8);
+  suscan_capture_put_u32(header +  8, SUSCAN_CAPTURE_VERSION);
+  suscan_capture_put_u32(header + 12, SUSCAN_CAPTURE_FORMAT_CF32LE);
+  suscan_capture_put_u64(header + 16, writer->info.samp_rate);
+  suscan_capture_put_u64(header + 24, writer->info.fc);
+  suscan_capture_put_u64(header + 32, writer->info.start_time);
+  suscan_capture_put_u32(header + 40, writer->info.psd_size);
+  suscan_capture_put_u32(header + 44, writer->info.line_samples);
+  suscan_capture_put_u32(header + 48, writer->info.keyframe_lines);
+}
+
+SUPRIVATE SUBOOL
+suscan_capture_writer_push_keyframe(suscan_capture_writer_t *writer)
+{
+  struct suscan_capture_keyframe *tmp;
+  struct suscan_capture_keyframe *kf;
+  unsigned int size = writer->info.psd_size;
+  unsigned int alloc;
+  unsigned int i;
+
+  if (writer->keyframe_count == writer->keyframe_alloc) {
+    alloc = writer->keyframe_alloc == 0 ? 16 : 2 * writer->keyframe_alloc;
+
+    SU_TRYCATCH(
+        tmp = realloc(
+            writer->keyframe_list,
+            alloc * sizeof(struct suscan_capture_keyframe)),
+        return SU_FALSE);
+
+    writer->keyframe_list = tmp;
+    writer->keyframe_alloc = alloc;
+  }
+
+  kf = writer->keyframe_list + writer->keyframe_count;
+
+  SU_TRYCATCH(kf->spect = malloc(size * sizeof(SUFLOAT)), return SU_FALSE);
+  memcpy(kf->spect, writer->avg, size * sizeof(SUFLOAT));
+
+  kf->sample = writer->sample_count;
+  kf->N0 = kf->spect[0];
+  for (i = 1; i < size; ++i)
+    if (kf->spect[i] < kf->N0)
+      kf->N0 = kf->spect[i];
+
+  ++writer->keyframe_count;
+
+  return SU_TRUE;
+}
+
+/* Finishes a level 0 line and propagates it up the pyramid */
+SUPRIVATE SUBOOL
+suscan_capture_writer_push_line(suscan_capture_writer_t *writer)
+{
+  struct suscan_capture_level *level;
+  unsigned int size = writer->info.psd_size;
+  const SUFLOAT *prev;
+  SUFLOAT k;
+  unsigned int i, j;
+
+  k = 1. / (writer->line_ffts * size);
+  for (i = 0; i < size; ++i)
+    writer->line[i] *= k;
+
+  if (!writer->avg_init) {
+    memcpy(writer->avg, writer->line, size * sizeof(SUFLOAT));
+    writer->avg_init = SU_TRUE;
+  } else {
+    for (i = 0; i < size; ++i)
+      writer->avg[i] +=
+          SUSCAN_CAPTURE_KEYFRAME_ALPHA * (writer->line[i] - writer->avg[i]);
+  }
+
+  for (j = 0; j < SUSCAN_CAPTURE_MAX_LEVELS; ++j) {
+    level = writer->level + j;
+
+    SU_TRYCATCH(
+        suscan_capture_level_append(level, writer->line, size),
+        return SU_FALSE);
+
+    if (j >= writer->level_count)
+      writer->level_count = j + 1;
+
+    if (level->line_count & 1)
+      break;
+
+    /* Two new lines here: their average goes one level up */
+    prev = level->lines + (level->line_count - 2) * size;
+    for (i = 0; i < size; ++i)
+      writer->line[i] = .5 * (prev[i] + prev[i + size]);
+  }
+
+  if (writer->level[0].line_count % writer->info.keyframe_lines == 0)
+    SU_TRYCATCH(suscan_capture_writer_push_keyframe(writer), return SU_FALSE);
+
+  memset(writer->line, 0, size * sizeof(SUFLOAT));
+  writer->line_ffts = 0;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_capture_writer_feed(
+    suscan_capture_writer_t *writer,
+    const float complex *data,
+    SUSCOUNT count)
+{
+  unsigned int size = writer->info.psd_size;
+  SUSCOUNT chunk;
+  SUSCOUNT i;
+
+  while (count > 0) {
+    chunk = SU_MIN(size - writer->fft_fill, count);
+    chunk = SU_MIN(writer->info.line_samples - writer->line_fill, chunk);
+
+    for (i = 0; i < chunk; ++i)
+      writer->fft[writer->fft_fill + i] =
+          data[i] * writer->window[writer->fft_fill + i];
+
+    writer->fft_fill  += chunk;
+    writer->line_fill += chunk;
+    writer->sample_count += chunk;
+    data  += chunk;
+    count -= chunk;
+
+    if (writer->fft_fill == size) {
+      SU_FFTW(_execute)(writer->plan);
+
+      for (i = 0; i < size; ++i)
+        writer->line[i] +=
+            SU_C_REAL(writer->fft[i] * SU_C_CONJ(writer->fft[i]));
+
+      ++writer->line_ffts;
+      writer->fft_fill = 0;
+    }
+
+    if (writer->line_fill == writer->info.line_samples) {
+      SU_TRYCATCH(suscan_capture_writer_push_line(writer), return SU_FALSE);
+      writer->line_fill = 0;
+    }
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_capture_writer_finish(suscan_capture_writer_t *writer, int fd)
+{
+  unsigned int size = writer->info.psd_size;
+  uint8_t trailer[SUSCAN_CAPTURE_TRAILER_SIZE];
+  const struct suscan_capture_keyframe *kf;
+  const struct suscan_capture_level *level;
+  uint8_t *buf = NULL;
+  uint8_t *p;
+  size_t alloc;
+  off_t offset;
+  unsigned int i, j;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH((offset = lseek(fd, 0, SEEK_END)) != -1, goto done);
+
+  /* One buffer, large enough for the biggest section */
+  alloc = SU_MAX(
+      8 + 4 + 4 * size,
+      4 + 4 * size * (size_t) writer->level[0].line_count);
+  SU_TRYCATCH(buf = malloc(alloc), goto done);
+
+  for (i = 0; i < writer->keyframe_count; ++i) {
+    kf = writer->keyframe_list + i;
+
+    suscan_capture_put_u64(buf, kf->sample);
+    suscan_capture_put_float(buf + 8, kf->N0);
+    for (j = 0, p = buf + 12; j < size; ++j, p += 4)
+      suscan_capture_put_float(p, kf->spect[j]);
+
+    SU_TRYCATCH(suscan_capture_write_all(fd, buf, p - buf), goto done);
+  }
+
+  for (i = 0; i < writer->level_count; ++i) {
+    level = writer->level + i;
+
+    suscan_capture_put_u32(buf, level->line_count);
+    for (j = 0, p = buf + 4; j < level->line_count * size; ++j, p += 4)
+      suscan_capture_put_float(p, level->lines[j]);
+
+    SU_TRYCATCH(suscan_capture_write_all(fd, buf, p - buf), goto done);
+  }
+
+  memset(trailer, 0, sizeof(trailer));
+  memcpy(trailer, SUSCAN_CAPTURE_INDEX_MAGIC, 8);
+  suscan_capture_put_u64(trailer +  8, writer->sample_count);
+  suscan_capture_put_u64(trailer + 16, offset);
+  suscan_capture_put_u32(trailer + 24, writer->keyframe_count);
+  suscan_capture_put_u32(trailer + 28, writer->level_count);
+
+  SU_TRYCATCH(
+      suscan_capture_write_all(fd, trailer, sizeof(trailer)),
+      goto done);
+
+  ok = SU_TRUE;
+
+done:
+  if (buf != NULL)
+    free(buf);
+
+  return ok;
+}
+
+/******************************** Reader *************************************/
+void
+suscan_capture_close(suscan_capture_t *capture)
+{
+  unsigned int i;
+
+  if (capture->fd != -1)
+    close(capture->fd);
+
+  for (i = 0; i < SUSCAN_CAPTURE_MAX_LEVELS; ++i)
+    if (capture->level[i].lines != NULL)
+      free(capture->level[i].lines);
+
+  for (i = 0; i < capture->keyframe_count; ++i)
+    if (capture->keyframe_list[i].spect != NULL)
+      free(capture->keyframe_list[i].spect);
+
+  if (capture->keyframe_list != NULL)
+    free(capture->keyframe_list);
+
+  if (capture->buffer != NULL)
+    free(capture->buffer);
+
+  free(capture);
+}
+
+/*
+ * Keyframes are loaded right away. Levels are only located: their lines
+ * are read the first time they are asked for.
+ */
+SUPRIVATE SUBOOL
+suscan_capture_load_index(suscan_capture_t *capture, uint64_t file_size)
+{
+  unsigned int size = capture->info.psd_size;
+  uint8_t trailer[SUSCAN_CAPTURE_TRAILER_SIZE];
+  struct suscan_capture_keyframe *kf;
+  uint8_t *buf = NULL;
+  uint64_t offset;
+  uint64_t index_offset;
+  uint64_t sample_count;
+  size_t kf_size = 12 + 4 * size;
+  unsigned int keyframe_count;
+  unsigned int level_count;
+  unsigned int i, j;
+  SUBOOL ok = SU_FALSE;
+
+  if (file_size < SUSCAN_CAPTURE_HEADER_SIZE + SUSCAN_CAPTURE_TRAILER_SIZE)
+    return SU_FALSE;
+
+  if (!suscan_capture_read_all(
+      capture->fd,
+      trailer,
+      sizeof(trailer),
+      file_size - SUSCAN_CAPTURE_TRAILER_SIZE)
+      || memcmp(trailer, SUSCAN_CAPTURE_INDEX_MAGIC, 8) != 0)
+    return SU_FALSE;
+
+  sample_count   = suscan_capture_get_u64(trailer + 8);
+  index_offset   = suscan_capture_get_u64(trailer + 16);
+  keyframe_count = suscan_capture_get_u32(trailer + 24);
+  level_count    = suscan_capture_get_u32(trailer + 28);
+
+  if (level_count > SUSCAN_CAPTURE_MAX_LEVELS
+      || index_offset != SUSCAN_CAPTURE_HEADER_SIZE
+          + sample_count * SUSCAN_CAPTURE_SAMPLE_SIZE)
+    goto done;
+
+  SU_TRYCATCH(buf = malloc(kf_size), goto done);
+
+  if (keyframe_count > 0)
+    SU_TRYCATCH(
+        capture->keyframe_list = calloc(
+            keyframe_count,
+            sizeof(struct suscan_capture_keyframe)),
+        goto done);
+
+  offset = index_offset;
+  for (i = 0; i < keyframe_count; ++i, offset += kf_size) {
+    kf = capture->keyframe_list + i;
+
+    if (!suscan_capture_read_all(capture->fd, buf, kf_size, offset))
+      goto done;
+
+    SU_TRYCATCH(kf->spect = malloc(size * sizeof(SUFLOAT)), goto done);
+    ++capture->keyframe_count;
+
+    kf->sample = suscan_capture_get_u64(buf);
+    kf->N0     = suscan_capture_get_float(buf + 8);
+    for (j = 0; j < size; ++j)
+      kf->spect[j] = suscan_capture_get_float(buf + 12 + 4 * j);
+  }
+
+  for (i = 0; i < level_count; ++i) {
+    if (!suscan_capture_read_all(capture->fd, buf, 4, offset))
+      goto done;
+
+    capture->level[i].line_count = suscan_capture_get_u32(buf);
+    capture->level[i].offset = offset + 4;
+    offset += 4 + 4 * size * (uint64_t) capture->level[i].line_count;
+  }
+
+  if (offset + SUSCAN_CAPTURE_TRAILER_SIZE != file_size)
+    goto done;
+
+  capture->level_count  = level_count;
+  capture->sample_count = sample_count;
+
+  ok = SU_TRUE;
+
+done:
+  if (!ok) {
+    for (i = 0; i < capture->keyframe_count; ++i)
+      free(capture->keyframe_list[i].spect);
+
+    if (capture->keyframe_list != NULL)
+      free(capture->keyframe_list);
+
+    capture->keyframe_list = NULL;
+    capture->keyframe_count = 0;
+    memset(capture->level, 0, sizeof(capture->level));
+  }
+
+  if (buf != NULL)
+    free(buf);
+
+  return ok;
+}
+
+suscan_capture_t *
+suscan_capture_open(const char *path)
+{
+  suscan_capture_t *new = NULL;
+  uint8_t header[SUSCAN_CAPTURE_HEADER_SIZE];
+  struct stat sbuf;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_capture_t)), goto fail);
+
+  if ((new->fd = open(path, O_RDONLY)) == -1) {
+    SU_ERROR("Cannot open %s: %s\n", path, strerror(errno));
+    goto fail;
+  }
+
+  SU_TRYCATCH(fstat(new->fd, &sbuf) == 0, goto fail);
+
+  if (!suscan_capture_read_all(new->fd, header, sizeof(header), 0)
+      || memcmp(header, SUSCAN_CAPTURE_MAGIC, 8) != 0) {
+    SU_ERROR("%s: not a capture file\n", path);
+    goto fail;
+  }
+
+  if (suscan_capture_get_u32(header + 8) != SUSCAN_CAPTURE_VERSION
+      || suscan_capture_get_u32(header + 12) != SUSCAN_CAPTURE_FORMAT_CF32LE) {
+    SU_ERROR("%s: unsupported capture version or format\n", path);
+    goto fail;
+  }
+
+  new->info.samp_rate      = suscan_capture_get_u64(header + 16);
+  new->info.fc             = suscan_capture_get_u64(header + 24);
+  new->info.start_time     = suscan_capture_get_u64(header + 32);
+  new->info.psd_size       = suscan_capture_get_u32(header + 40);
+  new->info.line_samples   = suscan_capture_get_u32(header + 44);
+  new->info.keyframe_lines = suscan_capture_get_u32(header + 48);
+
+  if (new->info.samp_rate == 0 || new->info.psd_size == 0) {
+    SU_ERROR("%s: corrupted capture header\n", path);
+    goto fail;
+  }
+
+  new->indexed = suscan_capture_load_index(new, sbuf.st_size);
+
+  if (!new->indexed) {
+    SU_WARNING("%s: capture has no index, overview unavailable\n", path);
+    new->sample_count = (sbuf.st_size - SUSCAN_CAPTURE_HEADER_SIZE)
+        / SUSCAN_CAPTURE_SAMPLE_SIZE;
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_capture_close(new);
+
+  return NULL;
+}
+
+SUSDIFF
+suscan_capture_read(
+    suscan_capture_t *capture,
+    SUCOMPLEX *data,
+    SUSCOUNT count)
+{
+  float complex *tmp;
+  SUSCOUNT i;
+
+  if (count > capture->sample_count - capture->pos)
+    count = capture->sample_count - capture->pos;
+
+  if (count == 0)
+    return 0;
+
+  if (count > capture->buffer_size) {
+    SU_TRYCATCH(
+        tmp = realloc(capture->buffer, count * SUSCAN_CAPTURE_SAMPLE_SIZE),
+        return -1);
+
+    capture->buffer = tmp;
+    capture->buffer_size = count;
+  }
+
+  if (!suscan_capture_read_all(
+      capture->fd,
+      (uint8_t *) capture->buffer,
+      count * SUSCAN_CAPTURE_SAMPLE_SIZE,
+      SUSCAN_CAPTURE_HEADER_SIZE
+          + capture->pos * SUSCAN_CAPTURE_SAMPLE_SIZE)) {
+    SU_ERROR("Capture read failed: %s\n", strerror(errno));
+    return -1;
+  }
+
+  for (i = 0; i < count; ++i)
+    data[i] = capture->buffer[i];
+
+  capture->pos += count;
+
+  return count;
+}
+
+SUBOOL
+suscan_capture_seek(suscan_capture_t *capture, uint64_t sample)
+{
+  if (sample > capture->sample_count)
+    return SU_FALSE;
+
+  capture->pos = sample;
+
+  return SU_TRUE;
+}
+
+uint64_t
+suscan_capture_time_to_sample(const suscan_capture_t *capture, uint64_t time)
+{
+  long double elapsed;
+
+  if (time <= capture->info.start_time)
+    return 0;
+
+  elapsed = (time - capture->info.start_time) * 1e-9l;
+
+  return SU_MIN(
+      (uint64_t) (elapsed * capture->info.samp_rate),
+      capture->sample_count);
+}
+
+const struct suscan_capture_keyframe *
+suscan_capture_find_keyframe(const suscan_capture_t *capture, uint64_t sample)
+{
+  unsigned int lo = 0;
+  unsigned int hi = capture->keyframe_count;
+  unsigned int mid;
+
+  /* First keyframe after sample */
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (capture->keyframe_list[mid].sample <= sample)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo == 0 ? NULL : capture->keyframe_list + lo - 1;
+}
+
+const struct suscan_capture_level *
+suscan_capture_get_overview(suscan_capture_t *capture, unsigned int max_lines)
+{
+  struct suscan_capture_level *level;
+  unsigned int size = capture->info.psd_size;
+  uint8_t *buf = NULL;
+  size_t len;
+  unsigned int i;
+
+  if (capture->level_count == 0)
+    return NULL;
+
+  /* Top level is the coarsest, even if it still is too long */
+  for (i = 0; i < capture->level_count - 1; ++i)
+    if (capture->level[i].line_count <= max_lines)
+      break;
+
+  level = capture->level + i;
+
+  if (level->lines == NULL && level->line_count > 0) {
+    len = 4 * size * (size_t) level->line_count;
+
+    SU_TRYCATCH(buf = malloc(len), goto fail);
+    SU_TRYCATCH(
+        level->lines = malloc(len / 4 * sizeof(SUFLOAT)),
+        goto fail);
+
+    if (!suscan_capture_read_all(capture->fd, buf, len, level->offset)) {
+      SU_ERROR("Cannot read capture overview: %s\n", strerror(errno));
+      goto fail;
+    }
+
+    for (i = 0; i < len / 4; ++i)
+      level->lines[i] = suscan_capture_get_float(buf + 4 * i);
+
+    level->line_alloc = level->line_count;
+
+    free(buf);
+  }
+
+  return level;
+
+fail:
+  if (buf != NULL)
+    free(buf);
+
+  if (level->lines != NULL) {
+    free(level->lines);
+    level->lines = NULL;
+  }
+
+  return NULL;
+}
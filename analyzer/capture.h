@@ -0,0 +1,180 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdint.h>
+#include <complex.h>
+#include <fftw3.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Indexed capture container. Layout:
+ *
+ *   header   SUSCAN_CAPTURE_HEADER_SIZE bytes, capture parameters
+ *   samples  raw complex float32, little endian
+ *   index    keyframes and PSD pyramid, appended when recording ends
+ *   trailer  SUSCAN_CAPTURE_TRAILER_SIZE bytes, locates the index
+ *
+ * Level 0 of the pyramid holds one averaged PSD line per line_samples
+ * samples. Every level above halves the resolution of the one below, so
+ * the full duration can be drawn from whichever level fits the screen.
+ * Keyframes store the running spectral average and noise floor every
+ * keyframe_lines lines, so a detector can be warmed up after a seek.
+ *
+ * A capture whose recording was interrupted has no trailer. It can still
+ * be read, just without overview nor keyframes.
+ */
+#define SUSCAN_CAPTURE_HEADER_SIZE     4096 /* Keeps samples O_DIRECT-aligned */
+#define SUSCAN_CAPTURE_TRAILER_SIZE    64
+#define SUSCAN_CAPTURE_VERSION         1
+#define SUSCAN_CAPTURE_PSD_SIZE        256  /* Bins per PSD line */
+#define SUSCAN_CAPTURE_LINE_RATE       10   /* Level 0 lines per second */
+#define SUSCAN_CAPTURE_KEYFRAME_LINES  10   /* Level 0 lines per keyframe */
+#define SUSCAN_CAPTURE_KEYFRAME_ALPHA  .1   /* Spectral average, per line */
+#define SUSCAN_CAPTURE_MAX_LEVELS      24
+
+struct suscan_capture_info {
+  uint64_t samp_rate;
+  uint64_t fc;
+  uint64_t start_time;     /* Wall clock at the first sample (ns) */
+  uint32_t psd_size;
+  uint32_t line_samples;
+  uint32_t keyframe_lines;
+};
+
+/* PSD lines of one pyramid level, psd_size bins each, in FFT order */
+struct suscan_capture_level {
+  SUFLOAT *lines;
+  uint32_t line_count;
+  uint32_t line_alloc;
+  uint64_t offset;         /* Reader only: position in file */
+};
+
+struct suscan_capture_keyframe {
+  uint64_t sample;         /* First sample after the keyframe */
+  SUFLOAT  N0;             /* Noise floor estimate */
+  SUFLOAT *spect;          /* Running spectral average, psd_size bins */
+};
+
+/******************************** Writer *************************************/
+/*
+ * Builds the index while recording. It only sees sample data, the file
+ * itself is written by the recorder.
+ */
+struct suscan_capture_writer {
+  struct suscan_capture_info info;
+
+  SUCOMPLEX *fft;          /* FFTW-allocated, in-place */
+  SU_FFTW(_plan) plan;
+  SUFLOAT  *window;        /* Hann window */
+  unsigned int fft_fill;
+
+  SUFLOAT  *line;          /* Power accumulated for the current line */
+  unsigned int line_ffts;
+  SUSCOUNT  line_fill;     /* Samples into the current line */
+
+  SUFLOAT  *avg;           /* Running average for keyframes */
+  SUBOOL    avg_init;
+
+  uint64_t  sample_count;
+
+  struct suscan_capture_level level[SUSCAN_CAPTURE_MAX_LEVELS];
+  unsigned int level_count;
+
+  struct suscan_capture_keyframe *keyframe_list;
+  unsigned int keyframe_count;
+  unsigned int keyframe_alloc;
+};
+
+typedef struct suscan_capture_writer suscan_capture_writer_t;
+
+suscan_capture_writer_t *suscan_capture_writer_new(
+    uint64_t samp_rate,
+    uint64_t fc);
+
+/* Header to be stored at the beginning of the file */
+void suscan_capture_writer_get_header(
+    const suscan_capture_writer_t *writer,
+    uint8_t *header);
+
+/* Samples as they are laid out in the file */
+SUBOOL suscan_capture_writer_feed(
+    suscan_capture_writer_t *writer,
+    const float complex *data,
+    SUSCOUNT count);
+
+/* Appends index and trailer at the end of fd */
+SUBOOL suscan_capture_writer_finish(suscan_capture_writer_t *writer, int fd);
+
+void suscan_capture_writer_destroy(suscan_capture_writer_t *writer);
+
+/******************************** Reader *************************************/
+struct suscan_capture {
+  int fd;
+  struct suscan_capture_info info;
+  uint64_t sample_count;
+  uint64_t pos;            /* Next sample to read */
+  SUBOOL   indexed;
+
+  struct suscan_capture_level level[SUSCAN_CAPTURE_MAX_LEVELS];
+  unsigned int level_count;
+
+  struct suscan_capture_keyframe *keyframe_list;
+  unsigned int keyframe_count;
+
+  float complex *buffer;   /* Samples as read from file */
+  SUSCOUNT buffer_size;
+};
+
+typedef struct suscan_capture suscan_capture_t;
+
+suscan_capture_t *suscan_capture_open(const char *path);
+
+void suscan_capture_close(suscan_capture_t *capture);
+
+/* Returns 0 at the end of the capture, -1 on error */
+SUSDIFF suscan_capture_read(
+    suscan_capture_t *capture,
+    SUCOMPLEX *data,
+    SUSCOUNT count);
+
+SUBOOL suscan_capture_seek(suscan_capture_t *capture, uint64_t sample);
+
+/* Converts a wall clock time (ns) to a sample offset */
+uint64_t suscan_capture_time_to_sample(
+    const suscan_capture_t *capture,
+    uint64_t time);
+
+/* Last keyframe before sample, NULL if none */
+const struct suscan_capture_keyframe *suscan_capture_find_keyframe(
+    const suscan_capture_t *capture,
+    uint64_t sample);
+
+/*
+ * Finest pyramid level with at most max_lines lines, loaded on first use.
+ * NULL if the capture has no index.
+ */
+const struct suscan_capture_level *suscan_capture_get_overview(
+    suscan_capture_t *capture,
+    unsigned int max_lines);
+
+#endif /* _CAPTURE_H */
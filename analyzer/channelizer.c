@@ -0,0 +1,371 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SU_LOG_DOMAIN "channelizer"
+
+#include "channelizer.h"
+
+/******************************* Channelizer *********************************/
+/*
+ * Called by the source worker for every buffer it reads. Frames are
+ * computed only while there are channels to consume them, but the
+ * input window and the frame counter always advance, so channels can
+ * join at any time.
+ */
+SUBOOL
+suscan_channelizer_feed(
+    suscan_channelizer_t *chz,
+    const SUCOMPLEX *data,
+    SUSCOUNT len,
+    struct suscan_sample_buffer **frames)
+{
+  struct suscan_sample_buffer *buffer = NULL;
+  SUBOOL active;
+  SUSCOUNT chunk;
+
+  active = __atomic_load_n(&chz->users, __ATOMIC_ACQUIRE) > 0;
+
+  while (len > 0) {
+    chunk = SU_MIN(len, chz->size - chz->fill);
+
+    memcpy(chz->window + chz->fill, data, chunk * sizeof(SUCOMPLEX));
+    chz->fill += chunk;
+    data      += chunk;
+    len       -= chunk;
+
+    if (chz->fill == chz->size) {
+      if (active) {
+        if (buffer == NULL) {
+          SU_TRYCATCH(
+              buffer = suscan_sample_buffer_pool_acquire(chz->frame_pool),
+              goto fail);
+          buffer->size = 0;
+          buffer->seq  = chz->seq;
+        }
+
+        /* Reads longer than announced would not fit */
+        SU_TRYCATCH(buffer->size + chz->size <= buffer->alloc, goto fail);
+
+        memcpy(chz->fft, chz->window, chz->size * sizeof(SUCOMPLEX));
+        SU_FFTW(_execute)(chz->plan);
+        memcpy(
+            buffer->data + buffer->size,
+            chz->fft,
+            chz->size * sizeof(SUCOMPLEX));
+
+        buffer->size += chz->size;
+      }
+
+      /* Overlap-save: keep the last half for the next frame */
+      memmove(
+          chz->window,
+          chz->window + chz->hop,
+          (chz->size - chz->hop) * sizeof(SUCOMPLEX));
+      chz->fill = chz->size - chz->hop;
+      ++chz->seq;
+    }
+  }
+
+  *frames = buffer;
+
+  return SU_TRUE;
+
+fail:
+  if (buffer != NULL)
+    suscan_sample_buffer_unref(buffer);
+
+  *frames = NULL;
+
+  return SU_FALSE;
+}
+
+void
+suscan_channelizer_destroy(suscan_channelizer_t *chz)
+{
+  if (chz->users > 0)
+    SU_WARNING("Channelizer destroyed with %d channels alive\n", chz->users);
+
+  if (chz->frame_pool != NULL)
+    suscan_sample_buffer_pool_destroy(chz->frame_pool);
+
+  if (chz->plan != NULL)
+    SU_FFTW(_destroy_plan)(chz->plan);
+
+  if (chz->fft != NULL)
+    SU_FFTW(_free)(chz->fft);
+
+  if (chz->window != NULL)
+    free(chz->window);
+
+  free(chz);
+}
+
+/*
+ * max_read: largest buffer that will ever be passed to feed. Frames are
+ * taken from arena, if not NULL.
+ */
+suscan_channelizer_t *
+suscan_channelizer_new(SUSCOUNT fs, SUSCOUNT max_read, suscan_arena_t *arena)
+{
+  suscan_channelizer_t *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_channelizer_t)), goto fail);
+
+  new->fs   = fs;
+  new->size = SUSCAN_CHANNELIZER_FFT_SIZE;
+  new->hop  = new->size / 2;
+
+  /* First frame is zero-padded */
+  new->fill = new->size - new->hop;
+
+  SU_TRYCATCH(
+      new->window = calloc(new->size, sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(new->size * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->plan = SU_FFTW(_plan_dft_1d)(
+          new->size,
+          (SU_FFTW(_complex) *) new->fft,
+          (SU_FFTW(_complex) *) new->fft,
+          FFTW_FORWARD,
+          FFTW_ESTIMATE),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->frame_pool = suscan_sample_buffer_pool_new(
+          new->size * (max_read / new->hop + 1),
+          arena),
+      goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_channelizer_destroy(new);
+
+  return NULL;
+}
+
+/********************************* Channels **********************************/
+/*
+ * Largest power-of-two decimation that keeps the whole channel inside
+ * the sub-band with some room for the taper. 1 means the channel is too
+ * wide to be worth channelizing.
+ */
+SUSCOUNT
+suscan_channelizer_get_decimation(
+    const suscan_channelizer_t *chz,
+    const struct sigutils_channel *channel)
+{
+  SUFLOAT width;
+  SUSCOUNT decimation = 1;
+
+  width = SU_MAX(channel->f_hi - channel->f_lo, channel->bw);
+
+  if (width <= 0)
+    return 1;
+
+  while (2 * decimation
+      <= chz->size / SUSCAN_CHANNELIZER_MIN_CHANNEL_FFT
+      && chz->fs / (SUFLOAT) (2 * decimation)
+      >= SUSCAN_CHANNELIZER_OVERSAMPLING * width)
+    decimation <<= 1;
+
+  return decimation;
+}
+
+/*
+ * Brings the sub-band of every frame back to the time domain. The output
+ * storage belongs to the channel, and is valid until the next call.
+ */
+SUBOOL
+suscan_channelizer_channel_extract(
+    suscan_channelizer_channel_t *chan,
+    const struct suscan_sample_buffer *frames,
+    const SUCOMPLEX **data,
+    SUSCOUNT *size)
+{
+  const suscan_channelizer_t *chz = chan->owner;
+  const SUCOMPLEX *bins;
+  SUCOMPLEX *tmp;
+  SUCOMPLEX rot;
+  SUSCOUNT frame_count, keep, first, needed, alloc;
+  SUSCOUNT i, j, n = 0;
+  uint64_t phase;
+
+  frame_count = suscan_sample_buffer_size(frames) / chz->size;
+  keep  = chan->size / 2;
+  first = chan->size / 4; /* Taper is zero-phase: skip both ends */
+
+  if ((needed = frame_count * keep) > chan->output_alloc) {
+    alloc = chan->output_alloc > 0 ? chan->output_alloc : keep;
+    while (alloc < needed)
+      alloc <<= 1;
+
+    SU_TRYCATCH(
+        tmp = realloc(chan->output, alloc * sizeof(SUCOMPLEX)),
+        return SU_FALSE);
+
+    chan->output = tmp;
+    chan->output_alloc = alloc;
+  }
+
+  for (i = 0; i < frame_count; ++i) {
+    bins = suscan_sample_buffer_data(frames) + i * chz->size;
+
+    for (j = 0; j < chan->size; ++j)
+      chan->fft[j] = chan->mask[j] * bins[chan->bin_index[j]];
+
+    SU_FFTW(_execute)(chan->plan);
+
+    /*
+     * Frames start at multiples of the hop, and each one is shifted by
+     * the center bin relative to its own start. Undo the phase jump.
+     */
+    phase = (((frames->seq + i) * chz->hop) % chz->size)
+        * chan->bin_index[0] % chz->size;
+    rot = SU_C_EXP(-2 * I * M_PI * (SUFLOAT) phase / chz->size);
+
+    for (j = 0; j < keep; ++j)
+      chan->output[n++] = rot * chan->fft[first + j];
+  }
+
+  *data = chan->output;
+  *size = n;
+
+  return SU_TRUE;
+}
+
+void
+suscan_channelizer_channel_destroy(suscan_channelizer_channel_t *chan)
+{
+  if (chan->owner != NULL)
+    __atomic_sub_fetch(&chan->owner->users, 1, __ATOMIC_RELEASE);
+
+  if (chan->plan != NULL)
+    SU_FFTW(_destroy_plan)(chan->plan);
+
+  if (chan->fft != NULL)
+    SU_FFTW(_free)(chan->fft);
+
+  if (chan->output != NULL)
+    free(chan->output);
+
+  if (chan->mask != NULL)
+    free(chan->mask);
+
+  if (chan->bin_index != NULL)
+    free(chan->bin_index);
+
+  free(chan);
+}
+
+/*
+ * The channel is centered at the nearest bin. sub_channel receives the
+ * same channel as seen from the sub-band, with the residual offset (at
+ * most half a bin) left to the inspector.
+ */
+suscan_channelizer_channel_t *
+suscan_channelizer_channel_new(
+    suscan_channelizer_t *chz,
+    const struct sigutils_channel *channel,
+    struct sigutils_channel *sub_channel)
+{
+  suscan_channelizer_channel_t *new = NULL;
+  SUFLOAT shift;
+  SUFLOAT pass, t;
+  int64_t offset;
+  SUSCOUNT j;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(suscan_channelizer_channel_t)),
+      goto fail);
+
+  new->decimation = suscan_channelizer_get_decimation(chz, channel);
+  new->size   = chz->size / new->decimation;
+  new->center = (int64_t) SU_FLOOR(channel->fc * chz->size / chz->fs + .5);
+
+  SU_TRYCATCH(
+      new->bin_index = malloc(new->size * sizeof(unsigned int)),
+      goto fail);
+
+  SU_TRYCATCH(new->mask = malloc(new->size * sizeof(SUFLOAT)), goto fail);
+
+  /* Flat in the middle 3/4, raised cosine down to the sub-band edges */
+  pass = .375 * new->size;
+
+  for (j = 0; j < new->size; ++j) {
+    offset = j < new->size / 2 ? (int64_t) j : (int64_t) j - new->size;
+
+    new->bin_index[j] =
+        ((new->center + offset) % (int64_t) chz->size + chz->size)
+        % chz->size;
+
+    if (SU_ABS(offset) <= pass) {
+      new->mask[j] = 1;
+    } else {
+      t = (SU_ABS(offset) - pass) / (.5 * new->size - pass);
+      new->mask[j] = .5 * (1 + cos(M_PI * t));
+    }
+
+    /* Forward FFT is not normalized */
+    new->mask[j] /= chz->size;
+  }
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(new->size * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->plan = SU_FFTW(_plan_dft_1d)(
+          new->size,
+          (SU_FFTW(_complex) *) new->fft,
+          (SU_FFTW(_complex) *) new->fft,
+          FFTW_BACKWARD,
+          FFTW_ESTIMATE),
+      goto fail);
+
+  shift = (SUFLOAT) new->center * chz->fs / chz->size;
+
+  *sub_channel = *channel;
+  sub_channel->fc   -= shift;
+  sub_channel->f_lo -= shift;
+  sub_channel->f_hi -= shift;
+
+  /* From now on, the source worker computes frames for us */
+  new->owner = chz;
+  __atomic_add_fetch(&chz->users, 1, __ATOMIC_RELEASE);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_channelizer_channel_destroy(new);
+
+  return NULL;
+}
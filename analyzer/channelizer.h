@@ -0,0 +1,124 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CHANNELIZER_H
+#define _CHANNELIZER_H
+
+#include <stdint.h>
+#include <fftw3.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+#include "buffer.h"
+
+/*
+ * Shared channelizer. The source band is split once with an overlap-save
+ * FFT filter bank: the source worker computes one forward FFT per hop and
+ * publishes the spectrum frames to every channelized inspector. Each
+ * inspector then takes the bins around its channel and brings them back
+ * to the time domain with a short inverse FFT, which yields its sub-band
+ * already shifted and decimated. Per-inspector cost is therefore
+ * proportional to its output rate, not to the source rate.
+ */
+
+#define SUSCAN_CHANNELIZER_FFT_SIZE       8192 /* Bins per frame */
+#define SUSCAN_CHANNELIZER_MIN_CHANNEL_FFT 64  /* Smallest inverse FFT */
+#define SUSCAN_CHANNELIZER_OVERSAMPLING   2    /* Sub-band rate / ch. width */
+
+struct suscan_channelizer {
+  SUSCOUNT fs;         /* Source sample rate */
+  SUSCOUNT size;       /* Forward FFT size */
+  SUSCOUNT hop;        /* New samples per frame (half the FFT) */
+
+  SUCOMPLEX *window;   /* Last size input samples */
+  SUSCOUNT   fill;
+  uint64_t   seq;      /* Frames computed (or skipped) so far */
+
+  SUCOMPLEX *fft;      /* FFTW-allocated, in-place */
+  SU_FFTW(_plan) plan;
+
+  struct suscan_sample_buffer_pool *frame_pool;
+
+  unsigned int users;  /* Channels alive. Frames are skipped if none */
+};
+
+typedef struct suscan_channelizer suscan_channelizer_t;
+
+/*
+ * One sub-band. Only touched by the consumer that is processing its
+ * inspector, except for construction and destruction.
+ */
+struct suscan_channelizer_channel {
+  suscan_channelizer_t *owner;
+  SUSCOUNT decimation;
+  SUSCOUNT size;         /* Inverse FFT size: owner->size / decimation */
+  int64_t  center;       /* Center bin in the source spectrum */
+
+  unsigned int *bin_index; /* Source bin for each channel bin */
+  SUFLOAT   *mask;       /* Spectral taper, normalization included */
+
+  SUCOMPLEX *fft;        /* FFTW-allocated, in-place */
+  SU_FFTW(_plan) plan;
+
+  SUCOMPLEX *output;     /* Decimated samples of the last extraction */
+  SUSCOUNT   output_alloc;
+};
+
+typedef struct suscan_channelizer_channel suscan_channelizer_channel_t;
+
+/* Source worker side */
+SUBOOL suscan_channelizer_feed(
+    suscan_channelizer_t *chz,
+    const SUCOMPLEX *data,
+    SUSCOUNT len,
+    struct suscan_sample_buffer **frames);
+
+void suscan_channelizer_destroy(suscan_channelizer_t *chz);
+
+suscan_channelizer_t *suscan_channelizer_new(
+    SUSCOUNT fs,
+    SUSCOUNT max_read,
+    suscan_arena_t *arena);
+
+/* Channel side */
+SUSCOUNT suscan_channelizer_get_decimation(
+    const suscan_channelizer_t *chz,
+    const struct sigutils_channel *channel);
+
+SUINLINE SUSCOUNT
+suscan_channelizer_channel_get_fs(const suscan_channelizer_channel_t *chan)
+{
+  return chan->owner->fs / chan->decimation;
+}
+
+SUBOOL suscan_channelizer_channel_extract(
+    suscan_channelizer_channel_t *chan,
+    const struct suscan_sample_buffer *frames,
+    const SUCOMPLEX **data,
+    SUSCOUNT *size);
+
+void suscan_channelizer_channel_destroy(suscan_channelizer_channel_t *chan);
+
+suscan_channelizer_channel_t *suscan_channelizer_channel_new(
+    suscan_channelizer_t *chz,
+    const struct sigutils_channel *channel,
+    struct sigutils_channel *sub_channel);
+
+#endif /* _CHANNELIZER_H */
@@ -0,0 +1,413 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "chanset"
+
+#include "chanset.h"
+#include "msg.h"
+
+/******************************* Channel tracker *****************************/
+void
+suscan_channel_tracker_init(struct suscan_channel_tracker *tracker)
+{
+  memset(tracker, 0, sizeof(struct suscan_channel_tracker));
+
+  tracker->next_id = 1;
+}
+
+void
+suscan_channel_tracker_finalize(struct suscan_channel_tracker *tracker)
+{
+  if (tracker->entry_list != NULL)
+    free(tracker->entry_list);
+
+  if (tracker->next_list != NULL)
+    free(tracker->next_list);
+
+  if (tracker->sort_list != NULL)
+    free(tracker->sort_list);
+
+  suscan_channel_tracker_init(tracker);
+}
+
+SUPRIVATE int
+suscan_channel_tracker_compare(const void *a, const void *b)
+{
+  const struct sigutils_channel *chan_a =
+      *(const struct sigutils_channel **) a;
+  const struct sigutils_channel *chan_b =
+      *(const struct sigutils_channel **) b;
+
+  if (chan_a->fc < chan_b->fc)
+    return -1;
+  else if (chan_a->fc > chan_b->fc)
+    return 1;
+
+  return 0;
+}
+
+SUPRIVATE SUBOOL
+suscan_channel_tracker_reserve(
+    struct suscan_channel_tracker *tracker,
+    unsigned int count)
+{
+  void *new;
+
+  if (count > tracker->sort_storage) {
+    SU_TRYCATCH(
+        new = realloc(
+            tracker->sort_list,
+            count * sizeof(struct sigutils_channel *)),
+        return SU_FALSE);
+    tracker->sort_list = new;
+    tracker->sort_storage = count;
+  }
+
+  if (count > tracker->entry_storage) {
+    SU_TRYCATCH(
+        new = realloc(
+            tracker->entry_list,
+            count * sizeof(struct suscan_channel_entry)),
+        return SU_FALSE);
+    tracker->entry_list = new;
+
+    SU_TRYCATCH(
+        new = realloc(
+            tracker->next_list,
+            count * sizeof(struct suscan_channel_entry)),
+        return SU_FALSE);
+    tracker->next_list = new;
+
+    tracker->entry_storage = count;
+  }
+
+  return SU_TRUE;
+}
+
+SUINLINE SUBOOL
+suscan_channel_tracker_same(
+    const struct sigutils_channel *old,
+    const struct sigutils_channel *new)
+{
+  return SU_ABS(old->fc - new->fc) < .5 * SU_MAX(old->bw, new->bw);
+}
+
+SUINLINE SUBOOL
+suscan_channel_tracker_changed(
+    const struct sigutils_channel *old,
+    const struct sigutils_channel *new)
+{
+  SUFLOAT tol = SUSCAN_CHANNEL_TRACKER_FREQ_TOL * new->bw;
+
+  return SU_ABS(old->fc - new->fc) > tol
+      || SU_ABS(old->bw - new->bw) > tol
+      || SU_ABS(old->f_lo - new->f_lo) > tol
+      || SU_ABS(old->f_hi - new->f_hi) > tol
+      || SU_ABS(old->snr - new->snr) > SUSCAN_CHANNEL_TRACKER_SNR_TOL;
+}
+
+/* Both lists are sorted by frequency: a single pass matches them */
+SUPRIVATE unsigned int
+suscan_channel_tracker_match(
+    struct suscan_channel_tracker *tracker,
+    unsigned int count)
+{
+  struct suscan_channel_entry *old = tracker->entry_list;
+  struct suscan_channel_entry *new = tracker->next_list;
+  const struct sigutils_channel *ch;
+  unsigned int changes = 0;
+  unsigned int i, j = 0;
+
+  for (i = 0; i < tracker->entry_count; ++i)
+    old[i].dirty = SU_FALSE;
+
+  for (i = 0; i < count; ++i) {
+    ch = tracker->sort_list[i];
+
+    while (j < tracker->entry_count
+        && old[j].channel.fc
+            < ch->fc - .5 * SU_MAX(old[j].channel.bw, ch->bw))
+      ++j;
+
+    if (j < tracker->entry_count
+        && suscan_channel_tracker_same(&old[j].channel, ch)) {
+      new[i].id = old[j].id;
+      old[j].dirty = SU_TRUE;
+
+      if (suscan_channel_tracker_changed(&old[j].channel, ch)) {
+        new[i].channel = *ch;
+        new[i].dirty = SU_TRUE;
+        ++changes;
+      } else {
+        new[i].channel = old[j].channel;
+        new[i].dirty = SU_FALSE;
+      }
+
+      ++j;
+    } else {
+      new[i].id = tracker->next_id++;
+      new[i].channel = *ch;
+      new[i].dirty = SU_TRUE;
+      ++changes;
+    }
+  }
+
+  return changes;
+}
+
+SUBOOL
+suscan_channel_tracker_update(
+    struct suscan_channel_tracker *tracker,
+    struct sigutils_channel **list,
+    unsigned int count,
+    SUFLOAT fc,
+    struct suscan_analyzer_channel_msg *msg)
+{
+  struct suscan_channel_entry *tmp;
+  struct sigutils_channel *ch;
+  unsigned int changes, matched = 0;
+  unsigned int i, n = 0;
+
+  SU_TRYCATCH(suscan_channel_tracker_reserve(tracker, count), return SU_FALSE);
+
+  for (i = 0; i < count; ++i)
+    if (list[i] != NULL && SU_CHANNEL_IS_VALID(list[i]))
+      tracker->sort_list[n++] = list[i];
+
+  qsort(
+      tracker->sort_list,
+      n,
+      sizeof(struct sigutils_channel *),
+      suscan_channel_tracker_compare);
+
+  changes = suscan_channel_tracker_match(tracker, n);
+
+  for (i = 0; i < tracker->entry_count; ++i)
+    if (tracker->entry_list[i].dirty)
+      ++matched;
+
+  /* Every now and then, resend everything for late joiners */
+  msg->full = ++tracker->updates >= SUSCAN_CHANNEL_TRACKER_RESYNC
+      || fc != tracker->fc;
+  if (msg->full) {
+    changes = n;
+    matched = tracker->entry_count;
+  }
+
+  if (changes > 0) {
+    SU_TRYCATCH(
+        msg->channel_list = calloc(changes, sizeof(struct sigutils_channel *)),
+        return SU_FALSE);
+    SU_TRYCATCH(
+        msg->id_list = calloc(changes, sizeof(uint32_t)),
+        return SU_FALSE);
+  }
+
+  if (tracker->entry_count > matched)
+    SU_TRYCATCH(
+        msg->removed_list = calloc(
+            tracker->entry_count - matched,
+            sizeof(uint32_t)),
+        return SU_FALSE);
+
+  for (i = 0; i < n; ++i)
+    if (msg->full || tracker->next_list[i].dirty) {
+      SU_TRYCATCH(
+          ch = su_channel_dup(&tracker->next_list[i].channel),
+          return SU_FALSE);
+
+      ch->fc   += fc;
+      ch->f_hi += fc;
+      ch->f_lo += fc;
+      ch->ft    = fc;
+
+      msg->id_list[msg->channel_count] = tracker->next_list[i].id;
+      msg->channel_list[msg->channel_count++] = ch;
+    }
+
+  /* Full messages replace the whole set, removals are implicit */
+  if (!msg->full)
+    for (i = 0; i < tracker->entry_count; ++i)
+      if (!tracker->entry_list[i].dirty)
+        msg->removed_list[msg->removed_count++] = tracker->entry_list[i].id;
+
+  /* Message complete, commit */
+  if (msg->full)
+    tracker->updates = 0;
+
+  tracker->fc = fc;
+
+  tmp = tracker->entry_list;
+  tracker->entry_list = tracker->next_list;
+  tracker->next_list = tmp;
+  tracker->entry_count = n;
+
+  return SU_TRUE;
+}
+
+/******************************** Channel set ********************************/
+void
+suscan_channel_set_init(struct suscan_channel_set *set)
+{
+  memset(set, 0, sizeof(struct suscan_channel_set));
+}
+
+void
+suscan_channel_set_clear(struct suscan_channel_set *set)
+{
+  set->entry_count = 0;
+}
+
+void
+suscan_channel_set_finalize(struct suscan_channel_set *set)
+{
+  if (set->entry_list != NULL)
+    free(set->entry_list);
+
+  suscan_channel_set_init(set);
+}
+
+/* Position of id, or where it should be inserted */
+SUPRIVATE unsigned int
+suscan_channel_set_find(const struct suscan_channel_set *set, uint32_t id)
+{
+  unsigned int lo = 0, hi = set->entry_count, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (set->entry_list[mid].id < id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+SUPRIVATE SUBOOL
+suscan_channel_set_put(
+    struct suscan_channel_set *set,
+    uint32_t id,
+    const struct sigutils_channel *channel)
+{
+  unsigned int pos = suscan_channel_set_find(set, id);
+  unsigned int storage;
+  void *new;
+
+  if (pos == set->entry_count || set->entry_list[pos].id != id) {
+    if (set->entry_count == set->entry_storage) {
+      storage = set->entry_storage == 0 ? 16 : set->entry_storage << 1;
+      SU_TRYCATCH(
+          new = realloc(
+              set->entry_list,
+              storage * sizeof(struct suscan_channel_entry)),
+          return SU_FALSE);
+      set->entry_list = new;
+      set->entry_storage = storage;
+    }
+
+    memmove(
+        set->entry_list + pos + 1,
+        set->entry_list + pos,
+        (set->entry_count - pos) * sizeof(struct suscan_channel_entry));
+    ++set->entry_count;
+
+    set->entry_list[pos].id = id;
+  }
+
+  set->entry_list[pos].channel = *channel;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_channel_set_remove(struct suscan_channel_set *set, uint32_t id)
+{
+  unsigned int pos = suscan_channel_set_find(set, id);
+
+  if (pos == set->entry_count || set->entry_list[pos].id != id)
+    return;
+
+  --set->entry_count;
+  memmove(
+      set->entry_list + pos,
+      set->entry_list + pos + 1,
+      (set->entry_count - pos) * sizeof(struct suscan_channel_entry));
+}
+
+SUBOOL
+suscan_channel_set_apply(
+    struct suscan_channel_set *set,
+    const struct suscan_analyzer_channel_msg *msg)
+{
+  unsigned int i;
+
+  if (msg->full)
+    suscan_channel_set_clear(set);
+
+  for (i = 0; i < msg->removed_count; ++i)
+    suscan_channel_set_remove(set, msg->removed_list[i]);
+
+  for (i = 0; i < msg->channel_count; ++i)
+    SU_TRYCATCH(
+        suscan_channel_set_put(set, msg->id_list[i], msg->channel_list[i]),
+        return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_channel_set_snapshot(
+    const struct suscan_channel_set *set,
+    struct sigutils_channel ***plist,
+    unsigned int *pcount)
+{
+  struct sigutils_channel **list = NULL;
+  unsigned int i;
+
+  if (set->entry_count > 0) {
+    SU_TRYCATCH(
+        list = calloc(set->entry_count, sizeof(struct sigutils_channel *)),
+        goto fail);
+
+    for (i = 0; i < set->entry_count; ++i)
+      SU_TRYCATCH(
+          list[i] = su_channel_dup(&set->entry_list[i].channel),
+          goto fail);
+  }
+
+  *plist = list;
+  *pcount = set->entry_count;
+
+  return SU_TRUE;
+
+fail:
+  if (list != NULL) {
+    for (i = 0; i < set->entry_count; ++i)
+      if (list[i] != NULL)
+        su_channel_destroy(list[i]);
+    free(list);
+  }
+
+  return SU_FALSE;
+}
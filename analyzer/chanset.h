@@ -0,0 +1,100 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CHANSET_H
+#define _CHANSET_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+/*
+ * Incremental channel lists. The tracker runs in the source worker and
+ * turns detector snapshots into deltas: channels added, changed beyond
+ * the tolerances below, and removed, keyed by IDs that stay the same
+ * for as long as the channel is being detected. Channel sets rebuild
+ * the full list on the receiving side.
+ */
+#define SUSCAN_CHANNEL_TRACKER_FREQ_TOL  .01 /* Fraction of bandwidth */
+#define SUSCAN_CHANNEL_TRACKER_SNR_TOL   .5  /* dB */
+#define SUSCAN_CHANNEL_TRACKER_RESYNC    100 /* Updates between snapshots */
+
+struct suscan_analyzer_channel_msg;
+
+struct suscan_channel_entry {
+  uint32_t id;
+  struct sigutils_channel channel; /* As last sent */
+  SUBOOL dirty; /* Tracker only: changed, or matched in the new list */
+};
+
+struct suscan_channel_tracker {
+  /* Sorted by frequency. Double buffered, swapped on every update */
+  struct suscan_channel_entry *entry_list;
+  unsigned int entry_count;
+  struct suscan_channel_entry *next_list;
+  unsigned int entry_storage;
+
+  const struct sigutils_channel **sort_list; /* Valid detector channels */
+  unsigned int sort_storage;
+
+  uint32_t next_id;
+  unsigned int updates; /* Since the last snapshot */
+  SUFLOAT fc; /* Of the last update. Retuning forces a snapshot */
+};
+
+void suscan_channel_tracker_init(struct suscan_channel_tracker *tracker);
+
+void suscan_channel_tracker_finalize(struct suscan_channel_tracker *tracker);
+
+/*
+ * Fills msg with the changes since the previous call, frequencies
+ * shifted by fc. Only changed channels are copied.
+ */
+SUBOOL suscan_channel_tracker_update(
+    struct suscan_channel_tracker *tracker,
+    struct sigutils_channel **list,
+    unsigned int count,
+    SUFLOAT fc,
+    struct suscan_analyzer_channel_msg *msg);
+
+/* Receiving side: the channel list rebuilt from deltas, sorted by ID */
+struct suscan_channel_set {
+  struct suscan_channel_entry *entry_list;
+  unsigned int entry_count;
+  unsigned int entry_storage;
+};
+
+void suscan_channel_set_init(struct suscan_channel_set *set);
+
+void suscan_channel_set_clear(struct suscan_channel_set *set);
+
+void suscan_channel_set_finalize(struct suscan_channel_set *set);
+
+SUBOOL suscan_channel_set_apply(
+    struct suscan_channel_set *set,
+    const struct suscan_analyzer_channel_msg *msg);
+
+/* Allocates a copy of every channel, in the format of channel messages */
+SUBOOL suscan_channel_set_snapshot(
+    const struct suscan_channel_set *set,
+    struct sigutils_channel ***plist,
+    unsigned int *pcount);
+
+#endif /* _CHANSET_H */
@@ -331,3 +331,169 @@ done:
 
   return ok;
 }
+
+/****************************** Recording methods ****************************/
+/*
+ * The file is opened here, so errors are reported right away. From then
+ * on, the recorder belongs to the analyzer thread. Indexed captures of
+ * the source stream take sample rate and frequency from the source, if
+ * not given.
+ */
+SUBOOL
+suscan_analyzer_start_recording_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const struct suscan_recorder_params *params,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  struct suscan_recorder_params rec_params = *params;
+  suscan_recorder_t *rec = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  if (rec_params.capture
+      && handle == SUSCAN_ANALYZER_SOURCE_HANDLE
+      && rec_params.samp_rate == 0) {
+    rec_params.samp_rate = analyzer->source.det_params.samp_rate;
+    rec_params.fc = analyzer->source.fc;
+  }
+
+  SU_TRYCATCH(rec = suscan_recorder_new(&rec_params), goto done);
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_START_RECORDING,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+  req->recorder = rec;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send start_recording command\n");
+    goto done;
+  }
+
+  req = NULL;
+  rec = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  if (rec != NULL)
+    suscan_recorder_destroy(rec);
+
+  return ok;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_wait_recording_resp(
+    suscan_analyzer_t *analyzer,
+    uint32_t req_id,
+    enum suscan_analyzer_inspector_msgkind kind)
+{
+  struct suscan_analyzer_inspector_msg *resp = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      resp = suscan_analyzer_read_inspector_msg(analyzer),
+      goto done);
+
+  if (resp->req_id != req_id) {
+    SU_ERROR("Unmatched response received\n");
+    goto done;
+  }
+
+  if (resp->kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE) {
+    SU_WARNING("Wrong handle passed to analyzer\n");
+    goto done;
+  } else if (resp->kind != kind) {
+    SU_ERROR("Unexpected message kind %d\n", resp->kind);
+    goto done;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (resp != NULL)
+    suscan_analyzer_inspector_msg_destroy(resp);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_start_recording(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    const struct suscan_recorder_params *params)
+{
+  uint32_t req_id = rand();
+
+  SU_TRYCATCH(
+      suscan_analyzer_start_recording_async(analyzer, handle, params, req_id),
+      return SU_FALSE);
+
+  return suscan_analyzer_wait_recording_resp(
+      analyzer,
+      req_id,
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_START_RECORDING);
+}
+
+SUBOOL
+suscan_analyzer_stop_recording_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_STOP_RECORDING,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send stop_recording command\n");
+    goto done;
+  }
+
+  req = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_stop_recording(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle)
+{
+  uint32_t req_id = rand();
+
+  SU_TRYCATCH(
+      suscan_analyzer_stop_recording_async(analyzer, handle, req_id),
+      return SU_FALSE);
+
+  return suscan_analyzer_wait_recording_resp(
+      analyzer,
+      req_id,
+      SUSCAN_ANALYZER_INSPECTOR_MSGKIND_STOP_RECORDING);
+}
@@ -26,11 +26,18 @@
 #include <time.h>
 
 /*
- * Consumer objects keep a local copy of the last retrieved samples. A consumer
- * is enabled as soon as its task counter becomes to non-zero. Then, it pushes
- * a persistent callback that reads from the consumer's slave port in
- * each run, populating its buffer. Consumer tasks will use this buffer to read
- * directly.
+ * Inspector scheduler. The source worker publishes every buffer it reads to
+ * all attached inspectors, each one holding a short queue of pending
+ * buffers. An inspector with pending buffers is placed in the run queue of
+ * the consumer that processed it last (its home). Consumers take inspectors
+ * from their own run queue first, and steal from the others when they run
+ * out of work. An inspector is never processed by two consumers at once,
+ * so its buffers are always processed in order.
+ *
+ * Consumers belong to a pool that several analyzers may share. Each
+ * analyzer has a pass: the consumer time its inspectors used so far,
+ * divided by its priority. Among the inspectors of a run queue, the one
+ * whose analyzer has the lowest pass goes first (stride scheduling).
  */
 
 #define SU_LOG_DOMAIN "consumer"
@@ -41,6 +48,226 @@
 #include "analyzer.h"
 #include "msg.h"
 
+/************************** Run queue operations *****************************/
+/* Must be called with consumer->lock held */
+SUPRIVATE void
+suscan_consumer_rq_push(suscan_consumer_t *consumer, suscan_inspector_t *insp)
+{
+  insp->sched_next = NULL;
+
+  if (consumer->rq_tail != NULL)
+    consumer->rq_tail->sched_next = insp;
+  else
+    consumer->rq_head = insp;
+
+  consumer->rq_tail = insp;
+
+  __atomic_add_fetch(&consumer->rq_count, 1, __ATOMIC_SEQ_CST);
+}
+
+SUINLINE uint64_t
+suscan_inspector_sched_pass(const suscan_inspector_t *insp)
+{
+  return __atomic_load_n(&insp->sched_analyzer->sched_pass, __ATOMIC_RELAXED);
+}
+
+/*
+ * Must be called with consumer->lock held. Takes the inspector of the
+ * analyzer with the lowest pass, the first one queued on ties.
+ */
+SUPRIVATE suscan_inspector_t *
+suscan_consumer_rq_pop(suscan_consumer_t *consumer)
+{
+  suscan_inspector_t *insp, *prev = NULL;
+  suscan_inspector_t *best, *best_prev = NULL;
+  uint64_t pass, best_pass;
+
+  if ((best = consumer->rq_head) == NULL)
+    return NULL;
+
+  best_pass = suscan_inspector_sched_pass(best);
+
+  for (prev = best, insp = best->sched_next;
+      insp != NULL;
+      prev = insp, insp = insp->sched_next)
+    if ((pass = suscan_inspector_sched_pass(insp)) < best_pass) {
+      best      = insp;
+      best_prev = prev;
+      best_pass = pass;
+    }
+
+  if (best_prev != NULL)
+    best_prev->sched_next = best->sched_next;
+  else
+    consumer->rq_head = best->sched_next;
+
+  if (consumer->rq_tail == best)
+    consumer->rq_tail = best_prev;
+
+  best->sched_next = NULL;
+
+  __atomic_sub_fetch(&consumer->rq_count, 1, __ATOMIC_SEQ_CST);
+
+  return best;
+}
+
+SUPRIVATE suscan_inspector_t *
+suscan_consumer_take(suscan_consumer_t *consumer)
+{
+  suscan_inspector_t *insp = NULL;
+
+  if (__atomic_load_n(&consumer->rq_count, __ATOMIC_SEQ_CST) > 0) {
+    pthread_mutex_lock(&consumer->lock);
+    insp = suscan_consumer_rq_pop(consumer);
+    pthread_mutex_unlock(&consumer->lock);
+  }
+
+  return insp;
+}
+
+SUPRIVATE suscan_inspector_t *
+suscan_consumer_steal(suscan_consumer_t *consumer)
+{
+  suscan_consumer_pool_t *pool = consumer->pool;
+  suscan_inspector_t *insp;
+  unsigned int i, n = pool->consumer_count;
+
+  for (i = 1; i < n; ++i)
+    if ((insp = suscan_consumer_take(
+        pool->consumer_list[(consumer->index + i) % n])) != NULL) {
+      __atomic_add_fetch(&consumer->tasks_stolen, 1, __ATOMIC_RELAXED);
+      return insp;
+    }
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_consumer_pool_has_pending_work(const suscan_consumer_pool_t *pool)
+{
+  unsigned int i;
+
+  for (i = 0; i < pool->consumer_count; ++i)
+    if (__atomic_load_n(
+        &pool->consumer_list[i]->rq_count,
+        __ATOMIC_SEQ_CST) > 0)
+      return SU_TRUE;
+
+  return SU_FALSE;
+}
+
+SUPRIVATE void
+suscan_consumer_pool_wake(suscan_consumer_pool_t *pool)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n(&pool->idle_count, __ATOMIC_SEQ_CST) > 0) {
+    pthread_mutex_lock(&pool->idle_mutex);
+    pthread_cond_signal(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_mutex);
+  }
+}
+
+/* Blocks until there is an inspector to run, or the consumer is halted */
+SUPRIVATE suscan_inspector_t *
+suscan_consumer_next_inspector(suscan_consumer_t *consumer)
+{
+  suscan_consumer_pool_t *pool = consumer->pool;
+  suscan_inspector_t *insp;
+
+  while (!consumer->eos) {
+    if ((insp = suscan_consumer_take(consumer)) != NULL)
+      return insp;
+
+    if ((insp = suscan_consumer_steal(consumer)) != NULL)
+      return insp;
+
+    pthread_mutex_lock(&pool->idle_mutex);
+
+    __atomic_add_fetch(&pool->idle_count, 1, __ATOMIC_SEQ_CST);
+
+    if (!consumer->eos && !suscan_consumer_pool_has_pending_work(pool))
+      pthread_cond_wait(&pool->idle_cond, &pool->idle_mutex);
+
+    __atomic_sub_fetch(&pool->idle_count, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_unlock(&pool->idle_mutex);
+  }
+
+  return NULL;
+}
+
+/* Charge consumer time to the analyzer that owns this inspector */
+SUINLINE void
+suscan_analyzer_sched_charge(suscan_analyzer_t *analyzer, uint64_t elapsed)
+{
+  __atomic_add_fetch(
+      &analyzer->sched_pass,
+      elapsed / analyzer->sched_priority,
+      __ATOMIC_RELAXED);
+}
+
+/*
+ * The analyzer got work after being idle. Its pass is brought up to
+ * the lowest one of the busy analyzers, so the time it spent idle does
+ * not become credit against them.
+ */
+SUPRIVATE void
+suscan_analyzer_sched_wake(suscan_analyzer_t *analyzer)
+{
+  suscan_consumer_pool_t *pool = analyzer->consumer_pool;
+  suscan_analyzer_t *other;
+  uint64_t pass, min_pass = 0;
+  SUBOOL busy = SU_FALSE;
+  unsigned int i;
+
+  pthread_mutex_lock(&pool->sched_mutex);
+
+  for (i = 0; i < pool->analyzer_count; ++i) {
+    if ((other = pool->analyzer_list[i]) == NULL || other == analyzer)
+      continue;
+
+    if (__atomic_load_n(&other->sched_active, __ATOMIC_RELAXED) == 0)
+      continue;
+
+    pass = __atomic_load_n(&other->sched_pass, __ATOMIC_RELAXED);
+    if (!busy || pass < min_pass)
+      min_pass = pass;
+
+    busy = SU_TRUE;
+  }
+
+  if (busy
+      && __atomic_load_n(&analyzer->sched_pass, __ATOMIC_RELAXED) < min_pass)
+    __atomic_store_n(&analyzer->sched_pass, min_pass, __ATOMIC_RELAXED);
+
+  pthread_mutex_unlock(&pool->sched_mutex);
+}
+
+/*
+ * Release an inspector that left the run queues. Must be called with
+ * insp->sched_lock held.
+ */
+SUPRIVATE void
+suscan_inspector_sched_release(suscan_inspector_t *insp)
+{
+  if (insp->sched_ready) {
+    insp->sched_ready = SU_FALSE;
+    __atomic_sub_fetch(
+        &insp->sched_analyzer->sched_active,
+        1,
+        __ATOMIC_RELAXED);
+  }
+
+  if (insp->state != SUSCAN_ASYNC_STATE_RUNNING) {
+    suscan_inspector_flush_queue(insp);
+    insp->state = SUSCAN_ASYNC_STATE_HALTED;
+
+    /* Someone may be waiting to destroy it */
+    pthread_cond_broadcast(&insp->sched_cond);
+  }
+}
+
 SUPRIVATE SUBOOL
 suscan_consumer_cb(
     struct suscan_mq *mq_out,
@@ -48,200 +275,448 @@ suscan_consumer_cb(
     void *cb_private)
 {
   suscan_consumer_t *consumer = (suscan_consumer_t *) wk_private;
-  SUSDIFF got;
-  SUSCOUNT p = 0;
-  SUSDIFF size = consumer->buffer_size;
-  SUBOOL mutex_acquired = SU_FALSE;
+  suscan_inspector_t *insp;
+  struct suscan_sample_buffer *buffer;
+  uint64_t start, elapsed;
+  SUBOOL ok;
 
-  /*
-   * This mutex protects the consumer against push() and remove()
-   * operations from different threads. This mutex will not sleep
-   * most of the time.
-   */
-  SU_TRYCATCH(pthread_mutex_lock(&consumer->lock) != -1, goto fail);
+  if ((insp = suscan_consumer_next_inspector(consumer)) == NULL)
+    return SU_FALSE; /* Halted. Remove consumer callback */
 
-  mutex_acquired = SU_TRUE;
+  pthread_mutex_lock(&insp->sched_lock);
 
-  if (consumer->tasks == 0) {
-    if (consumer->idle_counter == 0) {
-      SU_INFO("Consumer %p passed to idle state\n", consumer);
-      consumer->consuming = SU_FALSE;
+  insp->sched_home = consumer;
 
-      su_block_port_unplug(&consumer->port);
+  if (insp->state != SUSCAN_ASYNC_STATE_RUNNING
+      || insp->sched_count == 0) {
+    suscan_inspector_sched_release(insp);
+    pthread_mutex_unlock(&insp->sched_lock);
+    return SU_TRUE;
+  }
 
-      pthread_mutex_unlock(&consumer->lock);
+  buffer = insp->sched_queue[insp->sched_head];
+  insp->sched_head = (insp->sched_head + 1) % SUSCAN_INSPECTOR_QUEUE_SIZE;
+  --insp->sched_count;
 
-      return SU_FALSE; /* Remove consumer callback */
-    } else {
-      --consumer->idle_counter;
-    }
-  }
+  /* Wake up source, in case it was waiting for a free slot */
+  pthread_cond_broadcast(&insp->sched_cond);
 
-  while (size > 0) {
-    got = su_block_port_read(&consumer->port, consumer->buffer + p, size);
-
-    /* Normal read */
-    if (got > 0) {
-      p += got;
-      size -= got;
-    } else {
-      switch (got) {
-        case SU_BLOCK_PORT_READ_ERROR_PORT_DESYNC:
-          SU_WARNING("Samples lost by consumer (normal in slow CPUs)\n");
-          su_block_port_resync(&consumer->port);
-          break;
-
-        default:
-          suscan_analyzer_send_status(
-              consumer->analyzer,
-              SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
-              got,
-              "Consumer worker EOS");
-          goto fail;
-      }
-    }
+  if (insp->sched_lost > 0) {
+    SU_WARNING("Samples lost by inspector (normal in slow CPUs)\n");
+    insp->sched_lost = 0;
   }
 
-  consumer->buffer_pos += p;
+  pthread_mutex_unlock(&insp->sched_lock);
 
-  SU_TRYCATCH(pthread_mutex_unlock(&consumer->lock) != -1, goto fail);
+  start = suscan_stats_now_ns();
 
-  return SU_TRUE;
+  ok = suscan_inspector_process_buffer(insp, buffer);
 
-fail:
-  consumer->failed = SU_TRUE;
+  elapsed = suscan_stats_now_ns() - start;
+
+  suscan_stats_histogram_add(&consumer->process_hist, elapsed);
+
+  suscan_analyzer_sched_charge(insp->sched_analyzer, elapsed);
+
+  suscan_sample_buffer_unref(buffer);
 
-  if (mutex_acquired)
+  __atomic_add_fetch(&consumer->tasks_run, 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&insp->sched_lock);
+
+  if (!ok)
+    insp->state = SUSCAN_ASYNC_STATE_HALTED;
+
+  if (insp->state == SUSCAN_ASYNC_STATE_RUNNING && insp->sched_count > 0) {
+    /* More work for this inspector: keep it local */
+    pthread_mutex_lock(&consumer->lock);
+    suscan_consumer_rq_push(consumer, insp);
     pthread_mutex_unlock(&consumer->lock);
+  } else {
+    suscan_inspector_sched_release(insp);
+  }
 
-  suscan_worker_req_halt(consumer->worker);
+  pthread_mutex_unlock(&insp->sched_lock);
 
-  return SU_FALSE;
+  return SU_TRUE;
 }
 
-const SUCOMPLEX *
-suscan_consumer_get_buffer(const suscan_consumer_t *consumer)
+/*************************** Analyzer-side API *******************************/
+SUBOOL
+suscan_analyzer_attach_inspector(
+    suscan_analyzer_t *analyzer,
+    suscan_inspector_t *insp)
 {
-  return consumer->buffer;
+  SUBOOL ok = SU_FALSE;
+
+  suscan_consumer_pool_t *pool = analyzer->consumer_pool;
+  unsigned int next;
+
+  /* Next inspector will start in a different consumer */
+  next = __atomic_fetch_add(&pool->next_consumer, 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&analyzer->sched_mutex);
+
+  insp->sched_home = pool->consumer_list[next % pool->consumer_count];
+  insp->sched_analyzer = analyzer;
+
+  SU_TRYCATCH(
+      PTR_LIST_APPEND_CHECK(analyzer->sched_inspector, insp) != -1,
+      goto done);
+
+  ok = SU_TRUE;
+
+done:
+  pthread_mutex_unlock(&analyzer->sched_mutex);
+
+  return ok;
 }
 
-SUSCOUNT
-suscan_consumer_get_buffer_size(const suscan_consumer_t *consumer)
+/*
+ * Stop publishing buffers to this inspector, and mark it as halting.
+ * Consumers may still hold it: see suscan_analyzer_inspector_is_released.
+ */
+void
+suscan_analyzer_detach_inspector(
+    suscan_analyzer_t *analyzer,
+    suscan_inspector_t *insp)
 {
-  return consumer->buffer_size;
+  unsigned int i;
+
+  pthread_mutex_lock(&analyzer->sched_mutex);
+
+  for (i = 0; i < analyzer->sched_inspector_count; ++i)
+    if (analyzer->sched_inspector_list[i] == insp)
+      analyzer->sched_inspector_list[i] = NULL;
+
+  pthread_mutex_unlock(&analyzer->sched_mutex);
+
+  pthread_mutex_lock(&insp->sched_lock);
+
+  if (insp->state == SUSCAN_ASYNC_STATE_RUNNING)
+    insp->state = SUSCAN_ASYNC_STATE_HALTING;
+
+  /* Not in any run queue: nobody else will release it */
+  if (!insp->sched_ready)
+    suscan_inspector_sched_release(insp);
+
+  pthread_cond_broadcast(&insp->sched_cond);
+
+  pthread_mutex_unlock(&insp->sched_lock);
 }
 
-SUSCOUNT
-suscan_consumer_get_buffer_pos(const suscan_consumer_t *consumer)
+/*
+ * Whether a detached inspector can be destroyed: no consumer holds it,
+ * and the source worker is not waiting on its queue.
+ */
+SUBOOL
+suscan_analyzer_inspector_is_released(
+    suscan_analyzer_t *analyzer,
+    suscan_inspector_t *insp)
 {
-  return consumer->buffer_pos;
+  SUBOOL released;
+
+  pthread_mutex_lock(&analyzer->sched_mutex);
+  pthread_mutex_lock(&insp->sched_lock);
+
+  released = insp->state == SUSCAN_ASYNC_STATE_HALTED
+      && !insp->sched_ready
+      && insp->sched_waiters == 0;
+
+  pthread_mutex_unlock(&insp->sched_lock);
+  pthread_mutex_unlock(&analyzer->sched_mutex);
+
+  return released;
 }
 
-SUBOOL
-suscan_consumer_push_task(
-    suscan_consumer_t *consumer,
-    SUBOOL (*func) (
-              struct suscan_mq *mq_out,
-              void *wk_private,
-              void *cb_private),
-    void *private)
-{
-  SUBOOL mutex_acquired = SU_FALSE;
-  SUBOOL ok = SU_FALSE;
+/* Source worker must be halted: nobody else waits on the queue */
+SUPRIVATE void
+suscan_inspector_wait_released(suscan_inspector_t *insp)
+{
+  pthread_mutex_lock(&insp->sched_lock);
 
-  SU_TRYCATCH(pthread_mutex_lock(&consumer->lock) != -1, goto done);
+  while (insp->state != SUSCAN_ASYNC_STATE_HALTED || insp->sched_ready)
+    pthread_cond_wait(&insp->sched_cond, &insp->sched_lock);
 
-  mutex_acquired = SU_TRUE;
+  pthread_mutex_unlock(&insp->sched_lock);
+}
 
-  if (!consumer->consuming) {
-    if (!su_block_port_plug(
-        &consumer->port,
-        consumer->analyzer->source.block,
-        0)) {
-      SU_ERROR("Failed to push task: cannot plug port\n");
-      goto done;
-    }
+/* First inspector still taking buffers, NULL if none */
+SUPRIVATE suscan_inspector_t *
+suscan_analyzer_sched_first(suscan_analyzer_t *analyzer)
+{
+  suscan_inspector_t *insp = NULL;
+  unsigned int i;
 
-    /*
-     * Worker thread will block as suscan_consumer_cb will try to acquire
-     * consumer->lock
-     */
-    if (!suscan_worker_push(consumer->worker, suscan_consumer_cb, NULL)) {
-      SU_ERROR("Failed to push consumer callback\n");
+  pthread_mutex_lock(&analyzer->sched_mutex);
 
-      su_block_port_unplug(&consumer->port);
+  for (i = 0; i < analyzer->sched_inspector_count && insp == NULL; ++i)
+    insp = analyzer->sched_inspector_list[i];
 
-      goto done;
-    }
+  pthread_mutex_unlock(&analyzer->sched_mutex);
 
-    consumer->consuming = SU_TRUE;
+  return insp;
+}
+
+/*
+ * Detach all inspectors and wait for the consumers to let go of them.
+ * The consumers themselves may keep running for other analyzers, and
+ * detach entries meanwhile: the list is only looked at under its lock.
+ */
+void
+suscan_analyzer_sched_drain(suscan_analyzer_t *analyzer)
+{
+  suscan_inspector_t *insp;
+  unsigned int i;
+
+  /* Detaching clears the entry, so this always makes progress */
+  while ((insp = suscan_analyzer_sched_first(analyzer)) != NULL) {
+    suscan_analyzer_detach_inspector(analyzer, insp);
+    suscan_inspector_wait_released(insp);
   }
 
-  /* Restart consumer counter */
-  if (consumer->tasks++ == 0)
-    consumer->idle_counter = SUSCAN_CONSUMER_IDLE_COUNTER;
+  for (i = 0; i < analyzer->halted_inspector_count; ++i)
+    if ((insp = analyzer->halted_inspector_list[i]) != NULL)
+      suscan_inspector_wait_released(insp);
+}
 
-  /* This task will be executed after suscan_consumer_cb */
-  if (!suscan_worker_push(consumer->worker, func, private)) {
-    (void) suscan_consumer_remove_task(consumer);
+/*
+ * Called by the source worker. Channelized inspectors get the channelizer
+ * frames computed from this buffer (if any), the rest get the buffer
+ * itself. If an inspector queue is full, the buffer is either dropped
+ * (real time sources) or the source waits for the inspector to catch up
+ * (wait = SU_TRUE).
+ */
+SUBOOL
+suscan_analyzer_publish_buffer(
+    suscan_analyzer_t *analyzer,
+    struct suscan_sample_buffer *buffer,
+    struct suscan_sample_buffer *frames,
+    SUBOOL wait)
+{
+  suscan_inspector_t *insp;
+  suscan_consumer_t *home;
+  struct suscan_sample_buffer *this;
+  unsigned int i, tail;
+  SUBOOL wake = SU_FALSE;
+
+  pthread_mutex_lock(&analyzer->sched_mutex);
+
+  for (i = 0; i < analyzer->sched_inspector_count; ++i) {
+    if ((insp = analyzer->sched_inspector_list[i]) == NULL)
+      continue;
+
+    /* Read was too short to complete a frame */
+    if ((this = insp->chan != NULL ? frames : buffer) == NULL)
+      continue;
+
+    pthread_mutex_lock(&insp->sched_lock);
+
+    while (wait
+        && !analyzer->sched_halt
+        && insp->state == SUSCAN_ASYNC_STATE_RUNNING
+        && insp->sched_count == SUSCAN_INSPECTOR_QUEUE_SIZE) {
+      /*
+       * Don't block the analyzer thread while we wait. sched_waiters
+       * keeps the inspector alive until we get sched_mutex back.
+       */
+      ++insp->sched_waiters;
+      pthread_mutex_unlock(&analyzer->sched_mutex);
+
+      pthread_cond_wait(&insp->sched_cond, &insp->sched_lock);
+
+      pthread_mutex_unlock(&insp->sched_lock);
+      pthread_mutex_lock(&analyzer->sched_mutex);
+      pthread_mutex_lock(&insp->sched_lock);
+      --insp->sched_waiters;
+
+      if (analyzer->sched_inspector_list[i] != insp)
+        break; /* Detached meanwhile */
+    }
+
+    if (insp->state == SUSCAN_ASYNC_STATE_RUNNING) {
+      if (insp->sched_count < SUSCAN_INSPECTOR_QUEUE_SIZE) {
+        tail = (insp->sched_head + insp->sched_count)
+            % SUSCAN_INSPECTOR_QUEUE_SIZE;
+
+        suscan_sample_buffer_ref(this);
+        insp->sched_queue[tail] = this;
+        ++insp->sched_count;
+
+        if (!insp->sched_ready) {
+          insp->sched_ready = SU_TRUE;
+          home = insp->sched_home;
+
+          if (__atomic_fetch_add(
+              &analyzer->sched_active,
+              1,
+              __ATOMIC_RELAXED) == 0)
+            suscan_analyzer_sched_wake(analyzer);
+
+          pthread_mutex_lock(&home->lock);
+          suscan_consumer_rq_push(home, insp);
+          pthread_mutex_unlock(&home->lock);
+
+          wake = SU_TRUE;
+        }
+      } else {
+        insp->sched_lost += suscan_sample_buffer_size(this);
+        insp->sched_lost_total += suscan_sample_buffer_size(this);
+      }
+    }
 
-    goto done;
+    pthread_mutex_unlock(&insp->sched_lock);
   }
 
-  ok = SU_TRUE;
+  pthread_mutex_unlock(&analyzer->sched_mutex);
 
-done:
-  if (mutex_acquired)
-    SU_TRYCATCH(pthread_mutex_unlock(&consumer->lock) != -1, goto done);
+  if (wake)
+    suscan_consumer_pool_wake(analyzer->consumer_pool);
 
-  return ok;
+  return SU_TRUE;
 }
 
+/*
+ * Fill one entry per attached inspector. Symbol rates are measured since
+ * the previous call, so this must only be called from the source worker.
+ */
 SUBOOL
-suscan_consumer_remove_task(suscan_consumer_t *consumer)
+suscan_analyzer_get_inspector_stats(
+    suscan_analyzer_t *analyzer,
+    struct suscan_analyzer_inspector_stats **stats_list,
+    unsigned int *stats_count)
 {
-  SUBOOL mutex_acquired = SU_FALSE;
+  struct suscan_analyzer_inspector_stats *list = NULL;
+  suscan_inspector_t *insp;
+  unsigned int i, n = 0;
+  uint64_t now, sym;
   SUBOOL ok = SU_FALSE;
 
-  SU_TRYCATCH(pthread_mutex_lock(&consumer->lock) != -1, goto done);
+  now = suscan_stats_now_ns();
 
-  mutex_acquired = SU_TRUE;
+  pthread_mutex_lock(&analyzer->sched_mutex);
 
-  if (consumer->tasks == 0) {
-    SU_ERROR("Cannot remove tasks: task counter already 0\n");
-    goto done;
-  }
+  if (analyzer->sched_inspector_count > 0)
+    SU_TRYCATCH(
+        list = calloc(
+            analyzer->sched_inspector_count,
+            sizeof(struct suscan_analyzer_inspector_stats)),
+        goto done);
+
+  for (i = 0; i < analyzer->sched_inspector_count; ++i) {
+    if ((insp = analyzer->sched_inspector_list[i]) == NULL)
+      continue;
+
+    sym = __atomic_load_n(&insp->sym_total, __ATOMIC_RELAXED);
+
+    list[n].inspector_id = insp->params.inspector_id;
 
-  SU_TRYCATCH(!consumer->failed, goto done);
+    if (insp->stats_time_last != 0 && now > insp->stats_time_last)
+      list[n].symbol_rate =
+          1e9 * (sym - insp->stats_sym_last)
+          / (SUFLOAT) (now - insp->stats_time_last);
 
-  /* suscan_consumer_cb will handle 0 tasks on its own */
-  --consumer->tasks;
+    insp->stats_sym_last = sym;
+    insp->stats_time_last = now;
+
+    pthread_mutex_lock(&insp->sched_lock);
+    list[n].samples_lost = insp->sched_lost_total;
+    list[n].queued = insp->sched_count;
+    pthread_mutex_unlock(&insp->sched_lock);
+
+    ++n;
+  }
+
+  *stats_list = list;
+  *stats_count = n;
+  list = NULL;
 
   ok = SU_TRUE;
 
 done:
-  if (mutex_acquired)
-    SU_TRYCATCH(pthread_mutex_unlock(&consumer->lock) != -1, goto done);
+  pthread_mutex_unlock(&analyzer->sched_mutex);
+
+  if (list != NULL)
+    free(list);
 
   return ok;
 }
 
+/* Wake up the source worker, if it is waiting for slow inspectors */
+void
+suscan_analyzer_sched_halt(suscan_analyzer_t *analyzer)
+{
+  suscan_inspector_t *insp;
+  unsigned int i;
+
+  pthread_mutex_lock(&analyzer->sched_mutex);
+
+  analyzer->sched_halt = SU_TRUE;
+
+  for (i = 0; i < analyzer->sched_inspector_count; ++i)
+    if ((insp = analyzer->sched_inspector_list[i]) != NULL) {
+      pthread_mutex_lock(&insp->sched_lock);
+      pthread_cond_broadcast(&insp->sched_cond);
+      pthread_mutex_unlock(&insp->sched_lock);
+    }
+
+  pthread_mutex_unlock(&analyzer->sched_mutex);
+}
+
+/******************************* Consumer API ********************************/
+/* No more work will be taken by this consumer. Wakes it up if idle. */
+void
+suscan_consumer_force_eos(suscan_consumer_t *consumer)
+{
+  suscan_consumer_pool_t *pool = consumer->pool;
+
+  pthread_mutex_lock(&pool->idle_mutex);
+
+  consumer->eos = SU_TRUE;
+  pthread_cond_broadcast(&pool->idle_cond);
+
+  pthread_mutex_unlock(&pool->idle_mutex);
+}
+
+/*
+ * Consumers look into each other's run queues, so they must not start
+ * until the consumer list is complete.
+ */
 SUBOOL
-suscan_consumer_destroy(suscan_consumer_t *cons)
+suscan_consumer_start(suscan_consumer_t *consumer)
+{
+  /* Persistent callback: it runs one inspector task per call */
+  return suscan_worker_push_persistent(
+      consumer->worker,
+      suscan_consumer_cb,
+      NULL);
+}
+
+SUBOOL
+suscan_consumer_halt(suscan_consumer_t *cons)
 {
   if (cons->worker != NULL) {
+    /* The worker may be waiting for work that will never come */
+    suscan_consumer_force_eos(cons);
+
     if (!suscan_analyzer_halt_worker(cons->worker)) {
       SU_ERROR("Consumer worker destruction failed, memory leak ahead\n");
       return SU_FALSE;
     }
+
+    cons->worker = NULL;
   }
 
-  su_block_port_unplug(&cons->port);
+  return SU_TRUE;
+}
 
-  pthread_mutex_destroy(&cons->lock);
+SUBOOL
+suscan_consumer_destroy(suscan_consumer_t *cons)
+{
+  if (!suscan_consumer_halt(cons))
+    return SU_FALSE;
 
-  if (cons->buffer != NULL)
-    free(cons->buffer);
+  pthread_mutex_destroy(&cons->lock);
 
   free(cons);
 
@@ -249,50 +724,201 @@ suscan_consumer_destroy(suscan_consumer_t *cons)
 }
 
 suscan_consumer_t *
-suscan_consumer_new(struct suscan_analyzer *analyzer)
+suscan_consumer_new(
+    suscan_consumer_pool_t *pool,
+    unsigned int index,
+    uint64_t cpu_mask)
 {
   suscan_consumer_t *new = NULL;
-  pthread_mutexattr_t attr;
-  SUBOOL attr_init = SU_FALSE;
 
   SU_TRYCATCH(new = calloc(1, sizeof (suscan_consumer_t)), goto fail);
 
-  SU_TRYCATCH(pthread_mutexattr_init(&attr) != -1, goto fail);
+  SU_TRYCATCH(pthread_mutex_init(&new->lock, NULL) != -1, goto fail);
 
-  attr_init = SU_TRUE;
+  new->pool = pool;
+  new->index = index;
 
   SU_TRYCATCH(
-      pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != -1,
+      new->worker = suscan_worker_new_with_affinity(
+          &pool->mq,
+          new,
+          cpu_mask),
       goto fail);
 
-  SU_TRYCATCH(
-      pthread_mutex_init(&new->lock, &attr) != -1,
-      goto fail);
+  return new;
 
-  pthread_mutexattr_destroy(&attr);
+fail:
+  if (new != NULL)
+    suscan_consumer_destroy(new);
 
-  attr_init = SU_FALSE;
+  return NULL;
+}
 
-  new->buffer_size = analyzer->read_size;
+/**************************** Consumer pool API ******************************/
+SUPRIVATE unsigned int
+suscan_get_min_consumer_workers(void)
+{
+  long count;
 
-  SU_TRYCATCH(
-      new->buffer = malloc(new->buffer_size * sizeof(SUCOMPLEX)),
-      goto fail);
+  if ((count = sysconf(_SC_NPROCESSORS_ONLN)) < 2)
+    count = 2;
+
+  if (count > SUSCAN_ANALYZER_MAX_CONSUMERS + 1)
+    count = SUSCAN_ANALYZER_MAX_CONSUMERS + 1;
+
+  return count - 1;
+}
+
+SUPRIVATE uint64_t
+suscan_analyzer_params_get_consumer_cpu_mask(
+    const struct suscan_analyzer_params *params,
+    unsigned int index)
+{
+  unsigned int count = params->consumer_cpu_mask_count;
+
+  if (count == 0)
+    return 0;
+
+  if (count > SUSCAN_ANALYZER_MAX_CONSUMERS)
+    count = SUSCAN_ANALYZER_MAX_CONSUMERS;
+
+  return params->consumer_cpu_mask[index % count];
+}
+
+SUPRIVATE void
+suscan_consumer_pool_destroy(suscan_consumer_pool_t *pool)
+{
+  unsigned int i;
+
+  /*
+   * Consumers steal work from each other: all of them must be stopped
+   * before any consumer object is released.
+   */
+  for (i = 0; i < pool->consumer_count; ++i)
+    if (pool->consumer_list[i] != NULL)
+      suscan_consumer_force_eos(pool->consumer_list[i]);
+
+  for (i = 0; i < pool->consumer_count; ++i)
+    if (pool->consumer_list[i] != NULL)
+      if (!suscan_consumer_halt(pool->consumer_list[i])) {
+        SU_ERROR("Consumer worker halt failed, memory leak ahead\n");
+        return;
+      }
+
+  for (i = 0; i < pool->consumer_count; ++i)
+    if (pool->consumer_list[i] != NULL)
+      if (!suscan_consumer_destroy(pool->consumer_list[i])) {
+        SU_ERROR("Consumer worker destruction failed, memory leak ahead\n");
+        return;
+      }
+
+  if (pool->consumer_list != NULL)
+    free(pool->consumer_list);
+
+  if (pool->analyzer_list != NULL)
+    free(pool->analyzer_list);
 
-  new->analyzer = analyzer;
+  suscan_analyzer_consume_mq(&pool->mq);
+  suscan_mq_finalize(&pool->mq);
+
+  pthread_mutex_destroy(&pool->sched_mutex);
+  pthread_mutex_destroy(&pool->idle_mutex);
+  pthread_cond_destroy(&pool->idle_cond);
+
+  free(pool);
+}
+
+void
+suscan_consumer_pool_release(suscan_consumer_pool_t *pool)
+{
+  if (__atomic_sub_fetch(&pool->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+    suscan_consumer_pool_destroy(pool);
+}
+
+SUBOOL
+suscan_consumer_pool_attach(
+    suscan_consumer_pool_t *pool,
+    suscan_analyzer_t *analyzer)
+{
+  SUBOOL ok;
+
+  pthread_mutex_lock(&pool->sched_mutex);
+  ok = PTR_LIST_APPEND_CHECK(pool->analyzer, analyzer) != -1;
+  pthread_mutex_unlock(&pool->sched_mutex);
+
+  SU_TRYCATCH(ok, return SU_FALSE);
+
+  __atomic_add_fetch(&pool->refcnt, 1, __ATOMIC_ACQ_REL);
+
+  analyzer->consumer_pool = pool;
+
+  return SU_TRUE;
+}
+
+/* The analyzer must not have inspectors left in the pool */
+void
+suscan_consumer_pool_detach(
+    suscan_consumer_pool_t *pool,
+    suscan_analyzer_t *analyzer)
+{
+  pthread_mutex_lock(&pool->sched_mutex);
+  (void) PTR_LIST_REMOVE(pool->analyzer, analyzer);
+  pthread_mutex_unlock(&pool->sched_mutex);
+
+  analyzer->consumer_pool = NULL;
+
+  suscan_consumer_pool_release(pool);
+}
+
+suscan_consumer_pool_t *
+suscan_consumer_pool_new(const struct suscan_analyzer_params *params)
+{
+  suscan_consumer_pool_t *new = NULL;
+  suscan_consumer_t *consumer;
+  unsigned int worker_count;
+  unsigned int i;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_consumer_pool_t)), goto fail);
+
+  (void) pthread_mutex_init(&new->idle_mutex, NULL);
+  (void) pthread_cond_init(&new->idle_cond, NULL);
+  (void) pthread_mutex_init(&new->sched_mutex, NULL);
+
+  new->refcnt = 1;
 
   SU_TRYCATCH(
-      new->worker = suscan_worker_new(&analyzer->mq_in, new),
+      suscan_mq_init_ring(&new->mq, SUSCAN_MQ_DEFAULT_RING_SIZE),
       goto fail);
 
+  if ((worker_count = params->consumer_count) == 0)
+    worker_count = suscan_get_min_consumer_workers();
+  else if (worker_count > SUSCAN_ANALYZER_MAX_CONSUMERS)
+    worker_count = SUSCAN_ANALYZER_MAX_CONSUMERS;
+
+  for (i = 0; i < worker_count; ++i) {
+    SU_TRYCATCH(
+        consumer = suscan_consumer_new(
+            new,
+            i,
+            suscan_analyzer_params_get_consumer_cpu_mask(params, i)),
+        goto fail);
+
+    if (PTR_LIST_APPEND_CHECK(new->consumer, consumer) == -1) {
+      SU_ERROR("Cannot append consumer to list\n");
+      suscan_consumer_destroy(consumer);
+      goto fail;
+    }
+  }
+
+  /* Consumer list is complete, they can start taking work now */
+  for (i = 0; i < worker_count; ++i)
+    SU_TRYCATCH(suscan_consumer_start(new->consumer_list[i]), goto fail);
+
   return new;
 
 fail:
-  if (!attr_init)
-    pthread_mutexattr_destroy(&attr);
-
   if (new != NULL)
-    suscan_consumer_destroy(new);
+    suscan_consumer_pool_destroy(new);
 
   return NULL;
 }
@@ -23,48 +23,91 @@
 
 #include <sigutils/sigutils.h>
 
-#define SUSCAN_CONSUMER_IDLE_COUNTER 30
+#include "worker.h"
+#include "buffer.h"
+#include "stats.h"
 
 struct suscan_analyzer;
+struct suscan_analyzer_params;
+struct suscan_inspector;
+struct suscan_consumer_pool;
 
-/* Per-worker object: used to centralize reads */
+/*
+ * Per-worker object. Each consumer owns a run queue of inspectors that have
+ * published buffers pending to be processed. Idle consumers steal work from
+ * the run queues of the others.
+ */
 struct suscan_consumer {
-  pthread_mutex_t lock; /* Must be recursive */
+  pthread_mutex_t lock; /* Protects the run queue */
   suscan_worker_t *worker;
-  struct suscan_analyzer *analyzer;
-  su_block_port_t port; /* Slave reading port */
+  struct suscan_consumer_pool *pool;
+  unsigned int index;
 
-  SUCOMPLEX *buffer; /* TODO: make int const. Don't own this buffer */
-  SUSCOUNT   buffer_size;
-  SUSCOUNT   buffer_pos;
+  struct suscan_inspector *rq_head;
+  struct suscan_inspector *rq_tail;
+  unsigned int rq_count;
 
-  unsigned int tasks;
-  unsigned int idle_counter; /* Turns left on tasks == 0 before stop consuming */
+  /* Statistics */
+  uint64_t tasks_run;    /* Buffers processed by this consumer */
+  uint64_t tasks_stolen; /* Inspectors taken from other run queues */
+  struct suscan_stats_histogram process_hist; /* Inspector callbacks */
 
-  SUBOOL consuming; /* Whether we should be reading */
+  SUBOOL eos;       /* No more work will be accepted */
   SUBOOL failed;    /* Whether the consumer callback failed somehow */
 };
 
 typedef struct suscan_consumer suscan_consumer_t;
 
+/*
+ * Consumer workers, shared by all the analyzers attached to the pool.
+ * Analyzers get a share of the consumer time proportional to their
+ * priority, no matter how many inspectors they have open.
+ */
+struct suscan_consumer_pool {
+  struct suscan_mq mq; /* Worker output. Consumers don't write to it */
+  PTR_LIST(suscan_consumer_t, consumer);
+  unsigned int next_consumer; /* Home of the next inspector */
+
+  pthread_mutex_t idle_mutex;
+  pthread_cond_t  idle_cond;  /* Signaled when new work is available */
+  unsigned int    idle_count; /* Consumers waiting for work */
+
+  /* Attached analyzers, protected by sched_mutex */
+  pthread_mutex_t sched_mutex;
+  PTR_LIST(struct suscan_analyzer, analyzer);
+
+  unsigned int refcnt; /* Creator, plus one per attached analyzer */
+};
+
+typedef struct suscan_consumer_pool suscan_consumer_pool_t;
+
 SUBOOL suscan_consumer_destroy(suscan_consumer_t *cons);
 
-SUBOOL suscan_consumer_remove_task(suscan_consumer_t *consumer);
+void suscan_consumer_force_eos(suscan_consumer_t *consumer);
+
+SUBOOL suscan_consumer_start(suscan_consumer_t *consumer);
+
+SUBOOL suscan_consumer_halt(suscan_consumer_t *cons);
 
-const SUCOMPLEX *suscan_consumer_get_buffer(const suscan_consumer_t *consumer);
+suscan_consumer_t *suscan_consumer_new(
+    suscan_consumer_pool_t *pool,
+    unsigned int index,
+    uint64_t cpu_mask);
 
-SUSCOUNT suscan_consumer_get_buffer_size(const suscan_consumer_t *consumer);
+/* Thread layout is taken from the consumer_* members of params */
+suscan_consumer_pool_t *suscan_consumer_pool_new(
+    const struct suscan_analyzer_params *params);
 
-SUSCOUNT suscan_consumer_get_buffer_pos(const suscan_consumer_t *consumer);
+/* Drops a reference. Consumers are halted with the last one */
+void suscan_consumer_pool_release(suscan_consumer_pool_t *pool);
 
-SUBOOL suscan_consumer_push_task(
-    suscan_consumer_t *consumer,
-    SUBOOL (*func) (
-              struct suscan_mq *mq_out,
-              void *wk_private,
-              void *cb_private),
-    void *private);
+/* Each attached analyzer holds a reference */
+SUBOOL suscan_consumer_pool_attach(
+    suscan_consumer_pool_t *pool,
+    struct suscan_analyzer *analyzer);
 
-suscan_consumer_t *suscan_consumer_new(struct suscan_analyzer *analyzer);
+void suscan_consumer_pool_detach(
+    suscan_consumer_pool_t *pool,
+    struct suscan_analyzer *analyzer);
 
 #endif /* _CONSUMER_H */
@@ -0,0 +1,118 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "handle"
+
+#include "handle.h"
+
+void
+suscan_handle_table_init(struct suscan_handle_table *table)
+{
+  memset(table, 0, sizeof(struct suscan_handle_table));
+
+  table->free_head = -1;
+}
+
+void
+suscan_handle_table_finalize(struct suscan_handle_table *table)
+{
+  if (table->entry_list != NULL)
+    free(table->entry_list);
+
+  suscan_handle_table_init(table);
+}
+
+SUPRIVATE SUBOOL
+suscan_handle_table_grow(struct suscan_handle_table *table)
+{
+  struct suscan_handle_entry *new;
+  unsigned int count;
+  unsigned int i;
+
+  if (table->entry_count == SUSCAN_HANDLE_MAX_SLOTS) {
+    SU_ERROR("Too many handles\n");
+    return SU_FALSE;
+  }
+
+  count = table->entry_count == 0 ? 16 : table->entry_count << 1;
+  if (count > SUSCAN_HANDLE_MAX_SLOTS)
+    count = SUSCAN_HANDLE_MAX_SLOTS;
+
+  SU_TRYCATCH(
+      new = realloc(
+          table->entry_list,
+          count * sizeof(struct suscan_handle_entry)),
+      return SU_FALSE);
+
+  /* New slots go to the free list, lowest index first */
+  for (i = table->entry_count; i < count; ++i) {
+    new[i].ptr = NULL;
+    new[i].gen = 0;
+    new[i].next_free = i + 1 < count ? i + 1 : table->free_head;
+  }
+
+  table->free_head = table->entry_count;
+  table->entry_list = new;
+  table->entry_count = count;
+
+  return SU_TRUE;
+}
+
+int32_t
+suscan_handle_table_alloc(struct suscan_handle_table *table, void *ptr)
+{
+  struct suscan_handle_entry *entry;
+  int32_t index;
+
+  if (table->free_head == -1)
+    SU_TRYCATCH(suscan_handle_table_grow(table), return -1);
+
+  index = table->free_head;
+  entry = table->entry_list + index;
+
+  table->free_head = entry->next_free;
+  entry->next_free = -1;
+  entry->ptr = ptr;
+  ++table->used;
+
+  return ((int32_t) entry->gen << SUSCAN_HANDLE_INDEX_BITS) | index;
+}
+
+SUBOOL
+suscan_handle_table_release(struct suscan_handle_table *table, int32_t handle)
+{
+  struct suscan_handle_entry *entry;
+
+  if (suscan_handle_table_get(table, handle) == NULL)
+    return SU_FALSE;
+
+  entry = table->entry_list + (handle & SUSCAN_HANDLE_INDEX_MASK);
+
+  entry->ptr = NULL;
+  entry->gen = (entry->gen + 1) & SUSCAN_HANDLE_GEN_MASK;
+  entry->next_free = table->free_head;
+  table->free_head = handle & SUSCAN_HANDLE_INDEX_MASK;
+  --table->used;
+
+  return SU_TRUE;
+}
@@ -0,0 +1,93 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _HANDLE_H
+#define _HANDLE_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Handle table. Handles pack a slot index and the generation of the
+ * slot when the handle was issued, so handles of released objects
+ * stay invalid after their slot is reused. Released slots are kept in
+ * a free list, and the table only grows when all of them are in use.
+ */
+#define SUSCAN_HANDLE_INDEX_BITS 16
+#define SUSCAN_HANDLE_INDEX_MASK ((1 << SUSCAN_HANDLE_INDEX_BITS) - 1)
+#define SUSCAN_HANDLE_GEN_MASK   0x7fff /* Keeps handles positive */
+#define SUSCAN_HANDLE_MAX_SLOTS  (SUSCAN_HANDLE_INDEX_MASK + 1)
+
+struct suscan_handle_entry {
+  void *ptr;          /* NULL if free */
+  uint16_t gen;       /* Bumped on every release */
+  int32_t next_free;  /* Next slot in the free list, or -1 */
+};
+
+struct suscan_handle_table {
+  struct suscan_handle_entry *entry_list;
+  unsigned int entry_count;
+  unsigned int used;
+  int32_t free_head;
+};
+
+void suscan_handle_table_init(struct suscan_handle_table *table);
+
+void suscan_handle_table_finalize(struct suscan_handle_table *table);
+
+/* Returns -1 on failure */
+int32_t suscan_handle_table_alloc(
+    struct suscan_handle_table *table,
+    void *ptr);
+
+SUBOOL suscan_handle_table_release(
+    struct suscan_handle_table *table,
+    int32_t handle);
+
+SUINLINE void *
+suscan_handle_table_get(
+    const struct suscan_handle_table *table,
+    int32_t handle)
+{
+  const struct suscan_handle_entry *entry;
+  unsigned int index;
+
+  if (handle < 0)
+    return NULL;
+
+  index = handle & SUSCAN_HANDLE_INDEX_MASK;
+  if (index >= table->entry_count)
+    return NULL;
+
+  entry = table->entry_list + index;
+  if (entry->gen != (handle >> SUSCAN_HANDLE_INDEX_BITS))
+    return NULL;
+
+  return entry->ptr;
+}
+
+/* Slot-wise access, for iteration. Free slots yield NULL */
+SUINLINE void *
+suscan_handle_table_at(const struct suscan_handle_table *table, unsigned int i)
+{
+  return table->entry_list[i].ptr;
+}
+
+#endif /* _HANDLE_H */
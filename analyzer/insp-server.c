@@ -34,56 +34,126 @@
 #include <sigutils/sigutils.h>
 
 #include "inspector.h"
+#include "channelizer.h"
 #include "mq.h"
 #include "msg.h"
 
 /*
- * TODO: Store *one port* only per worker. This port is read once all
- * consumers have finished with their buffer.
+ * Rate limiting for display clients. Every batch adds the credit earned
+ * by the samples it came from, and symbols are evenly picked from it up
+ * to that credit. The phase of the pick is kept between batches, so the
+ * output is a plain decimation when the rate is steady.
  */
-SUPRIVATE SUBOOL
-suscan_inspector_wk_cb(
-    struct suscan_mq *mq_out,
-    void *wk_private,
-    void *cb_private)
+SUPRIVATE void
+suscan_inspector_decimate_batch(
+    suscan_inspector_t *insp,
+    struct suscan_analyzer_sample_batch_msg *batch_msg,
+    SUSCOUNT samp_count)
+{
+  SUFLOAT fs = su_channel_detector_get_fs(insp->fac_baud_det);
+  SUFLOAT rate = insp->params.display_rate;
+  SUFLOAT step;
+  SUFLOAT pos;
+  unsigned int count = batch_msg->sample_count;
+  unsigned int n = 0;
+
+  if (fs <= 0)
+    return;
+
+  insp->display_credit += rate * samp_count / fs;
+  if (insp->display_credit > rate * SUSCAN_INSPECTOR_DISPLAY_BURST + 1)
+    insp->display_credit = rate * SUSCAN_INSPECTOR_DISPLAY_BURST + 1;
+
+  if (count <= insp->display_credit) {
+    insp->display_credit -= count;
+    return;
+  }
+
+  /* One symbol out of every step */
+  step = count / SU_MAX(insp->display_credit, 1);
+
+  for (pos = insp->display_phase; pos < count; pos += step)
+    batch_msg->samples[n++] = batch_msg->samples[(unsigned int) pos];
+
+  insp->display_phase = pos - count;
+  insp->display_credit = SU_MAX(insp->display_credit - n, 0);
+  batch_msg->sample_count = n;
+}
+
+/*
+ * Called by the consumer that took the inspector from a run queue. The
+ * scheduler guarantees that no other consumer is processing this same
+ * inspector.
+ */
+SUBOOL
+suscan_inspector_process_buffer(
+    suscan_inspector_t *insp,
+    const struct suscan_sample_buffer *buffer)
 {
-  suscan_consumer_t *consumer = (suscan_consumer_t *) wk_private;
-  suscan_inspector_t *insp = (suscan_inspector_t *) cb_private;
-  unsigned int i;
+  unsigned int sym_count;
   int fed;
   SUSCOUNT samp_count;
+  SUSCOUNT samp_total;
   const SUCOMPLEX *samp_buf;
   struct suscan_analyzer_sample_batch_msg *batch_msg = NULL;
-  SUBOOL restart = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
 
-  samp_buf   = suscan_consumer_get_buffer(consumer);
-  samp_count = suscan_consumer_get_buffer_size(consumer);
+  if (insp->chan != NULL) {
+    /* Channelizer frames: take our sub-band */
+    SU_TRYCATCH(
+        suscan_channelizer_channel_extract(
+            insp->chan,
+            buffer,
+            &samp_buf,
+            &samp_count),
+        goto done);
+  } else {
+    samp_buf   = suscan_sample_buffer_data(buffer);
+    samp_count = suscan_sample_buffer_size(buffer);
+  }
 
   insp->per_cnt_psd += samp_count;
+  samp_total = samp_count;
 
-  while (samp_count > 0) {
-    /* Ensure the current inspector parameters are up-to-date */
-    suscan_inspector_assert_params(insp);
+  /* Ensure the current inspector parameters are up-to-date */
+  suscan_inspector_assert_params(insp);
 
-    SU_TRYCATCH(
-        (fed = suscan_inspector_feed_bulk(insp, samp_buf, samp_count)) >= 0,
-        goto done);
+  suscan_inspector_update_baud_det(insp, samp_count);
 
-    if (insp->sym_new_sample) {
-      /* Sampler was triggered */
-      if (batch_msg == NULL)
-        SU_TRYCATCH(
-            batch_msg = suscan_analyzer_sample_batch_msg_new(
-                insp->params.inspector_id),
-            goto done);
+  /* Presize batch from the expected symbol count */
+  SU_TRYCATCH(
+      batch_msg = suscan_analyzer_sample_batch_pool_acquire(
+          insp->sample_pool,
+          insp->params.inspector_id,
+          suscan_inspector_get_expected_symbols(insp, samp_count)),
+      goto done);
 
+  while (samp_count > 0) {
+    /* Estimation fell short (clock recovery jitter), make some room */
+    if (batch_msg->sample_count == batch_msg->sample_storage)
       SU_TRYCATCH(
-          suscan_analyzer_sample_batch_msg_append_sample(
+          suscan_analyzer_sample_batch_msg_reserve(
               batch_msg,
-              insp->sym_sampler_output),
+              batch_msg->sample_storage << 1),
           goto done);
 
-    }
+    SU_TRYCATCH(
+        (fed = suscan_inspector_feed_bulk_symbols(
+            insp,
+            samp_buf,
+            samp_count,
+            batch_msg->samples + batch_msg->sample_count,
+            batch_msg->sample_storage - batch_msg->sample_count,
+            &sym_count)) >= 0,
+        goto done);
+
+    /* Record the symbols before they are handed to the client */
+    suscan_recorder_slot_write(
+        &insp->recorder_slot,
+        batch_msg->samples + batch_msg->sample_count,
+        sym_count);
+
+    batch_msg->sample_count += sym_count;
 
     samp_buf   += fed;
     samp_count -= fed;
@@ -98,12 +168,12 @@ suscan_inspector_wk_cb(
 
       switch (insp->params.psd_source) {
         case SUSCAN_INSPECTOR_PSD_SOURCE_FAC:
-          if (!suscan_inspector_send_psd(insp, consumer, insp->fac_baud_det))
+          if (!suscan_inspector_send_psd(insp, insp->fac_baud_det))
             goto done;
           break;
 
         case SUSCAN_INSPECTOR_PSD_SOURCE_NLN:
-          if (!suscan_inspector_send_psd(insp, consumer, insp->nln_baud_det))
+          if (!suscan_inspector_send_psd(insp, insp->nln_baud_det))
             goto done;
           break;
 
@@ -115,29 +185,34 @@ suscan_inspector_wk_cb(
       insp->pending = SU_FALSE;
     }
 
+  /* Consumers may take turns with this inspector */
+  __atomic_add_fetch(
+      &insp->sym_total,
+      batch_msg->sample_count,
+      __ATOMIC_RELAXED);
+
+  /* Recorder got them all already, the client may not need as many */
+  if (insp->params.display_rate > 0)
+    suscan_inspector_decimate_batch(insp, batch_msg, samp_total);
+
   /* Got samples, send message batch */
-  if (batch_msg != NULL) {
+  if (batch_msg->sample_count > 0) {
     SU_TRYCATCH(
         suscan_mq_write(
-            consumer->analyzer->mq_out,
+            insp->sched_analyzer->mq_out,
             SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES,
             batch_msg),
         goto done);
     batch_msg = NULL;
   }
 
-  restart = insp->state == SUSCAN_ASYNC_STATE_RUNNING;
+  ok = SU_TRUE;
 
 done:
-  if (!restart) {
-    insp->state = SUSCAN_ASYNC_STATE_HALTED;
-    suscan_consumer_remove_task(consumer);
-  }
-
   if (batch_msg != NULL)
     suscan_analyzer_sample_batch_msg_destroy(batch_msg);
 
-  return restart;
+  return ok;
 }
 
 SUINLINE suscan_inspector_t *
@@ -147,10 +222,7 @@ suscan_analyzer_get_inspector(
 {
   suscan_inspector_t *brinsp;
 
-  if (handle < 0 || handle >= analyzer->inspector_count)
-    return NULL;
-
-  brinsp = analyzer->inspector_list[handle];
+  brinsp = suscan_handle_table_get(&analyzer->inspector_table, handle);
 
   if (brinsp != NULL && brinsp->state != SUSCAN_ASYNC_STATE_RUNNING)
     return NULL;
@@ -158,18 +230,54 @@ suscan_analyzer_get_inspector(
   return brinsp;
 }
 
+/*
+ * Free closed inspectors whose consumers are done with them. Called
+ * by the analyzer thread after every batch of requests, and periodically
+ * while it is idle and some are left.
+ */
+void
+suscan_analyzer_collect_halted_inspectors(suscan_analyzer_t *analyzer)
+{
+  suscan_inspector_t *insp;
+  unsigned int i, n = 0;
+
+  for (i = 0; i < analyzer->halted_inspector_count; ++i) {
+    insp = analyzer->halted_inspector_list[i];
+
+    if (suscan_analyzer_inspector_is_released(analyzer, insp))
+      suscan_inspector_destroy(insp);
+    else
+      analyzer->halted_inspector_list[n++] = insp;
+  }
+
+  analyzer->halted_inspector_count = n;
+}
+
+/*
+ * Close an inspector. Its handle becomes invalid right away, even if
+ * a consumer still holds the inspector.
+ */
 SUPRIVATE SUBOOL
 suscan_analyzer_dispose_inspector_handle(
     suscan_analyzer_t *analyzer,
     SUHANDLE handle)
 {
-  if (handle < 0 || handle >= analyzer->inspector_count)
-    return SU_FALSE;
+  suscan_inspector_t *insp;
 
-  if (analyzer->inspector_list[handle] == NULL)
+  if ((insp = suscan_handle_table_get(&analyzer->inspector_table, handle))
+      == NULL)
     return SU_FALSE;
 
-  analyzer->inspector_list[handle] = NULL;
+  (void) suscan_handle_table_release(&analyzer->inspector_table, handle);
+
+  suscan_analyzer_detach_inspector(analyzer, insp);
+
+  if (suscan_analyzer_inspector_is_released(analyzer, insp)) {
+    suscan_inspector_destroy(insp);
+  } else if (PTR_LIST_APPEND_CHECK(analyzer->halted_inspector, insp) == -1) {
+    SU_ERROR("Cannot defer inspector release, memory leak ahead\n");
+    return SU_FALSE;
+  }
 
   return SU_TRUE;
 }
@@ -182,21 +290,18 @@ suscan_analyzer_register_inspector(
   SUHANDLE hnd;
 
   if (brinsp->state != SUSCAN_ASYNC_STATE_CREATED)
-    return SU_FALSE;
+    return -1;
 
-  /* Plugged. Append handle to list */
-  /* TODO: Find inspectors in HALTED state, and free them */
-  if ((hnd = PTR_LIST_APPEND_CHECK(analyzer->inspector, brinsp)) == -1)
+  if ((hnd = suscan_handle_table_alloc(&analyzer->inspector_table, brinsp))
+      == -1)
     return -1;
 
-  /* Mark it as running and push to worker */
+  /* Mark it as running and let the scheduler feed it */
   brinsp->state = SUSCAN_ASYNC_STATE_RUNNING;
 
-  if (!suscan_analyzer_push_task(
-      analyzer,
-      suscan_inspector_wk_cb,
-      brinsp)) {
-    suscan_analyzer_dispose_inspector_handle(analyzer, hnd);
+  if (!suscan_analyzer_attach_inspector(analyzer, brinsp)) {
+    (void) suscan_handle_table_release(&analyzer->inspector_table, hnd);
+    brinsp->state = SUSCAN_ASYNC_STATE_CREATED;
     return -1;
   }
 
@@ -212,6 +317,37 @@ suscan_analyzer_register_inspector(
  * TODO: Protect access to inspector object!
  */
 
+/*
+ * The previous recorder, if any, is destroyed here: flushing its last
+ * buffer must not stall the source worker or the consumers.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_swap_recorder(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    suscan_recorder_t *rec)
+{
+  struct suscan_recorder_slot *slot;
+  suscan_inspector_t *insp;
+
+  if (handle == SUSCAN_ANALYZER_SOURCE_HANDLE) {
+    slot = &analyzer->recorder_slot;
+  } else if ((insp = suscan_analyzer_get_inspector(
+      analyzer,
+      handle)) != NULL) {
+    slot = &insp->recorder_slot;
+  } else {
+    if (rec != NULL)
+      suscan_recorder_destroy(rec);
+    return SU_FALSE;
+  }
+
+  if ((rec = suscan_recorder_slot_swap(slot, rec)) != NULL)
+    suscan_recorder_destroy(rec);
+
+  return SU_TRUE;
+}
+
 SUBOOL
 suscan_analyzer_parse_inspector_msg(
     suscan_analyzer_t *analyzer,
@@ -219,16 +355,40 @@ suscan_analyzer_parse_inspector_msg(
 {
   suscan_inspector_t *new = NULL;
   suscan_inspector_t *insp = NULL;
+  suscan_channelizer_channel_t *chan = NULL;
+  struct sigutils_channel sub_channel;
   SUHANDLE handle = -1;
   SUBOOL ok = SU_FALSE;
   SUBOOL update_baud;
 
   switch (msg->kind) {
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
-      if ((new = suscan_inspector_new(
-          su_channel_detector_get_fs(analyzer->source.detector),
-          &msg->channel)) == NULL)
+      /*
+       * Narrow channels are fed from the shared channelizer, so the
+       * inspector only sees its own sub-band, at a fraction of the rate.
+       */
+      if (suscan_channelizer_get_decimation(
+          analyzer->channelizer,
+          &msg->channel) > 1) {
+        SU_TRYCATCH(
+            chan = suscan_channelizer_channel_new(
+                analyzer->channelizer,
+                &msg->channel,
+                &sub_channel),
+            goto done);
+
+        if ((new = suscan_inspector_new(
+            suscan_channelizer_channel_get_fs(chan),
+            &sub_channel)) == NULL)
+          goto done;
+
+        new->chan = chan;
+        chan = NULL;
+      } else if ((new = suscan_inspector_new(
+          analyzer->source.det_params.samp_rate,
+          &msg->channel)) == NULL) {
         goto done;
+      }
 
       handle = suscan_analyzer_register_inspector(analyzer, new);
       if (handle == -1)
@@ -245,7 +405,11 @@ suscan_analyzer_parse_inspector_msg(
         /* No such handle */
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
       } else {
-        /* Retrieve current esimate for message kind */
+        /*
+         * Retrieve current esimate for message kind. If the NLN detector
+         * was idle, this wakes it up and its estimate may be stale.
+         */
+        suscan_inspector_request_baud_info(insp);
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO;
         msg->baud.fac = insp->fac_baud_det->baud;
         msg->baud.nln = insp->nln_baud_det->baud;
@@ -261,7 +425,7 @@ suscan_analyzer_parse_inspector_msg(
       } else {
         /* Retrieve current inspector params */
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_INSP_PARAMS;
-        msg->insp_params = insp->params;
+        suscan_inspector_get_params(insp, &msg->insp_params);
       }
       break;
 
@@ -278,35 +442,45 @@ suscan_analyzer_parse_inspector_msg(
       break;
 
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE:
-      if ((insp = suscan_analyzer_get_inspector(
-          analyzer,
+      /* Inspectors halted by a processing error can be closed too */
+      if ((insp = suscan_handle_table_get(
+          &analyzer->inspector_table,
           msg->handle)) == NULL) {
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
       } else {
         msg->inspector_id = insp->params.inspector_id;
 
-        if (insp->state == SUSCAN_ASYNC_STATE_HALTED) {
-          /*
-           * Inspector has been halted. It's safe to dispose the handle
-           * and free the object.
-           */
-          (void) suscan_analyzer_dispose_inspector_handle(
-              analyzer,
-              msg->handle);
-          suscan_inspector_destroy(insp);
-        } else {
-          /*
-           * Inspector is still running. Mark it as halting, so it will not
-           * come back to the worker queue.
-           */
-          insp->state = SUSCAN_ASYNC_STATE_HALTING;
-        }
+        /*
+         * Stop feeding buffers to this inspector. It is freed as soon
+         * as no consumer is working on it.
+         */
+        (void) suscan_analyzer_dispose_inspector_handle(
+            analyzer,
+            msg->handle);
 
         /* We can't trust the inspector contents from here on out */
         insp = NULL;
       }
       break;
 
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_START_RECORDING:
+      if (!suscan_analyzer_swap_recorder(
+          analyzer,
+          msg->handle,
+          msg->recorder))
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+
+      msg->recorder = NULL;
+      insp = suscan_analyzer_get_inspector(analyzer, msg->handle);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_STOP_RECORDING:
+      if (!suscan_analyzer_swap_recorder(analyzer, msg->handle, NULL))
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+
+      insp = suscan_analyzer_get_inspector(analyzer, msg->handle);
+      break;
+
     default:
       msg->status = msg->kind;
       msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND;
@@ -328,6 +502,9 @@ suscan_analyzer_parse_inspector_msg(
   ok = SU_TRUE;
 
 done:
+  if (chan != NULL)
+    suscan_channelizer_channel_destroy(chan);
+
   if (new != NULL)
     suscan_inspector_destroy(new);
 
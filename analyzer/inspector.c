@@ -31,6 +31,8 @@
 
 #include "source.h"
 #include "inspector.h"
+#include "channelizer.h"
+#include "msg.h"
 
 #define SUSCAN_INSPECTOR_DEFAULT_ROLL_OFF .35
 #define SUSCAN_INSPECTOR_MAX_MF_SPAN      1024
@@ -48,16 +50,33 @@ suscan_inspector_mf_span(SUSCOUNT span)
   return span;
 }
 
-SUPRIVATE void
-suscan_inspector_params_lock(suscan_inspector_t *insp)
+SUPRIVATE void suscan_inspector_select_kernel(suscan_inspector_t *insp);
+
+SUPRIVATE enum sigutils_costas_kind
+suscan_inspector_get_costas_kind(enum suscan_inspector_carrier_control fc_ctrl)
 {
-  (void) pthread_mutex_lock(&insp->params_mutex);
+  switch (fc_ctrl) {
+    case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_2:
+      return SU_COSTAS_KIND_BPSK;
+
+    case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_4:
+      return SU_COSTAS_KIND_QPSK;
+
+    case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_8:
+      return SU_COSTAS_KIND_8PSK;
+
+    default:
+      return SU_COSTAS_KIND_NONE;
+  }
 }
 
-SUPRIVATE void
-suscan_inspector_params_unlock(suscan_inspector_t *insp)
+SUPRIVATE SUBOOL
+suscan_inspector_init_costas(
+    su_costas_t *costas,
+    enum sigutils_costas_kind kind,
+    SUFLOAT bw)
 {
-  (void) pthread_mutex_unlock(&insp->params_mutex);
+  return su_costas_init(costas, kind, 0, bw, 3, 1e-2 * bw);
 }
 
 void
@@ -65,29 +84,159 @@ suscan_inspector_request_params(
     suscan_inspector_t *insp,
     struct suscan_inspector_params *params_request)
 {
-  suscan_inspector_params_lock(insp);
+  suscan_param_slot_publish(&insp->params_slot, params_request);
+}
+
+/* Last requested parameters, maybe not applied by the consumer yet */
+void
+suscan_inspector_get_params(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_params *params)
+{
+  (void) suscan_param_slot_fetch(&insp->params_slot, params);
+}
+
+/* Called from the analyzer thread: someone wants fresh baud estimates */
+void
+suscan_inspector_request_baud_info(suscan_inspector_t *insp)
+{
+  __atomic_add_fetch(&insp->info_req, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Decide whether the non-linear detector runs for the next count input
+ * samples. It is only needed for NLN spectrum updates and while clients
+ * keep asking for baud estimates. Caller is the consumer, once per buffer.
+ */
+void
+suscan_inspector_update_baud_det(suscan_inspector_t *insp, SUSCOUNT count)
+{
+  unsigned int req = __atomic_load_n(&insp->info_req, __ATOMIC_RELAXED);
+
+  if (req != insp->info_req_seen) {
+    insp->info_req_seen = req;
+    insp->nln_hold = SUSCAN_INSPECTOR_NLN_HOLD_TIME
+        * su_channel_detector_get_fs(insp->fac_baud_det);
+  }
+
+  insp->nln_active =
+         insp->params.psd_source == SUSCAN_INSPECTOR_PSD_SOURCE_NLN
+      || insp->nln_hold > 0;
+
+  insp->nln_hold -= SU_MIN(count, insp->nln_hold);
+}
+
+/* Bring the loops back to their initial state, as if freshly tuned */
+SUPRIVATE void
+suscan_inspector_reset_loops(suscan_inspector_t *insp)
+{
+  su_agc_t agc;
+  su_costas_t costas;
+
+  if (!su_agc_init(&agc, &insp->agc_params)) {
+    SU_ERROR("No memory left to reset AGC!\n");
+  } else {
+    su_agc_finalize(&insp->agc);
+    insp->agc = agc;
+  }
+
+  if (!suscan_inspector_init_costas(
+      &costas,
+      insp->costas_kind,
+      insp->costas_bw)) {
+    SU_ERROR("No memory left to reset Costas loop!\n");
+  } else {
+    su_costas_finalize(&insp->costas);
+    insp->costas = costas;
+  }
+
+  /* Forget the baudrate drift, too */
+  su_clock_detector_set_baud(
+      &insp->cd,
+      SU_ABS2NORM_BAUD(insp->equiv_fs, insp->params.baud));
+
+  insp->sym_phase = 0;
+  insp->sym_last_sample = 0;
+}
+
+/*
+ * Squelch check, once per block of channel samples, already centered
+ * and decimated so neighbouring carriers stay out of the measure. The
+ * mean power of quiet blocks is tracked as the noise floor: it follows
+ * drops immediately and rises slowly, so bursts never drag it up. The
+ * squelch opens when a block is squelch_level dB above it, and closes
+ * after a hang time without loud blocks. Returns whether the block
+ * should be demodulated.
+ */
+SUPRIVATE SUBOOL
+suscan_inspector_update_squelch(
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  SUFLOAT power = 0;
+  SUSCOUNT i;
+
+  if (!insp->params.squelch) {
+    insp->squelch_open = SU_TRUE;
+    return SU_TRUE;
+  }
+
+  if (count == 0)
+    return insp->squelch_open;
 
-  insp->params_request = *params_request;
+  for (i = 0; i < count; ++i)
+    power += SU_C_REAL(x[i] * SU_C_CONJ(x[i]));
 
-  insp->params_requested = SU_TRUE;
+  power = SU_MAX(power / count, SUSCAN_INSPECTOR_SQUELCH_MIN_POWER);
 
-  suscan_inspector_params_unlock(insp);
+  if (insp->squelch_floor <= 0 || power < insp->squelch_floor)
+    insp->squelch_floor = power;
+  else if (!insp->squelch_open)
+    insp->squelch_floor +=
+        SUSCAN_INSPECTOR_SQUELCH_FLOOR_ALPHA * (power - insp->squelch_floor);
+
+  if (SU_POWER_DB(power / insp->squelch_floor)
+      >= insp->params.squelch_level) {
+    if (!insp->squelch_open
+        && insp->params.squelch_policy
+        == SUSCAN_INSPECTOR_SQUELCH_POLICY_RESET)
+      suscan_inspector_reset_loops(insp);
+
+    insp->squelch_open = SU_TRUE;
+    insp->squelch_hang = SUSCAN_INSPECTOR_SQUELCH_HANG_TIME * insp->equiv_fs;
+  } else if (insp->squelch_open) {
+    if (insp->squelch_hang > count)
+      insp->squelch_hang -= count;
+    else
+      insp->squelch_open = SU_FALSE;
+  }
+
+  return insp->squelch_open;
 }
 
 void
 suscan_inspector_assert_params(suscan_inspector_t *insp)
 {
   SUFLOAT fs;
+  SUFLOAT old_baud, old_rolloff;
   SUBOOL mf_changed;
   su_iir_filt_t mf = su_iir_filt_INITIALIZER;
+  su_costas_t costas;
+  enum sigutils_costas_kind costas_kind;
+
+  /* Hot path: a single atomic load */
+  if (suscan_param_slot_changed(&insp->params_slot, insp->params_gen)) {
+    old_baud    = insp->params.baud;
+    old_rolloff = insp->params.mf_rolloff;
 
-  if (insp->params_requested) {
-    suscan_inspector_params_lock(insp);
+    insp->params_gen = suscan_param_slot_fetch(
+        &insp->params_slot,
+        &insp->params);
 
     mf_changed =
-        (insp->params.baud != insp->params_request.baud)
-        || (insp->params.mf_rolloff != insp->params_request.mf_rolloff);
-    insp->params = insp->params_request;
+        (insp->params.baud != old_baud)
+        || (insp->params.mf_rolloff != old_rolloff);
 
     fs = insp->equiv_fs; /* Use equivalent sample rate after dectimation */
 
@@ -125,22 +274,58 @@ suscan_inspector_assert_params(suscan_inspector_t *insp)
       }
     }
 
-    /* Re-center costas loops */
-    if (insp->params.fc_ctrl == SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL) {
-      su_ncqo_set_freq(&insp->costas_2.ncqo, 0);
-      su_ncqo_set_freq(&insp->costas_4.ncqo, 0);
-      su_ncqo_set_freq(&insp->costas_8.ncqo, 0);
+    /* Only one Costas loop is kept: rebuild it if the kind changed */
+    costas_kind = suscan_inspector_get_costas_kind(insp->params.fc_ctrl);
+    if (costas_kind != SU_COSTAS_KIND_NONE
+        && costas_kind != insp->costas_kind) {
+      if (!suscan_inspector_init_costas(
+          &costas,
+          costas_kind,
+          insp->costas_bw)) {
+        SU_ERROR("No memory left to update Costas loop!\n");
+        insp->params.fc_ctrl = SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL;
+      } else {
+        su_costas_finalize(&insp->costas);
+        insp->costas = costas;
+        insp->costas_kind = costas_kind;
+      }
     }
-    insp->params_requested = SU_FALSE;
 
-    suscan_inspector_params_unlock(insp);
+    /* Re-center costas loop */
+    if (insp->params.fc_ctrl == SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL)
+      su_ncqo_set_freq(&insp->costas.ncqo, 0);
+
+    suscan_inspector_select_kernel(insp);
   }
 }
 
+/* Release all pending buffers. Must be called with sched_lock held */
+void
+suscan_inspector_flush_queue(suscan_inspector_t *insp)
+{
+  while (insp->sched_count > 0) {
+    suscan_sample_buffer_unref(insp->sched_queue[insp->sched_head]);
+    insp->sched_head = (insp->sched_head + 1) % SUSCAN_INSPECTOR_QUEUE_SIZE;
+    --insp->sched_count;
+  }
+
+  insp->sched_lost = 0;
+
+  pthread_cond_broadcast(&insp->sched_cond);
+}
+
 void
 suscan_inspector_destroy(suscan_inspector_t *insp)
 {
-  pthread_mutex_destroy(&insp->params_mutex);
+  suscan_inspector_flush_queue(insp);
+
+  suscan_param_slot_finalize(&insp->params_slot);
+
+  suscan_recorder_slot_finalize(&insp->recorder_slot);
+
+  pthread_mutex_destroy(&insp->sched_lock);
+
+  pthread_cond_destroy(&insp->sched_cond);
 
   if (insp->fac_baud_det != NULL)
     su_channel_detector_destroy(insp->fac_baud_det);
@@ -148,16 +333,24 @@ suscan_inspector_destroy(suscan_inspector_t *insp)
   if (insp->nln_baud_det != NULL)
     su_channel_detector_destroy(insp->nln_baud_det);
 
+  if (insp->chan != NULL)
+    suscan_channelizer_channel_destroy(insp->chan);
+
   su_iir_filt_finalize(&insp->mf);
 
   su_agc_finalize(&insp->agc);
 
-  su_costas_finalize(&insp->costas_2);
-
-  su_costas_finalize(&insp->costas_4);
+  if (insp->costas_kind != SU_COSTAS_KIND_NONE)
+    su_costas_finalize(&insp->costas);
 
   su_clock_detector_finalize(&insp->cd);
 
+  if (insp->sample_pool != NULL)
+    suscan_analyzer_sample_batch_pool_release(insp->sample_pool);
+
+  if (insp->psd_pool != NULL)
+    suscan_analyzer_psd_pool_release(insp->psd_pool);
+
   free(insp);
 }
 
@@ -204,11 +397,31 @@ suscan_inspector_new(SUSCOUNT fs, const struct sigutils_channel *channel)
 
   new->state = SUSCAN_ASYNC_STATE_CREATED;
 
-  /* Initialize inspector parameters */
-  SU_TRYCATCH(pthread_mutex_init(&new->params_mutex, NULL) != -1, goto fail);
 
+  /* Initialize scheduler state */
+  SU_TRYCATCH(pthread_mutex_init(&new->sched_lock, NULL) != -1, goto fail);
+  SU_TRYCATCH(pthread_cond_init(&new->sched_cond, NULL) != -1, goto fail);
+
+  /* Initialize inspector parameters */
   suscan_inspector_params_initialize(&new->params);
 
+  SU_TRYCATCH(
+      suscan_param_slot_init(
+          &new->params_slot,
+          sizeof(struct suscan_inspector_params),
+          &new->params),
+      goto fail);
+
+  SU_TRYCATCH(suscan_recorder_slot_init(&new->recorder_slot), goto fail);
+
+  SU_TRYCATCH(
+      new->sample_pool = suscan_analyzer_sample_batch_pool_new(),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->psd_pool = suscan_analyzer_psd_pool_new(),
+      goto fail);
+
   /*
    * Removed alpha setting. This is now automatically done by
    * adjust_to_channel
@@ -226,10 +439,20 @@ suscan_inspector_new(SUSCOUNT fs, const struct sigutils_channel *channel)
   params.mode = SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION;
   SU_TRYCATCH(new->fac_baud_det = su_channel_detector_new(&params), goto fail);
 
-  /* Create non-linear baud rate detector */
+  /*
+   * Create non-linear baud rate detector. It works on the FAC detector
+   * output, which is already centered and decimated.
+   */
   params.mode = SU_CHANNEL_DETECTOR_MODE_NONLINEAR_DIFF;
+  params.samp_rate = SU_FLOOR(new->equiv_fs + .5);
+  params.decimation = 1;
+  params.fc = 0;
   SU_TRYCATCH(new->nln_baud_det = su_channel_detector_new(&params), goto fail);
 
+  /* Newly opened inspectors are usually asked for their baud rate soon */
+  new->nln_hold = SUSCAN_INSPECTOR_NLN_HOLD_TIME * fs;
+  new->nln_active = SU_TRUE;
+
   /* Create clock detector */
   SU_TRYCATCH(
       su_clock_detector_init(
@@ -257,6 +480,7 @@ suscan_inspector_new(SUSCOUNT fs, const struct sigutils_channel *channel)
   agc_params.mag_history_size = tau * SUSCAN_INSPECTOR_MAG_HISTORY_FRAC;
 
   SU_TRYCATCH(su_agc_init(&new->agc, &agc_params), goto fail);
+  new->agc_params = agc_params;
 
   /* Initialize matched filter, with T = tau */
   SU_TRYCATCH(
@@ -267,37 +491,17 @@ suscan_inspector_new(SUSCOUNT fs, const struct sigutils_channel *channel)
           new->params.mf_rolloff),
       goto fail);
 
-  /* Initialize PLLs */
+  /* Initialize PLL. Other kinds are built on demand */
+  new->costas_bw = SU_ABS2NORM_FREQ(new->equiv_fs, params.bw);
   SU_TRYCATCH(
-      su_costas_init(
-          &new->costas_2,
+      suscan_inspector_init_costas(
+          &new->costas,
           SU_COSTAS_KIND_BPSK,
-          0,
-          SU_ABS2NORM_FREQ(new->equiv_fs, params.bw),
-          3,
-          1e-2 * SU_ABS2NORM_FREQ(new->equiv_fs, params.bw)),
-      goto fail);
-
-  SU_TRYCATCH(
-      su_costas_init(
-          &new->costas_4,
-          SU_COSTAS_KIND_QPSK,
-          0,
-          SU_ABS2NORM_FREQ(new->equiv_fs, params.bw),
-          3,
-          1e-2 * SU_ABS2NORM_FREQ(new->equiv_fs, params.bw)),
+          new->costas_bw),
       goto fail);
+  new->costas_kind = SU_COSTAS_KIND_BPSK;
 
-
-  SU_TRYCATCH(
-      su_costas_init(
-          &new->costas_8,
-          SU_COSTAS_KIND_8PSK,
-          0,
-          SU_ABS2NORM_FREQ(new->equiv_fs, params.bw),
-          3,
-          1e-2 * SU_ABS2NORM_FREQ(new->equiv_fs, params.bw)),
-      goto fail);
+  suscan_inspector_select_kernel(new);
 
   return new;
 
@@ -308,37 +512,186 @@ fail:
   return NULL;
 }
 
-int
-suscan_inspector_feed_bulk(
+/*
+ * Inspector processing kernels. The chain is split in stages, each one
+ * run over a whole block of decimated samples:
+ *
+ *   carrier re-centering and gain -> carrier recovery -> matched filter
+ *   -> symbol sampler
+ *
+ * suscan_inspector_kernel is written once, and every combination of
+ * gain control, carrier control, matched filter and baudrate control
+ * gets its own copy with the switches resolved at compile time. The
+ * right one is picked by suscan_inspector_select_kernel when parameters
+ * change. Returns the number of symbols written to symbols[].
+ */
+SUINLINE __attribute__((always_inline)) unsigned int
+suscan_inspector_kernel(
+    suscan_inspector_t *insp,
+    SUCOMPLEX *x,
+    SUSCOUNT count,
+    SUCOMPLEX *symbols,
+    SUFLOAT samp_phase_samples,
+    enum suscan_inspector_gain_control gc_ctrl,
+    SUBOOL carrier_recovery,
+    enum suscan_inspector_matched_filter mf_conf,
+    enum suscan_inspector_baudrate_control br_ctrl)
+{
+  SUSCOUNT i;
+  unsigned int n = 0;
+  SUCOMPLEX phase = insp->phase;
+  SUCOMPLEX sample;
+  SUFLOAT alpha;
+
+  /* Re-center carrier and apply manual gain */
+  if (gc_ctrl == SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL)
+    phase *= 2 * insp->params.gc_gain;
+
+  for (i = 0; i < count; ++i)
+    x[i] *= SU_C_CONJ(su_ncqo_read(&insp->lo)) * phase;
+
+  /* Automatic gain control */
+  if (gc_ctrl == SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC)
+    for (i = 0; i < count; ++i)
+      x[i] = 2 * su_agc_feed(&insp->agc, x[i]) * 1.4142;
+
+  /* Frequency correction */
+  if (carrier_recovery)
+    for (i = 0; i < count; ++i) {
+      su_costas_feed(&insp->costas, x[i]);
+      x[i] = insp->costas.y;
+    }
+
+  /* Matched filter */
+  if (mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
+    for (i = 0; i < count; ++i)
+      x[i] = su_iir_filt_feed(&insp->mf, x[i]);
+
+  /* Symbol sampler */
+  if (br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
+    if (insp->sym_period >= 1.)
+      for (i = 0; i < count; ++i) {
+        insp->sym_phase += 1.;
+        if (insp->sym_phase >= insp->sym_period)
+          insp->sym_phase -= insp->sym_period;
+
+        if ((int) SU_FLOOR(insp->sym_phase - samp_phase_samples) == 0) {
+          alpha = insp->sym_phase - SU_FLOOR(insp->sym_phase);
+
+          symbols[n++] =
+              .5 * ((1 - alpha) * insp->sym_last_sample + alpha * x[i]);
+        }
+
+        insp->sym_last_sample = x[i];
+      }
+    else if (count > 0)
+      insp->sym_last_sample = x[count - 1];
+  } else {
+    /* Automatic baudrate control enabled */
+    for (i = 0; i < count; ++i) {
+      su_clock_detector_feed(&insp->cd, x[i]);
+
+      if (su_clock_detector_read(&insp->cd, &sample, 1) == 1)
+        symbols[n++] = .5 * sample;
+    }
+  }
+
+  return n;
+}
+
+#define SUSCAN_INSPECTOR_KERNEL(gc, fc, mf, br)                 \
+  suscan_inspector_kernel_ ## gc ## fc ## mf ## br
+
+#define SUSCAN_INSPECTOR_DEFINE_KERNEL(gc, fc, mf, br)          \
+SUPRIVATE unsigned int                                          \
+SUSCAN_INSPECTOR_KERNEL(gc, fc, mf, br)(                        \
+    suscan_inspector_t *insp,                                   \
+    SUCOMPLEX *x,                                               \
+    SUSCOUNT count,                                             \
+    SUCOMPLEX *symbols,                                         \
+    SUFLOAT samp_phase_samples)                                 \
+{                                                               \
+  return suscan_inspector_kernel(                               \
+      insp,                                                     \
+      x,                                                        \
+      count,                                                    \
+      symbols,                                                  \
+      samp_phase_samples,                                       \
+      gc,                                                       \
+      fc,                                                       \
+      mf,                                                       \
+      br);                                                      \
+}
+
+#define SUSCAN_INSPECTOR_DEFINE_KERNELS_BR(gc, fc, mf)          \
+  SUSCAN_INSPECTOR_DEFINE_KERNEL(gc, fc, mf, 0)                 \
+  SUSCAN_INSPECTOR_DEFINE_KERNEL(gc, fc, mf, 1)
+
+#define SUSCAN_INSPECTOR_DEFINE_KERNELS_MF(gc, fc)              \
+  SUSCAN_INSPECTOR_DEFINE_KERNELS_BR(gc, fc, 0)                 \
+  SUSCAN_INSPECTOR_DEFINE_KERNELS_BR(gc, fc, 1)
+
+#define SUSCAN_INSPECTOR_DEFINE_KERNELS_FC(gc)                  \
+  SUSCAN_INSPECTOR_DEFINE_KERNELS_MF(gc, 0)                     \
+  SUSCAN_INSPECTOR_DEFINE_KERNELS_MF(gc, 1)
+
+SUSCAN_INSPECTOR_DEFINE_KERNELS_FC(0)
+SUSCAN_INSPECTOR_DEFINE_KERNELS_FC(1)
+
+#define SUSCAN_INSPECTOR_KERNELS_BR(gc, fc, mf)                 \
+  { SUSCAN_INSPECTOR_KERNEL(gc, fc, mf, 0),                     \
+    SUSCAN_INSPECTOR_KERNEL(gc, fc, mf, 1) }
+
+#define SUSCAN_INSPECTOR_KERNELS_MF(gc, fc)                     \
+  { SUSCAN_INSPECTOR_KERNELS_BR(gc, fc, 0),                     \
+    SUSCAN_INSPECTOR_KERNELS_BR(gc, fc, 1) }
+
+#define SUSCAN_INSPECTOR_KERNELS_FC(gc)                         \
+  { SUSCAN_INSPECTOR_KERNELS_MF(gc, 0),                         \
+    SUSCAN_INSPECTOR_KERNELS_MF(gc, 1) }
+
+/* Indexed by gc_ctrl, carrier recovery enabled, mf_conf and br_ctrl */
+SUPRIVATE const suscan_inspector_kernel_t suscan_inspector_kernels[2][2][2][2] = {
+  SUSCAN_INSPECTOR_KERNELS_FC(0),
+  SUSCAN_INSPECTOR_KERNELS_FC(1)
+};
+
+SUPRIVATE void
+suscan_inspector_select_kernel(suscan_inspector_t *insp)
+{
+  insp->kernel = suscan_inspector_kernels
+      [insp->params.gc_ctrl == SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC]
+      [insp->params.fc_ctrl != SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL]
+      [insp->params.mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL]
+      [insp->params.br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_GARDNER];
+}
+
+/*
+ * Feed samples to the channel detectors, collecting the decimated output
+ * in insp->stage. Stops when count samples were read, or when max
+ * decimated samples were produced. Returns the number of input samples
+ * read, or -1 on error.
+ */
+SUPRIVATE int
+suscan_inspector_feed_detectors(
     suscan_inspector_t *insp,
     const SUCOMPLEX *x,
-    int count)
+    int count,
+    SUSCOUNT max,
+    SUSCOUNT *decimated)
 {
   int i;
-  SUFLOAT alpha;
+  SUSCOUNT n = 0;
   SUCOMPLEX det_x;
-  SUCOMPLEX sample;
-  SUCOMPLEX samp_phase_samples = insp->params.sym_phase * insp->sym_period;
-  SUBOOL ok = SU_FALSE;
-
-  insp->sym_new_sample = SU_FALSE;
 
-  for (i = 0; i < count && !insp->sym_new_sample; ++i) {
+  for (i = 0; i < count && n < max; ++i) {
     /*
-     * Feed channel detectors. TODO: use su_channel_detector_get_last_sample
-     * with nln_baud_det.
+     * The FAC detector also centers and decimates the channel for the
+     * rest of the chain. Skip sample if it was not consumed due to
+     * decimator.
      */
-    SU_TRYCATCH(
-        su_channel_detector_feed(insp->fac_baud_det, x[i]),
-        goto done);
-    SU_TRYCATCH(
-        su_channel_detector_feed(insp->nln_baud_det, x[i]),
-        goto done);
+    SU_TRYCATCH(su_channel_detector_feed(insp->fac_baud_det, x[i]), return -1);
 
-    /*
-     * Verify the detector signal. Skip sample if it was not consumed
-     * due to decimator.
-     */
     if (!su_channel_detector_sample_was_consumed(insp->fac_baud_det))
       continue;
 
@@ -348,78 +701,112 @@ suscan_inspector_feed_bulk(
 
     det_x = su_channel_detector_get_last_sample(insp->fac_baud_det);
 
-    /* Re-center carrier */
-    det_x *= SU_C_CONJ(su_ncqo_read(&insp->lo)) * insp->phase;
+    /* Non-linear detector only when somebody needs it */
+    if (insp->nln_active)
+      SU_TRYCATCH(
+          su_channel_detector_feed(insp->nln_baud_det, det_x),
+          return -1);
 
-    /* Perform gain control */
-    switch (insp->params.gc_ctrl) {
-      case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        det_x *= 2 * insp->params.gc_gain;
-        break;
+    insp->stage[n++] = det_x;
+  }
 
-      case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        det_x  = 2 * su_agc_feed(&insp->agc, det_x) * 1.4142;
-        break;
-    }
+  *decimated = n;
 
-    /* Perform frequency correction */
-    switch (insp->params.fc_ctrl) {
-      case SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL:
-        sample = det_x;
-        break;
-
-      case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_2:
-        su_costas_feed(&insp->costas_2, det_x);
-        sample = insp->costas_2.y;
-        break;
-
-      case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_4:
-        su_costas_feed(&insp->costas_4, det_x);
-        sample = insp->costas_4.y;
-        break;
-
-      case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_8:
-        su_costas_feed(&insp->costas_8, det_x);
-        sample = insp->costas_8.y;
-        break;
-    }
+  return i;
+}
 
-    /* Add matched filter, if enabled */
-    if (insp->params.mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
-      sample = su_iir_filt_feed(&insp->mf, sample);
+/* Legacy interface: stops right after the first symbol */
+int
+suscan_inspector_feed_bulk(
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    int count)
+{
+  unsigned int n;
+  int fed;
 
-    /* Check if channel sampler is enabled */
-    if (insp->params.br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
-      if (insp->sym_period >= 1.) {
-        insp->sym_phase += 1.;
-        if (insp->sym_phase >= insp->sym_period)
-          insp->sym_phase -= insp->sym_period;
+  fed = suscan_inspector_feed_bulk_symbols(
+      insp,
+      x,
+      count,
+      &insp->sym_sampler_output,
+      1,
+      &n);
 
-        insp->sym_new_sample =
-            (int) SU_FLOOR(insp->sym_phase - samp_phase_samples) == 0;
+  insp->sym_new_sample = n > 0;
 
-        if (insp->sym_new_sample) {
-          alpha = insp->sym_phase - SU_FLOOR(insp->sym_phase);
+  return fed;
+}
 
-          insp->sym_sampler_output =
-              .5 * ((1 - alpha) * insp->sym_last_sample + alpha * sample);
+/*
+ * Upper bound of the number of symbols produced after feeding count
+ * samples, given the current symbol period. Used to presize batches.
+ */
+unsigned int
+suscan_inspector_get_expected_symbols(
+    const suscan_inspector_t *insp,
+    SUSCOUNT count)
+{
+  SUFLOAT fs = su_channel_detector_get_fs(insp->fac_baud_det);
 
-        }
-      }
-      insp->sym_last_sample = sample;
-    } else {
-      /* Automatic baudrate control enabled */
-      su_clock_detector_feed(&insp->cd, sample);
-
-      insp->sym_new_sample = su_clock_detector_read(&insp->cd, &sample, 1) == 1;
-      if (insp->sym_new_sample)
-        insp->sym_sampler_output = .5 * sample;
+  if (insp->sym_period < 1. || fs <= 0)
+    return 0;
+
+  return (unsigned int)
+      SU_CEIL(count * insp->equiv_fs / (fs * insp->sym_period)) + 1;
+}
+
+/*
+ * Bulk mode: process samples until either the input is exhausted or the
+ * symbol buffer is full. Every symbol produced is appended to symbols[],
+ * and the number of stored symbols is returned in *symbol_count. Caller
+ * is expected to call suscan_inspector_assert_params once per buffer.
+ */
+int
+suscan_inspector_feed_bulk_symbols(
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    int count,
+    SUCOMPLEX *symbols,
+    unsigned int symbol_storage,
+    unsigned int *symbol_count)
+{
+  int i = 0;
+  int fed;
+  unsigned int n = 0;
+  SUSCOUNT decimated;
+  SUFLOAT samp_phase_samples = insp->params.sym_phase * insp->sym_period;
+
+  /*
+   * At most one symbol per decimated sample: blocks never produce more
+   * symbols than there is room for.
+   */
+  while (i < count && n < symbol_storage) {
+    if ((fed = suscan_inspector_feed_detectors(
+        insp,
+        x + i,
+        count - i,
+        SU_MIN(symbol_storage - n, SUSCAN_INSPECTOR_STAGE_SIZE),
+        &decimated)) == -1) {
+      *symbol_count = n;
+      return -1;
     }
+
+    i += fed;
+
+    /* Squelch closed: nothing worth demodulating here */
+    if (!suscan_inspector_update_squelch(insp, insp->stage, decimated))
+      continue;
+
+    n += (insp->kernel)(
+        insp,
+        insp->stage,
+        decimated,
+        symbols + n,
+        samp_phase_samples);
   }
 
-  ok = SU_TRUE;
+  *symbol_count = n;
 
-done:
-  return ok ? i : -1;
+  return i;
 }
-
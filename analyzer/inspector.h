@@ -27,10 +27,29 @@
 #include <sigutils/clock.h>
 #include <sigutils/detect.h>
 
+#include "buffer.h"
+#include "slot.h"
+#include "recorder.h"
+
 #define SUHANDLE int32_t
 
+#define SUSCAN_INSPECTOR_QUEUE_SIZE 8 /* Buffers waiting to be processed */
+
 #define SUSCAN_ANALYZER_CPU_USAGE_UPDATE_ALPHA .025
 
+#define SUSCAN_INSPECTOR_STAGE_SIZE 512 /* Decimated samples per block */
+
+/* Seconds of signal the NLN detector keeps running after a GET_INFO */
+#define SUSCAN_INSPECTOR_NLN_HOLD_TIME 10
+
+/* Seconds of display credit a rate-limited inspector may save up */
+#define SUSCAN_INSPECTOR_DISPLAY_BURST .1
+
+/* Squelch: seconds held open after the last loud block */
+#define SUSCAN_INSPECTOR_SQUELCH_HANG_TIME   .5
+#define SUSCAN_INSPECTOR_SQUELCH_FLOOR_ALPHA .01 /* Noise floor rise rate */
+#define SUSCAN_INSPECTOR_SQUELCH_MIN_POWER   1e-20
+
 enum suscan_aync_state {
   SUSCAN_ASYNC_STATE_CREATED,
   SUSCAN_ASYNC_STATE_RUNNING,
@@ -71,6 +90,12 @@ enum suscan_inspector_psd_source {
   SUSCAN_INSPECTOR_PSD_SOURCE_NLN
 };
 
+/* What happens to the loops while the squelch is closed */
+enum suscan_inspector_squelch_policy {
+  SUSCAN_INSPECTOR_SQUELCH_POLICY_HOLD, /* Resume from the last state */
+  SUSCAN_INSPECTOR_SQUELCH_POLICY_RESET /* Start over on every burst */
+};
+
 struct suscan_inspector_params {
   uint32_t inspector_id;
 
@@ -96,39 +121,118 @@ struct suscan_inspector_params {
   enum suscan_inspector_psd_source psd_source; /* Spectrum source */
   SUFLOAT sym_phase;  /* Symbol phase */
   SUFLOAT baud;       /* Baudrate */
+
+  /*
+   * Symbols per second delivered in sample batches, 0: all of them.
+   * Displays don't need more than they can draw. Recorders attached to
+   * the inspector always get every symbol.
+   */
+  SUFLOAT display_rate;
+
+  /* Squelch. Quiet channel samples skip the demodulator */
+  SUBOOL  squelch;
+  SUFLOAT squelch_level; /* Opening threshold, dB over the noise floor */
+  enum suscan_inspector_squelch_policy squelch_policy;
 };
 
+struct suscan_analyzer;
+struct suscan_analyzer_sample_batch_pool;
+struct suscan_analyzer_psd_pool;
+struct suscan_consumer;
+struct suscan_channelizer_channel;
+struct suscan_inspector;
+
+/* Processing chain, specialized for each parameter combination */
+typedef unsigned int (*suscan_inspector_kernel_t) (
+    struct suscan_inspector *insp,
+    SUCOMPLEX *x,
+    SUSCOUNT count,
+    SUCOMPLEX *symbols,
+    SUFLOAT samp_phase_samples);
+
 /* TODO: protect baudrate access with mutexes */
 struct suscan_inspector {
   struct sigutils_channel channel;
   SUFLOAT                 equiv_fs; /* Equivalent sample rate */
   su_channel_detector_t  *fac_baud_det; /* FAC baud detector */
-  su_channel_detector_t  *nln_baud_det; /* Non-linear baud detector */
+  su_channel_detector_t  *nln_baud_det; /* Non-linear baud detector, fed
+                                           from the FAC detector output */
   su_agc_t                agc;      /* AGC, for sampler */
-  su_costas_t             costas_2; /* 2nd order Costas loop */
-  su_costas_t             costas_4; /* 4th order Costas loop */
-  su_costas_t             costas_8; /* 8th order Costas loop */
+  struct su_agc_params    agc_params; /* Kept to restart the AGC */
+  su_costas_t             costas;   /* Costas loop, of costas_kind */
+  enum sigutils_costas_kind costas_kind;
+  SUFLOAT                 costas_bw; /* Arm filter bandwidth (normalized) */
   su_iir_filt_t           mf;       /* Matched filter (Root Raised Cosine) */
   su_clock_detector_t     cd;       /* Clock detector */
   su_ncqo_t               lo;       /* Oscillator for manual carrier offset */
   SUCOMPLEX               phase;    /* Local oscillator phase */
 
+  /* Sub-band of the shared channelizer. NULL: fed at the source rate */
+  struct suscan_channelizer_channel *chan;
+
   /* Spectrum state */
   SUFLOAT                 interval_psd;
   SUSCOUNT                per_cnt_psd;
   SUBOOL                  pending;
 
-  /* Inspector parameters */
-  pthread_mutex_t params_mutex;
+  /*
+   * Baud detector demand. info_req is bumped by the analyzer thread on
+   * every GET_INFO, the rest is only touched by the consumer.
+   */
+  unsigned int            info_req;
+  unsigned int            info_req_seen;
+  SUSCOUNT                nln_hold;   /* Samples left with NLN enabled */
+  SUBOOL                  nln_active;
+
+  /* Inspector parameters. params is the consumer's copy of params_slot */
+  struct suscan_param_slot params_slot;
+  unsigned int params_gen;
   struct suscan_inspector_params params;
-  struct suscan_inspector_params params_request;
-  SUBOOL    params_requested;
   SUBOOL    sym_new_sample;     /* New sample flag */
   SUCOMPLEX sym_last_sample;    /* Last sample fed to inspector */
   SUCOMPLEX sym_sampler_output; /* Sampler output */
   SUFLOAT   sym_phase;          /* Current sampling phase, in samples */
   SUFLOAT   sym_period;         /* In samples */
 
+  /* Processing kernel for the current params, and its input block */
+  suscan_inspector_kernel_t kernel;
+  SUCOMPLEX stage[SUSCAN_INSPECTOR_STAGE_SIZE];
+
+  /* Symbol recorder, if any */
+  struct suscan_recorder_slot recorder_slot;
+
+  /* Squelch state, consumer only */
+  SUBOOL   squelch_open;
+  SUFLOAT  squelch_floor; /* Mean power of quiet blocks */
+  SUSCOUNT squelch_hang;  /* Samples left before closing */
+
+  /* Symbols the client may still take, with display_rate > 0 */
+  SUFLOAT display_credit;
+  SUFLOAT display_phase; /* Decimation phase, carried across batches */
+
+  /* Sample batch messages and spectrum frames, reused across updates */
+  struct suscan_analyzer_sample_batch_pool *sample_pool;
+  struct suscan_analyzer_psd_pool *psd_pool;
+
+  /* Statistics. stats_* members are only touched by the source worker */
+  uint64_t sym_total;       /* Symbols delivered so far */
+  uint64_t stats_sym_last;  /* sym_total in the previous stats update */
+  uint64_t stats_time_last; /* Time of the previous stats update (ns) */
+
+  /* Scheduler state, protected by sched_lock */
+  pthread_mutex_t sched_lock;
+  pthread_cond_t  sched_cond; /* Signaled when a queue slot is released */
+  struct suscan_sample_buffer *sched_queue[SUSCAN_INSPECTOR_QUEUE_SIZE];
+  unsigned int sched_head;
+  unsigned int sched_count;
+  SUSCOUNT sched_lost;  /* Samples dropped since last warning */
+  uint64_t sched_lost_total; /* Samples dropped since the inspector opened */
+  SUBOOL   sched_ready; /* In a run queue, or being processed */
+  unsigned int sched_waiters; /* Publishers blocked on sched_cond */
+  struct suscan_consumer  *sched_home; /* Consumer that ran it last */
+  struct suscan_inspector *sched_next; /* Next in run queue */
+  struct suscan_analyzer  *sched_analyzer; /* Owner, set on attach */
+
   enum suscan_aync_state state; /* Used to remove analyzer from queue */
 };
 
@@ -137,6 +241,8 @@ typedef struct suscan_inspector suscan_inspector_t;
 
 void suscan_inspector_destroy(suscan_inspector_t *chanal);
 
+void suscan_inspector_flush_queue(suscan_inspector_t *insp);
+
 void suscan_inspector_params_initialize(
     struct suscan_inspector_params *params);
 
@@ -149,10 +255,30 @@ int suscan_inspector_feed_bulk(
     const SUCOMPLEX *x,
     int count);
 
+unsigned int suscan_inspector_get_expected_symbols(
+    const suscan_inspector_t *insp,
+    SUSCOUNT count);
+
+int suscan_inspector_feed_bulk_symbols(
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    int count,
+    SUCOMPLEX *symbols,
+    unsigned int symbol_storage,
+    unsigned int *symbol_count);
+
 void suscan_inspector_request_params(
     suscan_inspector_t *insp,
     struct suscan_inspector_params *params_request);
 
 void suscan_inspector_assert_params(suscan_inspector_t *insp);
 
+void suscan_inspector_get_params(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_params *params);
+
+void suscan_inspector_request_baud_info(suscan_inspector_t *insp);
+
+void suscan_inspector_update_baud_det(suscan_inspector_t *insp, SUSCOUNT count);
+
 #endif /* _INSPECTOR_H */
@@ -25,15 +25,31 @@
 #include <libgen.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <errno.h>
+#include <time.h>
 
 #include "mq.h"
 
 #ifdef SUSCAN_MQ_USE_POOL
 
+/*
+ * Message nodes are cached per thread. The process-wide pool is only
+ * touched when a thread cache runs empty (refill) or grows past
+ * SUSCAN_MQ_CACHE_SIZE (spill), and always in batches.
+ */
+struct suscan_msg_cache {
+  struct suscan_msg *head;
+  unsigned int count;
+  SUBOOL registered;
+};
+
 SUPRIVATE pthread_mutex_t msg_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 SUPRIVATE struct suscan_msg *msg_pool = NULL;
-SUPRIVATE int msg_pool_size;
-SUPRIVATE int msg_pool_peak;
+SUPRIVATE struct suscan_mq_pool_stats msg_pool_stats;
+
+SUPRIVATE pthread_once_t msg_cache_once = PTHREAD_ONCE_INIT;
+SUPRIVATE pthread_key_t  msg_cache_key;
+SUPRIVATE __thread struct suscan_msg_cache msg_cache;
 
 SUPRIVATE void
 suscan_msg_pool_enter(void)
@@ -48,24 +64,106 @@ suscan_msg_pool_leave(void)
   (void) pthread_mutex_unlock(&msg_pool_mutex);
 }
 
-SUPRIVATE struct suscan_msg *
-suscan_mq_alloc_msg(void)
+/* Move up to count nodes from the cache to the global pool */
+SUPRIVATE void
+suscan_msg_cache_spill(struct suscan_msg_cache *cache, unsigned int count)
 {
-  struct suscan_msg *msg = NULL;
+  struct suscan_msg *msg;
+
   suscan_msg_pool_enter();
 
-  if (msg_pool != NULL) {
-    msg = msg_pool;
+  while (count-- > 0 && (msg = cache->head) != NULL) {
+    cache->head = msg->free_next;
+    --cache->count;
+
+    msg->free_next = msg_pool;
+    msg_pool = msg;
+
+    ++msg_pool_stats.pool_size;
+  }
+
+  if (msg_pool_stats.pool_size > msg_pool_stats.pool_peak)
+    msg_pool_stats.pool_peak = msg_pool_stats.pool_size;
+
+  ++msg_pool_stats.spills;
+
+  suscan_msg_pool_leave();
+}
+
+SUPRIVATE void
+suscan_msg_cache_refill(struct suscan_msg_cache *cache)
+{
+  struct suscan_msg *msg;
+  unsigned int count = SUSCAN_MQ_CACHE_BATCH;
+
+  suscan_msg_pool_enter();
+
+  while (count-- > 0 && (msg = msg_pool) != NULL) {
     msg_pool = msg->free_next;
+    --msg_pool_stats.pool_size;
 
-    --msg_pool_size;
+    msg->free_next = cache->head;
+    cache->head = msg;
+    ++cache->count;
   }
 
+  ++msg_pool_stats.refills;
+
   suscan_msg_pool_leave();
+}
 
-  /* Fallback to malloc. TODO: add a message limit here */
-  if (msg == NULL)
+/* Called on thread exit: give the cached nodes back */
+SUPRIVATE void
+suscan_msg_cache_destructor(void *ptr)
+{
+  struct suscan_msg_cache *cache = (struct suscan_msg_cache *) ptr;
+
+  suscan_msg_cache_spill(cache, cache->count);
+
+  suscan_msg_pool_enter();
+  --msg_pool_stats.thread_caches;
+  suscan_msg_pool_leave();
+}
+
+SUPRIVATE void
+suscan_msg_cache_key_init(void)
+{
+  (void) pthread_key_create(&msg_cache_key, suscan_msg_cache_destructor);
+}
+
+SUINLINE struct suscan_msg_cache *
+suscan_msg_cache_get(void)
+{
+  if (!msg_cache.registered) {
+    (void) pthread_once(&msg_cache_once, suscan_msg_cache_key_init);
+    (void) pthread_setspecific(msg_cache_key, &msg_cache);
+    msg_cache.registered = SU_TRUE;
+
+    suscan_msg_pool_enter();
+    ++msg_pool_stats.thread_caches;
+    suscan_msg_pool_leave();
+  }
+
+  return &msg_cache;
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_alloc_msg(void)
+{
+  struct suscan_msg_cache *cache = suscan_msg_cache_get();
+  struct suscan_msg *msg;
+
+  if (cache->head == NULL)
+    suscan_msg_cache_refill(cache);
+
+  if ((msg = cache->head) != NULL) {
+    cache->head = msg->free_next;
+    --cache->count;
+  } else {
+    /* Fallback to malloc. TODO: add a message limit here */
+    __atomic_add_fetch(&msg_pool_stats.mallocs, 1, __ATOMIC_RELAXED);
     msg = (struct suscan_msg *) malloc (sizeof (struct suscan_msg));
+  }
 
   return msg;
 }
@@ -73,24 +171,23 @@ suscan_mq_alloc_msg(void)
 SUPRIVATE void
 suscan_mq_return_msg(struct suscan_msg *msg)
 {
-  int msg_pool_peak_copy = -1;
-  suscan_msg_pool_enter();
+  struct suscan_msg_cache *cache = suscan_msg_cache_get();
 
-  msg->free_next = msg_pool;
-  msg_pool = msg;
+  msg->free_next = cache->head;
+  cache->head = msg;
 
-  ++msg_pool_size;
-  if (msg_pool_size > msg_pool_peak) {
-    msg_pool_peak = msg_pool_size;
-    msg_pool_peak_copy = msg_pool_peak;
-  }
+  if (++cache->count > SUSCAN_MQ_CACHE_SIZE)
+    suscan_msg_cache_spill(cache, SUSCAN_MQ_CACHE_BATCH);
+}
 
+void
+suscan_mq_get_pool_stats(struct suscan_mq_pool_stats *stats)
+{
+  suscan_msg_pool_enter();
+  *stats = msg_pool_stats;
   suscan_msg_pool_leave();
 
-  if ((msg_pool_peak_copy % SUSCAN_MQ_POOL_WARNING_THRESHOLD) == 0)
-    SU_WARNING(
-        "Message pool freelist grew to %d elements!\n",
-        msg_pool_peak_copy);
+  stats->mallocs = __atomic_load_n(&msg_pool_stats.mallocs, __ATOMIC_RELAXED);
 }
 
 #else
@@ -105,6 +202,12 @@ suscan_mq_return_msg(struct suscan_msg *msg)
 {
   free(msg);
 }
+
+void
+suscan_mq_get_pool_stats(struct suscan_mq_pool_stats *stats)
+{
+  memset(stats, 0, sizeof(struct suscan_mq_pool_stats));
+}
 #endif
 
 SUPRIVATE void
@@ -125,22 +228,6 @@ suscan_mq_notify(struct suscan_mq *mq)
   pthread_cond_broadcast(&mq->acquire_cond);
 }
 
-SUPRIVATE void
-suscan_mq_wait_unsafe(struct suscan_mq *mq)
-{
-  pthread_cond_wait(&mq->acquire_cond, &mq->acquire_lock);
-}
-
-void
-suscan_mq_wait(struct suscan_mq *mq)
-{
-  suscan_mq_enter(mq);
-
-  suscan_mq_wait_unsafe(mq);
-
-  suscan_mq_leave(mq);
-}
-
 SUPRIVATE struct suscan_msg *
 suscan_msg_new(uint32_t type, void *private)
 {
@@ -161,6 +248,115 @@ suscan_msg_destroy(struct suscan_msg *msg)
   suscan_mq_return_msg(msg);
 }
 
+/****************************** Lock-free ring *******************************/
+SUPRIVATE SUBOOL
+suscan_mq_ring_push(struct suscan_mq *mq, struct suscan_msg *msg)
+{
+  struct suscan_mq_cell *cell;
+  uint64_t pos, seq;
+  int64_t dif;
+
+  pos = __atomic_load_n(&mq->enq_pos, __ATOMIC_RELAXED);
+
+  for (;;) {
+    cell = mq->ring + (pos & mq->ring_mask);
+    seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    dif  = (int64_t) seq - (int64_t) pos;
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(
+          &mq->enq_pos,
+          &pos,
+          pos + 1,
+          SU_TRUE,
+          __ATOMIC_SEQ_CST,
+          __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0) {
+      return SU_FALSE; /* Full */
+    } else {
+      pos = __atomic_load_n(&mq->enq_pos, __ATOMIC_RELAXED);
+    }
+  }
+
+  cell->msg = msg;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+  /* Only now may readers tell the write apart, see get_write_seq */
+  __atomic_add_fetch(&mq->pub_seq, 1, __ATOMIC_SEQ_CST);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_ring_pop(struct suscan_mq *mq)
+{
+  struct suscan_mq_cell *cell;
+  struct suscan_msg *msg;
+  uint64_t pos, seq;
+  int64_t dif;
+
+  if (mq->ring == NULL)
+    return NULL;
+
+  pos = __atomic_load_n(&mq->deq_pos, __ATOMIC_RELAXED);
+
+  for (;;) {
+    cell = mq->ring + (pos & mq->ring_mask);
+    seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    dif  = (int64_t) seq - (int64_t) (pos + 1);
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(
+          &mq->deq_pos,
+          &pos,
+          pos + 1,
+          SU_TRUE,
+          __ATOMIC_RELAXED,
+          __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0) {
+      return NULL; /* Empty */
+    } else {
+      pos = __atomic_load_n(&mq->deq_pos, __ATOMIC_RELAXED);
+    }
+  }
+
+  msg = cell->msg;
+  __atomic_store_n(&cell->seq, pos + mq->ring_mask + 1, __ATOMIC_RELEASE);
+
+  return msg;
+}
+
+/*
+ * Changes every time a message is written, no matter the path. Used by
+ * readers to decide whether they can go to sleep. enq_pos cannot be used
+ * here: it moves before the cell is published, and a reader could take
+ * it after the move, find the cell empty and sleep on a queued message.
+ */
+SUINLINE uint64_t
+suscan_mq_get_write_seq(struct suscan_mq *mq)
+{
+  return __atomic_load_n(&mq->pub_seq, __ATOMIC_SEQ_CST)
+      + __atomic_load_n(&mq->lseq, __ATOMIC_SEQ_CST);
+}
+
+/* Approximate number of queued messages, for statistics only */
+unsigned int
+suscan_mq_get_depth(struct suscan_mq *mq)
+{
+  uint64_t deq, enq;
+
+  /* Dequeue position first: it never goes past the enqueue position */
+  deq = __atomic_load_n(&mq->deq_pos, __ATOMIC_ACQUIRE);
+  enq = __atomic_load_n(&mq->enq_pos, __ATOMIC_ACQUIRE);
+
+  return __atomic_load_n(&mq->count, __ATOMIC_RELAXED)
+      + __atomic_load_n(&mq->ov_count, __ATOMIC_RELAXED)
+      + (enq > deq ? enq - deq : 0);
+}
+
+/******************************* Locked lists ********************************/
 SUPRIVATE void
 suscan_mq_push_front(struct suscan_mq *mq, struct suscan_msg *msg)
 {
@@ -169,32 +365,39 @@ suscan_mq_push_front(struct suscan_mq *mq, struct suscan_msg *msg)
 
   if (mq->tail == NULL)
     mq->tail = msg;
+
+  __atomic_add_fetch(&mq->count, 1, __ATOMIC_RELEASE);
 }
 
 SUPRIVATE void
-suscan_mq_push(struct suscan_mq *mq, struct suscan_msg *msg)
+suscan_msg_list_push(
+    struct suscan_msg **head,
+    struct suscan_msg **tail,
+    struct suscan_msg *msg)
 {
-  if (mq->tail != NULL)
-    mq->tail->next = msg;
+  msg->next = NULL;
 
-  mq->tail = msg;
+  if (*tail != NULL)
+    (*tail)->next = msg;
 
-  if (mq->head == NULL)
-    mq->head = msg;
+  *tail = msg;
+
+  if (*head == NULL)
+    *head = msg;
 }
 
 SUPRIVATE struct suscan_msg *
-suscan_mq_pop(struct suscan_mq *mq)
+suscan_msg_list_pop(struct suscan_msg **head, struct suscan_msg **tail)
 {
   struct suscan_msg *msg;
 
-  if ((msg = mq->head) == NULL)
+  if ((msg = *head) == NULL)
     return NULL;
 
-  mq->head = msg->next;
+  *head = msg->next;
 
-  if (mq->head == NULL)
-    mq->tail = NULL;
+  if (*head == NULL)
+    *tail = NULL;
 
   msg->next = NULL;
 
@@ -202,12 +405,15 @@ suscan_mq_pop(struct suscan_mq *mq)
 }
 
 SUPRIVATE struct suscan_msg *
-suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
+suscan_msg_list_pop_w_type(
+    struct suscan_msg **head,
+    struct suscan_msg **tail,
+    uint32_t type)
 {
   struct suscan_msg *this, *prev;
 
   prev = NULL;
-  this = mq->head;
+  this = *head;
 
   while (this != NULL) {
     if (this->type == type)
@@ -218,12 +424,12 @@ suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
 
   if (this != NULL) {
     if (prev == NULL)
-      mq->head = this->next;
+      *head = this->next;
     else
       prev->next = this->next;
 
-    if (this == mq->tail)
-      mq->tail = prev;
+    if (this == *tail)
+      *tail = prev;
 
     this->next = NULL;
   }
@@ -231,6 +437,132 @@ suscan_mq_pop_w_type(struct suscan_mq *mq, uint32_t type)
   return this;
 }
 
+SUPRIVATE void
+suscan_mq_push(struct suscan_mq *mq, struct suscan_msg *msg)
+{
+  suscan_msg_list_push(&mq->head, &mq->tail, msg);
+  __atomic_add_fetch(&mq->count, 1, __ATOMIC_RELEASE);
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_pop(struct suscan_mq *mq)
+{
+  struct suscan_msg *msg;
+
+  if ((msg = suscan_msg_list_pop(&mq->head, &mq->tail)) != NULL)
+    __atomic_sub_fetch(&mq->count, 1, __ATOMIC_RELEASE);
+
+  return msg;
+}
+
+SUPRIVATE void
+suscan_mq_push_overflow(struct suscan_mq *mq, struct suscan_msg *msg)
+{
+  suscan_msg_list_push(&mq->ov_head, &mq->ov_tail, msg);
+  __atomic_add_fetch(&mq->ov_count, 1, __ATOMIC_RELEASE);
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_pop_overflow(struct suscan_mq *mq)
+{
+  struct suscan_msg *msg;
+
+  if ((msg = suscan_msg_list_pop(&mq->ov_head, &mq->ov_tail)) != NULL)
+    __atomic_sub_fetch(&mq->ov_count, 1, __ATOMIC_RELEASE);
+
+  return msg;
+}
+
+/* Messages are read in order: locked list, ring, overflow list. */
+SUPRIVATE struct suscan_msg *
+suscan_mq_pop_any(struct suscan_mq *mq)
+{
+  struct suscan_msg *msg;
+
+  if (mq->ring != NULL
+      && __atomic_load_n(&mq->count, __ATOMIC_ACQUIRE) == 0) {
+    if ((msg = suscan_mq_ring_pop(mq)) != NULL)
+      return msg;
+
+    if (__atomic_load_n(&mq->ov_count, __ATOMIC_ACQUIRE) == 0)
+      return NULL;
+  }
+
+  suscan_mq_enter(mq);
+
+  if ((msg = suscan_mq_pop(mq)) == NULL)
+    if ((msg = suscan_mq_ring_pop(mq)) == NULL)
+      msg = suscan_mq_pop_overflow(mq);
+
+  suscan_mq_leave(mq);
+
+  return msg;
+}
+
+SUPRIVATE struct suscan_msg *
+suscan_mq_pop_w_type_any(struct suscan_mq *mq, uint32_t type)
+{
+  struct suscan_msg *msg, *this;
+
+  suscan_mq_enter(mq);
+
+  /* Typed reads need random access: move the ring contents to the list */
+  while ((this = suscan_mq_ring_pop(mq)) != NULL)
+    suscan_mq_push(mq, this);
+
+  if ((msg = suscan_msg_list_pop_w_type(&mq->head, &mq->tail, type)) != NULL)
+    __atomic_sub_fetch(&mq->count, 1, __ATOMIC_RELEASE);
+  else if ((msg = suscan_msg_list_pop_w_type(
+      &mq->ov_head,
+      &mq->ov_tail,
+      type)) != NULL)
+    __atomic_sub_fetch(&mq->ov_count, 1, __ATOMIC_RELEASE);
+
+  suscan_mq_leave(mq);
+
+  return msg;
+}
+
+/*
+ * Sleep until something is written after `seq' was taken, or until the
+ * deadline (if any) passes. The waiting counter is what lets ring writers
+ * skip the lock when nobody sleeps.
+ */
+SUPRIVATE SUBOOL
+suscan_mq_sleep(
+    struct suscan_mq *mq,
+    uint64_t seq,
+    const struct timespec *deadline)
+{
+  SUBOOL woken = SU_TRUE;
+
+  suscan_mq_enter(mq);
+
+  __atomic_add_fetch(&mq->waiting, 1, __ATOMIC_SEQ_CST);
+
+  if (suscan_mq_get_write_seq(mq) == seq) {
+    if (deadline == NULL)
+      pthread_cond_wait(&mq->acquire_cond, &mq->acquire_lock);
+    else
+      woken = pthread_cond_timedwait(
+          &mq->acquire_cond,
+          &mq->acquire_lock,
+          deadline) != ETIMEDOUT;
+  }
+
+  __atomic_sub_fetch(&mq->waiting, 1, __ATOMIC_SEQ_CST);
+
+  suscan_mq_leave(mq);
+
+  return woken;
+}
+
+void
+suscan_mq_wait(struct suscan_mq *mq)
+{
+  (void) suscan_mq_sleep(mq, suscan_mq_get_write_seq(mq), NULL);
+}
+
 SUPRIVATE struct suscan_msg *
 suscan_mq_read_msg_internal(
     struct suscan_mq *mq,
@@ -238,17 +570,21 @@ suscan_mq_read_msg_internal(
     uint32_t type)
 {
   struct suscan_msg *msg;
+  uint64_t seq;
 
-  suscan_mq_enter(mq);
+  for (;;) {
+    seq = suscan_mq_get_write_seq(mq);
 
-  if (with_type)
-    while ((msg = suscan_mq_pop_w_type(mq, type)) == NULL)
-      suscan_mq_wait_unsafe(mq);
-  else
-    while ((msg = suscan_mq_pop(mq)) == NULL)
-      suscan_mq_wait_unsafe(mq);
+    if (with_type)
+      msg = suscan_mq_pop_w_type_any(mq, type);
+    else
+      msg = suscan_mq_pop_any(mq);
 
-  suscan_mq_leave(mq);
+    if (msg != NULL)
+      break;
+
+    (void) suscan_mq_sleep(mq, seq, NULL);
+  }
 
   return msg;
 }
@@ -301,18 +637,10 @@ suscan_mq_read_msg_w_type(struct suscan_mq *mq, uint32_t type)
 struct suscan_msg *
 suscan_mq_poll_msg_internal(struct suscan_mq *mq, SUBOOL with_type, uint32_t type)
 {
-  struct suscan_msg *msg;
-
-  suscan_mq_enter(mq);
-
   if (with_type)
-    msg = suscan_mq_pop_w_type(mq, type);
+    return suscan_mq_pop_w_type_any(mq, type);
   else
-    msg = suscan_mq_pop(mq);
-
-  suscan_mq_leave(mq);
-
-  return msg;
+    return suscan_mq_pop_any(mq);
 }
 
 SUPRIVATE SUBOOL
@@ -352,6 +680,36 @@ suscan_mq_poll_w_type(struct suscan_mq *mq, uint32_t type, void **private)
   return suscan_mq_poll_internal(mq, NULL, private, type);
 }
 
+/* Like suscan_mq_poll, but waits up to timeout_ms for a message */
+SUBOOL
+suscan_mq_poll_timeout(
+    struct suscan_mq *mq,
+    uint32_t *type,
+    void **private,
+    unsigned int timeout_ms)
+{
+  struct timespec deadline;
+  uint64_t seq;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec  += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000l;
+  if (deadline.tv_nsec >= 1000000000l) {
+    ++deadline.tv_sec;
+    deadline.tv_nsec -= 1000000000l;
+  }
+
+  for (;;) {
+    seq = suscan_mq_get_write_seq(mq);
+
+    if (suscan_mq_poll(mq, type, private))
+      return SU_TRUE;
+
+    if (!suscan_mq_sleep(mq, seq, &deadline))
+      return suscan_mq_poll(mq, type, private);
+  }
+}
+
 struct suscan_msg *
 suscan_mq_poll_msg(struct suscan_mq *mq)
 {
@@ -367,9 +725,29 @@ suscan_mq_poll_msg_w_type(struct suscan_mq *mq, uint32_t type)
 void
 suscan_mq_write_msg(struct suscan_mq *mq, struct suscan_msg *msg)
 {
+  /* Fast path: no lock is taken unless a reader is sleeping */
+  if (mq->ring != NULL
+      && __atomic_load_n(&mq->ov_count, __ATOMIC_ACQUIRE) == 0
+      && suscan_mq_ring_push(mq, msg)) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&mq->waiting, __ATOMIC_SEQ_CST) > 0) {
+      suscan_mq_enter(mq);
+      suscan_mq_notify(mq);
+      suscan_mq_leave(mq);
+    }
+
+    return;
+  }
+
   suscan_mq_enter(mq);
 
-  suscan_mq_push(mq, msg);
+  if (mq->ring != NULL)
+    suscan_mq_push_overflow(mq, msg);
+  else
+    suscan_mq_push(mq, msg);
+
+  __atomic_add_fetch(&mq->lseq, 1, __ATOMIC_SEQ_CST);
 
   suscan_mq_notify(mq); /* We notify the queue always */
 
@@ -383,6 +761,8 @@ suscan_mq_write_msg_urgent(struct suscan_mq *mq, struct suscan_msg *msg)
 
   suscan_mq_push_front(mq, msg);
 
+  __atomic_add_fetch(&mq->lseq, 1, __ATOMIC_SEQ_CST);
+
   suscan_mq_notify(mq);
 
   suscan_mq_leave(mq);
@@ -424,21 +804,61 @@ suscan_mq_finalize(struct suscan_mq *mq)
 
     while ((msg = suscan_mq_pop(mq)) != NULL)
       suscan_msg_destroy(msg);
+
+    while ((msg = suscan_mq_ring_pop(mq)) != NULL)
+      suscan_msg_destroy(msg);
+
+    while ((msg = suscan_mq_pop_overflow(mq)) != NULL)
+      suscan_msg_destroy(msg);
+  }
+
+  if (mq->ring != NULL) {
+    free(mq->ring);
+    mq->ring = NULL;
   }
 }
 
 SUBOOL
 suscan_mq_init(struct suscan_mq *mq)
 {
+  memset(mq, 0, sizeof(struct suscan_mq));
+
   if (pthread_mutex_init(&mq->acquire_lock, NULL) == -1)
     return SU_FALSE;
 
   if (pthread_cond_init(&mq->acquire_cond, NULL) == -1)
     return SU_FALSE;
 
-  mq->head = NULL;
-  mq->tail = NULL;
-
   return SU_TRUE;
 }
 
+/*
+ * Same as suscan_mq_init, but enables the lock-free ring. Typed reads and
+ * urgent writes are still supported, they just take the locked path.
+ */
+SUBOOL
+suscan_mq_init_ring(struct suscan_mq *mq, unsigned int size)
+{
+  unsigned int i;
+
+  if (size == 0 || (size & (size - 1)) != 0) {
+    SU_ERROR("Message queue ring size must be a power of 2\n");
+    return SU_FALSE;
+  }
+
+  if (!suscan_mq_init(mq))
+    return SU_FALSE;
+
+  SU_TRYCATCH(
+      mq->ring = malloc(size * sizeof(struct suscan_mq_cell)),
+      return SU_FALSE);
+
+  for (i = 0; i < size; ++i) {
+    mq->ring[i].seq = i;
+    mq->ring[i].msg = NULL;
+  }
+
+  mq->ring_mask = size - 1;
+
+  return SU_TRUE;
+}
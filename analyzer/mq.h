@@ -22,11 +22,23 @@
 #define _MQ_H
 
 #include <pthread.h>
+#include <stdint.h>
 #include <sigutils/sigutils.h>
 
 #define SUSCAN_MQ_USE_POOL
 
-#define SUSCAN_MQ_POOL_WARNING_THRESHOLD 100
+#define SUSCAN_MQ_CACHE_SIZE  256 /* Per-thread cached nodes, at most */
+#define SUSCAN_MQ_CACHE_BATCH 64  /* Nodes moved per refill or spill */
+
+/* Message node pool counters, see suscan_mq_get_pool_stats */
+struct suscan_mq_pool_stats {
+  uint64_t pool_size;     /* Nodes in the global pool */
+  uint64_t pool_peak;     /* Largest global pool size seen */
+  uint64_t refills;       /* Thread cache refills from the global pool */
+  uint64_t spills;        /* Thread cache spills to the global pool */
+  uint64_t mallocs;       /* Nodes allocated because no cached node was left */
+  uint64_t thread_caches; /* Threads holding a node cache */
+};
 
 struct suscan_msg {
   uint32_t type;
@@ -38,16 +50,50 @@ struct suscan_msg {
 #endif
 };
 
+/*
+ * Optional lock-free fast path: a bounded multi-producer ring of message
+ * pointers. Writers that find it full fall back to the locked overflow
+ * list, which is only drained once the ring is empty, so per-producer
+ * ordering is preserved. Urgent messages and messages skipped by typed
+ * reads live in the locked list (head, tail), which is always read first.
+ */
+#define SUSCAN_MQ_DEFAULT_RING_SIZE 1024 /* Must be a power of 2 */
+#define SUSCAN_MQ_CACHE_LINE_SIZE   64
+
+struct suscan_mq_cell {
+  uint64_t seq;
+  struct suscan_msg *msg;
+};
+
 struct suscan_mq {
   pthread_mutex_t acquire_lock;
   pthread_cond_t  acquire_cond;
 
   struct suscan_msg *head;
   struct suscan_msg *tail;
+  unsigned int count;     /* Messages in the locked list */
+  uint64_t lseq;          /* Locked write counter */
+  unsigned int waiting;   /* Readers sleeping in acquire_cond */
+
+  /* Lock-free ring. NULL if disabled */
+  struct suscan_mq_cell *ring;
+  uint64_t ring_mask;
+
+  struct suscan_msg *ov_head;
+  struct suscan_msg *ov_tail;
+  unsigned int ov_count;  /* Messages in the overflow list */
+
+  char pad0[SUSCAN_MQ_CACHE_LINE_SIZE];
+  uint64_t enq_pos;
+  uint64_t pub_seq;       /* Ring cells published, bumped after enq_pos */
+  char pad1[SUSCAN_MQ_CACHE_LINE_SIZE];
+  uint64_t deq_pos;
+  char pad2[SUSCAN_MQ_CACHE_LINE_SIZE];
 };
 
 /*************************** Message queue API *******************************/
 SUBOOL suscan_mq_init(struct suscan_mq *mq);
+SUBOOL suscan_mq_init_ring(struct suscan_mq *mq, unsigned int size);
 void   suscan_mq_finalize(struct suscan_mq *mq);
 void  *suscan_mq_read(struct suscan_mq *mq, uint32_t *type);
 void  *suscan_mq_read_w_type(struct suscan_mq *mq, uint32_t type);
@@ -55,6 +101,11 @@ struct suscan_msg *suscan_mq_read_msg(struct suscan_mq *mq);
 struct suscan_msg *suscan_mq_read_msg_w_type(struct suscan_mq *mq, uint32_t type);
 SUBOOL suscan_mq_poll(struct suscan_mq *mq, uint32_t *type, void **private);
 SUBOOL suscan_mq_poll_w_type(struct suscan_mq *mq, uint32_t type, void **private);
+SUBOOL suscan_mq_poll_timeout(
+    struct suscan_mq *mq,
+    uint32_t *type,
+    void **private,
+    unsigned int timeout_ms);
 struct suscan_msg *suscan_mq_poll_msg(struct suscan_mq *mq);
 struct suscan_msg *suscan_mq_poll_msg_w_type(struct suscan_mq *mq, uint32_t type);
 SUBOOL suscan_mq_write(struct suscan_mq *mq, uint32_t type, void *private);
@@ -63,5 +114,7 @@ SUBOOL suscan_mq_write_urgent(struct suscan_mq *mq, uint32_t type, void *private
 void suscan_mq_write_msg(struct suscan_mq *mq, struct suscan_msg *msg);
 void suscan_mq_write_msg_urgent(struct suscan_mq *mq, struct suscan_msg *msg);
 void suscan_msg_destroy(struct suscan_msg *msg);
+void suscan_mq_get_pool_stats(struct suscan_mq_pool_stats *stats);
+unsigned int suscan_mq_get_depth(struct suscan_mq *mq);
 
 #endif /* _MQ_H */
@@ -67,17 +67,49 @@ suscan_analyzer_status_msg_new(uint32_t code, const char *msg)
   return new;
 }
 
+/* Samples lost */
+struct suscan_analyzer_samples_lost_msg *
+suscan_analyzer_samples_lost_msg_new(uint64_t lost, uint64_t total)
+{
+  struct suscan_analyzer_samples_lost_msg *new;
+
+  if ((new = malloc(sizeof(struct suscan_analyzer_samples_lost_msg))) == NULL)
+    return NULL;
+
+  new->lost = lost;
+  new->total = total;
+  new->sender = NULL;
+
+  return new;
+}
+
+void
+suscan_analyzer_samples_lost_msg_destroy(
+    struct suscan_analyzer_samples_lost_msg *msg)
+{
+  free(msg);
+}
+
+/* Pipeline statistics */
+void
+suscan_analyzer_stats_msg_destroy(struct suscan_analyzer_stats_msg *msg)
+{
+  if (msg->consumer_list != NULL)
+    free(msg->consumer_list);
+
+  if (msg->inspector_list != NULL)
+    free(msg->inspector_list);
+
+  free(msg);
+}
+
 void
-suscan_analyzer_channel_msg_take_channels(
-    struct suscan_analyzer_channel_msg *msg,
-    struct sigutils_channel ***pchannel_list,
-    unsigned int *pchannel_count)
+suscan_analyzer_overview_msg_destroy(struct suscan_analyzer_overview_msg *msg)
 {
-  *pchannel_list = msg->channel_list;
-  *pchannel_count = msg->channel_count;
+  if (msg->lines != NULL)
+    free(msg->lines);
 
-  msg->channel_list = NULL;
-  msg->channel_count = 0;
+  free(msg);
 }
 
 void
@@ -92,53 +124,27 @@ suscan_analyzer_channel_msg_destroy(struct suscan_analyzer_channel_msg *msg)
   if (msg->channel_list != NULL)
     free(msg->channel_list);
 
+  if (msg->id_list != NULL)
+    free(msg->id_list);
+
+  if (msg->removed_list != NULL)
+    free(msg->removed_list);
+
   free(msg);
 }
 
 struct suscan_analyzer_channel_msg *
-suscan_analyzer_channel_msg_new(
-    const suscan_analyzer_t *analyzer,
-    struct sigutils_channel **list,
-    unsigned int len)
+suscan_analyzer_channel_msg_new(const suscan_analyzer_t *analyzer)
 {
-  unsigned int i;
   struct suscan_analyzer_channel_msg *new = NULL;
-  unsigned int n = 0;
 
   if ((new = calloc(1, sizeof(struct suscan_analyzer_channel_msg))) == NULL)
-    goto fail;
-
-  if (len > 0)
-    if ((new->channel_list = calloc(len, sizeof(struct sigutils_channel *)))
-        == NULL)
-      goto fail;
+    return NULL;
 
-  new->channel_count = len;
   new->source = analyzer->source.config->source;
   new->sender = analyzer;
 
-  for (i = 0; i < len; ++i)
-    if (list[i] != NULL)
-      if (SU_CHANNEL_IS_VALID(list[i])) {
-        if ((new->channel_list[n] = su_channel_dup(list[i])) == NULL)
-          goto fail;
-
-        new->channel_list[n]->fc   += analyzer->source.fc;
-        new->channel_list[n]->f_hi += analyzer->source.fc;
-        new->channel_list[n]->f_lo += analyzer->source.fc;
-        new->channel_list[n]->ft    = analyzer->source.fc;
-        ++n;
-      }
-
-  new->channel_count = n;
-
   return new;
-
-fail:
-  if (new != NULL)
-    suscan_analyzer_channel_msg_destroy(new);
-
-  return NULL;
 }
 
 struct suscan_analyzer_inspector_msg *
@@ -164,8 +170,8 @@ suscan_analyzer_inspector_msg_destroy(
   free(msg);
 }
 
-void
-suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg)
+SUPRIVATE void
+suscan_analyzer_psd_msg_free(struct suscan_analyzer_psd_msg *msg)
 {
   if (msg->psd_data != NULL)
     free(msg->psd_data);
@@ -173,37 +179,143 @@ suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg)
   free(msg);
 }
 
-struct suscan_analyzer_psd_msg *
-suscan_analyzer_psd_msg_new(const su_channel_detector_t *cd)
+SUPRIVATE void
+suscan_analyzer_psd_pool_destroy(struct suscan_analyzer_psd_pool *pool)
 {
-  struct suscan_analyzer_psd_msg *new = NULL;
-  unsigned int i;
-  SU_TRYCATCH(
-      new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
-      goto fail);
+  struct suscan_analyzer_psd_msg *this;
 
-  new->psd_size = cd->params.window_size;
-  new->samp_rate = cd->params.samp_rate;
+  while ((this = pool->free_list) != NULL) {
+    pool->free_list = this->next;
+    suscan_analyzer_psd_msg_free(this);
+  }
+  pool->free_count = 0;
 
-  if (cd->params.decimation > 1)
-    new->samp_rate /= cd->params.decimation;
+  pthread_mutex_destroy(&pool->mutex);
 
-  new->fc = 0;
+  free(pool);
+}
+
+void
+suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg)
+{
+  struct suscan_analyzer_psd_pool *pool = msg->pool;
+  SUBOOL unused;
+
+  if (pool == NULL) {
+    suscan_analyzer_psd_msg_free(msg);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if (!pool->released) {
+    msg->next = pool->free_list;
+    pool->free_list = msg;
+    ++pool->free_count;
+  } else {
+    suscan_analyzer_psd_msg_free(msg);
+    --pool->allocated;
+  }
+
+  unused = --pool->refcnt == 0;
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (unused)
+    suscan_analyzer_psd_pool_destroy(pool);
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_psd_msg_reserve(
+    struct suscan_analyzer_psd_msg *msg,
+    SUSCOUNT storage)
+{
+  void *new;
+
+  if (storage <= msg->psd_storage)
+    return SU_TRUE;
 
   SU_TRYCATCH(
-      new->psd_data = malloc(sizeof(SUFLOAT) * new->psd_size),
-      goto fail);
+      new = realloc(msg->psd_data, sizeof(SUFLOAT) * storage),
+      return SU_FALSE);
+
+  msg->psd_data = new;
+  msg->psd_storage = storage;
+
+  return SU_TRUE;
+}
+
+/*
+ * Fill message from detector. If width is smaller than the detector
+ * window, adjacent bins are merged keeping their maximum, so narrow
+ * carriers are still visible in the decimated spectrum.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_psd_msg_fill(
+    struct suscan_analyzer_psd_msg *msg,
+    const su_channel_detector_t *cd,
+    SUSCOUNT width)
+{
+  SUSCOUNT size = cd->params.window_size;
+  SUSCOUNT i, j, first, last;
+  SUFLOAT max;
+
+  if (width == 0 || width > size)
+    width = size;
+
+  SU_TRYCATCH(suscan_analyzer_psd_msg_reserve(msg, width), return SU_FALSE);
+
+  msg->psd_size = width;
+  msg->samp_rate = cd->params.samp_rate;
+
+  if (cd->params.decimation > 1)
+    msg->samp_rate /= cd->params.decimation;
+
+  msg->fc = 0;
 
   switch (cd->params.mode) {
     case SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION:
-      for (i = 0; i < new->psd_size; ++i)
-        new->psd_data[i] = SU_C_REAL(cd->fft[i]);
+      for (j = 0; j < width; ++j) {
+        first = j * size / width;
+        last  = (j + 1) * size / width;
+        max = SU_C_REAL(cd->fft[first]);
+        for (i = first + 1; i < last; ++i)
+          if (SU_C_REAL(cd->fft[i]) > max)
+            max = SU_C_REAL(cd->fft[i]);
+        msg->psd_data[j] = max;
+      }
       break;
 
     default:
-      memcpy(new->psd_data, cd->spect, sizeof(SUFLOAT) * new->psd_size);
+      if (width == size) {
+        memcpy(msg->psd_data, cd->spect, sizeof(SUFLOAT) * size);
+      } else {
+        for (j = 0; j < width; ++j) {
+          first = j * size / width;
+          last  = (j + 1) * size / width;
+          max = cd->spect[first];
+          for (i = first + 1; i < last; ++i)
+            if (cd->spect[i] > max)
+              max = cd->spect[i];
+          msg->psd_data[j] = max;
+        }
+      }
   }
 
+  return SU_TRUE;
+}
+
+struct suscan_analyzer_psd_msg *
+suscan_analyzer_psd_msg_new(const su_channel_detector_t *cd)
+{
+  struct suscan_analyzer_psd_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
+      goto fail);
+
+  SU_TRYCATCH(suscan_analyzer_psd_msg_fill(new, cd, 0), goto fail);
+
   return new;
 
 fail:
@@ -213,14 +325,117 @@ fail:
   return NULL;
 }
 
-SUFLOAT *
-suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg)
+struct suscan_analyzer_psd_pool *
+suscan_analyzer_psd_pool_new(void)
 {
-  SUFLOAT *result = msg->psd_data;
+  struct suscan_analyzer_psd_pool *new = NULL;
 
-  msg->psd_data = NULL;
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_psd_pool)),
+      return NULL);
 
-  return result;
+  if (pthread_mutex_init(&new->mutex, NULL) == -1) {
+    free(new);
+    return NULL;
+  }
+
+  /* Owner reference */
+  new->refcnt = 1;
+
+  return new;
+}
+
+/*
+ * Take a frame from the pool and fill it with the current detector
+ * spectrum. If all frames are in flight, *msg is set to NULL: this is not
+ * an error, the update is just skipped.
+ */
+SUBOOL
+suscan_analyzer_psd_pool_acquire(
+    struct suscan_analyzer_psd_pool *pool,
+    const su_channel_detector_t *cd,
+    SUSCOUNT width,
+    struct suscan_analyzer_psd_msg **msg)
+{
+  struct suscan_analyzer_psd_msg *frame = NULL;
+  SUBOOL create = SU_FALSE;
+
+  *msg = NULL;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if ((frame = pool->free_list) != NULL) {
+    pool->free_list = frame->next;
+    --pool->free_count;
+    ++pool->refcnt;
+  } else if (pool->allocated < SUSCAN_ANALYZER_PSD_POOL_SIZE) {
+    ++pool->allocated;
+    ++pool->refcnt;
+    create = SU_TRUE;
+  } else {
+    ++pool->skipped;
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (create) {
+    if ((frame = calloc(1, sizeof(struct suscan_analyzer_psd_msg))) == NULL) {
+      pthread_mutex_lock(&pool->mutex);
+      --pool->allocated;
+      --pool->refcnt; /* Owner still holds one */
+      pthread_mutex_unlock(&pool->mutex);
+
+      SU_ERROR("Cannot allocate spectrum frame\n");
+      return SU_FALSE;
+    }
+
+    frame->pool = pool;
+  }
+
+  if (frame == NULL)
+    return SU_TRUE;
+
+  frame->next = NULL;
+  frame->inspector_id = 0;
+  frame->N0 = 0;
+
+  if (!suscan_analyzer_psd_msg_fill(frame, cd, width)) {
+    suscan_analyzer_psd_msg_destroy(frame);
+    return SU_FALSE;
+  }
+
+  *msg = frame;
+
+  return SU_TRUE;
+}
+
+/*
+ * Drop the owner reference. Frames still in flight will be freed
+ * when disposed, and the pool itself once the last of them goes away.
+ */
+void
+suscan_analyzer_psd_pool_release(struct suscan_analyzer_psd_pool *pool)
+{
+  struct suscan_analyzer_psd_msg *this;
+  SUBOOL unused;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->released = SU_TRUE;
+
+  while ((this = pool->free_list) != NULL) {
+    pool->free_list = this->next;
+    suscan_analyzer_psd_msg_free(this);
+  }
+  pool->allocated -= pool->free_count;
+  pool->free_count = 0;
+
+  unused = --pool->refcnt == 0;
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (unused)
+    suscan_analyzer_psd_pool_destroy(pool);
 }
 
 struct suscan_analyzer_sample_batch_msg *
@@ -237,34 +452,73 @@ suscan_analyzer_sample_batch_msg_new(uint32_t inspector_id)
   return new;
 }
 
+SUBOOL
+suscan_analyzer_sample_batch_msg_reserve(
+    struct suscan_analyzer_sample_batch_msg *msg,
+    unsigned int storage)
+{
+  void *new;
+
+  if (storage <= msg->sample_storage)
+    return SU_TRUE;
+
+  SU_TRYCATCH(
+      new = realloc(msg->samples, sizeof(SUCOMPLEX) * storage),
+      return SU_FALSE);
+
+  msg->samples = new;
+  msg->sample_storage = storage;
+
+  return SU_TRUE;
+}
+
 SUBOOL
 suscan_analyzer_sample_batch_msg_append_sample(
     struct suscan_analyzer_sample_batch_msg *msg,
     SUCOMPLEX sample)
 {
   unsigned int storage = msg->sample_storage;
-  void *new;
 
   if (storage == 0)
     storage = 1;
   else if (msg->sample_count == storage)
     storage <<= 1;
 
-  if (storage != msg->sample_storage) {
-    SU_TRYCATCH(
-        new = realloc(msg->samples, sizeof(SUCOMPLEX) * storage),
-        return SU_FALSE);
-    msg->samples = new;
-    msg->sample_storage = storage;
-  }
+  SU_TRYCATCH(
+      suscan_analyzer_sample_batch_msg_reserve(msg, storage),
+      return SU_FALSE);
 
   msg->samples[msg->sample_count++] = sample;
 
   return SU_TRUE;
 }
 
-void
-suscan_analyzer_sample_batch_msg_destroy(
+SUBOOL
+suscan_analyzer_sample_batch_msg_append_samples(
+    struct suscan_analyzer_sample_batch_msg *msg,
+    const SUCOMPLEX *samples,
+    unsigned int count)
+{
+  unsigned int storage = msg->sample_storage;
+
+  if (storage == 0)
+    storage = 1;
+
+  while (msg->sample_count + count > storage)
+    storage <<= 1;
+
+  SU_TRYCATCH(
+      suscan_analyzer_sample_batch_msg_reserve(msg, storage),
+      return SU_FALSE);
+
+  memcpy(msg->samples + msg->sample_count, samples, sizeof(SUCOMPLEX) * count);
+  msg->sample_count += count;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_analyzer_sample_batch_msg_free(
     struct suscan_analyzer_sample_batch_msg *msg)
 {
   if (msg->samples != NULL)
@@ -273,6 +527,162 @@ suscan_analyzer_sample_batch_msg_destroy(
   free(msg);
 }
 
+/* Called with the pool mutex held. Returns SU_TRUE if the pool is unused */
+SUPRIVATE SUBOOL
+suscan_analyzer_sample_batch_pool_unref(
+    struct suscan_analyzer_sample_batch_pool *pool)
+{
+  return --pool->refcnt == 0;
+}
+
+SUPRIVATE void
+suscan_analyzer_sample_batch_pool_destroy(
+    struct suscan_analyzer_sample_batch_pool *pool)
+{
+  struct suscan_analyzer_sample_batch_msg *this;
+
+  while ((this = pool->free_list) != NULL) {
+    pool->free_list = this->next;
+    suscan_analyzer_sample_batch_msg_free(this);
+  }
+
+  pthread_mutex_destroy(&pool->mutex);
+
+  free(pool);
+}
+
+void
+suscan_analyzer_sample_batch_msg_destroy(
+    struct suscan_analyzer_sample_batch_msg *msg)
+{
+  struct suscan_analyzer_sample_batch_pool *pool = msg->pool;
+  SUBOOL unused;
+
+  if (pool == NULL) {
+    suscan_analyzer_sample_batch_msg_free(msg);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if (!pool->released
+      && pool->free_count < SUSCAN_ANALYZER_SAMPLE_BATCH_POOL_MAX) {
+    msg->sample_count = 0;
+    msg->next = pool->free_list;
+    pool->free_list = msg;
+    ++pool->free_count;
+  } else {
+    suscan_analyzer_sample_batch_msg_free(msg);
+  }
+
+  unused = suscan_analyzer_sample_batch_pool_unref(pool);
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (unused)
+    suscan_analyzer_sample_batch_pool_destroy(pool);
+}
+
+struct suscan_analyzer_sample_batch_pool *
+suscan_analyzer_sample_batch_pool_new(void)
+{
+  struct suscan_analyzer_sample_batch_pool *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_sample_batch_pool)),
+      return NULL);
+
+  if (pthread_mutex_init(&new->mutex, NULL) == -1) {
+    free(new);
+    return NULL;
+  }
+
+  /* Owner reference */
+  new->refcnt = 1;
+
+  return new;
+}
+
+struct suscan_analyzer_sample_batch_msg *
+suscan_analyzer_sample_batch_pool_acquire(
+    struct suscan_analyzer_sample_batch_pool *pool,
+    uint32_t inspector_id,
+    unsigned int storage)
+{
+  struct suscan_analyzer_sample_batch_msg *msg;
+  SUBOOL unused;
+
+  if (storage < SUSCAN_ANALYZER_SAMPLE_BATCH_MIN_STORAGE)
+    storage = SUSCAN_ANALYZER_SAMPLE_BATCH_MIN_STORAGE;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if ((msg = pool->free_list) != NULL) {
+    pool->free_list = msg->next;
+    --pool->free_count;
+  }
+
+  ++pool->refcnt;
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (msg == NULL) {
+    if ((msg = suscan_analyzer_sample_batch_msg_new(inspector_id)) == NULL)
+      goto fail;
+    msg->pool = pool;
+  }
+
+  msg->inspector_id = inspector_id;
+  msg->sample_count = 0;
+  msg->next = NULL;
+
+  if (!suscan_analyzer_sample_batch_msg_reserve(msg, storage)) {
+    suscan_analyzer_sample_batch_msg_destroy(msg);
+    return NULL;
+  }
+
+  return msg;
+
+fail:
+  pthread_mutex_lock(&pool->mutex);
+  unused = suscan_analyzer_sample_batch_pool_unref(pool);
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (unused)
+    suscan_analyzer_sample_batch_pool_destroy(pool);
+
+  return NULL;
+}
+
+/*
+ * Drop the owner reference. Messages still in flight will be freed
+ * when disposed, and the pool itself once the last of them goes away.
+ */
+void
+suscan_analyzer_sample_batch_pool_release(
+    struct suscan_analyzer_sample_batch_pool *pool)
+{
+  struct suscan_analyzer_sample_batch_msg *this;
+  SUBOOL unused;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->released = SU_TRUE;
+
+  while ((this = pool->free_list) != NULL) {
+    pool->free_list = this->next;
+    suscan_analyzer_sample_batch_msg_free(this);
+  }
+  pool->free_count = 0;
+
+  unused = suscan_analyzer_sample_batch_pool_unref(pool);
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (unused)
+    suscan_analyzer_sample_batch_pool_destroy(pool);
+}
+
 void
 suscan_analyzer_dispose_message(uint32_t type, void *ptr)
 {
@@ -282,6 +692,18 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
       suscan_analyzer_status_msg_destroy(ptr);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+      suscan_analyzer_samples_lost_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_STATS:
+      suscan_analyzer_stats_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_OVERVIEW:
+      suscan_analyzer_overview_msg_destroy(ptr);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
       suscan_analyzer_channel_msg_destroy(ptr);
       break;
@@ -298,6 +720,10 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
       suscan_analyzer_sample_batch_msg_destroy(ptr);
       break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      free(ptr);
+      break;
   }
 }
 
@@ -341,6 +767,170 @@ done:
   return ok;
 }
 
+SUBOOL
+suscan_analyzer_send_samples_lost(
+    suscan_analyzer_t *analyzer,
+    uint64_t lost,
+    uint64_t total)
+{
+  struct suscan_analyzer_samples_lost_msg *msg;
+
+  if ((msg = suscan_analyzer_samples_lost_msg_new(lost, total)) == NULL)
+    return SU_FALSE;
+
+  msg->sender = analyzer;
+
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST,
+      msg)) {
+    suscan_analyzer_samples_lost_msg_destroy(msg);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+/* Must be called from the source worker */
+SUBOOL
+suscan_analyzer_send_stats(suscan_analyzer_t *analyzer)
+{
+  struct suscan_analyzer_stats_msg *msg = NULL;
+  const suscan_consumer_pool_t *pool = analyzer->consumer_pool;
+  const suscan_consumer_t *consumer;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      msg = calloc(1, sizeof(struct suscan_analyzer_stats_msg)),
+      goto done);
+
+  msg->sender = analyzer;
+  msg->run_time_ns = suscan_analyzer_get_run_time_ns(analyzer);
+  msg->samples_read =
+      __atomic_load_n(&analyzer->samp_total, __ATOMIC_RELAXED);
+  msg->read_rate = suscan_analyzer_get_read_rate(analyzer);
+  msg->cpu_usage = analyzer->cpu_usage;
+
+  suscan_stats_histogram_snapshot(&msg->source_read, &analyzer->read_hist);
+  suscan_stats_histogram_snapshot(&msg->detector_feed, &analyzer->feed_hist);
+  suscan_stats_histogram_snapshot(&msg->psd_send, &analyzer->psd_hist);
+
+  msg->mq_in_depth = suscan_mq_get_depth(&analyzer->mq_in);
+  msg->mq_out_depth = suscan_mq_get_depth(analyzer->mq_out);
+  suscan_mq_get_pool_stats(&msg->mq_pool);
+  msg->desyncs = analyzer->desyncs;
+
+  if (analyzer->source.reader_running) {
+    msg->read_ahead_depth = suscan_ring_get_avail(&analyzer->source.read_ring);
+    msg->read_ahead_size = analyzer->source.read_ring.size;
+    msg->read_ahead_overruns = __atomic_load_n(
+        &analyzer->source.ring_overruns,
+        __ATOMIC_RELAXED);
+  }
+
+  /* Shared pools report every consumer, whoever they worked for */
+  if (pool->consumer_count > 0)
+    SU_TRYCATCH(
+        msg->consumer_list = calloc(
+            pool->consumer_count,
+            sizeof(struct suscan_analyzer_consumer_stats)),
+        goto done);
+
+  for (i = 0; i < pool->consumer_count; ++i) {
+    consumer = pool->consumer_list[i];
+    suscan_stats_histogram_snapshot(
+        &msg->consumer_list[i].process,
+        &consumer->process_hist);
+    msg->consumer_list[i].tasks_run =
+        __atomic_load_n(&consumer->tasks_run, __ATOMIC_RELAXED);
+    msg->consumer_list[i].tasks_stolen =
+        __atomic_load_n(&consumer->tasks_stolen, __ATOMIC_RELAXED);
+  }
+  msg->consumer_count = pool->consumer_count;
+
+  SU_TRYCATCH(
+      suscan_analyzer_get_inspector_stats(
+          analyzer,
+          &msg->inspector_list,
+          &msg->inspector_count),
+      goto done);
+
+  SU_TRYCATCH(
+      suscan_mq_write(
+          analyzer->mq_out,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_STATS,
+          msg),
+      goto done);
+
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_stats_msg_destroy(msg);
+
+  return ok;
+}
+
+/* The capture index is read here, readers get their own copy */
+SUBOOL
+suscan_analyzer_send_overview(
+    suscan_analyzer_t *analyzer,
+    suscan_capture_t *capture)
+{
+  struct suscan_analyzer_overview_msg *msg = NULL;
+  const struct suscan_capture_level *level;
+  size_t size;
+  SUBOOL ok = SU_FALSE;
+
+  /* No index, nothing to show */
+  if ((level = suscan_capture_get_overview(
+      capture,
+      SUSCAN_ANALYZER_OVERVIEW_MAX_LINES)) == NULL)
+    return SU_TRUE;
+
+  SU_TRYCATCH(
+      msg = calloc(1, sizeof(struct suscan_analyzer_overview_msg)),
+      goto done);
+
+  msg->sender = analyzer;
+  msg->fc = capture->info.fc;
+  msg->samp_rate = capture->info.samp_rate;
+  msg->start_time = capture->info.start_time;
+  msg->psd_size = capture->info.psd_size;
+  msg->line_count = level->line_count;
+
+  /* Every level up doubles the duration of a line */
+  msg->line_duration = (SUFLOAT) capture->info.line_samples
+      * (1ull << (level - capture->level))
+      / capture->info.samp_rate;
+
+  size = msg->psd_size * msg->line_count * sizeof(SUFLOAT);
+  if (size > 0) {
+    SU_TRYCATCH(msg->lines = malloc(size), goto done);
+    memcpy(msg->lines, level->lines, size);
+  }
+
+  SU_TRYCATCH(
+      suscan_mq_write(
+          analyzer->mq_out,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_OVERVIEW,
+          msg),
+      goto done);
+
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_overview_msg_destroy(msg);
+
+  return ok;
+}
+
 SUBOOL
 suscan_analyzer_send_detector_channels(
     suscan_analyzer_t *analyzer,
@@ -353,8 +943,14 @@ suscan_analyzer_send_detector_channels(
 
   su_channel_detector_get_channel_list(detector, &ch_list, &ch_count);
 
-  if ((msg = suscan_analyzer_channel_msg_new(analyzer, ch_list, ch_count))
-      == NULL) {
+  /* Sent even if nothing changed: receivers use it as a tick */
+  if ((msg = suscan_analyzer_channel_msg_new(analyzer)) == NULL
+      || !suscan_channel_tracker_update(
+          &analyzer->source.tracker,
+          ch_list,
+          ch_count,
+          analyzer->source.fc,
+          msg)) {
     suscan_analyzer_send_status(
         analyzer,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
@@ -396,7 +992,11 @@ suscan_analyzer_send_psd(
   struct suscan_analyzer_psd_msg *msg = NULL;
   SUBOOL ok = SU_FALSE;
 
-  if ((msg = suscan_analyzer_psd_msg_new(detector)) == NULL) {
+  if (!suscan_analyzer_psd_pool_acquire(
+      analyzer->psd_pool,
+      detector,
+      analyzer->source.psd_width,
+      &msg)) {
     suscan_analyzer_send_status(
         analyzer,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
@@ -406,6 +1006,10 @@ suscan_analyzer_send_psd(
     goto done;
   }
 
+  /* Reader is lagging behind, skip this update */
+  if (msg == NULL)
+    return SU_TRUE;
+
   msg->fc = analyzer->source.fc;
   msg->N0 = detector->N0;
 
@@ -434,18 +1038,114 @@ done:
   return ok;
 }
 
+/*
+ * Stitched spectrum and channels of a complete sweep. Sweep spectra are
+ * larger than detector frames and far less frequent, so they are not
+ * taken from the PSD pool.
+ */
+SUBOOL
+suscan_analyzer_send_sweep(
+    suscan_analyzer_t *analyzer,
+    const suscan_sweep_t *sweep)
+{
+  struct suscan_analyzer_psd_msg *psd = NULL;
+  struct suscan_analyzer_channel_msg *msg = NULL;
+  SUSCOUNT size = suscan_sweep_get_psd_size(sweep);
+  uint64_t fc = suscan_sweep_get_fc(sweep);
+  SUBOOL ok = SU_FALSE;
+
+  if ((psd = calloc(1, sizeof(struct suscan_analyzer_psd_msg))) == NULL
+      || !suscan_analyzer_psd_msg_reserve(psd, size)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot create message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  memcpy(psd->psd_data, sweep->psd, size * sizeof(SUFLOAT));
+  psd->psd_size  = size;
+  psd->fc        = fc;
+  psd->samp_rate = suscan_sweep_get_span(sweep);
+  psd->N0        = sweep->N0;
+
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_PSD,
+      psd)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot write message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  psd = NULL;
+
+  if ((msg = suscan_analyzer_channel_msg_new(analyzer)) == NULL
+      || !suscan_channel_tracker_update(
+          &analyzer->source.tracker,
+          sweep->channel_ptrs,
+          sweep->channel_count,
+          fc,
+          msg)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot create message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  if (!suscan_mq_write(
+      analyzer->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL,
+      msg)) {
+    suscan_analyzer_send_status(
+        analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot write message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  /* Messages queued, forget about them */
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (psd != NULL)
+    suscan_analyzer_dispose_message(SUSCAN_ANALYZER_MESSAGE_TYPE_PSD, psd);
+
+  if (msg != NULL)
+    suscan_analyzer_dispose_message(SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL, msg);
+
+  return ok;
+}
+
 SUBOOL
 suscan_inspector_send_psd(
     suscan_inspector_t *insp,
-    const suscan_consumer_t *consumer,
     const su_channel_detector_t *detector)
 {
+  suscan_analyzer_t *analyzer = insp->sched_analyzer;
   struct suscan_analyzer_psd_msg *msg = NULL;
   SUBOOL ok = SU_FALSE;
 
-  if ((msg = suscan_analyzer_psd_msg_new(detector)) == NULL) {
+  if (!suscan_analyzer_psd_pool_acquire(
+      insp->psd_pool,
+      detector,
+      analyzer->source.psd_width,
+      &msg)) {
     suscan_analyzer_send_status(
-        consumer->analyzer,
+        analyzer,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
         -1,
         "Cannot create message: %s",
@@ -453,16 +1153,20 @@ suscan_inspector_send_psd(
     goto done;
   }
 
-  msg->fc = consumer->analyzer->source.fc;
+  /* Reader is lagging behind, skip this update */
+  if (msg == NULL)
+    return SU_TRUE;
+
+  msg->fc = analyzer->source.fc;
   msg->N0 = detector->N0;
   msg->inspector_id = insp->params.inspector_id;
 
   if (!suscan_mq_write(
-      consumer->analyzer->mq_out,
+      analyzer->mq_out,
       SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD,
       msg)) {
     suscan_analyzer_send_status(
-        consumer->analyzer,
+        analyzer,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
         -1,
         "Cannot write message: %s",
@@ -23,6 +23,7 @@
 
 #include <util.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #include "analyzer.h"
 
@@ -37,6 +38,8 @@
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES       0x8 /* Sample batch */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD      0x9 /* Inspector spectrum */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS        0xa /* Analyzer params */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_STATS         0xb /* Pipeline stats */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_OVERVIEW      0xc /* Capture overview */
 
 #define SUSCAN_ANALYZER_INIT_SUCCESS               0
 #define SUSCAN_ANALYZER_INIT_FAILURE              -1
@@ -48,14 +51,102 @@ struct suscan_analyzer_status_msg {
   const suscan_analyzer_t *sender;
 };
 
-/* Channel notification message */
+/*
+ * Samples dropped by the source because the analyzer was not reading
+ * fast enough. Counts are exact: lost is the number of samples dropped
+ * since the previous message, total since the source was opened.
+ */
+struct suscan_analyzer_samples_lost_msg {
+  uint64_t lost;
+  uint64_t total;
+  const suscan_analyzer_t *sender;
+};
+
+/*
+ * Periodic pipeline statistics. Histograms and counters are cumulative,
+ * since the analyzer started. Symbol rates are measured over the last
+ * update interval.
+ */
+struct suscan_analyzer_consumer_stats {
+  struct suscan_stats_histogram process; /* Inspector callbacks */
+  uint64_t tasks_run;
+  uint64_t tasks_stolen;
+};
+
+struct suscan_analyzer_inspector_stats {
+  uint32_t     inspector_id;
+  SUFLOAT      symbol_rate;  /* Symbols per second */
+  uint64_t     samples_lost; /* Dropped because the inspector was lagging */
+  unsigned int queued;       /* Buffers waiting to be processed */
+};
+
+struct suscan_analyzer_stats_msg {
+  uint64_t run_time_ns;
+  uint64_t samples_read;
+  SUFLOAT  read_rate;   /* Samples per second */
+  SUFLOAT  cpu_usage;
+
+  /* Source worker stages */
+  struct suscan_stats_histogram source_read;
+  struct suscan_stats_histogram detector_feed;
+  struct suscan_stats_histogram psd_send;
+
+  unsigned int mq_in_depth;
+  unsigned int mq_out_depth;
+  struct suscan_mq_pool_stats mq_pool; /* Process-wide message nodes */
+  uint64_t     desyncs; /* Port desyncs in the source reader */
+
+  /* Read-ahead ring of real time sources, if any */
+  unsigned int read_ahead_depth; /* Buffers waiting to be processed */
+  unsigned int read_ahead_size;
+  uint64_t     read_ahead_overruns;
+
+  struct suscan_analyzer_consumer_stats *consumer_list;
+  unsigned int consumer_count;
+
+  struct suscan_analyzer_inspector_stats *inspector_list;
+  unsigned int inspector_count;
+
+  const suscan_analyzer_t *sender;
+};
+
+/*
+ * Channel notification message. Carries the channels that appeared or
+ * changed since the previous message (id_list runs parallel to
+ * channel_list) and the IDs of those that went away. If full is set,
+ * channel_list is the complete list and replaces whatever was known.
+ */
 struct suscan_analyzer_channel_msg {
   const struct suscan_source *source;
   PTR_LIST(struct sigutils_channel, channel);
+  uint32_t *id_list;
+  uint32_t *removed_list;
+  unsigned int removed_count;
+  SUBOOL full;
+  const suscan_analyzer_t *sender;
+};
+
+/*
+ * Full-duration spectrum of an indexed capture, sent once when it is
+ * opened. Lines are psd_size bins each, oldest first, in FFT order like
+ * spectrum updates, and line_duration seconds apart.
+ */
+#define SUSCAN_ANALYZER_OVERVIEW_MAX_LINES 2048
+
+struct suscan_analyzer_overview_msg {
+  uint64_t fc;
+  SUFLOAT  samp_rate;
+  uint64_t start_time;     /* Wall clock at the first sample (ns) */
+  SUFLOAT  line_duration;
+  SUSCOUNT psd_size;
+  unsigned int line_count;
+  SUFLOAT *lines;
   const suscan_analyzer_t *sender;
 };
 
 /* Channel spectrum message */
+struct suscan_analyzer_psd_pool;
+
 struct suscan_analyzer_psd_msg {
   uint64_t fc;
   uint32_t inspector_id;
@@ -63,14 +154,61 @@ struct suscan_analyzer_psd_msg {
   SUSCOUNT psd_size;
   SUFLOAT *psd_data;
   SUFLOAT  N0;
+
+  /* Pool this frame must be returned to, if any */
+  SUSCOUNT psd_storage;
+  struct suscan_analyzer_psd_pool *pool;
+  struct suscan_analyzer_psd_msg  *next;
+};
+
+/*
+ * Fixed set of spectrum frames, reused across updates. When all frames
+ * are in flight the reader is lagging behind, and new updates are simply
+ * skipped. Like sample batch pools, these are reference counted.
+ */
+#define SUSCAN_ANALYZER_PSD_POOL_SIZE 8
+
+struct suscan_analyzer_psd_pool {
+  pthread_mutex_t mutex;
+  unsigned int    refcnt;
+  SUBOOL          released;
+
+  struct suscan_analyzer_psd_msg *free_list;
+  unsigned int    free_count;
+  unsigned int    allocated; /* Frames alive, free or in flight */
+  uint64_t        skipped;   /* Updates skipped because of lagging readers */
 };
 
 /* Channel sample batch */
+struct suscan_analyzer_sample_batch_pool;
+
 struct suscan_analyzer_sample_batch_msg {
   uint32_t     inspector_id;
   SUCOMPLEX   *samples;
   unsigned int sample_count;
   unsigned int sample_storage;
+
+  /* Pool this message must be returned to, if any */
+  struct suscan_analyzer_sample_batch_pool *pool;
+  struct suscan_analyzer_sample_batch_msg  *next;
+};
+
+/*
+ * Per-inspector pool of sample batch messages. Messages are taken from
+ * the pool by the inspector task and handed back when disposed. The pool
+ * is reference counted: it is kept alive until both its owner and every
+ * borrowed message have been released.
+ */
+#define SUSCAN_ANALYZER_SAMPLE_BATCH_POOL_MAX     16
+#define SUSCAN_ANALYZER_SAMPLE_BATCH_MIN_STORAGE  16
+
+struct suscan_analyzer_sample_batch_pool {
+  pthread_mutex_t mutex;
+  unsigned int    refcnt;
+  SUBOOL          released;
+
+  struct suscan_analyzer_sample_batch_msg *free_list;
+  unsigned int    free_count;
 };
 
 /*
@@ -87,7 +225,9 @@ enum suscan_analyzer_inspector_msgkind {
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE,
-  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_START_RECORDING,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_STOP_RECORDING
 };
 
 struct suscan_analyzer_inspector_msg {
@@ -102,6 +242,7 @@ struct suscan_analyzer_inspector_msg {
     struct suscan_baud_det_result baud;
     struct suscan_analyzer_params params;
     struct suscan_inspector_params insp_params;
+    suscan_recorder_t *recorder; /* Always taken by the analyzer thread */
   };
 };
 
@@ -117,6 +258,17 @@ SUBOOL suscan_analyzer_send_status(
     int code,
     const char *err_msg_fmt, ...);
 
+SUBOOL suscan_analyzer_send_samples_lost(
+    suscan_analyzer_t *analyzer,
+    uint64_t lost,
+    uint64_t total);
+
+SUBOOL suscan_analyzer_send_stats(suscan_analyzer_t *analyzer);
+
+SUBOOL suscan_analyzer_send_overview(
+    suscan_analyzer_t *analyzer,
+    suscan_capture_t *capture);
+
 SUBOOL suscan_analyzer_send_detector_channels(
     suscan_analyzer_t *analyzer,
     const su_channel_detector_t *detector);
@@ -125,15 +277,19 @@ SUBOOL suscan_analyzer_send_psd(
     suscan_analyzer_t *analyzer,
     const su_channel_detector_t *detector);
 
+SUBOOL suscan_analyzer_send_sweep(
+    suscan_analyzer_t *analyzer,
+    const suscan_sweep_t *sweep);
+
 SUBOOL suscan_inspector_send_psd(
     suscan_inspector_t *insp,
-    const suscan_consumer_t *consumer,
     const su_channel_detector_t *detector);
 
 /************************* Message parsing methods ***************************/
 SUBOOL suscan_analyzer_parse_inspector_msg(
     suscan_analyzer_t *analyzer,
     struct suscan_analyzer_inspector_msg *msg);
+void suscan_analyzer_collect_halted_inspectors(suscan_analyzer_t *analyzer);
 
 /***************** Message constructors and destructors **********************/
 /* Status message */
@@ -142,15 +298,23 @@ struct suscan_analyzer_status_msg *suscan_analyzer_status_msg_new(
     const char *msg);
 void suscan_analyzer_status_msg_destroy(struct suscan_analyzer_status_msg *status);
 
+/* Samples lost notification */
+struct suscan_analyzer_samples_lost_msg *suscan_analyzer_samples_lost_msg_new(
+    uint64_t lost,
+    uint64_t total);
+void suscan_analyzer_samples_lost_msg_destroy(
+    struct suscan_analyzer_samples_lost_msg *msg);
+
+/* Pipeline statistics */
+void suscan_analyzer_stats_msg_destroy(struct suscan_analyzer_stats_msg *msg);
+
+/* Capture overview */
+void suscan_analyzer_overview_msg_destroy(
+    struct suscan_analyzer_overview_msg *msg);
+
 /* Channel list update */
 struct suscan_analyzer_channel_msg *suscan_analyzer_channel_msg_new(
-    const suscan_analyzer_t *analyzer,
-    struct sigutils_channel **list,
-    unsigned int len);
-void suscan_analyzer_channel_msg_take_channels(
-    struct suscan_analyzer_channel_msg *msg,
-    struct sigutils_channel ***pchannel_list,
-    unsigned int *pchannel_count);
+    const suscan_analyzer_t *analyzer);
 void suscan_analyzer_channel_msg_destroy(struct suscan_analyzer_channel_msg *msg);
 
 /* Channel inspector commands */
@@ -163,20 +327,50 @@ void suscan_analyzer_inspector_msg_destroy(
 /* Spectrum update message */
 struct suscan_analyzer_psd_msg *suscan_analyzer_psd_msg_new(
     const su_channel_detector_t *cd);
-SUFLOAT *suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg);
 void suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg);
 
+struct suscan_analyzer_psd_pool *suscan_analyzer_psd_pool_new(void);
+
+SUBOOL suscan_analyzer_psd_pool_acquire(
+    struct suscan_analyzer_psd_pool *pool,
+    const su_channel_detector_t *cd,
+    SUSCOUNT width,
+    struct suscan_analyzer_psd_msg **msg);
+
+void suscan_analyzer_psd_pool_release(struct suscan_analyzer_psd_pool *pool);
+
 /* Sample batch message */
 struct suscan_analyzer_sample_batch_msg *suscan_analyzer_sample_batch_msg_new(
     uint32_t inspector_id);
 
+SUBOOL suscan_analyzer_sample_batch_msg_reserve(
+    struct suscan_analyzer_sample_batch_msg *msg,
+    unsigned int storage);
+
 SUBOOL suscan_analyzer_sample_batch_msg_append_sample(
     struct suscan_analyzer_sample_batch_msg *msg,
     SUCOMPLEX sample);
 
+SUBOOL suscan_analyzer_sample_batch_msg_append_samples(
+    struct suscan_analyzer_sample_batch_msg *msg,
+    const SUCOMPLEX *samples,
+    unsigned int count);
+
 void suscan_analyzer_sample_batch_msg_destroy(
     struct suscan_analyzer_sample_batch_msg *msg);
 
+struct suscan_analyzer_sample_batch_pool *
+suscan_analyzer_sample_batch_pool_new(void);
+
+struct suscan_analyzer_sample_batch_msg *
+suscan_analyzer_sample_batch_pool_acquire(
+    struct suscan_analyzer_sample_batch_pool *pool,
+    uint32_t inspector_id,
+    unsigned int storage);
+
+void suscan_analyzer_sample_batch_pool_release(
+    struct suscan_analyzer_sample_batch_pool *pool);
+
 /* Generic message disposer */
 void suscan_analyzer_dispose_message(uint32_t type, void *ptr);
 
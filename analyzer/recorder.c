@@ -0,0 +1,389 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <complex.h>
+
+#define SU_LOG_DOMAIN "recorder"
+
+#include "recorder.h"
+
+#define SUSCAN_RECORDER_SAMPLE_SIZE sizeof(float complex)
+#define SUSCAN_RECORDER_BUFFER_SAMPLES \
+  (SUSCAN_RECORDER_BUFFER_SIZE / SUSCAN_RECORDER_SAMPLE_SIZE)
+
+SUPRIVATE SUBOOL
+suscan_recorder_write_all(
+    suscan_recorder_t *rec,
+    const uint8_t *data,
+    size_t size)
+{
+  ssize_t ret;
+
+  while (size > 0) {
+    if ((ret = write(rec->fd, data, size)) < 0) {
+      if (errno == EINTR)
+        continue;
+
+      SU_ERROR("Recorder write failed: %s\n", strerror(errno));
+      return SU_FALSE;
+    }
+
+    data += ret;
+    size -= ret;
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * O_DIRECT writes must be a multiple of the alignment. The tail is padded
+ * with zeroes and the file truncated back to its actual length.
+ */
+SUPRIVATE SUBOOL
+suscan_recorder_write_tail(suscan_recorder_t *rec, uint8_t *data, size_t size)
+{
+  size_t padded;
+  off_t len;
+
+  if (!rec->direct)
+    return suscan_recorder_write_all(rec, data, size);
+
+  padded = (size + SUSCAN_RECORDER_ALIGNMENT - 1)
+      & ~(size_t) (SUSCAN_RECORDER_ALIGNMENT - 1);
+  memset(data + size, 0, padded - size);
+
+  SU_TRYCATCH((len = lseek(rec->fd, 0, SEEK_CUR)) != -1, return SU_FALSE);
+  SU_TRYCATCH(suscan_recorder_write_all(rec, data, padded), return SU_FALSE);
+  SU_TRYCATCH(ftruncate(rec->fd, len + size) == 0, return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+/* A capture that could not be indexed is still valid, just unindexed */
+SUPRIVATE void
+suscan_recorder_feed_capture(
+    suscan_recorder_t *rec,
+    const uint8_t *data,
+    size_t size)
+{
+  if (rec->capture == NULL)
+    return;
+
+  if (!suscan_capture_writer_feed(
+      rec->capture,
+      (const float complex *) data,
+      size / SUSCAN_RECORDER_SAMPLE_SIZE)) {
+    SU_WARNING("Cannot index capture, storing samples only\n");
+    suscan_capture_writer_destroy(rec->capture);
+    rec->capture = NULL;
+  }
+}
+
+/* The index is appended unaligned, after the (truncated) sample data */
+SUPRIVATE SUBOOL
+suscan_recorder_finish_capture(suscan_recorder_t *rec)
+{
+  int flags;
+
+  if (rec->direct) {
+    SU_TRYCATCH((flags = fcntl(rec->fd, F_GETFL)) != -1, return SU_FALSE);
+    SU_TRYCATCH(
+        fcntl(rec->fd, F_SETFL, flags & ~O_DIRECT) != -1,
+        return SU_FALSE);
+  }
+
+  return suscan_capture_writer_finish(rec->capture, rec->fd);
+}
+
+SUPRIVATE void *
+suscan_recorder_thread(void *data)
+{
+  suscan_recorder_t *rec = (suscan_recorder_t *) data;
+  uint8_t *buffer;
+  size_t size;
+  SUBOOL ok;
+
+  pthread_mutex_lock(&rec->mutex);
+
+  for (;;) {
+    while (!rec->busy && !rec->halting)
+      pthread_cond_wait(&rec->cond, &rec->mutex);
+
+    if (!rec->busy)
+      break;
+
+    buffer = rec->buffer[!rec->current];
+    size = rec->pending;
+
+    /* The other buffer keeps filling while we write */
+    pthread_mutex_unlock(&rec->mutex);
+    if (!rec->failed)
+      suscan_recorder_feed_capture(rec, buffer, size);
+    ok = rec->failed || suscan_recorder_write_all(rec, buffer, size);
+    pthread_mutex_lock(&rec->mutex);
+
+    if (!ok)
+      rec->failed = SU_TRUE;
+
+    rec->pending = 0;
+    rec->busy = SU_FALSE;
+    pthread_cond_broadcast(&rec->cond);
+  }
+
+  /* Halting: flush what is left in the current buffer */
+  if (!rec->failed && rec->fill > 0) {
+    suscan_recorder_feed_capture(rec, rec->buffer[rec->current], rec->fill);
+    if (!suscan_recorder_write_tail(rec, rec->buffer[rec->current], rec->fill))
+      rec->failed = SU_TRUE;
+  }
+
+  rec->fill = 0;
+
+  pthread_mutex_unlock(&rec->mutex);
+
+  return NULL;
+}
+
+void
+suscan_recorder_destroy(suscan_recorder_t *rec)
+{
+  unsigned int i;
+
+  if (rec->thread_init) {
+    pthread_mutex_lock(&rec->mutex);
+    rec->halting = SU_TRUE;
+    pthread_cond_broadcast(&rec->cond);
+    pthread_mutex_unlock(&rec->mutex);
+
+    pthread_join(rec->thread, NULL);
+  }
+
+  if (rec->capture != NULL) {
+    if (rec->thread_init && !rec->failed
+        && !suscan_recorder_finish_capture(rec))
+      SU_WARNING("Failed to write capture index\n");
+
+    suscan_capture_writer_destroy(rec->capture);
+  }
+
+  if (rec->samples_lost > 0)
+    SU_WARNING(
+        "Recorder dropped %llu samples (disk too slow?)\n",
+        (unsigned long long) rec->samples_lost);
+
+  if (rec->fd != -1)
+    close(rec->fd);
+
+  for (i = 0; i < 2; ++i)
+    if (rec->buffer[i] != NULL)
+      free(rec->buffer[i]);
+
+  if (rec->cond_init)
+    pthread_cond_destroy(&rec->cond);
+
+  if (rec->mutex_init)
+    pthread_mutex_destroy(&rec->mutex);
+
+  free(rec);
+}
+
+suscan_recorder_t *
+suscan_recorder_new(const struct suscan_recorder_params *params)
+{
+  suscan_recorder_t *new = NULL;
+  unsigned int i;
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_recorder_t)), goto fail);
+
+  new->fd = -1;
+  new->direct = params->direct;
+
+  if (new->direct)
+    flags |= O_DIRECT;
+
+  if ((new->fd = open(params->path, flags, 0644)) == -1) {
+    SU_ERROR("Cannot open %s: %s\n", params->path, strerror(errno));
+    goto fail;
+  }
+
+  for (i = 0; i < 2; ++i)
+    SU_TRYCATCH(
+        posix_memalign(
+            (void **) &new->buffer[i],
+            SUSCAN_RECORDER_ALIGNMENT,
+            SUSCAN_RECORDER_BUFFER_SIZE) == 0,
+        goto fail);
+
+  if (params->capture) {
+    SU_TRYCATCH(
+        new->capture = suscan_capture_writer_new(params->samp_rate, params->fc),
+        goto fail);
+
+    /* Header size is a multiple of the alignment, so O_DIRECT is fine */
+    suscan_capture_writer_get_header(new->capture, new->buffer[0]);
+    SU_TRYCATCH(
+        suscan_recorder_write_all(
+            new,
+            new->buffer[0],
+            SUSCAN_CAPTURE_HEADER_SIZE),
+        goto fail);
+  }
+
+  SU_TRYCATCH(pthread_mutex_init(&new->mutex, NULL) == 0, goto fail);
+  new->mutex_init = SU_TRUE;
+
+  SU_TRYCATCH(pthread_cond_init(&new->cond, NULL) == 0, goto fail);
+  new->cond_init = SU_TRUE;
+
+  SU_TRYCATCH(
+      pthread_create(&new->thread, NULL, suscan_recorder_thread, new) == 0,
+      goto fail);
+  new->thread_init = SU_TRUE;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_recorder_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_recorder_write(
+    suscan_recorder_t *rec,
+    const SUCOMPLEX *data,
+    SUSCOUNT count)
+{
+  float complex *out;
+  SUSCOUNT chunk;
+  SUSCOUNT i;
+
+  pthread_mutex_lock(&rec->mutex);
+
+  while (count > 0 && !rec->failed) {
+    chunk = SUSCAN_RECORDER_BUFFER_SAMPLES
+        - rec->fill / SUSCAN_RECORDER_SAMPLE_SIZE;
+
+    if (chunk == 0) {
+      /* Current buffer full. If the other one is still busy, we drop */
+      if (rec->busy)
+        break;
+
+      rec->pending = rec->fill;
+      rec->fill = 0;
+      rec->current = !rec->current;
+      rec->busy = SU_TRUE;
+      pthread_cond_broadcast(&rec->cond);
+      continue;
+    }
+
+    if (chunk > count)
+      chunk = count;
+
+    out = (float complex *) (rec->buffer[rec->current] + rec->fill);
+    for (i = 0; i < chunk; ++i)
+      out[i] = data[i];
+
+    rec->fill += chunk * SUSCAN_RECORDER_SAMPLE_SIZE;
+    rec->samples_written += chunk;
+    data  += chunk;
+    count -= chunk;
+  }
+
+  rec->samples_lost += count;
+
+  pthread_mutex_unlock(&rec->mutex);
+}
+
+uint64_t
+suscan_recorder_get_lost(suscan_recorder_t *rec)
+{
+  uint64_t lost;
+
+  pthread_mutex_lock(&rec->mutex);
+  lost = rec->samples_lost;
+  pthread_mutex_unlock(&rec->mutex);
+
+  return lost;
+}
+
+/****************************** Recorder slot ********************************/
+SUBOOL
+suscan_recorder_slot_init(struct suscan_recorder_slot *slot)
+{
+  memset(slot, 0, sizeof(struct suscan_recorder_slot));
+
+  SU_TRYCATCH(pthread_mutex_init(&slot->mutex, NULL) == 0, return SU_FALSE);
+  slot->mutex_init = SU_TRUE;
+
+  return SU_TRUE;
+}
+
+void
+suscan_recorder_slot_finalize(struct suscan_recorder_slot *slot)
+{
+  if (slot->recorder != NULL)
+    suscan_recorder_destroy(slot->recorder);
+
+  if (slot->mutex_init)
+    pthread_mutex_destroy(&slot->mutex);
+
+  slot->recorder = NULL;
+  slot->mutex_init = SU_FALSE;
+}
+
+suscan_recorder_t *
+suscan_recorder_slot_swap(
+    struct suscan_recorder_slot *slot,
+    suscan_recorder_t *rec)
+{
+  suscan_recorder_t *old;
+
+  pthread_mutex_lock(&slot->mutex);
+  old = slot->recorder;
+  __atomic_store_n(&slot->recorder, rec, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&slot->mutex);
+
+  return old;
+}
+
+void
+suscan_recorder_slot_write(
+    struct suscan_recorder_slot *slot,
+    const SUCOMPLEX *data,
+    SUSCOUNT count)
+{
+  /* Nothing attached: don't even take the lock */
+  if (__atomic_load_n(&slot->recorder, __ATOMIC_RELAXED) == NULL)
+    return;
+
+  pthread_mutex_lock(&slot->mutex);
+  if (slot->recorder != NULL)
+    suscan_recorder_write(slot->recorder, data, count);
+  pthread_mutex_unlock(&slot->mutex);
+}
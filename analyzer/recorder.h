@@ -0,0 +1,118 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sigutils/sigutils.h>
+
+#include "capture.h"
+
+/*
+ * Streaming sample recorder. Samples are stored as raw complex float.
+ * Writers fill one buffer while a writer thread flushes the other, so
+ * disk I/O never happens in the caller's thread. If both buffers are
+ * full the new samples are dropped and counted as lost.
+ *
+ * In capture mode the file is an indexed capture (see capture.h). Its
+ * overview is computed in the writer thread, from the flushed buffers.
+ */
+#define SUSCAN_RECORDER_BUFFER_SIZE (4 << 20) /* Bytes per buffer */
+#define SUSCAN_RECORDER_ALIGNMENT   4096      /* Good for O_DIRECT */
+
+struct suscan_recorder_params {
+  const char *path;
+  SUBOOL direct; /* Open with O_DIRECT, bypassing the page cache */
+  SUBOOL capture; /* Indexed capture instead of raw samples */
+  uint64_t samp_rate; /* Capture mode only */
+  uint64_t fc;
+};
+
+#define suscan_recorder_params_INITIALIZER {NULL, SU_FALSE, SU_FALSE, 0, 0}
+
+struct suscan_recorder {
+  int fd;
+  SUBOOL direct;
+  suscan_capture_writer_t *capture; /* Owned by the writer thread */
+
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond; /* Signaled when a buffer is ready or released */
+
+  uint8_t *buffer[2];
+  unsigned int current; /* Buffer being filled */
+  size_t fill;          /* Bytes in the current buffer */
+  size_t pending;       /* Bytes of the other buffer left to flush */
+  SUBOOL busy;          /* The other buffer is being flushed */
+  SUBOOL halting;
+  SUBOOL failed;        /* Write error, nothing else will be stored */
+
+  uint64_t samples_written;
+  uint64_t samples_lost;
+
+  SUBOOL mutex_init;
+  SUBOOL cond_init;
+  SUBOOL thread_init;
+  pthread_t thread;
+};
+
+typedef struct suscan_recorder suscan_recorder_t;
+
+suscan_recorder_t *suscan_recorder_new(
+    const struct suscan_recorder_params *params);
+
+/* Never blocks on I/O */
+void suscan_recorder_write(
+    suscan_recorder_t *rec,
+    const SUCOMPLEX *data,
+    SUSCOUNT count);
+
+uint64_t suscan_recorder_get_lost(suscan_recorder_t *rec);
+
+/* Flushes whatever is left and closes the file */
+void suscan_recorder_destroy(suscan_recorder_t *rec);
+
+/*
+ * Attachment point for recorders. The recorder can be swapped from any
+ * thread while the producer keeps writing to it.
+ */
+struct suscan_recorder_slot {
+  pthread_mutex_t mutex;
+  suscan_recorder_t *recorder;
+  SUBOOL mutex_init;
+};
+
+SUBOOL suscan_recorder_slot_init(struct suscan_recorder_slot *slot);
+
+/* Destroys the attached recorder, if any */
+void suscan_recorder_slot_finalize(struct suscan_recorder_slot *slot);
+
+/* Returns the previously attached recorder, to be destroyed by the caller */
+suscan_recorder_t *suscan_recorder_slot_swap(
+    struct suscan_recorder_slot *slot,
+    suscan_recorder_t *rec);
+
+void suscan_recorder_slot_write(
+    struct suscan_recorder_slot *slot,
+    const SUCOMPLEX *data,
+    SUSCOUNT count);
+
+#endif /* _RECORDER_H */
@@ -0,0 +1,413 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+ * Client side of remote analyzers. Messages from the server are decoded
+ * into regular analyzer messages and queued in mq_out, so the rest of
+ * the client API works unchanged.
+ */
+
+#define SU_LOG_DOMAIN "analyzer-remote"
+
+#include "remote.h"
+#include "msg.h"
+
+SUPRIVATE void
+suscan_remote_link_deliver(
+    struct suscan_remote_link *link,
+    uint32_t type,
+    const uint8_t *data,
+    size_t size)
+{
+  void *msg;
+
+  if ((msg = suscan_remote_decode(link->analyzer, type, data, size)) != NULL)
+    if (!suscan_mq_write(link->analyzer->mq_out, type, msg))
+      suscan_analyzer_dispose_message(type, msg);
+}
+
+SUPRIVATE void *
+suscan_remote_link_rx_thread(void *data)
+{
+  struct suscan_remote_link *link = (struct suscan_remote_link *) data;
+  struct suscan_remote_header header;
+  uint8_t *buf = NULL;
+  size_t alloc = 0;
+
+  while (suscan_remote_read_frame(link->fd, &header, &buf, &alloc))
+    suscan_remote_link_deliver(link, header.type, buf, header.size);
+
+  if (buf != NULL)
+    free(buf);
+
+  /* Let the client know, unless it is the one hanging up */
+  if (!__atomic_load_n(&link->halting, __ATOMIC_ACQUIRE))
+    (void) suscan_analyzer_send_status(
+        link->analyzer,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_EOS,
+        SU_BLOCK_PORT_READ_ERROR_ACQUIRE,
+        "Connection to analyzer server lost");
+
+  return NULL;
+}
+
+SUPRIVATE void *
+suscan_remote_link_mcast_thread(void *data)
+{
+  struct suscan_remote_link *link = (struct suscan_remote_link *) data;
+  struct suscan_remote_header header;
+  struct sockaddr_in from;
+  socklen_t from_len;
+  uint8_t *buf;
+  ssize_t got;
+
+  SU_TRYCATCH(buf = malloc(SUSCAN_REMOTE_MAX_DATAGRAM), return NULL);
+
+  while (!__atomic_load_n(&link->halting, __ATOMIC_ACQUIRE)) {
+    from_len = sizeof(struct sockaddr_in);
+    if ((got = recvfrom(
+        link->mcast_fd,
+        buf,
+        SUSCAN_REMOTE_MAX_DATAGRAM,
+        0,
+        (struct sockaddr *) &from,
+        &from_len)) < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        continue;
+      SU_ERROR("Multicast receive failed: %s\n", strerror(errno));
+      break;
+    }
+
+    /* Datagrams may come from other servers in the group, or be cut */
+    if (from.sin_addr.s_addr != link->mcast_source.s_addr
+        || got < SUSCAN_REMOTE_HEADER_SIZE
+        || !suscan_remote_parse_header(buf, &header)
+        || header.size != got - SUSCAN_REMOTE_HEADER_SIZE
+        || !suscan_remote_type_is_bulk(header.type))
+      continue;
+
+    suscan_remote_link_deliver(
+        link,
+        header.type,
+        buf + SUSCAN_REMOTE_HEADER_SIZE,
+        header.size);
+  }
+
+  free(buf);
+
+  return NULL;
+}
+
+SUPRIVATE int
+suscan_remote_connect(const char *host, uint16_t port)
+{
+  struct addrinfo hints, *res = NULL, *p;
+  char service[8];
+  int fd = -1;
+  int one = 1;
+  int err;
+
+  memset(&hints, 0, sizeof(struct addrinfo));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  snprintf(service, sizeof(service), "%u", port);
+
+  if ((err = getaddrinfo(host, service, &hints, &res)) != 0) {
+    SU_ERROR("Cannot resolve %s: %s\n", host, gai_strerror(err));
+    return -1;
+  }
+
+  for (p = res; p != NULL; p = p->ai_next) {
+    if ((fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1)
+      continue;
+
+    if (connect(fd, p->ai_addr, p->ai_addrlen) == 0)
+      break;
+
+    close(fd);
+    fd = -1;
+  }
+
+  freeaddrinfo(res);
+
+  if (fd == -1)
+    SU_ERROR("Cannot connect to %s:%d: %s\n", host, port, strerror(errno));
+  else
+    (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  return fd;
+}
+
+/* IPv4 address of the server, as seen from the control connection */
+SUPRIVATE SUBOOL
+suscan_remote_get_peer_in4(int fd, struct in_addr *addr)
+{
+  struct sockaddr_storage peer;
+  const struct sockaddr_in6 *in6;
+  socklen_t len = sizeof(struct sockaddr_storage);
+
+  SU_TRYCATCH(
+      getpeername(fd, (struct sockaddr *) &peer, &len) == 0,
+      return SU_FALSE);
+
+  if (peer.ss_family == AF_INET) {
+    *addr = ((const struct sockaddr_in *) &peer)->sin_addr;
+    return SU_TRUE;
+  }
+
+  in6 = (const struct sockaddr_in6 *) &peer;
+  if (peer.ss_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+    memcpy(addr, in6->sin6_addr.s6_addr + 12, sizeof(struct in_addr));
+    return SU_TRUE;
+  }
+
+  return SU_FALSE;
+}
+
+SUPRIVATE int
+suscan_remote_join_mcast(const char *group, uint16_t port)
+{
+  struct sockaddr_in addr;
+  struct ip_mreq mreq;
+  struct timeval tv;
+  int fd;
+  int one = 1;
+
+  memset(&mreq, 0, sizeof(struct ip_mreq));
+  if (inet_aton(group, &mreq.imr_multiaddr) == 0) {
+    SU_ERROR("Invalid multicast group `%s'\n", group);
+    return -1;
+  }
+
+  mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+  SU_TRYCATCH((fd = socket(AF_INET, SOCK_DGRAM, 0)) != -1, return -1);
+
+  (void) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  tv.tv_sec  = 0;
+  tv.tv_usec = SUSCAN_REMOTE_MCAST_POLL_MS * 1000;
+  (void) setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  memset(&addr, 0, sizeof(struct sockaddr_in));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+
+  SU_TRYCATCH(
+      bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0,
+      goto fail);
+
+  SU_TRYCATCH(
+      setsockopt(
+          fd,
+          IPPROTO_IP,
+          IP_ADD_MEMBERSHIP,
+          &mreq,
+          sizeof(mreq)) == 0,
+      goto fail);
+
+  return fd;
+
+fail:
+  close(fd);
+
+  return -1;
+}
+
+void
+suscan_remote_link_destroy(struct suscan_remote_link *link)
+{
+  __atomic_store_n(&link->halting, SU_TRUE, __ATOMIC_RELEASE);
+
+  if (link->rx_init) {
+    shutdown(link->fd, SHUT_RDWR);
+    pthread_join(link->rx_thread, NULL);
+  }
+
+  if (link->mcast_init)
+    pthread_join(link->mcast_thread, NULL);
+
+  if (link->fd != -1)
+    close(link->fd);
+
+  if (link->mcast_fd != -1)
+    close(link->mcast_fd);
+
+  if (link->mutex_init)
+    pthread_mutex_destroy(&link->tx_mutex);
+
+  suscan_remote_frame_finalize(&link->tx_frame);
+
+  free(link);
+}
+
+struct suscan_remote_link *
+suscan_remote_link_new(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_remote_params *params)
+{
+  struct suscan_remote_link *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct suscan_remote_link)), goto fail);
+
+  new->analyzer = analyzer;
+  new->fd = -1;
+  new->mcast_fd = -1;
+
+  suscan_remote_frame_init(&new->tx_frame);
+
+  SU_TRYCATCH(pthread_mutex_init(&new->tx_mutex, NULL) == 0, goto fail);
+  new->mutex_init = SU_TRUE;
+
+  if ((new->fd = suscan_remote_connect(params->host, params->port)) == -1)
+    goto fail;
+
+  if (params->mcast_addr != NULL) {
+    /*
+     * Multicast groups are IPv4: so must be the server. Datagrams are
+     * only taken from its address, so it must be reached at the address
+     * it multicasts from (not through loopback or NAT).
+     */
+    if (!suscan_remote_get_peer_in4(new->fd, &new->mcast_source)) {
+      SU_ERROR("Multicast needs an IPv4 connection to the server\n");
+      goto fail;
+    }
+
+    if ((new->mcast_fd = suscan_remote_join_mcast(
+        params->mcast_addr,
+        params->mcast_port)) == -1)
+      goto fail;
+  }
+
+  SU_TRYCATCH(
+      pthread_create(
+          &new->rx_thread,
+          NULL,
+          suscan_remote_link_rx_thread,
+          new) == 0,
+      goto fail);
+  new->rx_init = SU_TRUE;
+
+  if (new->mcast_fd != -1) {
+    SU_TRYCATCH(
+        pthread_create(
+            &new->mcast_thread,
+            NULL,
+            suscan_remote_link_mcast_thread,
+            new) == 0,
+        goto fail);
+    new->mcast_init = SU_TRUE;
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_remote_link_destroy(new);
+
+  return NULL;
+}
+
+SUBOOL
+suscan_remote_link_write(
+    struct suscan_remote_link *link,
+    uint32_t type,
+    void *msg)
+{
+  SUBOOL ok;
+
+  pthread_mutex_lock(&link->tx_mutex);
+  ok = suscan_remote_frame_encode(&link->tx_frame, type, msg)
+      && suscan_remote_frame_write(link->fd, &link->tx_frame);
+  pthread_mutex_unlock(&link->tx_mutex);
+
+  if (!ok)
+    return SU_FALSE;
+
+  /* Keep suscan_analyzer_get_params meaningful on this side */
+  if (type == SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS)
+    suscan_param_slot_publish(&link->analyzer->params_slot, msg);
+
+  suscan_analyzer_dispose_message(type, msg);
+
+  return SU_TRUE;
+}
+
+/*
+ * Remote analyzers only have the output queue and the parameter slot.
+ * suscan_analyzer_destroy ends up here for them.
+ */
+void
+suscan_analyzer_destroy_remote(suscan_analyzer_t *analyzer)
+{
+  if (analyzer->remote != NULL)
+    suscan_remote_link_destroy(analyzer->remote);
+
+  suscan_param_slot_finalize(&analyzer->params_slot);
+
+  free(analyzer);
+}
+
+suscan_analyzer_t *
+suscan_analyzer_connect(
+    const struct suscan_remote_params *params,
+    struct suscan_mq *mq)
+{
+  suscan_analyzer_t *analyzer = NULL;
+  struct suscan_analyzer_params analyzer_params =
+      suscan_analyzer_params_INITIALIZER;
+
+  SU_TRYCATCH(analyzer = calloc(1, sizeof (suscan_analyzer_t)), goto fail);
+
+  analyzer->mq_out = mq;
+
+  SU_TRYCATCH(
+      suscan_param_slot_init(
+          &analyzer->params_slot,
+          sizeof(struct suscan_analyzer_params),
+          &analyzer_params),
+      goto fail);
+
+  SU_TRYCATCH(
+      analyzer->remote = suscan_remote_link_new(analyzer, params),
+      goto fail);
+
+  analyzer->running = SU_TRUE;
+
+  return analyzer;
+
+fail:
+  if (analyzer != NULL)
+    suscan_analyzer_destroy_remote(analyzer);
+
+  return NULL;
+}
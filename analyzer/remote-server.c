@@ -0,0 +1,573 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+ * Headless analyzer server: runs a local analyzer and forwards its
+ * messages to remote clients, whose requests are sent back to it.
+ */
+
+#define SU_LOG_DOMAIN "analyzer-server"
+
+#include "remote.h"
+#include "stats.h"
+#include "msg.h"
+
+/* Wakes up the sender thread when destroying the server */
+#define SUSCAN_ANALYZER_SERVER_MSG_TYPE_WAKE 0xfffffffe
+
+/******************************* Client objects ******************************/
+/* inet_ntoa is not thread safe, and clients are logged from every thread */
+SUPRIVATE const char *
+suscan_analyzer_server_addr_str(
+    const struct sockaddr_in *addr,
+    char *buf,
+    size_t size)
+{
+  if (inet_ntop(AF_INET, &addr->sin_addr, buf, size) == NULL)
+    return "(unknown)";
+
+  return buf;
+}
+
+SUPRIVATE void
+suscan_analyzer_server_client_destroy(
+    struct suscan_analyzer_server_client *client)
+{
+  char addr[INET_ADDRSTRLEN];
+
+  if (client->thread_init) {
+    shutdown(client->fd, SHUT_RDWR);
+    pthread_join(client->thread, NULL);
+  }
+
+  if (client->dropped > 0)
+    SU_INFO(
+        "%s: %llu bulk messages dropped by rate limiting\n",
+        suscan_analyzer_server_addr_str(&client->addr, addr, sizeof(addr)),
+        (unsigned long long) client->dropped);
+
+  if (client->fd != -1)
+    close(client->fd);
+
+  free(client);
+}
+
+/* Requests from this client, straight to the analyzer */
+SUPRIVATE void *
+suscan_analyzer_server_client_thread(void *data)
+{
+  struct suscan_analyzer_server_client *client =
+      (struct suscan_analyzer_server_client *) data;
+  suscan_analyzer_t *analyzer = client->server->analyzer;
+  struct suscan_remote_header header;
+  uint8_t *buf = NULL;
+  size_t alloc = 0;
+  void *msg;
+
+  while (suscan_remote_read_frame(client->fd, &header, &buf, &alloc)) {
+    if (header.type != SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR
+        && header.type != SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS) {
+      SU_WARNING("Ignoring client message of type 0x%x\n", header.type);
+      continue;
+    }
+
+    if ((msg = suscan_remote_decode(
+        analyzer,
+        header.type,
+        buf,
+        header.size)) == NULL)
+      break;
+
+    if (!suscan_analyzer_write(analyzer, header.type, msg)) {
+      suscan_analyzer_dispose_message(header.type, msg);
+      break;
+    }
+  }
+
+  if (buf != NULL)
+    free(buf);
+
+  __atomic_store_n(&client->dead, SU_TRUE, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/*
+ * Token bucket, refilled at client_rate bytes per second with up to one
+ * second of burst. Only bulk messages are subject to it. Frames larger
+ * than the bucket go out whenever it is full, and leave it in debt.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_server_client_take(
+    struct suscan_analyzer_server_client *client,
+    size_t size)
+{
+  uint64_t rate = client->server->params.client_rate;
+  uint64_t now;
+
+  if (rate == 0)
+    return SU_TRUE;
+
+  now = suscan_stats_now_ns();
+  client->tokens += 1e-9 * rate * (now - client->last_refill);
+  client->last_refill = now;
+
+  if (client->tokens > rate)
+    client->tokens = rate;
+
+  if (client->tokens < SU_MIN(size, rate)) {
+    ++client->dropped;
+    return SU_FALSE;
+  }
+
+  client->tokens -= size;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE struct suscan_analyzer_server_client *
+suscan_analyzer_server_client_new(
+    struct suscan_analyzer_server *server,
+    int fd,
+    const struct sockaddr_in *addr)
+{
+  struct suscan_analyzer_server_client *new = NULL;
+  struct suscan_analyzer_status_msg *status = NULL;
+  struct suscan_remote_frame frame;
+  struct timeval tv;
+  int one = 1;
+
+  suscan_remote_frame_init(&frame);
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_server_client)),
+      goto fail);
+
+  new->server = server;
+  new->fd = fd;
+  new->addr = *addr;
+  new->tokens = server->params.client_rate;
+  new->last_refill = suscan_stats_now_ns();
+
+  /* Clients that stop reading must not stall everyone else for long */
+  tv.tv_sec  = server->params.send_timeout_ms / 1000;
+  tv.tv_usec = (server->params.send_timeout_ms % 1000) * 1000;
+  (void) setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  /* The analyzer announced itself long ago, do it again for this one */
+  SU_TRYCATCH(
+      status = suscan_analyzer_status_msg_new(
+          SUSCAN_ANALYZER_INIT_SUCCESS,
+          NULL),
+      goto fail);
+  SU_TRYCATCH(
+      suscan_remote_frame_encode(
+          &frame,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT,
+          status),
+      goto fail);
+  SU_TRYCATCH(suscan_remote_frame_write(fd, &frame), goto fail);
+
+  SU_TRYCATCH(
+      pthread_create(
+          &new->thread,
+          NULL,
+          suscan_analyzer_server_client_thread,
+          new) == 0,
+      goto fail);
+  new->thread_init = SU_TRUE;
+
+  suscan_analyzer_status_msg_destroy(status);
+  suscan_remote_frame_finalize(&frame);
+
+  return new;
+
+fail:
+  if (status != NULL)
+    suscan_analyzer_status_msg_destroy(status);
+
+  suscan_remote_frame_finalize(&frame);
+
+  if (new != NULL)
+    suscan_analyzer_server_client_destroy(new);
+  else
+    close(fd);
+
+  return NULL;
+}
+
+/******************************* Server threads ******************************/
+SUPRIVATE unsigned int
+suscan_analyzer_server_client_count(const struct suscan_analyzer_server *srv)
+{
+  unsigned int i, count = 0;
+
+  for (i = 0; i < srv->client_count; ++i)
+    if (srv->client_list[i] != NULL)
+      ++count;
+
+  return count;
+}
+
+SUPRIVATE void *
+suscan_analyzer_server_accept_thread(void *data)
+{
+  struct suscan_analyzer_server *server =
+      (struct suscan_analyzer_server *) data;
+  struct suscan_analyzer_server_client *client;
+  struct sockaddr_in addr;
+  char name[INET_ADDRSTRLEN];
+  socklen_t len;
+  SUBOOL full;
+  int fd;
+
+  for (;;) {
+    len = sizeof(struct sockaddr_in);
+    if ((fd = accept(server->listen_fd, (struct sockaddr *) &addr, &len)) < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      break; /* Listening socket shut down */
+    }
+
+    pthread_mutex_lock(&server->client_mutex);
+    full = suscan_analyzer_server_client_count(server)
+        >= server->params.max_clients;
+    pthread_mutex_unlock(&server->client_mutex);
+
+    if (full) {
+      SU_WARNING(
+          "Rejecting %s: too many clients\n",
+          suscan_analyzer_server_addr_str(&addr, name, sizeof(name)));
+      close(fd);
+      continue;
+    }
+
+    if ((client = suscan_analyzer_server_client_new(server, fd, &addr))
+        == NULL)
+      continue;
+
+    pthread_mutex_lock(&server->client_mutex);
+    if (PTR_LIST_APPEND_CHECK(server->client, client) == -1) {
+      pthread_mutex_unlock(&server->client_mutex);
+      suscan_analyzer_server_client_destroy(client);
+      continue;
+    }
+    pthread_mutex_unlock(&server->client_mutex);
+
+    SU_INFO(
+        "Client %s connected\n",
+        suscan_analyzer_server_addr_str(&addr, name, sizeof(name)));
+  }
+
+  return NULL;
+}
+
+/* Called with client_mutex held */
+SUPRIVATE void
+suscan_analyzer_server_broadcast(
+    struct suscan_analyzer_server *server,
+    const struct suscan_remote_frame *frame,
+    SUBOOL bulk)
+{
+  struct suscan_analyzer_server_client *client;
+  char name[INET_ADDRSTRLEN];
+  unsigned int i;
+
+  for (i = 0; i < server->client_count; ++i) {
+    if ((client = server->client_list[i]) == NULL)
+      continue;
+
+    if (!__atomic_load_n(&client->dead, __ATOMIC_ACQUIRE)) {
+      if (bulk && !suscan_analyzer_server_client_take(client, frame->size))
+        continue;
+
+      if (suscan_remote_frame_write(client->fd, frame))
+        continue;
+
+      SU_WARNING(
+          "Client %s is not keeping up, disconnecting\n",
+          suscan_analyzer_server_addr_str(&client->addr, name, sizeof(name)));
+    } else {
+      SU_INFO(
+          "Client %s disconnected\n",
+          suscan_analyzer_server_addr_str(&client->addr, name, sizeof(name)));
+    }
+
+    server->client_list[i] = NULL;
+    suscan_analyzer_server_client_destroy(client);
+  }
+}
+
+SUPRIVATE void *
+suscan_analyzer_server_sender_thread(void *data)
+{
+  struct suscan_analyzer_server *server =
+      (struct suscan_analyzer_server *) data;
+  struct suscan_remote_frame frame;
+  struct msghdr mh;
+  SUBOOL bulk;
+  uint32_t type;
+  void *msg;
+
+  suscan_remote_frame_init(&frame);
+
+  memset(&mh, 0, sizeof(struct msghdr));
+  mh.msg_name = &server->mcast_sa;
+  mh.msg_namelen = sizeof(struct sockaddr_in);
+
+  for (;;) {
+    msg = suscan_analyzer_read(server->analyzer, &type);
+
+    if (type == SUSCAN_ANALYZER_SERVER_MSG_TYPE_WAKE)
+      break;
+
+    /* Encode once, send to everyone straight from the message buffers */
+    if (suscan_remote_frame_encode(&frame, type, msg)) {
+      bulk = suscan_remote_type_is_bulk(type);
+
+      if (bulk
+          && server->mcast_fd != -1
+          && frame.size <= SUSCAN_REMOTE_MAX_DATAGRAM) {
+        mh.msg_iov = frame.iov;
+        mh.msg_iovlen = frame.iovcnt;
+        if (sendmsg(server->mcast_fd, &mh, 0) < 0)
+          SU_WARNING("Multicast send failed: %s\n", strerror(errno));
+      } else {
+        pthread_mutex_lock(&server->client_mutex);
+        suscan_analyzer_server_broadcast(server, &frame, bulk);
+        pthread_mutex_unlock(&server->client_mutex);
+      }
+    }
+
+    suscan_analyzer_dispose_message(type, msg);
+
+    if (type == SUSCAN_ANALYZER_MESSAGE_TYPE_EOS)
+      break;
+  }
+
+  suscan_remote_frame_finalize(&frame);
+
+  return NULL;
+}
+
+/******************************** Server API *********************************/
+SUPRIVATE SUBOOL
+suscan_analyzer_server_init_mcast(struct suscan_analyzer_server *server)
+{
+  unsigned char ttl = 1;
+
+  server->mcast_sa.sin_family = AF_INET;
+  server->mcast_sa.sin_port = htons(server->params.mcast_port);
+
+  if (inet_aton(server->params.mcast_addr, &server->mcast_sa.sin_addr) == 0) {
+    SU_ERROR("Invalid multicast group `%s'\n", server->params.mcast_addr);
+    return SU_FALSE;
+  }
+
+  SU_TRYCATCH(
+      (server->mcast_fd = socket(AF_INET, SOCK_DGRAM, 0)) != -1,
+      return SU_FALSE);
+
+  (void) setsockopt(
+      server->mcast_fd,
+      IPPROTO_IP,
+      IP_MULTICAST_TTL,
+      &ttl,
+      sizeof(ttl));
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_server_init_listen(struct suscan_analyzer_server *server)
+{
+  struct sockaddr_in addr;
+  int one = 1;
+
+  SU_TRYCATCH(
+      (server->listen_fd = socket(AF_INET, SOCK_STREAM, 0)) != -1,
+      return SU_FALSE);
+
+  (void) setsockopt(
+      server->listen_fd,
+      SOL_SOCKET,
+      SO_REUSEADDR,
+      &one,
+      sizeof(one));
+
+  memset(&addr, 0, sizeof(struct sockaddr_in));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(server->params.port);
+
+  if (bind(server->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+    SU_ERROR(
+        "Cannot bind to port %d: %s\n",
+        server->params.port,
+        strerror(errno));
+    return SU_FALSE;
+  }
+
+  SU_TRYCATCH(listen(server->listen_fd, 5) == 0, return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+void
+suscan_analyzer_server_wait(suscan_analyzer_server_t *server)
+{
+  if (server->sender_init) {
+    pthread_join(server->sender_thread, NULL);
+    server->sender_init = SU_FALSE;
+  }
+}
+
+void
+suscan_analyzer_server_destroy(suscan_analyzer_server_t *server)
+{
+  unsigned int i;
+
+  /* No new clients */
+  if (server->accept_init) {
+    shutdown(server->listen_fd, SHUT_RDWR);
+    pthread_join(server->accept_thread, NULL);
+  }
+
+  if (server->sender_init) {
+    suscan_mq_write_urgent(
+        &server->mq,
+        SUSCAN_ANALYZER_SERVER_MSG_TYPE_WAKE,
+        NULL);
+    suscan_analyzer_server_wait(server);
+  }
+
+  for (i = 0; i < server->client_count; ++i)
+    if (server->client_list[i] != NULL)
+      suscan_analyzer_server_client_destroy(server->client_list[i]);
+
+  if (server->client_list != NULL)
+    free(server->client_list);
+
+  /* Consumes the rest of the output queue */
+  if (server->analyzer != NULL)
+    suscan_analyzer_destroy(server->analyzer);
+
+  if (server->mq_init) {
+    suscan_analyzer_consume_mq(&server->mq);
+    suscan_mq_finalize(&server->mq);
+  }
+
+  if (server->listen_fd != -1)
+    close(server->listen_fd);
+
+  if (server->mcast_fd != -1)
+    close(server->mcast_fd);
+
+  if (server->mutex_init)
+    pthread_mutex_destroy(&server->client_mutex);
+
+  free(server);
+}
+
+suscan_analyzer_server_t *
+suscan_analyzer_server_new(
+    const struct suscan_analyzer_server_params *params,
+    const struct suscan_analyzer_params *analyzer_params,
+    struct suscan_source_config *config)
+{
+  struct suscan_recorder_params rec_params =
+      suscan_recorder_params_INITIALIZER;
+  suscan_analyzer_server_t *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_analyzer_server_t)), goto fail);
+
+  new->params = *params;
+  new->listen_fd = -1;
+  new->mcast_fd = -1;
+
+  SU_TRYCATCH(pthread_mutex_init(&new->client_mutex, NULL) == 0, goto fail);
+  new->mutex_init = SU_TRUE;
+
+  SU_TRYCATCH(
+      suscan_mq_init_ring(&new->mq, SUSCAN_MQ_DEFAULT_RING_SIZE),
+      goto fail);
+  new->mq_init = SU_TRUE;
+
+  if (params->mcast_addr != NULL)
+    SU_TRYCATCH(suscan_analyzer_server_init_mcast(new), goto fail);
+
+  SU_TRYCATCH(suscan_analyzer_server_init_listen(new), goto fail);
+
+  SU_TRYCATCH(
+      new->analyzer = suscan_analyzer_new(analyzer_params, config, &new->mq),
+      goto fail);
+
+  /* Started before any client connects: nobody waits for the response */
+  if (params->record_path != NULL) {
+    rec_params.path = params->record_path;
+    rec_params.capture = SU_TRUE;
+
+    SU_TRYCATCH(
+        suscan_analyzer_start_recording_async(
+            new->analyzer,
+            SUSCAN_ANALYZER_SOURCE_HANDLE,
+            &rec_params,
+            0),
+        goto fail);
+  }
+
+  SU_TRYCATCH(
+      pthread_create(
+          &new->sender_thread,
+          NULL,
+          suscan_analyzer_server_sender_thread,
+          new) == 0,
+      goto fail);
+  new->sender_init = SU_TRUE;
+
+  SU_TRYCATCH(
+      pthread_create(
+          &new->accept_thread,
+          NULL,
+          suscan_analyzer_server_accept_thread,
+          new) == 0,
+      goto fail);
+  new->accept_init = SU_TRUE;
+
+  SU_INFO("Analyzer server listening on port %d\n", params->port);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_server_destroy(new);
+
+  return NULL;
+}
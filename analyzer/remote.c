@@ -0,0 +1,924 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <endian.h>
+#include <complex.h>
+
+#define SU_LOG_DOMAIN "remote"
+
+#include "remote.h"
+#include "msg.h"
+
+/*
+ * Arrays can go straight from message buffers to the socket when the
+ * host already uses the wire layout.
+ */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define SUSCAN_REMOTE_HOST_LAYOUT SU_TRUE
+#else
+#  define SUSCAN_REMOTE_HOST_LAYOUT SU_FALSE
+#endif
+
+#define SUSCAN_REMOTE_FLOAT_IS_WIRE \
+  (SUSCAN_REMOTE_HOST_LAYOUT && sizeof(SUFLOAT) == sizeof(float))
+#define SUSCAN_REMOTE_COMPLEX_IS_WIRE \
+  (SUSCAN_REMOTE_HOST_LAYOUT && sizeof(SUCOMPLEX) == sizeof(float complex))
+
+#define SUSCAN_REMOTE_CHANNEL_SIZE 40 /* 8 floats, 2 integers */
+
+/******************************* Field packing *******************************/
+struct suscan_remote_cursor {
+  uint8_t *p;
+  const uint8_t *end;
+  SUBOOL ok; /* Cleared on overflow */
+};
+
+SUINLINE void
+suscan_remote_cursor_init(
+    struct suscan_remote_cursor *cur,
+    const void *data,
+    size_t size)
+{
+  cur->p = (uint8_t *) data;
+  cur->end = cur->p + size;
+  cur->ok = SU_TRUE;
+}
+
+SUINLINE uint8_t *
+suscan_remote_cursor_take(struct suscan_remote_cursor *cur, size_t size)
+{
+  uint8_t *p = cur->p;
+
+  if (!cur->ok || (size_t) (cur->end - cur->p) < size) {
+    cur->ok = SU_FALSE;
+    return NULL;
+  }
+
+  cur->p += size;
+
+  return p;
+}
+
+SUINLINE void
+suscan_remote_put_u32(struct suscan_remote_cursor *cur, uint32_t val)
+{
+  uint8_t *p;
+
+  if ((p = suscan_remote_cursor_take(cur, 4)) != NULL) {
+    val = htole32(val);
+    memcpy(p, &val, 4);
+  }
+}
+
+SUINLINE void
+suscan_remote_put_u64(struct suscan_remote_cursor *cur, uint64_t val)
+{
+  uint8_t *p;
+
+  if ((p = suscan_remote_cursor_take(cur, 8)) != NULL) {
+    val = htole64(val);
+    memcpy(p, &val, 8);
+  }
+}
+
+SUINLINE void
+suscan_remote_put_float(struct suscan_remote_cursor *cur, SUFLOAT val)
+{
+  float f = val;
+  uint32_t u;
+
+  memcpy(&u, &f, 4);
+  suscan_remote_put_u32(cur, u);
+}
+
+SUINLINE uint32_t
+suscan_remote_get_u32(struct suscan_remote_cursor *cur)
+{
+  uint8_t *p;
+  uint32_t val = 0;
+
+  if ((p = suscan_remote_cursor_take(cur, 4)) != NULL)
+    memcpy(&val, p, 4);
+
+  return le32toh(val);
+}
+
+SUINLINE uint64_t
+suscan_remote_get_u64(struct suscan_remote_cursor *cur)
+{
+  uint8_t *p;
+  uint64_t val = 0;
+
+  if ((p = suscan_remote_cursor_take(cur, 8)) != NULL)
+    memcpy(&val, p, 8);
+
+  return le64toh(val);
+}
+
+SUINLINE SUFLOAT
+suscan_remote_get_float(struct suscan_remote_cursor *cur)
+{
+  uint32_t u = suscan_remote_get_u32(cur);
+  float f;
+
+  memcpy(&f, &u, 4);
+
+  return f;
+}
+
+SUPRIVATE void
+suscan_remote_put_channel(
+    struct suscan_remote_cursor *cur,
+    const struct sigutils_channel *channel)
+{
+  suscan_remote_put_float(cur, channel->fc);
+  suscan_remote_put_float(cur, channel->f_lo);
+  suscan_remote_put_float(cur, channel->f_hi);
+  suscan_remote_put_float(cur, channel->bw);
+  suscan_remote_put_float(cur, channel->snr);
+  suscan_remote_put_float(cur, channel->S0);
+  suscan_remote_put_float(cur, channel->N0);
+  suscan_remote_put_float(cur, channel->ft);
+  suscan_remote_put_u32(cur, channel->age);
+  suscan_remote_put_u32(cur, channel->present);
+}
+
+SUPRIVATE void
+suscan_remote_get_channel(
+    struct suscan_remote_cursor *cur,
+    struct sigutils_channel *channel)
+{
+  memset(channel, 0, sizeof(struct sigutils_channel));
+
+  channel->fc      = suscan_remote_get_float(cur);
+  channel->f_lo    = suscan_remote_get_float(cur);
+  channel->f_hi    = suscan_remote_get_float(cur);
+  channel->bw      = suscan_remote_get_float(cur);
+  channel->snr     = suscan_remote_get_float(cur);
+  channel->S0      = suscan_remote_get_float(cur);
+  channel->N0      = suscan_remote_get_float(cur);
+  channel->ft      = suscan_remote_get_float(cur);
+  channel->age     = suscan_remote_get_u32(cur);
+  channel->present = suscan_remote_get_u32(cur);
+}
+
+SUPRIVATE void
+suscan_remote_put_insp_params(
+    struct suscan_remote_cursor *cur,
+    const struct suscan_inspector_params *params)
+{
+  suscan_remote_put_u32(cur, params->inspector_id);
+  suscan_remote_put_u32(cur, params->gc_ctrl);
+  suscan_remote_put_float(cur, params->gc_gain);
+  suscan_remote_put_u32(cur, params->fc_ctrl);
+  suscan_remote_put_float(cur, params->fc_off);
+  suscan_remote_put_float(cur, params->fc_phi);
+  suscan_remote_put_u32(cur, params->mf_conf);
+  suscan_remote_put_float(cur, params->mf_rolloff);
+  suscan_remote_put_u32(cur, params->br_ctrl);
+  suscan_remote_put_float(cur, params->br_alpha);
+  suscan_remote_put_float(cur, params->br_beta);
+  suscan_remote_put_u32(cur, params->psd_source);
+  suscan_remote_put_float(cur, params->sym_phase);
+  suscan_remote_put_float(cur, params->baud);
+  suscan_remote_put_float(cur, params->display_rate);
+  suscan_remote_put_u32(cur, params->squelch);
+  suscan_remote_put_float(cur, params->squelch_level);
+  suscan_remote_put_u32(cur, params->squelch_policy);
+}
+
+SUPRIVATE void
+suscan_remote_get_insp_params(
+    struct suscan_remote_cursor *cur,
+    struct suscan_inspector_params *params)
+{
+  params->inspector_id   = suscan_remote_get_u32(cur);
+  params->gc_ctrl        = suscan_remote_get_u32(cur);
+  params->gc_gain        = suscan_remote_get_float(cur);
+  params->fc_ctrl        = suscan_remote_get_u32(cur);
+  params->fc_off         = suscan_remote_get_float(cur);
+  params->fc_phi         = suscan_remote_get_float(cur);
+  params->mf_conf        = suscan_remote_get_u32(cur);
+  params->mf_rolloff     = suscan_remote_get_float(cur);
+  params->br_ctrl        = suscan_remote_get_u32(cur);
+  params->br_alpha       = suscan_remote_get_float(cur);
+  params->br_beta        = suscan_remote_get_float(cur);
+  params->psd_source     = suscan_remote_get_u32(cur);
+  params->sym_phase      = suscan_remote_get_float(cur);
+  params->baud           = suscan_remote_get_float(cur);
+  params->display_rate   = suscan_remote_get_float(cur);
+  params->squelch        = suscan_remote_get_u32(cur);
+  params->squelch_level  = suscan_remote_get_float(cur);
+  params->squelch_policy = suscan_remote_get_u32(cur);
+}
+
+/********************************* Encoding **********************************/
+void
+suscan_remote_frame_init(struct suscan_remote_frame *frame)
+{
+  memset(frame, 0, sizeof(struct suscan_remote_frame));
+}
+
+void
+suscan_remote_frame_finalize(struct suscan_remote_frame *frame)
+{
+  if (frame->scratch != NULL)
+    free(frame->scratch);
+
+  suscan_remote_frame_init(frame);
+}
+
+SUPRIVATE void *
+suscan_remote_frame_scratch(struct suscan_remote_frame *frame, size_t size)
+{
+  void *new;
+
+  if (size > frame->scratch_size) {
+    SU_TRYCATCH(new = realloc(frame->scratch, size), return NULL);
+    frame->scratch = new;
+    frame->scratch_size = size;
+  }
+
+  return frame->scratch;
+}
+
+SUPRIVATE SUBOOL
+suscan_remote_encode_floats(
+    struct suscan_remote_frame *frame,
+    const SUFLOAT *data,
+    size_t count)
+{
+  struct suscan_remote_cursor cur;
+  size_t i;
+
+  if (SUSCAN_REMOTE_FLOAT_IS_WIRE) {
+    frame->iov[1].iov_base = (void *) data;
+  } else {
+    SU_TRYCATCH(
+        frame->iov[1].iov_base = suscan_remote_frame_scratch(
+            frame,
+            count * sizeof(float)),
+        return SU_FALSE);
+
+    suscan_remote_cursor_init(&cur, frame->scratch, count * sizeof(float));
+    for (i = 0; i < count; ++i)
+      suscan_remote_put_float(&cur, data[i]);
+  }
+
+  frame->iov[1].iov_len = count * sizeof(float);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_remote_encode_complex(
+    struct suscan_remote_frame *frame,
+    const SUCOMPLEX *data,
+    size_t count)
+{
+  struct suscan_remote_cursor cur;
+  size_t i;
+
+  if (SUSCAN_REMOTE_COMPLEX_IS_WIRE) {
+    frame->iov[1].iov_base = (void *) data;
+  } else {
+    SU_TRYCATCH(
+        frame->iov[1].iov_base = suscan_remote_frame_scratch(
+            frame,
+            count * sizeof(float complex)),
+        return SU_FALSE);
+
+    suscan_remote_cursor_init(
+        &cur,
+        frame->scratch,
+        count * sizeof(float complex));
+    for (i = 0; i < count; ++i) {
+      suscan_remote_put_float(&cur, SU_C_REAL(data[i]));
+      suscan_remote_put_float(&cur, SU_C_IMAG(data[i]));
+    }
+  }
+
+  frame->iov[1].iov_len = count * sizeof(float complex);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_remote_encode_inspector(
+    struct suscan_remote_cursor *cur,
+    const struct suscan_analyzer_inspector_msg *msg)
+{
+  suscan_remote_put_u32(cur, msg->kind);
+  suscan_remote_put_u32(cur, msg->inspector_id);
+  suscan_remote_put_u32(cur, msg->req_id);
+  suscan_remote_put_u32(cur, msg->handle);
+  suscan_remote_put_u32(cur, msg->status);
+
+  switch (msg->kind) {
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+      suscan_remote_put_channel(cur, &msg->channel);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO:
+      suscan_remote_put_float(cur, msg->baud.fac);
+      suscan_remote_put_float(cur, msg->baud.nln);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_INSP_PARAMS:
+      suscan_remote_put_insp_params(cur, &msg->insp_params);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_START_RECORDING:
+      /* Recorders write to local files */
+      SU_ERROR("Recording is not available through remote analyzers\n");
+      return SU_FALSE;
+
+    default:
+      break;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_remote_encode_params(
+    struct suscan_remote_cursor *cur,
+    const struct suscan_analyzer_params *params)
+{
+  suscan_remote_put_u32(cur, params->detector_params.window_size);
+  suscan_remote_put_u32(cur, params->detector_params.window);
+  suscan_remote_put_float(cur, params->detector_params.alpha);
+  suscan_remote_put_float(cur, params->detector_params.beta);
+  suscan_remote_put_float(cur, params->detector_params.gamma);
+  suscan_remote_put_float(cur, params->detector_params.snr);
+  suscan_remote_put_float(cur, params->channel_update_int);
+  suscan_remote_put_float(cur, params->psd_update_int);
+  suscan_remote_put_u32(cur, params->psd_width);
+  suscan_remote_put_float(cur, params->stats_update_int);
+  suscan_remote_put_float(cur, params->replay_speed);
+}
+
+SUBOOL
+suscan_remote_type_is_bulk(uint32_t type)
+{
+  /* Channel deltas are not: losing one corrupts the receiver's list */
+  switch (type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
+      return SU_TRUE;
+  }
+
+  return SU_FALSE;
+}
+
+SUBOOL
+suscan_remote_frame_encode(
+    struct suscan_remote_frame *frame,
+    uint32_t type,
+    const void *msg)
+{
+  struct suscan_remote_cursor cur, hdr;
+  const struct suscan_analyzer_status_msg *status;
+  const struct suscan_analyzer_samples_lost_msg *lost;
+  const struct suscan_analyzer_channel_msg *channels;
+  const struct suscan_analyzer_psd_msg *psd;
+  const struct suscan_analyzer_sample_batch_msg *batch;
+  struct suscan_remote_cursor bulk;
+  size_t len;
+  unsigned int i;
+
+  suscan_remote_cursor_init(&cur, frame->head, SUSCAN_REMOTE_HEAD_SIZE);
+  hdr = cur;
+  suscan_remote_cursor_take(&cur, SUSCAN_REMOTE_HEADER_SIZE);
+
+  frame->iov[0].iov_base = frame->head;
+  frame->iov[1].iov_len  = 0;
+
+  switch (type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+      status = (const struct suscan_analyzer_status_msg *) msg;
+      len = status->err_msg == NULL ? 0 : strlen(status->err_msg);
+
+      suscan_remote_put_u32(&cur, status->code);
+      suscan_remote_put_u32(&cur, len);
+
+      frame->iov[1].iov_base = status->err_msg;
+      frame->iov[1].iov_len  = len;
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+      lost = (const struct suscan_analyzer_samples_lost_msg *) msg;
+
+      suscan_remote_put_u64(&cur, lost->lost);
+      suscan_remote_put_u64(&cur, lost->total);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+      channels = (const struct suscan_analyzer_channel_msg *) msg;
+      len = channels->channel_count * (4 + SUSCAN_REMOTE_CHANNEL_SIZE)
+          + channels->removed_count * 4;
+
+      suscan_remote_put_u32(&cur, channels->full);
+      suscan_remote_put_u32(&cur, channels->channel_count);
+      suscan_remote_put_u32(&cur, channels->removed_count);
+
+      SU_TRYCATCH(
+          frame->iov[1].iov_base = suscan_remote_frame_scratch(frame, len),
+          return SU_FALSE);
+      frame->iov[1].iov_len = len;
+
+      suscan_remote_cursor_init(&bulk, frame->scratch, len);
+      for (i = 0; i < channels->channel_count; ++i) {
+        suscan_remote_put_u32(&bulk, channels->id_list[i]);
+        suscan_remote_put_channel(&bulk, channels->channel_list[i]);
+      }
+
+      for (i = 0; i < channels->removed_count; ++i)
+        suscan_remote_put_u32(&bulk, channels->removed_list[i]);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
+      psd = (const struct suscan_analyzer_psd_msg *) msg;
+
+      suscan_remote_put_u64(&cur, psd->fc);
+      suscan_remote_put_u32(&cur, psd->inspector_id);
+      suscan_remote_put_float(&cur, psd->samp_rate);
+      suscan_remote_put_float(&cur, psd->N0);
+      suscan_remote_put_u32(&cur, psd->psd_size);
+
+      SU_TRYCATCH(
+          suscan_remote_encode_floats(frame, psd->psd_data, psd->psd_size),
+          return SU_FALSE);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      batch = (const struct suscan_analyzer_sample_batch_msg *) msg;
+
+      suscan_remote_put_u32(&cur, batch->inspector_id);
+      suscan_remote_put_u32(&cur, batch->sample_count);
+
+      SU_TRYCATCH(
+          suscan_remote_encode_complex(
+              frame,
+              batch->samples,
+              batch->sample_count),
+          return SU_FALSE);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      if (!suscan_remote_encode_inspector(&cur, msg))
+        return SU_FALSE;
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      suscan_remote_encode_params(&cur, msg);
+      break;
+
+    default:
+      return SU_FALSE;
+  }
+
+  SU_TRYCATCH(cur.ok, return SU_FALSE);
+
+  frame->iov[0].iov_len = cur.p - frame->head;
+  frame->iovcnt = frame->iov[1].iov_len > 0 ? 2 : 1;
+  frame->size = frame->iov[0].iov_len + frame->iov[1].iov_len;
+
+  suscan_remote_put_u32(&hdr, SUSCAN_REMOTE_MAGIC);
+  suscan_remote_put_u32(&hdr, type);
+  suscan_remote_put_u32(&hdr, frame->size - SUSCAN_REMOTE_HEADER_SIZE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_remote_frame_write(int fd, const struct suscan_remote_frame *frame)
+{
+  struct iovec iov[2];
+  int iovcnt = frame->iovcnt;
+  struct iovec *p = iov;
+  ssize_t ret;
+
+  memcpy(iov, frame->iov, sizeof(struct iovec) * iovcnt);
+
+  /* Short writes are possible with send timeouts */
+  while (iovcnt > 0) {
+    if ((ret = writev(fd, p, iovcnt)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return SU_FALSE;
+    }
+
+    while (iovcnt > 0 && (size_t) ret >= p->iov_len) {
+      ret -= p->iov_len;
+      ++p;
+      --iovcnt;
+    }
+
+    if (iovcnt > 0) {
+      p->iov_base = (uint8_t *) p->iov_base + ret;
+      p->iov_len -= ret;
+    }
+  }
+
+  return SU_TRUE;
+}
+
+/********************************* Decoding **********************************/
+SUBOOL
+suscan_remote_parse_header(
+    const uint8_t *data,
+    struct suscan_remote_header *header)
+{
+  struct suscan_remote_cursor cur;
+
+  suscan_remote_cursor_init(&cur, data, SUSCAN_REMOTE_HEADER_SIZE);
+
+  header->magic = suscan_remote_get_u32(&cur);
+  header->type  = suscan_remote_get_u32(&cur);
+  header->size  = suscan_remote_get_u32(&cur);
+
+  if (header->magic != SUSCAN_REMOTE_MAGIC) {
+    SU_ERROR("Bad frame magic 0x%08x\n", header->magic);
+    return SU_FALSE;
+  }
+
+  if (header->size > SUSCAN_REMOTE_MAX_FRAME) {
+    SU_ERROR("Frame too big (%u bytes)\n", header->size);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_remote_read_all(int fd, uint8_t *data, size_t size)
+{
+  ssize_t ret;
+
+  while (size > 0) {
+    if ((ret = read(fd, data, size)) <= 0) {
+      if (ret < 0 && errno == EINTR)
+        continue;
+      return SU_FALSE;
+    }
+
+    data += ret;
+    size -= ret;
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_remote_read_frame(
+    int fd,
+    struct suscan_remote_header *header,
+    uint8_t **buf,
+    size_t *alloc)
+{
+  uint8_t head[SUSCAN_REMOTE_HEADER_SIZE];
+  void *new;
+
+  if (!suscan_remote_read_all(fd, head, sizeof(head)))
+    return SU_FALSE;
+
+  SU_TRYCATCH(suscan_remote_parse_header(head, header), return SU_FALSE);
+
+  if (header->size > *alloc) {
+    SU_TRYCATCH(new = realloc(*buf, header->size), return SU_FALSE);
+    *buf = new;
+    *alloc = header->size;
+  }
+
+  return suscan_remote_read_all(fd, *buf, header->size);
+}
+
+SUPRIVATE void *
+suscan_remote_decode_status(
+    suscan_analyzer_t *analyzer,
+    struct suscan_remote_cursor *cur)
+{
+  struct suscan_analyzer_status_msg *new = NULL;
+  char *err_msg = NULL;
+  const uint8_t *text;
+  int code;
+  uint32_t len;
+
+  code = suscan_remote_get_u32(cur);
+  len  = suscan_remote_get_u32(cur);
+  SU_TRYCATCH(text = suscan_remote_cursor_take(cur, len), goto done);
+
+  if (len > 0) {
+    SU_TRYCATCH(err_msg = malloc(len + 1), goto done);
+    memcpy(err_msg, text, len);
+    err_msg[len] = '\0';
+  }
+
+  SU_TRYCATCH(new = suscan_analyzer_status_msg_new(code, err_msg), goto done);
+  new->sender = analyzer;
+
+done:
+  if (err_msg != NULL)
+    free(err_msg);
+
+  return new;
+}
+
+SUPRIVATE void *
+suscan_remote_decode_channels(
+    suscan_analyzer_t *analyzer,
+    struct suscan_remote_cursor *cur)
+{
+  struct suscan_analyzer_channel_msg *new = NULL;
+  struct sigutils_channel channel;
+  uint32_t full, count, removed;
+  unsigned int i;
+
+  full    = suscan_remote_get_u32(cur);
+  count   = suscan_remote_get_u32(cur);
+  removed = suscan_remote_get_u32(cur);
+  SU_TRYCATCH(
+      count <= SUSCAN_REMOTE_MAX_FRAME && removed <= SUSCAN_REMOTE_MAX_FRAME,
+      goto fail);
+  SU_TRYCATCH(
+      (size_t) (cur->end - cur->p)
+          >= count * (4 + SUSCAN_REMOTE_CHANNEL_SIZE) + removed * 4,
+      goto fail);
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_channel_msg)),
+      goto fail);
+
+  new->sender = analyzer;
+  new->full = full != 0;
+
+  if (count > 0) {
+    SU_TRYCATCH(
+        new->channel_list = calloc(count, sizeof(struct sigutils_channel *)),
+        goto fail);
+    SU_TRYCATCH(new->id_list = calloc(count, sizeof(uint32_t)), goto fail);
+  }
+
+  if (removed > 0)
+    SU_TRYCATCH(
+        new->removed_list = calloc(removed, sizeof(uint32_t)),
+        goto fail);
+
+  for (i = 0; i < count; ++i) {
+    new->id_list[i] = suscan_remote_get_u32(cur);
+    suscan_remote_get_channel(cur, &channel);
+    SU_TRYCATCH(new->channel_list[i] = su_channel_dup(&channel), goto fail);
+    new->channel_count = i + 1;
+  }
+
+  for (i = 0; i < removed; ++i)
+    new->removed_list[i] = suscan_remote_get_u32(cur);
+  new->removed_count = removed;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_channel_msg_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void *
+suscan_remote_decode_psd(struct suscan_remote_cursor *cur)
+{
+  struct suscan_analyzer_psd_msg *new = NULL;
+  unsigned int i;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
+      goto fail);
+
+  new->fc           = suscan_remote_get_u64(cur);
+  new->inspector_id = suscan_remote_get_u32(cur);
+  new->samp_rate    = suscan_remote_get_float(cur);
+  new->N0           = suscan_remote_get_float(cur);
+  new->psd_size     = suscan_remote_get_u32(cur);
+
+  SU_TRYCATCH(
+      cur->ok && (size_t) (cur->end - cur->p) >= new->psd_size * 4,
+      goto fail);
+
+  if (new->psd_size > 0)
+    SU_TRYCATCH(
+        new->psd_data = malloc(new->psd_size * sizeof(SUFLOAT)),
+        goto fail);
+
+  new->psd_storage = new->psd_size;
+
+  for (i = 0; i < new->psd_size; ++i)
+    new->psd_data[i] = suscan_remote_get_float(cur);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_psd_msg_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void *
+suscan_remote_decode_samples(struct suscan_remote_cursor *cur)
+{
+  struct suscan_analyzer_sample_batch_msg *new = NULL;
+  uint32_t inspector_id;
+  uint32_t count;
+  SUFLOAT re, im;
+  unsigned int i;
+
+  inspector_id = suscan_remote_get_u32(cur);
+  count = suscan_remote_get_u32(cur);
+
+  /* Count comes from the wire: no allocation past what the frame holds */
+  SU_TRYCATCH(
+      cur->ok && count <= (size_t) (cur->end - cur->p) / 8,
+      goto fail);
+
+  SU_TRYCATCH(
+      new = suscan_analyzer_sample_batch_msg_new(inspector_id),
+      goto fail);
+
+  SU_TRYCATCH(suscan_analyzer_sample_batch_msg_reserve(new, count), goto fail);
+
+  for (i = 0; i < count; ++i) {
+    re = suscan_remote_get_float(cur);
+    im = suscan_remote_get_float(cur);
+    new->samples[i] = re + I * im;
+  }
+
+  new->sample_count = count;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_sample_batch_msg_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void *
+suscan_remote_decode_inspector(struct suscan_remote_cursor *cur)
+{
+  struct suscan_analyzer_inspector_msg *new = NULL;
+  enum suscan_analyzer_inspector_msgkind kind;
+
+  kind = suscan_remote_get_u32(cur);
+
+  SU_TRYCATCH(new = suscan_analyzer_inspector_msg_new(kind, 0), return NULL);
+
+  new->inspector_id = suscan_remote_get_u32(cur);
+  new->req_id       = suscan_remote_get_u32(cur);
+  new->handle       = suscan_remote_get_u32(cur);
+  new->status       = suscan_remote_get_u32(cur);
+
+  switch (kind) {
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+      suscan_remote_get_channel(cur, &new->channel);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO:
+      new->baud.fac = suscan_remote_get_float(cur);
+      new->baud.nln = suscan_remote_get_float(cur);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_INSP_PARAMS:
+      suscan_remote_get_insp_params(cur, &new->insp_params);
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_START_RECORDING:
+      /* Would carry a pointer */
+      cur->ok = SU_FALSE;
+      break;
+
+    default:
+      break;
+  }
+
+  return new;
+}
+
+SUPRIVATE void *
+suscan_remote_decode_params(
+    suscan_analyzer_t *analyzer,
+    struct suscan_remote_cursor *cur)
+{
+  struct suscan_analyzer_params *new = NULL;
+
+  SU_TRYCATCH(
+      new = malloc(sizeof(struct suscan_analyzer_params)),
+      return NULL);
+
+  suscan_analyzer_get_params(analyzer, new);
+
+  new->detector_params.window_size = suscan_remote_get_u32(cur);
+  new->detector_params.window      = suscan_remote_get_u32(cur);
+  new->detector_params.alpha       = suscan_remote_get_float(cur);
+  new->detector_params.beta        = suscan_remote_get_float(cur);
+  new->detector_params.gamma       = suscan_remote_get_float(cur);
+  new->detector_params.snr         = suscan_remote_get_float(cur);
+  new->channel_update_int          = suscan_remote_get_float(cur);
+  new->psd_update_int              = suscan_remote_get_float(cur);
+  new->psd_width                   = suscan_remote_get_u32(cur);
+  new->stats_update_int            = suscan_remote_get_float(cur);
+  new->replay_speed                = suscan_remote_get_float(cur);
+
+  return new;
+}
+
+void *
+suscan_remote_decode(
+    suscan_analyzer_t *analyzer,
+    uint32_t type,
+    const uint8_t *data,
+    size_t size)
+{
+  struct suscan_remote_cursor cur;
+  struct suscan_analyzer_samples_lost_msg *lost;
+  uint64_t lost_count, lost_total;
+  void *msg = NULL;
+
+  suscan_remote_cursor_init(&cur, data, size);
+
+  switch (type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+      msg = suscan_remote_decode_status(analyzer, &cur);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+      /* In wire order: argument evaluation order is unspecified */
+      lost_count = suscan_remote_get_u64(&cur);
+      lost_total = suscan_remote_get_u64(&cur);
+      if ((lost = suscan_analyzer_samples_lost_msg_new(
+          lost_count,
+          lost_total)) != NULL)
+        lost->sender = analyzer;
+      msg = lost;
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+      msg = suscan_remote_decode_channels(analyzer, &cur);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
+      msg = suscan_remote_decode_psd(&cur);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      msg = suscan_remote_decode_samples(&cur);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      msg = suscan_remote_decode_inspector(&cur);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      msg = suscan_remote_decode_params(analyzer, &cur);
+      break;
+
+    default:
+      SU_WARNING("Unexpected remote message type 0x%x\n", type);
+      return NULL;
+  }
+
+  if (msg != NULL && !cur.ok) {
+    SU_ERROR("Truncated remote message (type 0x%x)\n", type);
+    suscan_analyzer_dispose_message(type, msg);
+    msg = NULL;
+  }
+
+  return msg;
+}
@@ -0,0 +1,222 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _REMOTE_H
+#define _REMOTE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <sigutils/sigutils.h>
+
+#include "analyzer.h"
+
+/*
+ * Binary protocol for remote analyzers. Every frame is a 12 byte header
+ * followed by the payload. All integers and floats are little endian,
+ * floats are IEEE 754 single precision. Sample and spectrum arrays are
+ * sent as they are in memory whenever the host layout matches.
+ *
+ * The server sends SOURCE_INIT, EOS, CHANNEL, SAMPLES_LOST, INSPECTOR,
+ * PSD, SAMPLES and INSP_PSD messages. Clients send INSPECTOR and PARAMS.
+ */
+#define SUSCAN_REMOTE_MAGIC         0x4e535553 /* "SUSN" */
+#define SUSCAN_REMOTE_DEFAULT_PORT  28001
+#define SUSCAN_REMOTE_HEADER_SIZE   12
+#define SUSCAN_REMOTE_HEAD_SIZE     128 /* Header plus fixed fields */
+#define SUSCAN_REMOTE_MAX_FRAME     (16 << 20)
+#define SUSCAN_REMOTE_MAX_DATAGRAM  65507
+
+struct suscan_remote_header {
+  uint32_t magic;
+  uint32_t type; /* SUSCAN_ANALYZER_MESSAGE_TYPE_* */
+  uint32_t size; /* Payload size, header not included */
+};
+
+/* Encoded message, ready to be written with writev or sendmsg */
+struct suscan_remote_frame {
+  uint8_t head[SUSCAN_REMOTE_HEAD_SIZE];
+  void   *scratch; /* Payloads that must be converted first */
+  size_t  scratch_size;
+
+  struct iovec iov[2];
+  int    iovcnt;
+  size_t size; /* Total bytes, header included */
+};
+
+void suscan_remote_frame_init(struct suscan_remote_frame *frame);
+
+void suscan_remote_frame_finalize(struct suscan_remote_frame *frame);
+
+/* Fails for message types the protocol does not carry */
+SUBOOL suscan_remote_frame_encode(
+    struct suscan_remote_frame *frame,
+    uint32_t type,
+    const void *msg);
+
+SUBOOL suscan_remote_frame_write(
+    int fd,
+    const struct suscan_remote_frame *frame);
+
+/* Spectrum and sample updates: the ones subject to rate limiting */
+SUBOOL suscan_remote_type_is_bulk(uint32_t type);
+
+/* Reads a whole frame from a stream socket. buf grows as needed */
+SUBOOL suscan_remote_read_frame(
+    int fd,
+    struct suscan_remote_header *header,
+    uint8_t **buf,
+    size_t *alloc);
+
+SUBOOL suscan_remote_parse_header(
+    const uint8_t *data,
+    struct suscan_remote_header *header);
+
+/*
+ * Builds a regular analyzer message from a payload. PARAMS payloads only
+ * carry the client-tunable fields: the rest is taken from analyzer.
+ */
+void *suscan_remote_decode(
+    suscan_analyzer_t *analyzer,
+    uint32_t type,
+    const uint8_t *data,
+    size_t size);
+
+/******************************** Server side ********************************/
+struct suscan_analyzer_server_params {
+  uint16_t port;           /* TCP port */
+  const char *mcast_addr;  /* Multicast group for bulk updates, or NULL */
+  uint16_t mcast_port;
+  uint64_t client_rate;    /* Bulk bytes per second per client, 0: any */
+  unsigned int max_clients;
+  unsigned int send_timeout_ms; /* Clients blocking us longer are dropped */
+  const char *record_path; /* Indexed capture of the source stream, or NULL */
+};
+
+#define suscan_analyzer_server_params_INITIALIZER {           \
+  SUSCAN_REMOTE_DEFAULT_PORT, /* port */                      \
+  NULL,                       /* mcast_addr */                \
+  SUSCAN_REMOTE_DEFAULT_PORT, /* mcast_port */                \
+  0,                          /* client_rate */               \
+  8,                          /* max_clients */               \
+  1000,                       /* send_timeout_ms */           \
+  NULL                        /* record_path */               \
+}
+
+struct suscan_analyzer_server;
+
+struct suscan_analyzer_server_client {
+  struct suscan_analyzer_server *server;
+  int fd;
+  struct sockaddr_in addr;
+
+  /* Token bucket for bulk messages, touched by the sender thread only */
+  SUFLOAT  tokens;
+  uint64_t last_refill;
+  uint64_t dropped;
+
+  SUBOOL    dead;        /* Set by the receiver thread on disconnection */
+  SUBOOL    thread_init;
+  pthread_t thread;      /* Receiver: requests to the analyzer */
+};
+
+struct suscan_analyzer_server {
+  struct suscan_analyzer_server_params params;
+  struct suscan_mq mq;         /* Analyzer output */
+  suscan_analyzer_t *analyzer;
+
+  int listen_fd;
+  int mcast_fd;
+  struct sockaddr_in mcast_sa;
+
+  pthread_mutex_t client_mutex;
+  PTR_LIST(struct suscan_analyzer_server_client, client);
+
+  SUBOOL halting;
+  SUBOOL mq_init;
+  SUBOOL mutex_init;
+  SUBOOL accept_init;
+  SUBOOL sender_init;
+  pthread_t accept_thread;
+  pthread_t sender_thread;   /* Analyzer messages to clients */
+};
+
+typedef struct suscan_analyzer_server suscan_analyzer_server_t;
+
+suscan_analyzer_server_t *suscan_analyzer_server_new(
+    const struct suscan_analyzer_server_params *params,
+    const struct suscan_analyzer_params *analyzer_params,
+    struct suscan_source_config *config);
+
+/* Returns when the sender stops: end of stream or fatal error */
+void suscan_analyzer_server_wait(suscan_analyzer_server_t *server);
+
+void suscan_analyzer_server_destroy(suscan_analyzer_server_t *server);
+
+/******************************** Client side ********************************/
+struct suscan_remote_params {
+  const char *host;
+  uint16_t port;
+  const char *mcast_addr;  /* Must match the server's, or NULL */
+  uint16_t mcast_port;
+};
+
+/* Polling period of the multicast receiver, to notice shutdowns */
+#define SUSCAN_REMOTE_MCAST_POLL_MS 250
+
+#define suscan_remote_params_INITIALIZER {                    \
+  "localhost",                /* host */                      \
+  SUSCAN_REMOTE_DEFAULT_PORT, /* port */                      \
+  NULL,                       /* mcast_addr */                \
+  SUSCAN_REMOTE_DEFAULT_PORT  /* mcast_port */                \
+}
+
+/* Connection behind a remote suscan_analyzer_t */
+struct suscan_remote_link {
+  suscan_analyzer_t *analyzer;
+  int fd;
+  int mcast_fd;
+  struct in_addr mcast_source; /* Server address, datagrams must match */
+
+  pthread_mutex_t tx_mutex;
+  struct suscan_remote_frame tx_frame;
+
+  SUBOOL    halting;
+  SUBOOL    mutex_init;
+  SUBOOL    rx_init;
+  SUBOOL    mcast_init;
+  pthread_t rx_thread;
+  pthread_t mcast_thread;
+};
+
+struct suscan_remote_link *suscan_remote_link_new(
+    suscan_analyzer_t *analyzer,
+    const struct suscan_remote_params *params);
+
+/* Takes ownership of msg on success, like suscan_mq_write */
+SUBOOL suscan_remote_link_write(
+    struct suscan_remote_link *link,
+    uint32_t type,
+    void *msg);
+
+void suscan_remote_link_destroy(struct suscan_remote_link *link);
+
+#endif /* _REMOTE_H */
@@ -0,0 +1,196 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define SU_LOG_DOMAIN "ring"
+
+#include "ring.h"
+
+SUBOOL
+suscan_ring_init(struct suscan_ring *ring, size_t elem_size, size_t count)
+{
+  size_t size = 1;
+
+  memset(ring, 0, sizeof(struct suscan_ring));
+
+  /* Power of two sizes let positions wrap around freely */
+  while (size < count)
+    size <<= 1;
+
+  SU_TRYCATCH(ring->buffer = malloc(size * elem_size), goto fail);
+
+  ring->elem_size = elem_size;
+  ring->size = size;
+
+  SU_TRYCATCH(pthread_mutex_init(&ring->mutex, NULL) == 0, goto fail);
+  ring->mutex_init = SU_TRUE;
+
+  SU_TRYCATCH(pthread_cond_init(&ring->cond, NULL) == 0, goto fail);
+  ring->cond_init = SU_TRUE;
+
+  return SU_TRUE;
+
+fail:
+  suscan_ring_finalize(ring);
+
+  return SU_FALSE;
+}
+
+void
+suscan_ring_finalize(struct suscan_ring *ring)
+{
+  if (ring->cond_init)
+    pthread_cond_destroy(&ring->cond);
+
+  if (ring->mutex_init)
+    pthread_mutex_destroy(&ring->mutex);
+
+  if (ring->buffer != NULL)
+    free(ring->buffer);
+
+  memset(ring, 0, sizeof(struct suscan_ring));
+}
+
+SUPRIVATE void
+suscan_ring_wake_consumer(struct suscan_ring *ring)
+{
+  /*
+   * Pairs with the store to waiting in suscan_ring_read: either we see the
+   * consumer waiting, or the consumer sees our update before sleeping.
+   */
+  if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&ring->mutex);
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->mutex);
+  }
+}
+
+size_t
+suscan_ring_write(struct suscan_ring *ring, const void *data, size_t count)
+{
+  const uint8_t *bytes = (const uint8_t *) data;
+  size_t head, tail;
+  size_t offset, chunk;
+
+  head = ring->head;
+  tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+  if (count > ring->size - (head - tail))
+    count = ring->size - (head - tail);
+
+  if (count == 0)
+    return 0;
+
+  offset = head & (ring->size - 1);
+  chunk = SU_MIN(count, ring->size - offset);
+
+  memcpy(
+      ring->buffer + offset * ring->elem_size,
+      bytes,
+      chunk * ring->elem_size);
+  memcpy(
+      ring->buffer,
+      bytes + chunk * ring->elem_size,
+      (count - chunk) * ring->elem_size);
+
+  __atomic_store_n(&ring->head, head + count, __ATOMIC_SEQ_CST);
+
+  suscan_ring_wake_consumer(ring);
+
+  return count;
+}
+
+void
+suscan_ring_close(struct suscan_ring *ring)
+{
+  __atomic_store_n(&ring->closed, SU_TRUE, __ATOMIC_SEQ_CST);
+
+  suscan_ring_wake_consumer(ring);
+}
+
+size_t
+suscan_ring_get_avail(const struct suscan_ring *ring)
+{
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+}
+
+size_t
+suscan_ring_read(
+    struct suscan_ring *ring,
+    void *data,
+    size_t count,
+    unsigned int timeout_ms)
+{
+  uint8_t *bytes = (uint8_t *) data;
+  struct timespec deadline;
+  size_t avail;
+  size_t offset, chunk;
+
+  avail = suscan_ring_get_avail(ring);
+
+  if (avail == 0 && timeout_ms > 0) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      ++deadline.tv_sec;
+    }
+
+    pthread_mutex_lock(&ring->mutex);
+    __atomic_store_n(&ring->waiting, SU_TRUE, __ATOMIC_SEQ_CST);
+
+    while ((avail = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST)
+        - ring->tail) == 0
+        && !__atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST))
+      if (pthread_cond_timedwait(&ring->cond, &ring->mutex, &deadline)
+          == ETIMEDOUT)
+        break;
+
+    __atomic_store_n(&ring->waiting, SU_FALSE, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&ring->mutex);
+  }
+
+  if (count > avail)
+    count = avail;
+
+  if (count == 0)
+    return 0;
+
+  offset = ring->tail & (ring->size - 1);
+  chunk = SU_MIN(count, ring->size - offset);
+
+  memcpy(
+      bytes,
+      ring->buffer + offset * ring->elem_size,
+      chunk * ring->elem_size);
+  memcpy(
+      bytes + chunk * ring->elem_size,
+      ring->buffer,
+      (count - chunk) * ring->elem_size);
+
+  __atomic_store_n(&ring->tail, ring->tail + count, __ATOMIC_RELEASE);
+
+  return count;
+}
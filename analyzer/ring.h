@@ -0,0 +1,84 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _RING_H
+#define _RING_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Single-producer, single-consumer ring of fixed-size elements. Neither
+ * side takes a lock in the fast path: the producer never blocks (writes
+ * are truncated when there is no room, and the caller decides what to do
+ * with the rest) and the mutex is only used to put the consumer to sleep
+ * when the ring is empty.
+ */
+struct suscan_ring {
+  uint8_t *buffer;
+  size_t   elem_size;
+  size_t   size;        /* In elements, power of two */
+
+  size_t   head;        /* Only written by the producer */
+  size_t   tail;        /* Only written by the consumer */
+  SUBOOL   closed;      /* No more data will be written */
+
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  SUBOOL   waiting;     /* Consumer is sleeping on cond */
+  SUBOOL   mutex_init;
+  SUBOOL   cond_init;
+};
+
+SUBOOL suscan_ring_init(
+    struct suscan_ring *ring,
+    size_t elem_size,
+    size_t count);
+
+void suscan_ring_finalize(struct suscan_ring *ring);
+
+/* Producer side. Returns the number of elements actually written */
+size_t suscan_ring_write(
+    struct suscan_ring *ring,
+    const void *data,
+    size_t count);
+
+void suscan_ring_close(struct suscan_ring *ring);
+
+/*
+ * Consumer side. Waits up to timeout_ms for data if the ring is empty.
+ * Returns 0 on timeout, or when the ring is closed and drained.
+ */
+size_t suscan_ring_read(
+    struct suscan_ring *ring,
+    void *data,
+    size_t count,
+    unsigned int timeout_ms);
+
+size_t suscan_ring_get_avail(const struct suscan_ring *ring);
+
+SUINLINE SUBOOL
+suscan_ring_is_closed(const struct suscan_ring *ring)
+{
+  return __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+}
+
+#endif /* _RING_H */
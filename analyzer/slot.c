@@ -0,0 +1,90 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "slot"
+
+#include "slot.h"
+
+SUBOOL
+suscan_param_slot_init(
+    struct suscan_param_slot *slot,
+    size_t size,
+    const void *initial)
+{
+  memset(slot, 0, sizeof(struct suscan_param_slot));
+
+  SU_TRYCATCH(slot->data = malloc(size), goto fail);
+  slot->size = size;
+
+  memcpy(slot->data, initial, size);
+
+  SU_TRYCATCH(pthread_mutex_init(&slot->mutex, NULL) == 0, goto fail);
+  slot->mutex_init = SU_TRUE;
+
+  return SU_TRUE;
+
+fail:
+  suscan_param_slot_finalize(slot);
+
+  return SU_FALSE;
+}
+
+void
+suscan_param_slot_finalize(struct suscan_param_slot *slot)
+{
+  if (slot->mutex_init)
+    pthread_mutex_destroy(&slot->mutex);
+
+  if (slot->data != NULL)
+    free(slot->data);
+
+  memset(slot, 0, sizeof(struct suscan_param_slot));
+}
+
+void
+suscan_param_slot_publish(struct suscan_param_slot *slot, const void *data)
+{
+  pthread_mutex_lock(&slot->mutex);
+
+  memcpy(slot->data, data, slot->size);
+
+  /* Readers that see the new generation will wait for us in fetch */
+  __atomic_add_fetch(&slot->gen, 1, __ATOMIC_RELEASE);
+
+  pthread_mutex_unlock(&slot->mutex);
+}
+
+unsigned int
+suscan_param_slot_fetch(struct suscan_param_slot *slot, void *data)
+{
+  unsigned int gen;
+
+  pthread_mutex_lock(&slot->mutex);
+
+  memcpy(data, slot->data, slot->size);
+  gen = slot->gen;
+
+  pthread_mutex_unlock(&slot->mutex);
+
+  return gen;
+}
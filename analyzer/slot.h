@@ -0,0 +1,66 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SLOT_H
+#define _SLOT_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Generation-counted parameter slot. Writers publish a new copy under
+ * the mutex and bump the generation. Readers keep the generation of
+ * their own copy: checking for changes is a single atomic load, and the
+ * mutex is only taken to fetch a new copy.
+ */
+struct suscan_param_slot {
+  pthread_mutex_t mutex;
+  unsigned int gen;   /* Bumped by every publish */
+  size_t size;
+  void  *data;
+  SUBOOL mutex_init;
+};
+
+SUBOOL suscan_param_slot_init(
+    struct suscan_param_slot *slot,
+    size_t size,
+    const void *initial);
+
+void suscan_param_slot_finalize(struct suscan_param_slot *slot);
+
+void suscan_param_slot_publish(
+    struct suscan_param_slot *slot,
+    const void *data);
+
+/* Copies the current contents, and returns their generation */
+unsigned int suscan_param_slot_fetch(
+    struct suscan_param_slot *slot,
+    void *data);
+
+SUINLINE SUBOOL
+suscan_param_slot_changed(
+    const struct suscan_param_slot *slot,
+    unsigned int gen)
+{
+  return __atomic_load_n(&slot->gen, __ATOMIC_ACQUIRE) != gen;
+}
+
+#endif /* _SLOT_H */
@@ -31,6 +31,7 @@
 #include "sources/bladerf.h"
 #include "sources/hack_rf.h"
 #include "sources/alsa.h"
+#include "sources/rawfile.h"
 
 /* Will never be freed */
 PTR_LIST(struct suscan_source, source);
@@ -669,6 +670,10 @@ suscan_init_sources(void)
 
   SU_TRYCATCH(suscan_iqfile_source_init(), return SU_FALSE);
 
+  SU_TRYCATCH(suscan_capture_source_init(), return SU_FALSE);
+
+  SU_TRYCATCH(suscan_rawfile_source_init(), return SU_FALSE);
+
   SU_TRYCATCH(suscan_bladeRF_source_init(), return SU_FALSE);
 
   SU_TRYCATCH(suscan_hackRF_source_init(), return SU_FALSE);
@@ -18,10 +18,29 @@
 
 */
 
+#include <string.h>
+#include <errno.h>
+
+#define SU_LOG_DOMAIN "alsa-source"
+
 #include <config.h>
 #include "source.h"
 
-#include "alsa.h"
+#include <sources/alsa.h>
+#include <sources/iqconv.h>
+
+/*
+ * Formats we can convert, preferred first. Sound cards exposing 24 bit
+ * converters usually offer S32_LE, which keeps the extra resolution.
+ */
+SUPRIVATE const struct {
+  snd_pcm_format_t format;
+  size_t size;
+} alsa_formats[] = {
+    {SND_PCM_FORMAT_FLOAT_LE, sizeof(float)},
+    {SND_PCM_FORMAT_S32_LE,   sizeof(int32_t)},
+    {SND_PCM_FORMAT_S16_LE,   sizeof(int16_t)}
+};
 
 void
 alsa_state_destroy(struct alsa_state *state)
@@ -29,6 +48,9 @@ alsa_state_destroy(struct alsa_state *state)
   if (state->handle != NULL)
     snd_pcm_close(state->handle);
 
+  if (state->buffer != NULL)
+    free(state->buffer);
+
   free(state);
 }
 
@@ -38,8 +60,8 @@ alsa_state_new(const struct alsa_params *params)
   struct alsa_state *new = NULL;
   snd_pcm_hw_params_t *hw_params = NULL;
   int err = 0;
-  int dir;
   unsigned int rate;
+  unsigned int i;
   SUBOOL ok = SU_FALSE;
 
   SU_TRYCATCH(new = calloc(1, sizeof(struct alsa_state)), goto done);
@@ -63,18 +85,41 @@ alsa_state_new(const struct alsa_params *params)
       (err = snd_pcm_hw_params_any(new->handle, hw_params)) >= 0,
       goto done);
 
+  /* Memory mapped access lets us skip the intermediate buffer */
+  new->mmap = snd_pcm_hw_params_test_access(
+      new->handle,
+      hw_params,
+      SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+
   SU_TRYCATCH(
       (err = snd_pcm_hw_params_set_access(
           new->handle,
           hw_params,
-          SND_PCM_ACCESS_RW_INTERLEAVED)) >= 0,
+          new->mmap
+          ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+          : SND_PCM_ACCESS_RW_INTERLEAVED)) >= 0,
       goto done);
 
+  for (i = 0; i < sizeof(alsa_formats) / sizeof(alsa_formats[0]); ++i)
+    if (snd_pcm_hw_params_test_format(
+        new->handle,
+        hw_params,
+        alsa_formats[i].format) == 0)
+      break;
+
+  if (i == sizeof(alsa_formats) / sizeof(alsa_formats[0])) {
+    SU_ERROR("Capture device supports none of our sample formats\n");
+    goto done;
+  }
+
+  new->format = alsa_formats[i].format;
+  new->sample_size = alsa_formats[i].size;
+
   SU_TRYCATCH(
       (err = snd_pcm_hw_params_set_format(
           new->handle,
           hw_params,
-          SND_PCM_FORMAT_S16_LE)) >= 0,
+          new->format)) >= 0,
       goto done);
 
   rate = params->samp_rate;
@@ -105,6 +150,16 @@ alsa_state_new(const struct alsa_params *params)
       (err = snd_pcm_prepare(new->handle)) >= 0,
       goto done);
 
+  if (!new->mmap)
+    SU_TRYCATCH(
+        new->buffer = malloc(ALSA_BUFFER_FRAMES * new->sample_size),
+        goto done);
+
+  SU_INFO(
+      "ALSA capture: %s, %s access\n",
+      snd_pcm_format_name(new->format),
+      new->mmap ? "mmap" : "read/write");
+
   ok = SU_TRUE;
 
 done:
@@ -122,6 +177,116 @@ done:
   return new;
 }
 
+SUPRIVATE void
+alsa_state_convert(
+    struct alsa_state *state,
+    SUCOMPLEX *out,
+    const void *in,
+    SUSCOUNT count)
+{
+  SUFLOAT *last = state->dc_remove ? &state->last : NULL;
+
+  switch (state->format) {
+    case SND_PCM_FORMAT_FLOAT_LE:
+      suscan_iqconv_real_f32(out, in, count, last);
+      break;
+
+    case SND_PCM_FORMAT_S32_LE:
+      suscan_iqconv_real_s32(out, in, count, last);
+      break;
+
+    default:
+      suscan_iqconv_real_s16(out, in, count, last);
+  }
+}
+
+/* Overruns are not fatal: samples are lost, but capture goes on */
+SUPRIVATE SUBOOL
+alsa_state_recover(struct alsa_state *state, int err)
+{
+  SU_WARNING("ALSA capture error: %s, recovering\n", snd_strerror(err));
+
+  if ((err = snd_pcm_recover(state->handle, err, 1)) < 0) {
+    SU_ERROR("ALSA recovery failed: %s\n", snd_strerror(err));
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+/* Returns frames read, 0 on timeout or -1 on unrecoverable errors */
+SUPRIVATE snd_pcm_sframes_t
+alsa_state_read_mmap(struct alsa_state *state, SUCOMPLEX *out, SUSCOUNT size)
+{
+  const snd_pcm_channel_area_t *areas;
+  snd_pcm_uframes_t offset, frames;
+  snd_pcm_sframes_t avail, committed;
+  int err;
+
+  for (;;) {
+    /* Capture does not start by itself in mmap mode */
+    if (snd_pcm_state(state->handle) == SND_PCM_STATE_PREPARED)
+      if ((err = snd_pcm_start(state->handle)) < 0)
+        return alsa_state_recover(state, err) ? 0 : -1;
+
+    if ((avail = snd_pcm_avail_update(state->handle)) < 0) {
+      if (!alsa_state_recover(state, avail))
+        return -1;
+      continue;
+    }
+
+    if (avail > 0)
+      break;
+
+    if ((err = snd_pcm_wait(state->handle, ALSA_WAIT_TIMEOUT_MS)) == 0)
+      return 0;
+    else if (err < 0 && !alsa_state_recover(state, err))
+      return -1;
+  }
+
+  frames = SU_MIN(size, (snd_pcm_uframes_t) avail);
+
+  if ((err = snd_pcm_mmap_begin(
+      state->handle,
+      &areas,
+      &offset,
+      &frames)) < 0)
+    return alsa_state_recover(state, err) ? 0 : -1;
+
+  /* Single channel, interleaved: samples are contiguous */
+  alsa_state_convert(
+      state,
+      out,
+      (const uint8_t *) areas[0].addr
+      + (areas[0].first + offset * areas[0].step) / 8,
+      frames);
+
+  committed = snd_pcm_mmap_commit(state->handle, offset, frames);
+  if (committed < 0 || (snd_pcm_uframes_t) committed != frames)
+    if (!alsa_state_recover(state, committed < 0 ? committed : -EPIPE))
+      return -1;
+
+  return frames;
+}
+
+SUPRIVATE snd_pcm_sframes_t
+alsa_state_read_rw(struct alsa_state *state, SUCOMPLEX *out, SUSCOUNT size)
+{
+  snd_pcm_sframes_t got;
+
+  got = snd_pcm_readi(
+      state->handle,
+      state->buffer,
+      SU_MIN(size, ALSA_BUFFER_FRAMES));
+
+  if (got < 0)
+    return alsa_state_recover(state, got) ? 0 : -1;
+
+  alsa_state_convert(state, out, state->buffer, got);
+
+  return got;
+}
+
 SUPRIVATE void
 su_block_alsa_dtor(void *private)
 {
@@ -182,46 +347,41 @@ su_block_alsa_acquire(
 {
   struct alsa_state *state = (struct alsa_state *) priv;
   SUSDIFF size;
-  SUCOMPLEX samp;
   SUCOMPLEX *start;
-  int i;
-  int got;
+  snd_pcm_sframes_t got;
+  unsigned int retries = 0;
 
   /* Get the number of complex samples to acquire */
   size = su_stream_get_contiguous(
       out,
       &start,
-      MIN(out->size, ALSA_INTEGER_BUFFER_SIZE));
-
-  got = snd_pcm_readi(state->handle, state->buffer, size);
-  if (got > 0) {
-    /*
-     * ALSA does not seem to allow to read FLOAT64_LE directly. We have
-     * to transform the integer samples manually
-     */
-
-    if (state->dc_remove) {
-      for (i = 0; i < got; ++i) {
-        samp = state->buffer[i] / 32768.0;
-        start[i] = samp - state->last;
-        state->last = samp;
-      }
-    } else {
-      for (i = 0; i < got; ++i)
-        start[i] = state->buffer[i] / 32768.0;
-    }
+      SU_MIN(out->size, ALSA_BUFFER_FRAMES));
+
+  /*
+   * Short reads and recovered overruns are retried, but a stalled device
+   * must not keep the source worker from seeing halt requests.
+   */
+  do {
+    got = state->mmap
+        ? alsa_state_read_mmap(state, start, size)
+        : alsa_state_read_rw(state, start, size);
+  } while (got == 0 && ++retries < ALSA_MAX_RETRIES);
+
+  if (got == 0) {
+    SU_ERROR("ALSA read timeout\n");
+    return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+  }
 
-    /* Increment position */
-    if (su_stream_advance_contiguous(out, got) != got) {
-      SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
-      return -1;
-    }
-  } else  {
-    SU_ERROR("ALSA read error: %s\n", snd_strerror(got));
+  if (got < 0)
     return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+
+  /* Increment position */
+  if (su_stream_advance_contiguous(out, got) != got) {
+    SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
+    return -1;
   }
 
-  return size;
+  return got;
 }
 
 SUPRIVATE struct sigutils_block_class su_block_class_ALSA = {
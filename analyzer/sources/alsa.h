@@ -31,7 +31,9 @@ struct alsa_params {
   SUBOOL dc_remove;
 };
 
-#define ALSA_INTEGER_BUFFER_SIZE 2048
+#define ALSA_BUFFER_FRAMES   2048 /* Largest read, in frames */
+#define ALSA_WAIT_TIMEOUT_MS 1000
+#define ALSA_MAX_RETRIES     5    /* Empty reads before giving up */
 
 #define alsa_params_INITIALIZER {"default", 44100, 0}
 
@@ -39,8 +41,13 @@ struct alsa_state {
   snd_pcm_t *handle;
   uint64_t samp_rate;
   uint64_t fc;
-  int16_t buffer[ALSA_INTEGER_BUFFER_SIZE];
-  SUCOMPLEX last;
+
+  snd_pcm_format_t format; /* Best of FLOAT_LE, S32_LE and S16_LE */
+  size_t sample_size;
+  SUBOOL mmap;             /* Convert straight from the DMA area */
+  void  *buffer;           /* Only for RW access, ALSA_BUFFER_FRAMES long */
+
+  SUFLOAT last;            /* Previous sample, for DC removal */
   SUBOOL dc_remove;
 };
 
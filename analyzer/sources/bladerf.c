@@ -26,10 +26,31 @@
 #include <string.h>
 
 #include "bladerf.h"
+#include "iqconv.h"
+
+SUPRIVATE void
+bladeRF_state_stop_async(struct bladeRF_state *state)
+{
+  if (state->stream_running) {
+    /* The callback returns BLADERF_STREAM_SHUTDOWN on the next transfer */
+    __atomic_store_n(&state->stream_halt, SU_TRUE, __ATOMIC_RELEASE);
+    pthread_join(state->stream_thread, NULL);
+    state->stream_running = SU_FALSE;
+  }
+
+  if (state->stream != NULL) {
+    bladerf_deinit_stream(state->stream);
+    state->stream = NULL;
+  }
+}
 
 SUPRIVATE void
 bladeRF_state_destroy(struct bladeRF_state *state)
 {
+  bladeRF_state_stop_async(state);
+
+  suscan_ring_finalize(&state->ring);
+
   if (state->dev != NULL)
     bladerf_close(state->dev);
 
@@ -62,6 +83,130 @@ bladeRF_state_init_sync(struct bladeRF_state *state)
   return SU_TRUE;
 }
 
+/*
+ * Runs in libbladeRF's stream thread. Never blocks: if the reader is
+ * lagging and the ring is full, the samples that don't fit are counted
+ * as lost.
+ */
+SUPRIVATE void *
+bladeRF_stream_cb(
+    struct bladerf *dev,
+    struct bladerf_stream *stream,
+    struct bladerf_metadata *meta,
+    void *samples,
+    size_t num_samples,
+    void *user_data)
+{
+  struct bladeRF_state *state = (struct bladeRF_state *) user_data;
+  size_t written;
+  void *next;
+
+  if (__atomic_load_n(&state->stream_halt, __ATOMIC_ACQUIRE))
+    return BLADERF_STREAM_SHUTDOWN;
+
+  if (samples != NULL) {
+    written = suscan_ring_write(&state->ring, samples, num_samples);
+    if (written < num_samples)
+      __atomic_add_fetch(
+          &state->samples_lost,
+          num_samples - written,
+          __ATOMIC_RELAXED);
+  }
+
+  next = state->stream_buffers[state->stream_next];
+  state->stream_next = (state->stream_next + 1) % state->params.buffers;
+
+  return next;
+}
+
+SUPRIVATE void *
+bladeRF_stream_thread(void *data)
+{
+  struct bladeRF_state *state = (struct bladeRF_state *) data;
+  int status;
+
+  status = bladerf_stream(state->stream, BLADERF_MODULE_RX);
+  if (status != 0)
+    SU_ERROR("bladeRF stream error: %s\n", bladerf_strerror(status));
+
+  /* Let the reader know no more samples will arrive */
+  suscan_ring_close(&state->ring);
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+bladeRF_state_init_async(struct bladeRF_state *state)
+{
+  int status;
+
+  if (state->params.transfers == 0)
+    state->params.transfers = 1;
+
+  if (state->params.buffers <= state->params.transfers) {
+    SU_WARNING(
+        "Need more buffers than transfers, using %d buffers\n",
+        state->params.transfers + 1);
+    state->params.buffers = state->params.transfers + 1;
+  }
+
+  status = bladerf_init_stream(
+      &state->stream,
+      state->dev,
+      bladeRF_stream_cb,
+      &state->stream_buffers,
+      state->params.buffers,
+      BLADERF_FORMAT_SC16_Q11,
+      state->params.bufsiz,
+      state->params.transfers,
+      state);
+  if (status != 0) {
+    SU_ERROR(
+        "Failed to configure RX async interface: %s\n",
+        bladerf_strerror(status));
+    return SU_FALSE;
+  }
+
+  status = bladerf_set_stream_timeout(
+      state->dev,
+      BLADERF_MODULE_RX,
+      3500);
+  if (status != 0) {
+    SU_ERROR(
+        "Failed to set RX stream timeout: %s\n",
+        bladerf_strerror(status));
+    return SU_FALSE;
+  }
+
+  /* One element per sample, with both components */
+  SU_TRYCATCH(
+      suscan_ring_init(
+          &state->ring,
+          2 * sizeof(int16_t),
+          BLADERF_ASYNC_RING_BUFFERS
+          * state->params.buffers
+          * state->params.bufsiz),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+bladeRF_state_start_async(struct bladeRF_state *state)
+{
+  SU_TRYCATCH(
+      pthread_create(
+          &state->stream_thread,
+          NULL,
+          bladeRF_stream_thread,
+          state) == 0,
+      return SU_FALSE);
+
+  state->stream_running = SU_TRUE;
+
+  return SU_TRUE;
+}
+
 SUPRIVATE struct bladeRF_state *
 bladeRF_state_new(const struct bladeRF_params *params)
 {
@@ -79,8 +224,13 @@ bladeRF_state_new(const struct bladeRF_params *params)
 
   new->params = *params;
 
+  /* Async stream buffers must be a multiple of 1024 samples */
+  if (params->async)
+    new->params.bufsiz = (params->bufsiz + 1023) & ~1023;
+
   /* 1 sample: 2 components (I & Q) */
-  if ((new->buffer = malloc(sizeof(uint16_t) * params->bufsiz * 2)) == NULL)
+  if ((new->buffer = malloc(
+      sizeof(uint16_t) * new->params.bufsiz * 2)) == NULL)
     goto fail;
 
   bladerf_init_devinfo(&dev_info);
@@ -192,8 +342,13 @@ bladeRF_state_new(const struct bladeRF_params *params)
     goto fail;
   }
 
-  /* Configure sync RX */
-  if (!bladeRF_state_init_sync(new)) {
+  /* Configure RX interface */
+  if (params->async) {
+    if (!bladeRF_state_init_async(new)) {
+      SU_ERROR("Failed to init bladeRF in async mode\n");
+      goto fail;
+    }
+  } else if (!bladeRF_state_init_sync(new)) {
     SU_ERROR("Failed to init bladeRF in sync mode\n");
     goto fail;
   }
@@ -205,6 +360,11 @@ bladeRF_state_new(const struct bladeRF_params *params)
     goto fail;
   }
 
+  if (params->async && !bladeRF_state_start_async(new)) {
+    SU_ERROR("Failed to start bladeRF stream thread\n");
+    goto fail;
+  }
+
   new->samp_rate = actual_samp_rate;
   new->fc = actual_fc;
 
@@ -257,6 +417,26 @@ su_block_bladeRF_ctor(struct sigutils_block *block, void **private, va_list ap)
     goto fail;
   }
 
+  /* Written by the analyzer in sweep mode */
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc_request",
+      &state->fc_request)) {
+    SU_ERROR("Expose fc_request failed\n");
+    goto fail;
+  }
+
+  /* Polled by the analyzer to report overruns */
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samples_lost",
+      &state->samples_lost)) {
+    SU_ERROR("Expose samples_lost failed\n");
+    goto fail;
+  }
+
   *private = state;
 
   return SU_TRUE;
@@ -268,9 +448,75 @@ fail:
   return SU_FALSE;
 }
 
-#ifdef BLADERF_SAVE_SAMPLES
-FILE *fp;
-#endif /* BLADERF_SAVE_SAMPLES */
+/*
+ * Pending retune request. In async mode, whatever the ring holds was
+ * received at the old frequency, so it goes away with it.
+ */
+SUPRIVATE SUBOOL
+bladeRF_state_retune(struct bladeRF_state *state)
+{
+  uint64_t fc = __atomic_load_n(&state->fc_request, __ATOMIC_ACQUIRE);
+  int status;
+
+  if (fc == 0 || fc == state->fc)
+    return SU_TRUE;
+
+  status = bladerf_set_frequency(state->dev, BLADERF_MODULE_RX, fc);
+  if (status != 0) {
+    SU_ERROR("Failed to retune bladeRF: %s\n", bladerf_strerror(status));
+    return SU_FALSE;
+  }
+
+  state->fc = fc;
+
+  if (state->params.async)
+    while (suscan_ring_read(
+        &state->ring,
+        state->buffer,
+        state->params.bufsiz,
+        0))
+      ;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUSDIFF
+su_block_bladeRF_acquire_async(
+    struct bladeRF_state *state,
+    su_stream_t *out)
+{
+  SUSDIFF size;
+  SUCOMPLEX *start;
+
+  size = su_stream_get_contiguous(
+      out,
+      &start,
+      SU_MIN(state->params.bufsiz, out->size));
+
+  size = suscan_ring_read(
+      &state->ring,
+      state->buffer,
+      size,
+      BLADERF_ASYNC_READ_TIMEOUT_MS);
+
+  if (size == 0) {
+    if (suscan_ring_is_closed(&state->ring))
+      SU_ERROR("bladeRF stream stopped\n");
+    else
+      SU_ERROR("bladeRF async read timeout\n");
+
+    return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+  }
+
+  suscan_iqconv_s16(start, state->buffer, size, 1. / 2048.);
+
+  if (su_stream_advance_contiguous(out, size) != size) {
+    SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
+    return -1;
+  }
+
+  return size;
+}
 
 SUPRIVATE SUSDIFF
 su_block_bladeRF_acquire(
@@ -281,16 +527,15 @@ su_block_bladeRF_acquire(
 {
   struct bladeRF_state *state = (struct bladeRF_state *) priv;
   SUSDIFF size;
-  unsigned int i;
   SUCOMPLEX *start;
   SUCOMPLEX samp;
   int status;
-#ifdef BLADERF_SAVE_SAMPLES
-  complex float iq;
 
-  if (fp == NULL)
-    fp = fopen("output.raw", "wb");
-#endif /* BLADERF_SAVE_SAMPLES */
+  if (!bladeRF_state_retune(state))
+    return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+
+  if (state->params.async)
+    return su_block_bladeRF_acquire_async(state, out);
 
   /* Get the number of complex samples to acquire */
   size = su_stream_get_contiguous(
@@ -306,15 +551,7 @@ su_block_bladeRF_acquire(
       5000);
   if (status == 0) {
     /* Read OK. Transform samples */
-      for (i = 0; i < size; ++i) {
-        start[i] =
-            state->buffer[i << 1] / 2048.0
-            + I * state->buffer[(i << 1) + 1] / 2048.0;
-#ifdef BLADERF_SAVE_SAMPLES
-        iq = start[i];
-        fwrite(&iq, 1, sizeof(complex float), fp);
-#endif /* BLADERF_SAVE_SAMPLES */
-      }
+      suscan_iqconv_s16(start, state->buffer, size, 1. / 2048.);
 
       /* Increment position */
       if (su_stream_advance_contiguous(out, size) != size) {
@@ -385,6 +622,21 @@ suscan_bladeRF_source_ctor(const struct suscan_source_config *config)
   if (value->set)
     params.lnagain = value->as_int;
 
+  if ((value = suscan_source_config_get_value(config, "async")) == NULL)
+    return NULL;
+  if (value->set)
+    params.async = value->as_bool;
+
+  if ((value = suscan_source_config_get_value(config, "transfers")) == NULL)
+    return NULL;
+  if (value->set)
+    params.transfers = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "buffers")) == NULL)
+    return NULL;
+  if (value->set)
+    params.buffers = value->as_int;
+
   return su_block_new("bladeRF", &params);
 }
 
@@ -468,6 +720,29 @@ suscan_bladeRF_source_init(void)
       "LNA gain"))
     return SU_FALSE;
 
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_BOOLEAN,
+      SU_TRUE,
+      "async",
+      "Asynchronous streaming"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "transfers",
+      "USB transfers in flight"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "buffers",
+      "Stream buffers"))
+    return SU_FALSE;
 
   return SU_TRUE;
 }
@@ -28,6 +28,12 @@
 # ifdef HAVE_BLADERF
 
 #include <libbladeRF.h>
+#include <pthread.h>
+
+#include "ring.h"
+
+#define BLADERF_ASYNC_READ_TIMEOUT_MS 5000
+#define BLADERF_ASYNC_RING_BUFFERS    4 /* Ring size, in stream buffers */
 
 struct bladeRF_params {
   const char *serial;
@@ -38,6 +44,9 @@ struct bladeRF_params {
   SUBOOL lna; /* Enable XB 300 LNA */
   int    lnagain; /* XB 300 gain */
   SUSCOUNT bufsiz; /* Buffer size */
+  SUBOOL   async; /* Use the asynchronous stream API */
+  unsigned int transfers; /* In-flight USB transfers (async only) */
+  unsigned int buffers;   /* Stream buffers (async only) */
 };
 
 #define sigutils_bladeRF_params_INITIALIZER     \
@@ -50,6 +59,9 @@ struct bladeRF_params {
   SU_TRUE, /* lna */                            \
   BLADERF_LNA_GAIN_MAX, /* lnagain */           \
   4096, /* bufsiz */                            \
+  SU_TRUE, /* async */                          \
+  8, /* transfers */                            \
+  16, /* buffers */                             \
 }
 
 struct bladeRF_state {
@@ -57,7 +69,22 @@ struct bladeRF_state {
   struct bladerf *dev;
   uint64_t samp_rate; /* Actual sample rate */
   uint64_t fc; /* Actual frequency */
+  uint64_t fc_request; /* Set by sweeps, applied by the reading thread */
   int16_t *buffer; /* Must be SIGNED! */
+
+  /*
+   * Asynchronous streaming: a dedicated thread runs bladerf_stream, whose
+   * callback copies each transfer to the ring. Conversion takes place in
+   * the reading thread.
+   */
+  struct bladerf_stream *stream;
+  void   **stream_buffers;
+  unsigned int stream_next;     /* Next buffer to hand to libbladeRF */
+  pthread_t stream_thread;
+  SUBOOL   stream_running;      /* Stream thread was started */
+  SUBOOL   stream_halt;         /* Asks the callback to shut down */
+  struct suscan_ring ring;      /* Of SC16 Q11 samples */
+  uint64_t samples_lost;        /* Ring was full, exposed as property */
 };
 
 
@@ -24,6 +24,7 @@
 #include <ctype.h>
 
 #include "source.h"
+#include "arena.h"
 #include "xsig.h"
 
 #define XSIG_SNDFILE_READ sf_read_double
@@ -48,9 +49,11 @@ xsig_source_params_copy(
     goto fail;
 
   dest->window_size = orig->window_size;
+  dest->prefetch = orig->prefetch;
   dest->onacquire = orig->onacquire;
   dest->private = orig->private;
   dest->loop = orig->loop;
+  dest->start = orig->start;
 
   return SU_TRUE;
 
@@ -60,20 +63,220 @@ fail:
   return SU_FALSE;
 }
 
+/*
+ * Lands on the last keyframe before time, where the spectral average
+ * stored in the index starts over. Captures without keyframes are
+ * positioned at the exact sample.
+ */
+SUPRIVATE void
+xsig_source_seek_capture(struct xsig_source *source, uint64_t time)
+{
+  const struct suscan_capture_keyframe *kf;
+  uint64_t sample;
+
+  sample = suscan_capture_time_to_sample(source->capture, time);
+
+  if ((kf = suscan_capture_find_keyframe(source->capture, sample)) != NULL)
+    sample = kf->sample;
+
+  (void) suscan_capture_seek(source->capture, sample);
+}
+
+/*
+ * Seek requests are taken by whoever decodes. With prefetch, windows
+ * already decoded are still delivered before the new position.
+ */
+SUPRIVATE SUSCOUNT
+xsig_source_read_capture(struct xsig_source *source, SUCOMPLEX *window)
+{
+  uint64_t time;
+  SUSDIFF got;
+
+  if ((time = __atomic_exchange_n(&source->seek_request, 0, __ATOMIC_ACQ_REL))
+      != 0)
+    xsig_source_seek_capture(source, time);
+
+  got = suscan_capture_read(
+      source->capture,
+      window,
+      source->params.window_size);
+
+  if (got == 0 && source->params.loop) {
+    suscan_capture_seek(source->capture, 0);
+    got = suscan_capture_read(
+        source->capture,
+        window,
+        source->params.window_size);
+  }
+
+  return got > 0 ? got : 0;
+}
+
+/* Reads one window, looping if needed. Returns 0 when done */
+SUPRIVATE SUSCOUNT
+xsig_source_read_window(struct xsig_source *source, SUCOMPLEX *window)
+{
+  SUFLOAT *as_real = (SUFLOAT *) window;
+  unsigned int real_count;
+  int got;
+  int i;
+
+  if (source->capture != NULL)
+    return xsig_source_read_capture(source, window);
+
+  real_count = source->params.window_size * source->info.channels;
+
+  do {
+    got = XSIG_SNDFILE_READ(source->sf, as_real, real_count);
+
+    if (got <= 0) {
+      if (!source->params.loop)
+        return 0; /* End of file reached and looping disabled, stop */
+      else if (sf_seek(source->sf, 0, SEEK_SET) == -1)
+        return 0; /* Seek failed, return */
+    }
+  } while (got <= 0);
+
+  /*
+   * One channel only: convert everything to complex. Conversion
+   * can be performed in-place
+   */
+  if (source->info.channels == 1)
+    for (i = got - 1; i >= 0; --i)
+      window[i] = as_real[i];
+
+  return got / source->info.channels;
+}
+
+SUPRIVATE void *
+xsig_source_prefetch_thread(void *data)
+{
+  struct xsig_source *source = (struct xsig_source *) data;
+  unsigned int slot;
+  SUSCOUNT got;
+
+  pthread_mutex_lock(&source->mutex);
+
+  for (;;) {
+    while (!source->halt && source->queued == source->window_count)
+      pthread_cond_wait(&source->cond, &source->mutex);
+
+    if (source->halt)
+      break;
+
+    /* Free slots are never touched by the reader */
+    slot = (source->head + source->queued) % source->window_count;
+    pthread_mutex_unlock(&source->mutex);
+
+    got = xsig_source_read_window(source, source->window_list[slot]);
+
+    pthread_mutex_lock(&source->mutex);
+
+    if (got == 0) {
+      source->eof = SU_TRUE;
+      pthread_cond_broadcast(&source->cond);
+      break;
+    }
+
+    source->window_avail[slot] = got;
+    ++source->queued;
+    pthread_cond_broadcast(&source->cond);
+  }
+
+  pthread_mutex_unlock(&source->mutex);
+
+  return NULL;
+}
+
 void
 xsig_source_destroy(struct xsig_source *source)
 {
+  unsigned int i;
+
+  if (source->thread_running) {
+    pthread_mutex_lock(&source->mutex);
+    source->halt = SU_TRUE;
+    pthread_cond_broadcast(&source->cond);
+    pthread_mutex_unlock(&source->mutex);
+
+    pthread_join(source->thread, NULL);
+  }
+
+  if (source->sync_init) {
+    pthread_cond_destroy(&source->cond);
+    pthread_mutex_destroy(&source->mutex);
+  }
+
   xsig_source_params_finalize(&source->params);
 
   if (source->sf != NULL)
     sf_close(source->sf);
 
-  if (source->as_complex != NULL)
-    free(source->as_complex);
+  if (source->capture != NULL)
+    suscan_capture_close(source->capture);
+
+  if (source->window_list != NULL) {
+    for (i = 0; i < source->window_count; ++i)
+      if (source->window_list[i] != NULL)
+        free(source->window_list[i]);
+
+    free(source->window_list);
+  }
+
+  if (source->window_avail != NULL)
+    free(source->window_avail);
 
   free(source);
 }
 
+SUPRIVATE SUBOOL
+xsig_source_init_windows(struct xsig_source *source)
+{
+  unsigned int i;
+
+  source->window_count = source->params.prefetch + 1;
+
+  SU_TRYCATCH(
+      source->window_list = calloc(source->window_count, sizeof(SUCOMPLEX *)),
+      return SU_FALSE);
+  SU_TRYCATCH(
+      source->window_avail = calloc(source->window_count, sizeof(SUSCOUNT)),
+      return SU_FALSE);
+
+  /* Windows are decoded in place, keep them SIMD-friendly */
+  for (i = 0; i < source->window_count; ++i)
+    SU_TRYCATCH(
+        posix_memalign(
+            (void **) &source->window_list[i],
+            SUSCAN_ARENA_ALIGNMENT,
+            suscan_arena_align(
+                source->params.window_size * sizeof(SUCOMPLEX))) == 0,
+        return SU_FALSE);
+
+  source->as_complex = source->window_list[0];
+
+  if (source->params.prefetch == 0)
+    return SU_TRUE;
+
+  SU_TRYCATCH(pthread_mutex_init(&source->mutex, NULL) == 0, return SU_FALSE);
+  if (pthread_cond_init(&source->cond, NULL) != 0) {
+    pthread_mutex_destroy(&source->mutex);
+    return SU_FALSE;
+  }
+  source->sync_init = SU_TRUE;
+
+  SU_TRYCATCH(
+      pthread_create(
+          &source->thread,
+          NULL,
+          xsig_source_prefetch_thread,
+          source) == 0,
+      return SU_FALSE);
+  source->thread_running = SU_TRUE;
+
+  return SU_TRUE;
+}
+
 struct xsig_source *
 xsig_source_new(const struct xsig_source_params *params)
 {
@@ -93,21 +296,34 @@ xsig_source_new(const struct xsig_source_params *params)
     goto fail;
   }
 
-  if ((new->sf = sf_open(params->file, SFM_READ, &new->info)) == NULL) {
-    SU_ERROR(
-        "failed to open `%s': error %s\n",
-        params->file,
-        sf_strerror(NULL));
-    goto fail;
-  }
+  if (params->capture) {
+    if ((new->capture = suscan_capture_open(params->file)) == NULL)
+      goto fail;
+
+    new->info.channels = 2;
+    new->samp_rate = new->capture->info.samp_rate;
+    new->fc = new->capture->info.fc;
+
+    if (params->start > 0)
+      xsig_source_seek_capture(
+          new,
+          new->capture->info.start_time + params->start * 1e9);
+  } else {
+    if ((new->sf = sf_open(params->file, SFM_READ, &new->info)) == NULL) {
+      SU_ERROR(
+          "failed to open `%s': error %s\n",
+          params->file,
+          sf_strerror(NULL));
+      goto fail;
+    }
 
-  /* These are used to expose block properties */
-  new->samp_rate = new->info.samplerate;
-  new->fc = params->fc;
+    /* These are used to expose block properties */
+    new->samp_rate = new->info.samplerate;
+    new->fc = params->fc;
+  }
 
-  if ((new->as_complex = malloc(params->window_size * sizeof(SUCOMPLEX)))
-      == NULL) {
-    SU_ERROR("cannot allocate memory for read window\n");
+  if (!xsig_source_init_windows(new)) {
+    SU_ERROR("cannot allocate read windows\n");
     goto fail;
   }
 
@@ -128,36 +344,49 @@ xsig_source_complete_acquire(struct xsig_source *source)
     (source->params.onacquire)(source, source->params.private);
 }
 
-SUBOOL
-xsig_source_acquire(struct xsig_source *source)
+/* Hands the current window back to the decoder, and waits for the next */
+SUPRIVATE SUBOOL
+xsig_source_acquire_prefetched(struct xsig_source *source)
 {
-  unsigned int size;
-  unsigned int real_count;
-  int got;
-  int i;
+  SUBOOL ok = SU_FALSE;
 
-  real_count = source->params.window_size * source->info.channels;
+  pthread_mutex_lock(&source->mutex);
 
-  do {
-    got = XSIG_SNDFILE_READ(source->sf, source->as_real, real_count);
+  if (source->held) {
+    source->head = (source->head + 1) % source->window_count;
+    --source->queued;
+    source->held = SU_FALSE;
+    pthread_cond_broadcast(&source->cond);
+  }
 
-    if (got == 0) {
-      if (!source->params.loop)
-        return SU_FALSE; /* End of file reached and looping disabled, stop */
-      else if (sf_seek(source->sf, 0, SEEK_SET) == -1)
-        return SU_FALSE; /* Seek failed, return */
-    }
-  } while (got == 0);
+  while (source->queued == 0 && !source->eof)
+    pthread_cond_wait(&source->cond, &source->mutex);
 
-  /*
-   * One channel only: convert everything to complex. Conversion
-   * can be performed in-place
-   */
-  if (source->info.channels == 1)
-    for (i = got - 1; i >= 0; --i)
-      source->as_complex[i] = source->as_real[i];
+  if (source->queued > 0) {
+    source->as_complex = source->window_list[source->head];
+    source->size = source->window_avail[source->head];
+    source->held = SU_TRUE;
+    ok = SU_TRUE;
+  }
+
+  pthread_mutex_unlock(&source->mutex);
+
+  return ok;
+}
+
+SUBOOL
+xsig_source_acquire(struct xsig_source *source)
+{
+  if (source->thread_running) {
+    if (!xsig_source_acquire_prefetched(source))
+      return SU_FALSE;
+  } else if ((source->size = xsig_source_read_window(
+      source,
+      source->as_complex)) == 0) {
+    return SU_FALSE;
+  }
 
-  source->avail = got / source->info.channels;
+  source->avail = source->size;
 
   xsig_source_complete_acquire(source);
 
@@ -193,6 +422,21 @@ xsig_source_block_ctor(struct sigutils_block *block, void **private, va_list ap)
       "fc",
       &source->fc);
 
+  /* Captures expose their index, and accept seeks by wall clock time */
+  if (source->capture != NULL) {
+    ok = ok && su_block_set_property_ref(
+        block,
+        SU_PROPERTY_TYPE_OBJECT,
+        "capture",
+        &source->capture);
+
+    ok = ok && su_block_set_property_ref(
+        block,
+        SU_PROPERTY_TYPE_INTEGER,
+        "seek_request",
+        &source->seek_request);
+  }
+
 done:
   if (!ok) {
     if (source != NULL)
@@ -235,7 +479,7 @@ xsig_source_block_acquire(
   if (size > source->avail)
     size = source->avail;
 
-  ptr = source->params.window_size - source->avail;
+  ptr = source->size - source->avail;
 
   memcpy(start, source->as_complex + ptr, size * sizeof (SUCOMPLEX));
 
@@ -319,11 +563,19 @@ suscan_wav_source_ctor(const struct suscan_source_config *config)
     return NULL;
   params.loop = value->as_bool; /* defaults to false */
 
+  if ((value = suscan_source_config_get_value(config, "prefetch")) == NULL)
+    return NULL;
+  params.prefetch = value->as_int > 0
+      ? value->as_int
+      : XSIG_SOURCE_DEFAULT_PREFETCH;
+
   params.onacquire = NULL;
   params.private = NULL;
   params.window_size = 512;
   params.onacquire = NULL;
   params.raw_iq = SU_FALSE;
+  params.capture = SU_FALSE;
+  params.start = 0;
 
   return xsig_source_create_block(&params);
 }
@@ -365,6 +617,14 @@ suscan_wav_source_init(void)
       "Loop"))
     return SU_FALSE;
 
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "prefetch",
+      "Read-ahead windows (0: default)"))
+    return SU_FALSE;
+
   return SU_TRUE;
 }
 
@@ -390,11 +650,19 @@ suscan_iqfile_source_ctor(const struct suscan_source_config *config)
     return NULL;
   params.loop = value->as_bool; /* defaults to false */
 
+  if ((value = suscan_source_config_get_value(config, "prefetch")) == NULL)
+    return NULL;
+  params.prefetch = value->as_int > 0
+      ? value->as_int
+      : XSIG_SOURCE_DEFAULT_PREFETCH;
+
   params.onacquire = NULL;
   params.private = NULL;
   params.window_size = 512;
   params.onacquire = NULL;
   params.raw_iq = SU_TRUE;
+  params.capture = SU_FALSE;
+  params.start = 0;
 
   return xsig_source_create_block(&params);
 }
@@ -442,6 +710,95 @@ suscan_iqfile_source_init(void)
       "Loop"))
     return SU_FALSE;
 
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "prefetch",
+      "Read-ahead windows (0: default)"))
+    return SU_FALSE;
+
   return SU_TRUE;
 }
 
+
+SUPRIVATE su_block_t *
+suscan_capture_source_ctor(const struct suscan_source_config *config)
+{
+  struct xsig_source_params params;
+  struct suscan_field_value *value;
+
+  if ((value = suscan_source_config_get_value(config, "path")) == NULL)
+    return NULL;
+  params.file = value->as_string;
+
+  if ((value = suscan_source_config_get_value(config, "loop")) == NULL)
+    return NULL;
+  params.loop = value->as_bool; /* defaults to false */
+
+  if ((value = suscan_source_config_get_value(config, "prefetch")) == NULL)
+    return NULL;
+  params.prefetch = value->as_int > 0
+      ? value->as_int
+      : XSIG_SOURCE_DEFAULT_PREFETCH;
+
+  if ((value = suscan_source_config_get_value(config, "start")) == NULL)
+    return NULL;
+  params.start = value->as_float; /* defaults to 0 */
+
+  params.onacquire = NULL;
+  params.private = NULL;
+  params.window_size = 512;
+  params.samp_rate = 0;
+  params.fc = 0;
+  params.raw_iq = SU_FALSE;
+  params.capture = SU_TRUE;
+
+  return xsig_source_create_block(&params);
+}
+
+SUBOOL
+suscan_capture_source_init(void)
+{
+  struct suscan_source *source = NULL;
+
+  if ((source = suscan_source_register(
+      "capture",
+      "Suscan indexed capture",
+      suscan_capture_source_ctor)) == NULL)
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_FILE,
+      SU_FALSE,
+      "path",
+      "File path"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_BOOLEAN,
+      SU_TRUE,
+      "loop",
+      "Loop"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "prefetch",
+      "Read-ahead windows (0: default)"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_FLOAT,
+      SU_TRUE,
+      "start",
+      "Start at (seconds)"))
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
@@ -25,34 +25,43 @@
 #ifdef HAVE_HACKRF
 
 #include <sources/hack_rf.h>
+#include <sources/iqconv.h>
+
+SUPRIVATE void
+hackRF_push_samples(struct hackRF_state *state, const uint8_t *iq, size_t count)
+{
+  size_t written;
+
+  written = suscan_ring_write(&state->ring, iq, count);
+
+  if (written < count)
+    __atomic_add_fetch(
+        &state->samples_lost,
+        count - written,
+        __ATOMIC_RELAXED);
+}
 
 SUPRIVATE int
 hackRF_rx_callback(hackrf_transfer* transfer)
 {
-  SUCOMPLEX *start;
-  SUSDIFF size;
-  SUFLOAT val;
   struct hackRF_state *state = (struct hackRF_state *) transfer->rx_ctx;
-  int i;
-
-  pthread_mutex_lock(&state->lock);
-
-  for (i = 0; i < transfer->valid_length; ++i) {
-    val = (transfer->buffer[i] ^ 0x80) / 128.;
-    if (!state->toggle_iq) {
-      /* Build real part */
-      state->samp = val;
-    } else {
-      /* Build imaginary part and append */
-      state->samp += I * val;
-      su_stream_write(&state->stream, &state->samp, 1);
-    }
-
-    state->toggle_iq = !state->toggle_iq;
+  const uint8_t *bytes = transfer->buffer;
+  SUSCOUNT len = transfer->valid_length;
+
+  /* Complete the sample whose real part came in the previous transfer */
+  if (state->iq_pending && len > 0) {
+    state->iq_half[1] = *bytes++;
+    --len;
+    hackRF_push_samples(state, state->iq_half, 1);
+    state->iq_pending = SU_FALSE;
   }
 
-  pthread_cond_signal(&state->cond);
-  pthread_mutex_unlock(&state->lock);
+  hackRF_push_samples(state, bytes, len >> 1);
+
+  if (len & 1) {
+    state->iq_half[0] = bytes[len - 1];
+    state->iq_pending = SU_TRUE;
+  }
 
   return 0;
 }
@@ -73,10 +82,10 @@ hackRF_state_destroy(struct hackRF_state *state)
   if (state->dev != NULL)
     hackrf_close(state->dev);
 
-  pthread_mutex_destroy(&state->lock);
-  pthread_cond_destroy(&state->cond);
+  suscan_ring_finalize(&state->ring);
 
-  su_stream_finalize(&state->stream);
+  if (state->raw != NULL)
+    free(state->raw);
 
   free(state);
 }
@@ -94,11 +103,14 @@ hackRF_state_new(const struct hackRF_params *params)
   if (new->params.bufsiz == 0)
     new->params.bufsiz = HACKRF_STREAM_SIZE;
 
-  SU_TRYCATCH(pthread_mutex_init(&new->lock, NULL) != -1, goto fail);
-
-  SU_TRYCATCH(pthread_cond_init(&new->cond, NULL) != -1, goto fail);
+  SU_TRYCATCH(new->raw = malloc(2 * new->params.bufsiz), goto fail);
 
-  SU_TRYCATCH (su_stream_init(&new->stream, new->params.bufsiz), goto fail);
+  SU_TRYCATCH(
+      suscan_ring_init(
+          &new->ring,
+          2,
+          HACKRF_RING_BUFFERS * new->params.bufsiz),
+      goto fail);
 
   if (params->serial == NULL || strlen(params->serial) == 0)
     result = hackrf_open(&new->dev);
@@ -231,6 +243,26 @@ su_block_hackRF_ctor(struct sigutils_block *block, void **private, va_list ap)
     goto fail;
   }
 
+  /* Written by the analyzer in sweep mode */
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc_request",
+      &state->fc_request)) {
+    SU_ERROR("Expose fc_request failed\n");
+    goto fail;
+  }
+
+  /* Polled by the analyzer to report overruns */
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samples_lost",
+      &state->samples_lost)) {
+    SU_ERROR("Expose samples_lost failed\n");
+    goto fail;
+  }
+
   *private = state;
 
   return SU_TRUE;
@@ -242,9 +274,35 @@ fail:
   return SU_FALSE;
 }
 
-#ifdef HACKRF_SAVE_SAMPLES
-FILE *fp;
-#endif /* HACKRF_SAVE_SAMPLES */
+/*
+ * Pending retune request. Whatever the ring holds was received at the
+ * old frequency, so it goes away with it.
+ */
+SUPRIVATE SUBOOL
+hackRF_state_retune(struct hackRF_state *state)
+{
+  uint64_t fc = __atomic_load_n(&state->fc_request, __ATOMIC_ACQUIRE);
+  int result;
+
+  if (fc == 0 || fc == state->fc)
+    return SU_TRUE;
+
+  result = hackrf_set_freq(state->dev, fc);
+  if (result != HACKRF_SUCCESS) {
+    SU_ERROR(
+        "Failed to retune HackRF: %s (%d)\n",
+        hackrf_error_name(result),
+        result);
+    return SU_FALSE;
+  }
+
+  state->fc = fc;
+
+  while (suscan_ring_read(&state->ring, state->raw, state->params.bufsiz, 0))
+    ;
+
+  return SU_TRUE;
+}
 
 SUPRIVATE SUSDIFF
 su_block_hackRF_acquire(
@@ -257,16 +315,8 @@ su_block_hackRF_acquire(
   SUSDIFF size;
   SUSDIFF got;
   SUCOMPLEX *start;
-  unsigned int i;
   int result;
 
-#ifdef HACKRF_SAVE_SAMPLES
-  complex float iq;
-
-  if (fp == NULL)
-    fp = fopen("output.raw", "wb");
-#endif /* HACKRF_SAVE_SAMPLES */
-
   /* Get the number of complex samples to acquire */
   size = su_stream_get_contiguous(
       out,
@@ -288,21 +338,22 @@ su_block_hackRF_acquire(
     state->rx_started = SU_TRUE;
   }
 
-  /* Acquire samples */
-  pthread_mutex_lock(&state->lock);
-  do {
-    got = su_stream_read(&state->stream, su_stream_tell(out), start, size);
-
-    if (got == 0) {
-      pthread_cond_wait(&state->cond, &state->lock);
-    } else if (got == -1) {
-      SU_WARNING(
-          "HackRF is delivering samples way too fast: samples lost (%lld)\n",
-          state->stream.pos - out->pos);
-      out->pos = state->stream.pos;
-    }
-  } while (got < 1);
-  pthread_mutex_unlock(&state->lock);
+  if (!hackRF_state_retune(state))
+    return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+
+  /* Acquire samples. Overruns are reported by the analyzer */
+  got = suscan_ring_read(
+      &state->ring,
+      state->raw,
+      size,
+      HACKRF_READ_TIMEOUT_MS);
+
+  if (got == 0) {
+    SU_ERROR("HackRF read timeout\n");
+    return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
+  }
+
+  suscan_iqconv_u8(start, state->raw, got);
 
   /* Increment position */
   if (su_stream_advance_contiguous(out, got) != got) {
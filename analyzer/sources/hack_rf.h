@@ -29,7 +29,11 @@
 
 #include <libhackrf/hackrf.h>
 
-#define HACKRF_STREAM_SIZE (1024 * 1024)
+#include "ring.h"
+
+#define HACKRF_STREAM_SIZE      (1024 * 1024)
+#define HACKRF_RING_BUFFERS     4 /* Ring size, in read buffers */
+#define HACKRF_READ_TIMEOUT_MS  5000
 
 struct hackRF_params {
   const char *serial;
@@ -59,12 +63,21 @@ struct hackRF_state {
   struct hackrf_device *dev;
   uint64_t samp_rate; /* Actual sample rate */
   uint64_t fc; /* Actual frequency */
-  pthread_mutex_t lock;
-  pthread_cond_t cond;
-  su_stream_t stream;
+  uint64_t fc_request; /* Set by sweeps, applied by the reading thread */
   SUBOOL rx_started;
-  SUBOOL toggle_iq;
-  SUCOMPLEX samp;
+
+  /*
+   * libhackrf's USB thread pushes raw IQ byte pairs to the ring, and the
+   * acquire function converts them as it reads. The callback never waits
+   * for the reader: whatever doesn't fit is counted as lost.
+   */
+  struct suscan_ring ring;
+  uint8_t *raw;          /* Read buffer, 2 bytes per sample */
+  uint64_t samples_lost; /* Exposed as a block property */
+
+  /* Only accessed from the RX callback */
+  SUBOOL iq_pending;    /* Last transfer ended in the middle of a sample */
+  uint8_t iq_half[2];   /* Bytes of the incomplete sample */
 };
 
 
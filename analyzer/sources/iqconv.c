@@ -0,0 +1,587 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "iqconv"
+
+#include <sources/iqconv.h>
+
+/*
+ * Hand-written kernels are only provided for single precision builds. The
+ * output buffer is processed as a flat array of 2 * count SUFLOATs, which
+ * is the memory layout of SUCOMPLEX.
+ */
+#ifdef _SU_SINGLE_PRECISION
+#  if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    define SUSCAN_IQCONV_X86
+#    include <immintrin.h>
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define SUSCAN_IQCONV_NEON
+#    include <arm_neon.h>
+#  endif
+#endif /* _SU_SINGLE_PRECISION */
+
+#define SUSCAN_IQCONV_U8_SCALE  (1. / 128.)
+#define SUSCAN_IQCONV_S16_SCALE (1. / 32768.)
+#define SUSCAN_IQCONV_S32_SCALE (1. / 2147483648.)
+
+/****************************** Generic kernels ******************************/
+SUPRIVATE void
+suscan_iqconv_u8_generic(SUFLOAT *out, const uint8_t *in, SUSCOUNT len)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i)
+    out[i] = (in[i] ^ 0x80) * SUSCAN_IQCONV_U8_SCALE;
+}
+
+SUPRIVATE void
+suscan_iqconv_s16_generic(
+    SUFLOAT *out,
+    const int16_t *in,
+    SUSCOUNT len,
+    SUFLOAT scale)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i)
+    out[i] = in[i] * scale;
+}
+
+/*
+ * Real sample kernels write len complex samples with a zero imaginary
+ * part. If last is not NULL, they output the first difference instead,
+ * with *last holding the previous input across calls.
+ */
+#define SUSCAN_IQCONV_DEFINE_REAL_GENERIC(fmt, type)                    \
+SUPRIVATE void                                                          \
+suscan_iqconv_real_ ## fmt ## _generic(                                 \
+    SUFLOAT *out,                                                       \
+    const type *in,                                                     \
+    SUSCOUNT len,                                                       \
+    SUFLOAT scale,                                                      \
+    SUFLOAT *last)                                                      \
+{                                                                       \
+  SUSCOUNT i;                                                           \
+  SUFLOAT x;                                                            \
+                                                                        \
+  if (last != NULL) {                                                   \
+    for (i = 0; i < len; ++i) {                                         \
+      x = in[i] * scale;                                                \
+      out[2 * i]     = x - *last;                                       \
+      out[2 * i + 1] = 0;                                               \
+      *last = x;                                                        \
+    }                                                                   \
+  } else {                                                              \
+    for (i = 0; i < len; ++i) {                                         \
+      out[2 * i]     = in[i] * scale;                                   \
+      out[2 * i + 1] = 0;                                               \
+    }                                                                   \
+  }                                                                     \
+}
+
+SUSCAN_IQCONV_DEFINE_REAL_GENERIC(s16, int16_t)
+SUSCAN_IQCONV_DEFINE_REAL_GENERIC(s32, int32_t)
+SUSCAN_IQCONV_DEFINE_REAL_GENERIC(f32, float)
+
+#ifdef SUSCAN_IQCONV_X86
+/******************************** SSE2 kernels *******************************/
+__attribute__((target("sse2"))) SUPRIVATE void
+suscan_iqconv_u8_sse2(SUFLOAT *out, const uint8_t *in, SUSCOUNT len)
+{
+  const __m128i bias = _mm_set1_epi8((char) 0x80);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(SUSCAN_IQCONV_U8_SCALE);
+  __m128i x, lo, hi;
+  SUSCOUNT i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    x  = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + i)), bias);
+    lo = _mm_unpacklo_epi8(x, zero);
+    hi = _mm_unpackhi_epi8(x, zero);
+
+    _mm_storeu_ps(
+        out + i,
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+    _mm_storeu_ps(
+        out + i + 4,
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+    _mm_storeu_ps(
+        out + i + 8,
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+    _mm_storeu_ps(
+        out + i + 12,
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+  }
+
+  suscan_iqconv_u8_generic(out + i, in + i, len - i);
+}
+
+__attribute__((target("sse2"))) SUPRIVATE void
+suscan_iqconv_s16_sse2(
+    SUFLOAT *out,
+    const int16_t *in,
+    SUSCOUNT len,
+    SUFLOAT scale)
+{
+  const __m128 k = _mm_set1_ps(scale);
+  __m128i x;
+  SUSCOUNT i;
+
+  for (i = 0; i + 8 <= len; i += 8) {
+    x = _mm_loadu_si128((const __m128i *) (in + i));
+
+    /* Sign extension: place each word in the upper half, shift back */
+    _mm_storeu_ps(
+        out + i,
+        _mm_mul_ps(
+            _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)),
+            k));
+    _mm_storeu_ps(
+        out + i + 4,
+        _mm_mul_ps(
+            _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)),
+            k));
+  }
+
+  suscan_iqconv_s16_generic(out + i, in + i, len - i, scale);
+}
+
+/******************************** AVX2 kernels *******************************/
+__attribute__((target("avx2"))) SUPRIVATE void
+suscan_iqconv_u8_avx2(SUFLOAT *out, const uint8_t *in, SUSCOUNT len)
+{
+  const __m128i bias = _mm_set1_epi8((char) 0x80);
+  const __m256 scale = _mm256_set1_ps(SUSCAN_IQCONV_U8_SCALE);
+  __m128i x;
+  SUSCOUNT i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    x = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (in + i)), bias);
+
+    _mm256_storeu_ps(
+        out + i,
+        _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(x)), scale));
+    _mm256_storeu_ps(
+        out + i + 8,
+        _mm256_mul_ps(
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(x, 8))),
+            scale));
+  }
+
+  suscan_iqconv_u8_generic(out + i, in + i, len - i);
+}
+
+__attribute__((target("avx2"))) SUPRIVATE void
+suscan_iqconv_s16_avx2(
+    SUFLOAT *out,
+    const int16_t *in,
+    SUSCOUNT len,
+    SUFLOAT scale)
+{
+  const __m256 k = _mm256_set1_ps(scale);
+  __m256i x;
+  SUSCOUNT i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    x = _mm256_loadu_si256((const __m256i *) (in + i));
+
+    _mm256_storeu_ps(
+        out + i,
+        _mm256_mul_ps(
+            _mm256_cvtepi32_ps(
+                _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x))),
+            k));
+    _mm256_storeu_ps(
+        out + i + 8,
+        _mm256_mul_ps(
+            _mm256_cvtepi32_ps(
+                _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1))),
+            k));
+  }
+
+  suscan_iqconv_s16_generic(out + i, in + i, len - i, scale);
+}
+
+/*
+ * Real sample kernels. The previous sample of every lane is built by
+ * rotating the vector one lane up and inserting the last lane of the
+ * previous one.
+ */
+#define SUSCAN_IQCONV_LOAD_S16_SSE2(p)                                  \
+  _mm_cvtepi32_ps(                                                      \
+      _mm_srai_epi32(                                                   \
+          _mm_unpacklo_epi16(                                           \
+              _mm_setzero_si128(),                                      \
+              _mm_loadl_epi64((const __m128i *) (p))),                  \
+          16))
+
+#define SUSCAN_IQCONV_LOAD_S32_SSE2(p)                                  \
+  _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (p)))
+
+#define SUSCAN_IQCONV_LOAD_F32_SSE2(p) _mm_loadu_ps(p)
+
+#define SUSCAN_IQCONV_DEFINE_REAL_SSE2(fmt, type, load)                 \
+__attribute__((target("sse2"))) SUPRIVATE void                          \
+suscan_iqconv_real_ ## fmt ## _sse2(                                    \
+    SUFLOAT *out,                                                       \
+    const type *in,                                                     \
+    SUSCOUNT len,                                                       \
+    SUFLOAT scale,                                                      \
+    SUFLOAT *last)                                                      \
+{                                                                       \
+  const __m128 k = _mm_set1_ps(scale);                                  \
+  const __m128 zero = _mm_setzero_ps();                                 \
+  __m128 x, y, prev;                                                    \
+  SUSCOUNT i;                                                           \
+                                                                        \
+  prev = _mm_set1_ps(last != NULL ? *last : 0);                         \
+                                                                        \
+  for (i = 0; i + 4 <= len; i += 4) {                                   \
+    x = _mm_mul_ps(load(in + i), k);                                    \
+                                                                        \
+    if (last != NULL) {                                                 \
+      y = _mm_sub_ps(                                                   \
+          x,                                                            \
+          _mm_move_ss(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 1, 0, 3)), prev)); \
+      prev = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));             \
+    } else {                                                            \
+      y = x;                                                            \
+    }                                                                   \
+                                                                        \
+    _mm_storeu_ps(out + 2 * i,     _mm_unpacklo_ps(y, zero));           \
+    _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(y, zero));           \
+  }                                                                     \
+                                                                        \
+  if (last != NULL)                                                     \
+    *last = _mm_cvtss_f32(prev);                                        \
+                                                                        \
+  suscan_iqconv_real_ ## fmt ## _generic(                               \
+      out + 2 * i,                                                      \
+      in + i,                                                           \
+      len - i,                                                          \
+      scale,                                                            \
+      last);                                                            \
+}
+
+SUSCAN_IQCONV_DEFINE_REAL_SSE2(s16, int16_t, SUSCAN_IQCONV_LOAD_S16_SSE2)
+SUSCAN_IQCONV_DEFINE_REAL_SSE2(s32, int32_t, SUSCAN_IQCONV_LOAD_S32_SSE2)
+SUSCAN_IQCONV_DEFINE_REAL_SSE2(f32, float,   SUSCAN_IQCONV_LOAD_F32_SSE2)
+#endif /* SUSCAN_IQCONV_X86 */
+
+#ifdef SUSCAN_IQCONV_NEON
+/******************************** NEON kernels *******************************/
+SUPRIVATE void
+suscan_iqconv_u8_neon(SUFLOAT *out, const uint8_t *in, SUSCOUNT len)
+{
+  const uint8x16_t bias = vdupq_n_u8(0x80);
+  uint8x16_t x;
+  uint16x8_t lo, hi;
+  SUSCOUNT i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    x  = veorq_u8(vld1q_u8(in + i), bias);
+    lo = vmovl_u8(vget_low_u8(x));
+    hi = vmovl_u8(vget_high_u8(x));
+
+    vst1q_f32(
+        out + i,
+        vmulq_n_f32(
+            vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))),
+            SUSCAN_IQCONV_U8_SCALE));
+    vst1q_f32(
+        out + i + 4,
+        vmulq_n_f32(
+            vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))),
+            SUSCAN_IQCONV_U8_SCALE));
+    vst1q_f32(
+        out + i + 8,
+        vmulq_n_f32(
+            vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))),
+            SUSCAN_IQCONV_U8_SCALE));
+    vst1q_f32(
+        out + i + 12,
+        vmulq_n_f32(
+            vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))),
+            SUSCAN_IQCONV_U8_SCALE));
+  }
+
+  suscan_iqconv_u8_generic(out + i, in + i, len - i);
+}
+
+SUPRIVATE void
+suscan_iqconv_s16_neon(
+    SUFLOAT *out,
+    const int16_t *in,
+    SUSCOUNT len,
+    SUFLOAT scale)
+{
+  int16x8_t x;
+  SUSCOUNT i;
+
+  for (i = 0; i + 8 <= len; i += 8) {
+    x = vld1q_s16(in + i);
+
+    vst1q_f32(
+        out + i,
+        vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+    vst1q_f32(
+        out + i + 4,
+        vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+  }
+
+  suscan_iqconv_s16_generic(out + i, in + i, len - i, scale);
+}
+
+/* Real sample kernels. vst2q interleaves the zero imaginary parts */
+#define SUSCAN_IQCONV_LOAD_S16_NEON(p) vcvtq_f32_s32(vmovl_s16(vld1_s16(p)))
+#define SUSCAN_IQCONV_LOAD_S32_NEON(p) vcvtq_f32_s32(vld1q_s32(p))
+#define SUSCAN_IQCONV_LOAD_F32_NEON(p) vld1q_f32(p)
+
+#define SUSCAN_IQCONV_DEFINE_REAL_NEON(fmt, type, load)                 \
+SUPRIVATE void                                                          \
+suscan_iqconv_real_ ## fmt ## _neon(                                    \
+    SUFLOAT *out,                                                       \
+    const type *in,                                                     \
+    SUSCOUNT len,                                                       \
+    SUFLOAT scale,                                                      \
+    SUFLOAT *last)                                                      \
+{                                                                       \
+  float32x4x2_t pair;                                                   \
+  float32x4_t x, prev;                                                  \
+  SUSCOUNT i;                                                           \
+                                                                        \
+  prev = vdupq_n_f32(last != NULL ? *last : 0);                         \
+  pair.val[1] = vdupq_n_f32(0);                                         \
+                                                                        \
+  for (i = 0; i + 4 <= len; i += 4) {                                   \
+    x = vmulq_n_f32(load(in + i), scale);                               \
+                                                                        \
+    if (last != NULL) {                                                 \
+      pair.val[0] = vsubq_f32(x, vextq_f32(prev, x, 3));                \
+      prev = x;                                                         \
+    } else {                                                            \
+      pair.val[0] = x;                                                  \
+    }                                                                   \
+                                                                        \
+    vst2q_f32(out + 2 * i, pair);                                       \
+  }                                                                     \
+                                                                        \
+  if (last != NULL)                                                     \
+    *last = vgetq_lane_f32(prev, 3);                                    \
+                                                                        \
+  suscan_iqconv_real_ ## fmt ## _generic(                               \
+      out + 2 * i,                                                      \
+      in + i,                                                           \
+      len - i,                                                          \
+      scale,                                                            \
+      last);                                                            \
+}
+
+SUSCAN_IQCONV_DEFINE_REAL_NEON(s16, int16_t, SUSCAN_IQCONV_LOAD_S16_NEON)
+SUSCAN_IQCONV_DEFINE_REAL_NEON(s32, int32_t, SUSCAN_IQCONV_LOAD_S32_NEON)
+SUSCAN_IQCONV_DEFINE_REAL_NEON(f32, float,   SUSCAN_IQCONV_LOAD_F32_NEON)
+#endif /* SUSCAN_IQCONV_NEON */
+
+/****************************** Kernel dispatch ******************************/
+struct suscan_iqconv_kernels {
+  const char *name;
+  void (*u8) (SUFLOAT *out, const uint8_t *in, SUSCOUNT len);
+  void (*s16) (SUFLOAT *out, const int16_t *in, SUSCOUNT len, SUFLOAT scale);
+
+  void (*real_s16) (
+      SUFLOAT *out,
+      const int16_t *in,
+      SUSCOUNT len,
+      SUFLOAT scale,
+      SUFLOAT *last);
+  void (*real_s32) (
+      SUFLOAT *out,
+      const int32_t *in,
+      SUSCOUNT len,
+      SUFLOAT scale,
+      SUFLOAT *last);
+  void (*real_f32) (
+      SUFLOAT *out,
+      const float *in,
+      SUSCOUNT len,
+      SUFLOAT scale,
+      SUFLOAT *last);
+};
+
+SUPRIVATE const struct suscan_iqconv_kernels *suscan_iqconv_selected;
+
+SUPRIVATE const struct suscan_iqconv_kernels *
+suscan_iqconv_select(void)
+{
+  static const struct suscan_iqconv_kernels generic = {
+      "generic",
+      suscan_iqconv_u8_generic,
+      suscan_iqconv_s16_generic,
+      suscan_iqconv_real_s16_generic,
+      suscan_iqconv_real_s32_generic,
+      suscan_iqconv_real_f32_generic
+  };
+#ifdef SUSCAN_IQCONV_X86
+  static const struct suscan_iqconv_kernels sse2 = {
+      "SSE2",
+      suscan_iqconv_u8_sse2,
+      suscan_iqconv_s16_sse2,
+      suscan_iqconv_real_s16_sse2,
+      suscan_iqconv_real_s32_sse2,
+      suscan_iqconv_real_f32_sse2
+  };
+  static const struct suscan_iqconv_kernels avx2 = {
+      "AVX2",
+      suscan_iqconv_u8_avx2,
+      suscan_iqconv_s16_avx2,
+      suscan_iqconv_real_s16_sse2, /* Memory bound, SSE2 is enough */
+      suscan_iqconv_real_s32_sse2,
+      suscan_iqconv_real_f32_sse2
+  };
+#endif /* SUSCAN_IQCONV_X86 */
+#ifdef SUSCAN_IQCONV_NEON
+  static const struct suscan_iqconv_kernels neon = {
+      "NEON",
+      suscan_iqconv_u8_neon,
+      suscan_iqconv_s16_neon,
+      suscan_iqconv_real_s16_neon,
+      suscan_iqconv_real_s32_neon,
+      suscan_iqconv_real_f32_neon
+  };
+#endif /* SUSCAN_IQCONV_NEON */
+  const struct suscan_iqconv_kernels *kernels;
+
+  /* Concurrent first calls resolve to the same kernels, this is harmless */
+  if ((kernels = __atomic_load_n(&suscan_iqconv_selected, __ATOMIC_ACQUIRE))
+      != NULL)
+    return kernels;
+
+  kernels = &generic;
+
+#if defined(SUSCAN_IQCONV_X86)
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    kernels = &avx2;
+  else if (__builtin_cpu_supports("sse2"))
+    kernels = &sse2;
+#elif defined(SUSCAN_IQCONV_NEON)
+  kernels = &neon;
+#endif
+
+  SU_INFO("Using %s IQ conversion kernels\n", kernels->name);
+
+  __atomic_store_n(&suscan_iqconv_selected, kernels, __ATOMIC_RELEASE);
+
+  return kernels;
+}
+
+void
+suscan_iqconv_u8(SUCOMPLEX *out, const uint8_t *in, SUSCOUNT count)
+{
+  (suscan_iqconv_select()->u8) ((SUFLOAT *) out, in, count << 1);
+}
+
+void
+suscan_iqconv_s16(
+    SUCOMPLEX *out,
+    const int16_t *in,
+    SUSCOUNT count,
+    SUFLOAT scale)
+{
+  (suscan_iqconv_select()->s16) ((SUFLOAT *) out, in, count << 1, scale);
+}
+
+void
+suscan_iqconv_real_s16(
+    SUCOMPLEX *out,
+    const int16_t *in,
+    SUSCOUNT count,
+    SUFLOAT *last)
+{
+  (suscan_iqconv_select()->real_s16) (
+      (SUFLOAT *) out,
+      in,
+      count,
+      SUSCAN_IQCONV_S16_SCALE,
+      last);
+}
+
+void
+suscan_iqconv_real_s32(
+    SUCOMPLEX *out,
+    const int32_t *in,
+    SUSCOUNT count,
+    SUFLOAT *last)
+{
+  (suscan_iqconv_select()->real_s32) (
+      (SUFLOAT *) out,
+      in,
+      count,
+      SUSCAN_IQCONV_S32_SCALE,
+      last);
+}
+
+void
+suscan_iqconv_real_f32(
+    SUCOMPLEX *out,
+    const float *in,
+    SUSCOUNT count,
+    SUFLOAT *last)
+{
+  (suscan_iqconv_select()->real_f32) ((SUFLOAT *) out, in, count, 1, last);
+}
+
+/*
+ * Less demanding formats, used by file sources only. These are left to the
+ * compiler.
+ */
+void
+suscan_iqconv_cu8(SUCOMPLEX *out, const uint8_t *in, SUSCOUNT count)
+{
+  SUFLOAT *flat = (SUFLOAT *) out;
+  SUSCOUNT i;
+
+  count <<= 1;
+
+  for (i = 0; i < count; ++i)
+    flat[i] = ((int) in[i] - 128) * SUSCAN_IQCONV_U8_SCALE;
+}
+
+void
+suscan_iqconv_f32(SUCOMPLEX *out, const float *in, SUSCOUNT count)
+{
+  SUFLOAT *flat = (SUFLOAT *) out;
+  SUSCOUNT i;
+
+  /* Same layout: this is a plain copy */
+  if (sizeof(SUFLOAT) == sizeof(float)) {
+    memcpy(out, in, count * sizeof(SUCOMPLEX));
+    return;
+  }
+
+  count <<= 1;
+
+  for (i = 0; i < count; ++i)
+    flat[i] = in[i];
+}
@@ -0,0 +1,74 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _ANALYZER_SOURCES_IQCONV_H
+#define _ANALYZER_SOURCES_IQCONV_H
+
+#include <sigutils/sigutils.h>
+#include <stdint.h>
+
+/*
+ * Bulk conversion of interleaved integer IQ samples, as delivered by SDR
+ * hardware, to SUCOMPLEX. Count is given in complex samples (i.e. in
+ * has 2 * count elements). The best kernel for the running CPU is
+ * selected on first use.
+ */
+
+/* Offset binary bytes (HackRF): (x ^ 0x80) / 128 */
+void suscan_iqconv_u8(SUCOMPLEX *out, const uint8_t *in, SUSCOUNT count);
+
+/* Signed 16 bit words (bladeRF): x * scale */
+void suscan_iqconv_s16(
+    SUCOMPLEX *out,
+    const int16_t *in,
+    SUSCOUNT count,
+    SUFLOAT scale);
+
+/* Unsigned bytes centered at 128 (RTL-SDR cu8): (x - 128) / 128 */
+void suscan_iqconv_cu8(SUCOMPLEX *out, const uint8_t *in, SUSCOUNT count);
+
+/* Single precision floats (GQRX's cf32) */
+void suscan_iqconv_f32(SUCOMPLEX *out, const float *in, SUSCOUNT count);
+
+/*
+ * Real samples (single channel audio capture), count elements in input,
+ * scaled to full range with a zero imaginary part. If last is not NULL,
+ * the first difference is returned instead to remove DC, and *last keeps
+ * the previous input across calls.
+ */
+void suscan_iqconv_real_s16(
+    SUCOMPLEX *out,
+    const int16_t *in,
+    SUSCOUNT count,
+    SUFLOAT *last);
+
+void suscan_iqconv_real_s32(
+    SUCOMPLEX *out,
+    const int32_t *in,
+    SUSCOUNT count,
+    SUFLOAT *last);
+
+void suscan_iqconv_real_f32(
+    SUCOMPLEX *out,
+    const float *in,
+    SUSCOUNT count,
+    SUFLOAT *last);
+
+#endif /* _ANALYZER_SOURCES_IQCONV_H */
@@ -0,0 +1,393 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SU_LOG_DOMAIN "rawfile"
+
+#include "source.h"
+
+#include <sources/rawfile.h>
+#include <sources/iqconv.h>
+
+/*
+ * Raw I/Q capture source. The file is mapped in memory and samples are
+ * converted straight from the page cache to the output stream, with no
+ * intermediate read buffer.
+ */
+
+SUPRIVATE void
+rawfile_state_destroy(struct rawfile_state *state)
+{
+  if (state->map != NULL)
+    munmap((void *) state->map, state->map_size);
+
+  if (state->fd != -1)
+    close(state->fd);
+
+  free(state);
+}
+
+SUPRIVATE size_t
+rawfile_format_sample_size(enum rawfile_format format)
+{
+  switch (format) {
+    case RAWFILE_FORMAT_CF32:
+      return 2 * sizeof(float);
+
+    case RAWFILE_FORMAT_CS16:
+      return 2 * sizeof(int16_t);
+
+    case RAWFILE_FORMAT_CU8:
+      return 2 * sizeof(uint8_t);
+  }
+
+  return 0;
+}
+
+SUPRIVATE struct rawfile_state *
+rawfile_state_new(const struct rawfile_params *params)
+{
+  struct rawfile_state *new = NULL;
+  struct stat sbuf;
+
+  SU_TRYCATCH(new = calloc(1, sizeof (struct rawfile_state)), goto fail);
+
+  new->fd = -1;
+  new->params = *params;
+  new->samp_rate = params->samp_rate;
+  new->fc = params->fc;
+  new->sample_size = rawfile_format_sample_size(params->format);
+
+  if ((new->fd = open(params->path, O_RDONLY)) == -1) {
+    SU_ERROR("Cannot open `%s': %s\n", params->path, strerror(errno));
+    goto fail;
+  }
+
+  SU_TRYCATCH(fstat(new->fd, &sbuf) != -1, goto fail);
+
+  if ((new->samp_count = sbuf.st_size / new->sample_size) == 0) {
+    SU_ERROR("`%s': capture file is empty\n", params->path);
+    goto fail;
+  }
+
+  new->map_size = new->samp_count * new->sample_size;
+
+  if ((new->map = mmap(
+      NULL,
+      new->map_size,
+      PROT_READ,
+      MAP_PRIVATE,
+      new->fd,
+      0)) == MAP_FAILED) {
+    new->map = NULL;
+    SU_ERROR("Cannot map `%s': %s\n", params->path, strerror(errno));
+    goto fail;
+  }
+
+  /* Not fatal: this is just a hint */
+  (void) madvise((void *) new->map, new->map_size, MADV_SEQUENTIAL);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    rawfile_state_destroy(new);
+
+  return NULL;
+}
+
+/*
+ * Keep the kernel one chunk ahead of the reading position, and drop the
+ * chunks we are done with so long captures do not fill the page cache
+ * with our pages only.
+ */
+SUPRIVATE void
+rawfile_state_advise(struct rawfile_state *state)
+{
+  size_t offset = state->pos * state->sample_size;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t end;
+
+  if (offset + RAWFILE_READAHEAD_SIZE > state->advised
+      && state->advised < state->map_size) {
+    end = state->advised + 2 * RAWFILE_READAHEAD_SIZE;
+    if (end > state->map_size)
+      end = state->map_size;
+
+    (void) madvise(
+        (void *) (state->map + state->advised),
+        end - state->advised,
+        MADV_WILLNEED);
+
+    /* Next request must start at a page boundary */
+    state->advised = end == state->map_size ? end : end & ~(page - 1);
+  }
+
+  if (offset >= state->released + RAWFILE_READAHEAD_SIZE) {
+    end = offset & ~(page - 1);
+
+    (void) madvise(
+        (void *) (state->map + state->released),
+        end - state->released,
+        MADV_DONTNEED);
+
+    state->released = end;
+  }
+}
+
+SUPRIVATE void
+rawfile_state_rewind(struct rawfile_state *state)
+{
+  state->pos = 0;
+  state->advised = 0;
+  state->released = 0;
+}
+
+SUPRIVATE void
+rawfile_state_convert(
+    const struct rawfile_state *state,
+    SUCOMPLEX *out,
+    SUSCOUNT count)
+{
+  const void *in = state->map + state->pos * state->sample_size;
+
+  switch (state->params.format) {
+    case RAWFILE_FORMAT_CF32:
+      suscan_iqconv_f32(out, (const float *) in, count);
+      break;
+
+    case RAWFILE_FORMAT_CS16:
+      suscan_iqconv_s16(out, (const int16_t *) in, count, 1. / 32768.);
+      break;
+
+    case RAWFILE_FORMAT_CU8:
+      suscan_iqconv_cu8(out, (const uint8_t *) in, count);
+      break;
+  }
+}
+
+SUPRIVATE void
+su_block_rawfile_dtor(void *private)
+{
+  struct rawfile_state *state = (struct rawfile_state *) private;
+
+  rawfile_state_destroy(state);
+}
+
+SUPRIVATE SUBOOL
+su_block_rawfile_ctor(struct sigutils_block *block, void **private, va_list ap)
+{
+  struct rawfile_state *state = NULL;
+  const struct rawfile_params *params;
+
+  params = va_arg(ap, const struct rawfile_params *);
+
+  if ((state = rawfile_state_new(params)) == NULL) {
+    SU_ERROR("Create rawfile state failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "samp_rate",
+      &state->samp_rate)) {
+    SU_ERROR("Expose samp_rate failed\n");
+    goto fail;
+  }
+
+  if (!su_block_set_property_ref(
+      block,
+      SU_PROPERTY_TYPE_INTEGER,
+      "fc",
+      &state->fc)) {
+    SU_ERROR("Expose fc failed\n");
+    goto fail;
+  }
+
+  *private = state;
+
+  return SU_TRUE;
+
+fail:
+  if (state != NULL)
+    rawfile_state_destroy(state);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUSDIFF
+su_block_rawfile_acquire(
+    void *priv,
+    su_stream_t *out,
+    unsigned int port_id,
+    su_block_port_t *in)
+{
+  struct rawfile_state *state = (struct rawfile_state *) priv;
+  SUCOMPLEX *start;
+  SUSDIFF size;
+
+  if (state->pos == state->samp_count) {
+    if (!state->params.loop)
+      return SU_BLOCK_PORT_READ_END_OF_STREAM;
+
+    rawfile_state_rewind(state);
+  }
+
+  size = su_stream_get_contiguous(out, &start, out->size);
+
+  if (size > state->samp_count - state->pos)
+    size = state->samp_count - state->pos;
+
+  rawfile_state_advise(state);
+
+  rawfile_state_convert(state, start, size);
+
+  /* Increment position */
+  if (su_stream_advance_contiguous(out, size) != size) {
+    SU_ERROR("Unexpected size after su_stream_advance_contiguous\n");
+    return -1;
+  }
+
+  state->pos += size;
+
+  return size;
+}
+
+SUPRIVATE struct sigutils_block_class su_block_class_RAWFILE = {
+    "rawfile", /* name */
+    0,         /* in_size */
+    1,         /* out_size */
+    su_block_rawfile_ctor,     /* constructor */
+    su_block_rawfile_dtor,     /* destructor */
+    su_block_rawfile_acquire,  /* acquire */
+};
+
+SUPRIVATE SUBOOL
+rawfile_format_from_string(const char *string, enum rawfile_format *format)
+{
+  if (strcasecmp(string, "cf32") == 0 || strcasecmp(string, "float32") == 0)
+    *format = RAWFILE_FORMAT_CF32;
+  else if (strcasecmp(string, "cs16") == 0)
+    *format = RAWFILE_FORMAT_CS16;
+  else if (strcasecmp(string, "cu8") == 0)
+    *format = RAWFILE_FORMAT_CU8;
+  else
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE su_block_t *
+suscan_rawfile_source_ctor(const struct suscan_source_config *config)
+{
+  struct rawfile_params params = rawfile_params_INITIALIZER;
+  const struct suscan_field_value *value;
+
+  if ((value = suscan_source_config_get_value(config, "path")) == NULL)
+    return NULL;
+  params.path = value->as_string;
+
+  if ((value = suscan_source_config_get_value(config, "format")) == NULL)
+    return NULL;
+  if (value->set && strlen(value->as_string) > 0)
+    if (!rawfile_format_from_string(value->as_string, &params.format)) {
+      SU_ERROR("Unknown raw sample format `%s'\n", value->as_string);
+      return NULL;
+    }
+
+  if ((value = suscan_source_config_get_value(config, "fs")) == NULL)
+    return NULL;
+  params.samp_rate = value->as_int;
+
+  if ((value = suscan_source_config_get_value(config, "fc")) == NULL)
+    return NULL;
+  params.fc = value->as_int; /* defaults to 0 */
+
+  if ((value = suscan_source_config_get_value(config, "loop")) == NULL)
+    return NULL;
+  params.loop = value->as_bool; /* defaults to false */
+
+  return su_block_new("rawfile", &params);
+}
+
+SUBOOL
+suscan_rawfile_source_init(void)
+{
+  struct suscan_source *source = NULL;
+
+  if (!su_block_class_register(&su_block_class_RAWFILE))
+    return SU_FALSE;
+
+  if ((source = suscan_source_register(
+      "rawfile",
+      "Raw I/Q capture (memory mapped)",
+      suscan_rawfile_source_ctor)) == NULL)
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_FILE,
+      SU_FALSE,
+      "path",
+      "File path"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_STRING,
+      SU_TRUE,
+      "format",
+      "Sample format (cf32, cs16, cu8)"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_FALSE,
+      "fs",
+      "Sampling frequency"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_INTEGER,
+      SU_TRUE,
+      "fc",
+      "Center frequency"))
+    return SU_FALSE;
+
+  if (!suscan_source_add_field(
+      source,
+      SUSCAN_FIELD_TYPE_BOOLEAN,
+      SU_TRUE,
+      "loop",
+      "Loop"))
+    return SU_FALSE;
+
+  return SU_TRUE;
+}
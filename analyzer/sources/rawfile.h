@@ -0,0 +1,70 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _ANALYZER_SOURCES_RAWFILE_H
+#define _ANALYZER_SOURCES_RAWFILE_H
+
+#include <sigutils/sigutils.h>
+#include <stdint.h>
+
+/* Readahead is requested in chunks of this size (bytes) */
+#define RAWFILE_READAHEAD_SIZE (16 * 1024 * 1024)
+
+enum rawfile_format {
+  RAWFILE_FORMAT_CF32, /* Interleaved float32 I/Q, like GQRX */
+  RAWFILE_FORMAT_CS16, /* Interleaved signed 16 bit I/Q */
+  RAWFILE_FORMAT_CU8   /* Interleaved unsigned 8 bit I/Q, like RTL-SDR */
+};
+
+struct rawfile_params {
+  const char *path;
+  enum rawfile_format format;
+  SUSCOUNT samp_rate;
+  uint64_t fc;
+  SUBOOL loop;
+};
+
+#define rawfile_params_INITIALIZER             \
+{                                              \
+  NULL, /* path */                             \
+  RAWFILE_FORMAT_CF32, /* format */            \
+  250000, /* samp_rate */                      \
+  0, /* fc */                                  \
+  SU_FALSE, /* loop */                         \
+}
+
+struct rawfile_state {
+  struct rawfile_params params;
+  uint64_t samp_rate;
+  uint64_t fc;
+
+  int fd;
+  const uint8_t *map;   /* Whole capture, mapped read-only */
+  size_t map_size;
+  size_t sample_size;   /* Bytes per complex sample */
+  SUSCOUNT samp_count;  /* Complex samples in file */
+  SUSCOUNT pos;         /* Next sample to deliver */
+  size_t advised;       /* Bytes requested for readahead so far */
+  size_t released;      /* Bytes already dropped from memory */
+};
+
+SUBOOL suscan_rawfile_source_init(void);
+
+#endif /* _ANALYZER_SOURCES_RAWFILE_H */
@@ -0,0 +1,105 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "stats"
+
+#include "stats.h"
+
+/*
+ * Histograms are written by one thread only, so increments don't need
+ * to be atomic read-modify-write operations. Relaxed loads and stores
+ * are enough to let other threads read consistent 64 bit values.
+ */
+SUINLINE void
+suscan_stats_counter_add(uint64_t *counter, uint64_t value)
+{
+  __atomic_store_n(
+      counter,
+      __atomic_load_n(counter, __ATOMIC_RELAXED) + value,
+      __ATOMIC_RELAXED);
+}
+
+void
+suscan_stats_histogram_add(struct suscan_stats_histogram *hist, uint64_t ns)
+{
+  uint64_t us = ns / 1000;
+  unsigned int bucket = 0;
+
+  while (us > 0 && bucket < SUSCAN_STATS_HISTOGRAM_BUCKETS - 1) {
+    us >>= 1;
+    ++bucket;
+  }
+
+  suscan_stats_counter_add(&hist->bucket[bucket], 1);
+  suscan_stats_counter_add(&hist->total_ns, ns);
+
+  if (ns > hist->max_ns)
+    __atomic_store_n(&hist->max_ns, ns, __ATOMIC_RELAXED);
+
+  /* Last, so readers never see more samples than bucket contents */
+  suscan_stats_counter_add(&hist->count, 1);
+}
+
+void
+suscan_stats_histogram_snapshot(
+    struct suscan_stats_histogram *dest,
+    const struct suscan_stats_histogram *hist)
+{
+  unsigned int i;
+
+  dest->count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+  dest->total_ns = __atomic_load_n(&hist->total_ns, __ATOMIC_RELAXED);
+  dest->max_ns = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+
+  for (i = 0; i < SUSCAN_STATS_HISTOGRAM_BUCKETS; ++i)
+    dest->bucket[i] = __atomic_load_n(&hist->bucket[i], __ATOMIC_RELAXED);
+}
+
+uint64_t
+suscan_stats_histogram_get_percentile(
+    const struct suscan_stats_histogram *hist,
+    SUFLOAT p)
+{
+  uint64_t total = 0;
+  uint64_t target;
+  unsigned int i;
+
+  for (i = 0; i < SUSCAN_STATS_HISTOGRAM_BUCKETS; ++i)
+    total += hist->bucket[i];
+
+  if (total == 0)
+    return 0;
+
+  target = p * total;
+
+  for (i = 0; i < SUSCAN_STATS_HISTOGRAM_BUCKETS; ++i) {
+    if (hist->bucket[i] > target)
+      break;
+    target -= hist->bucket[i];
+  }
+
+  if (i == SUSCAN_STATS_HISTOGRAM_BUCKETS)
+    return hist->max_ns;
+
+  /* Upper bound of the bucket, in nanoseconds */
+  return 1000ull << i;
+}
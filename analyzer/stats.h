@@ -0,0 +1,73 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Timing histogram with power-of-two microsecond buckets: bucket 0 counts
+ * durations below 1 us, bucket n durations in [2^(n-1), 2^n) us, and the
+ * last one everything above. Each histogram has a single writer, any
+ * thread may take a snapshot of it at any time.
+ */
+#define SUSCAN_STATS_HISTOGRAM_BUCKETS 24
+
+struct suscan_stats_histogram {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+  uint64_t bucket[SUSCAN_STATS_HISTOGRAM_BUCKETS];
+};
+
+SUINLINE uint64_t
+suscan_stats_timespec_to_ns(const struct timespec *ts)
+{
+  return ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+SUINLINE uint64_t
+suscan_stats_now_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+  return suscan_stats_timespec_to_ns(&now);
+}
+
+/* Must only be called by the histogram owner */
+void suscan_stats_histogram_add(
+    struct suscan_stats_histogram *hist,
+    uint64_t ns);
+
+void suscan_stats_histogram_snapshot(
+    struct suscan_stats_histogram *dest,
+    const struct suscan_stats_histogram *hist);
+
+/* Approximate percentile (0 to 1), in nanoseconds */
+uint64_t suscan_stats_histogram_get_percentile(
+    const struct suscan_stats_histogram *hist,
+    SUFLOAT p);
+
+#endif /* _STATS_H */
@@ -0,0 +1,375 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SU_LOG_DOMAIN "sweep"
+
+#include "sweep.h"
+
+void
+suscan_sweep_destroy(suscan_sweep_t *sweep)
+{
+  if (sweep->plan != NULL)
+    SU_FFTW(_destroy_plan)(sweep->plan);
+
+  if (sweep->fft != NULL)
+    SU_FFTW(_free)(sweep->fft);
+
+  if (sweep->window != NULL)
+    free(sweep->window);
+
+  if (sweep->accum != NULL)
+    free(sweep->accum);
+
+  if (sweep->psd != NULL)
+    free(sweep->psd);
+
+  if (sweep->channel_list != NULL)
+    free(sweep->channel_list);
+
+  if (sweep->channel_ptrs != NULL)
+    free(sweep->channel_ptrs);
+
+  free(sweep);
+}
+
+suscan_sweep_t *
+suscan_sweep_new(
+    const struct suscan_sweep_params *params,
+    SUFLOAT samp_rate,
+    unsigned int fft_size,
+    uint64_t *fc_request)
+{
+  suscan_sweep_t *new = NULL;
+  SUFLOAT step_width;
+  unsigned int i;
+
+  SU_TRYCATCH(samp_rate > 0 && fft_size > 1, goto fail);
+  SU_TRYCATCH(params->freq_max > params->freq_min, goto fail);
+  SU_TRYCATCH(fc_request != NULL, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_sweep_t)), goto fail);
+
+  new->params     = *params;
+  new->samp_rate  = samp_rate;
+  new->fft_size   = fft_size;
+  new->fc_request = fc_request;
+
+  new->step_bins = SU_MAX(fft_size * SUSCAN_SWEEP_USABLE_FRACTION, 1);
+  step_width = new->step_bins * samp_rate / fft_size;
+  new->step_count = SU_MAX(
+      SU_CEIL((params->freq_max - params->freq_min) / step_width),
+      1);
+
+  new->settle_samples = params->settle * samp_rate;
+  new->dwell_samples  = SU_MAX(params->dwell * samp_rate, fft_size);
+
+  SU_TRYCATCH(new->window = malloc(fft_size * sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->accum = calloc(fft_size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(
+      new->psd = calloc(suscan_sweep_get_psd_size(new), sizeof(SUFLOAT)),
+      goto fail);
+
+  for (i = 0; i < fft_size; ++i)
+    new->window[i] = .5 - .5 * cos(2 * M_PI * i / (fft_size - 1));
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(fft_size * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->plan = SU_FFTW(_plan_dft_1d)(
+          fft_size,
+          (SU_FFTW(_complex) *) new->fft,
+          (SU_FFTW(_complex) *) new->fft,
+          FFTW_FORWARD,
+          FFTW_ESTIMATE),
+      goto fail);
+
+  /* First step. Source retunes on its next read */
+  __atomic_store_n(
+      new->fc_request,
+      suscan_sweep_get_step_fc(new, 0),
+      __ATOMIC_RELEASE);
+
+  SU_INFO(
+      "Sweep: %d steps of %lg Hz, %d bins\n",
+      new->step_count,
+      step_width,
+      suscan_sweep_get_psd_size(new));
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_sweep_destroy(new);
+
+  return NULL;
+}
+
+/* Lowest bin of a step kept in the stitched spectrum, lowest first */
+SUINLINE unsigned int
+suscan_sweep_first_bin(const suscan_sweep_t *sweep)
+{
+  return (sweep->fft_size - sweep->step_bins) / 2;
+}
+
+uint64_t
+suscan_sweep_get_step_fc(const suscan_sweep_t *sweep, unsigned int step)
+{
+  SUFLOAT bin = sweep->samp_rate / sweep->fft_size;
+
+  /* The (DC) center bin of the step, in the stitched spectrum */
+  return sweep->params.freq_min + bin * (
+      step * sweep->step_bins
+      + sweep->fft_size / 2
+      - suscan_sweep_first_bin(sweep));
+}
+
+uint64_t
+suscan_sweep_get_fc(const suscan_sweep_t *sweep)
+{
+  return sweep->params.freq_min
+      + sweep->samp_rate / sweep->fft_size
+      * (suscan_sweep_get_psd_size(sweep) / 2);
+}
+
+SUFLOAT
+suscan_sweep_get_span(const suscan_sweep_t *sweep)
+{
+  return sweep->samp_rate / sweep->fft_size * suscan_sweep_get_psd_size(sweep);
+}
+
+SUBOOL
+suscan_sweep_tuner_advance(
+    suscan_sweep_t *sweep,
+    SUSCOUNT count,
+    unsigned int *seq)
+{
+  SUBOOL settling = sweep->tune_count < sweep->settle_samples;
+
+  *seq = sweep->tune_seq;
+  sweep->tune_count += count;
+
+  /* Step read: retune now, the worker is still busy with this one */
+  if (sweep->tune_count >= sweep->settle_samples + sweep->dwell_samples) {
+    ++sweep->tune_seq;
+    sweep->tune_count = 0;
+
+    if (sweep->step_count > 1)
+      __atomic_store_n(
+          sweep->fc_request,
+          suscan_sweep_get_step_fc(
+              sweep,
+              sweep->tune_seq % sweep->step_count),
+          __ATOMIC_RELEASE);
+  }
+
+  return !settling;
+}
+
+SUPRIVATE SUBOOL
+suscan_sweep_assert_channels(suscan_sweep_t *sweep, unsigned int count)
+{
+  struct sigutils_channel *new_list;
+  struct sigutils_channel **new_ptrs;
+  unsigned int i;
+
+  if (count <= sweep->channel_storage)
+    return SU_TRUE;
+
+  SU_TRYCATCH(
+      new_list = realloc(
+          sweep->channel_list,
+          count * sizeof(struct sigutils_channel)),
+      return SU_FALSE);
+  sweep->channel_list = new_list;
+
+  SU_TRYCATCH(
+      new_ptrs = realloc(
+          sweep->channel_ptrs,
+          count * sizeof(struct sigutils_channel *)),
+      return SU_FALSE);
+  sweep->channel_ptrs = new_ptrs;
+
+  for (i = 0; i < count; ++i)
+    sweep->channel_ptrs[i] = sweep->channel_list + i;
+
+  sweep->channel_storage = count;
+
+  return SU_TRUE;
+}
+
+/*
+ * Channels are runs of bins above N0 by SUSCAN_SWEEP_CHANNEL_SNR. Since
+ * steps are already stitched, a channel that spans two steps comes out
+ * as a single one. Frequencies are relative to the sweep center.
+ */
+SUPRIVATE SUBOOL
+suscan_sweep_detect_channels(suscan_sweep_t *sweep)
+{
+  struct sigutils_channel *ch;
+  unsigned int size = suscan_sweep_get_psd_size(sweep);
+  SUFLOAT bin = sweep->samp_rate / sweep->fft_size;
+  SUFLOAT threshold = sweep->N0 * pow(10, SUSCAN_SWEEP_CHANNEL_SNR / 10.);
+  SUFLOAT peak = 0;
+  SUFLOAT value;
+  unsigned int first = 0;
+  unsigned int i;
+  SUBOOL inside = SU_FALSE;
+
+  sweep->channel_count = 0;
+
+  for (i = 0; i <= size; ++i) {
+    /* Lowest frequency first. One past the end closes the last run */
+    value = i < size ? sweep->psd[(i + size / 2) % size] : 0;
+
+    if (value > threshold) {
+      if (!inside) {
+        inside = SU_TRUE;
+        first = i;
+        peak = value;
+      } else if (value > peak) {
+        peak = value;
+      }
+    } else if (inside) {
+      inside = SU_FALSE;
+
+      if (i - first < SUSCAN_SWEEP_CHANNEL_MIN_BINS)
+        continue;
+
+      SU_TRYCATCH(
+          suscan_sweep_assert_channels(sweep, sweep->channel_count + 1),
+          return SU_FALSE);
+
+      ch = sweep->channel_list + sweep->channel_count++;
+      memset(ch, 0, sizeof(struct sigutils_channel));
+
+      ch->f_lo = ((SUFLOAT) first - size / 2) * bin;
+      ch->f_hi = ((SUFLOAT) i - size / 2) * bin;
+      ch->fc   = .5 * (ch->f_lo + ch->f_hi);
+      ch->bw   = ch->f_hi - ch->f_lo;
+      ch->S0   = SU_POWER_DB(peak);
+      ch->N0   = SU_POWER_DB(sweep->N0);
+      ch->snr  = ch->S0 - ch->N0;
+
+      /* Seen in every sweep so far, as far as we know */
+      ch->age     = sweep->sweeps;
+      ch->present = sweep->sweeps;
+    }
+  }
+
+  return SU_TRUE;
+}
+
+/* Average of the step just read goes to its place in the spectrum */
+SUPRIVATE void
+suscan_sweep_stitch(suscan_sweep_t *sweep)
+{
+  unsigned int size = suscan_sweep_get_psd_size(sweep);
+  unsigned int first = suscan_sweep_first_bin(sweep);
+  unsigned int n = sweep->fft_size;
+  unsigned int step = sweep->proc_seq % sweep->step_count;
+  unsigned int i, j, k;
+  SUFLOAT norm;
+
+  if (sweep->accum_ffts == 0)
+    return;
+
+  norm = 1. / ((SUFLOAT) sweep->accum_ffts * n * n);
+
+  /* LO leakage: replace the DC bin by its neighbours */
+  sweep->accum[0] = .5 * (sweep->accum[1] + sweep->accum[n - 1]);
+
+  for (i = 0; i < sweep->step_bins; ++i) {
+    /* Bin of the step (FFT order) and of the stitched spectrum */
+    j = (first + i + n / 2) % n;
+    k = (step * sweep->step_bins + i + size / 2) % size;
+    sweep->psd[k] = sweep->accum[j] * norm;
+  }
+}
+
+SUBOOL
+suscan_sweep_feed(
+    suscan_sweep_t *sweep,
+    unsigned int seq,
+    const SUCOMPLEX *data,
+    SUSCOUNT count,
+    SUBOOL *complete)
+{
+  unsigned int size = sweep->fft_size;
+  unsigned int chunk;
+  unsigned int i;
+
+  *complete = SU_FALSE;
+
+  /* New step: the previous one is done */
+  if (!sweep->proc_started || seq != sweep->proc_seq) {
+    if (sweep->proc_started) {
+      suscan_sweep_stitch(sweep);
+
+      if (sweep->proc_seq % sweep->step_count == sweep->step_count - 1) {
+        ++sweep->sweeps;
+
+        sweep->N0 = sweep->psd[0];
+        for (i = 1; i < suscan_sweep_get_psd_size(sweep); ++i)
+          if (sweep->psd[i] < sweep->N0)
+            sweep->N0 = sweep->psd[i];
+
+        SU_TRYCATCH(suscan_sweep_detect_channels(sweep), return SU_FALSE);
+
+        *complete = SU_TRUE;
+      }
+    }
+
+    memset(sweep->accum, 0, size * sizeof(SUFLOAT));
+    sweep->accum_ffts = 0;
+    sweep->fft_fill = 0;
+    sweep->proc_seq = seq;
+    sweep->proc_started = SU_TRUE;
+  }
+
+  while (count > 0) {
+    chunk = SU_MIN(size - sweep->fft_fill, count);
+
+    for (i = 0; i < chunk; ++i)
+      sweep->fft[sweep->fft_fill + i] =
+          data[i] * sweep->window[sweep->fft_fill + i];
+
+    sweep->fft_fill += chunk;
+    data  += chunk;
+    count -= chunk;
+
+    if (sweep->fft_fill == size) {
+      SU_FFTW(_execute)(sweep->plan);
+
+      for (i = 0; i < size; ++i)
+        sweep->accum[i] += SU_C_REAL(sweep->fft[i] * SU_C_CONJ(sweep->fft[i]));
+
+      ++sweep->accum_ffts;
+      sweep->fft_fill = 0;
+    }
+  }
+
+  return SU_TRUE;
+}
@@ -0,0 +1,134 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SWEEP_H
+#define _SWEEP_H
+
+#include <stdint.h>
+#include <complex.h>
+#include <fftw3.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+/*
+ * Wideband sweep. The tuner is stepped across [freq_min, freq_max], the
+ * averaged power spectrum of every step is kept, and the central part of
+ * each step is stitched into a single spectrum covering the whole band.
+ * Channels are detected on the stitched spectrum.
+ *
+ * There are two sides. The tuner side runs in the thread that reads the
+ * source: it counts samples, drops those read while the tuner settles,
+ * and requests the next frequency as soon as a step has been read, so
+ * the device retunes while the previous step is still being processed.
+ * The processing side runs in the source worker.
+ */
+#define SUSCAN_SWEEP_USABLE_FRACTION .75 /* Central part kept from steps */
+#define SUSCAN_SWEEP_CHANNEL_SNR     6   /* dB over N0 to detect a channel */
+#define SUSCAN_SWEEP_CHANNEL_MIN_BINS 2
+
+struct suscan_sweep_params {
+  uint64_t freq_min;
+  uint64_t freq_max;
+  SUFLOAT  dwell;  /* Seconds of samples averaged per step */
+  SUFLOAT  settle; /* Seconds discarded after every retune */
+};
+
+struct suscan_sweep {
+  struct suscan_sweep_params params;
+  SUFLOAT  samp_rate;
+  unsigned int fft_size;
+  unsigned int step_bins;  /* Bins kept from each step */
+  unsigned int step_count;
+  SUSCOUNT settle_samples;
+  SUSCOUNT dwell_samples;
+
+  /* Tuner side */
+  uint64_t *fc_request;    /* Retune property of the source */
+  unsigned int tune_seq;   /* Steps read so far, step is seq % step_count */
+  SUSCOUNT tune_count;     /* Samples read since the last retune */
+
+  /* Processing side */
+  SUCOMPLEX *fft;
+  SU_FFTW(_plan) plan;
+  SUFLOAT *window;
+  SUFLOAT *accum;          /* Power of the current step, FFT order */
+  unsigned int accum_ffts;
+  unsigned int fft_fill;
+  unsigned int proc_seq;   /* Step being averaged, as tune_seq */
+  SUBOOL proc_started;
+  unsigned int sweeps;     /* Complete sweeps so far */
+
+  SUFLOAT *psd;            /* Stitched spectrum, FFT order */
+  SUFLOAT N0;
+
+  /* Channels of the last complete sweep */
+  struct sigutils_channel *channel_list;
+  struct sigutils_channel **channel_ptrs;
+  unsigned int channel_count;
+  unsigned int channel_storage;
+};
+
+typedef struct suscan_sweep suscan_sweep_t;
+
+suscan_sweep_t *suscan_sweep_new(
+    const struct suscan_sweep_params *params,
+    SUFLOAT samp_rate,
+    unsigned int fft_size,
+    uint64_t *fc_request);
+
+void suscan_sweep_destroy(suscan_sweep_t *sweep);
+
+uint64_t suscan_sweep_get_step_fc(
+    const suscan_sweep_t *sweep,
+    unsigned int step);
+
+/* Center frequency and bandwidth of the stitched spectrum */
+uint64_t suscan_sweep_get_fc(const suscan_sweep_t *sweep);
+
+SUFLOAT suscan_sweep_get_span(const suscan_sweep_t *sweep);
+
+SUINLINE unsigned int
+suscan_sweep_get_psd_size(const suscan_sweep_t *sweep)
+{
+  return sweep->step_count * sweep->step_bins;
+}
+
+/*
+ * Tuner side, after each read of count samples. Returns SU_FALSE if
+ * they were read while settling and must be dropped. Otherwise, *seq
+ * is the sequence number of the step they belong to.
+ */
+SUBOOL suscan_sweep_tuner_advance(
+    suscan_sweep_t *sweep,
+    SUSCOUNT count,
+    unsigned int *seq);
+
+/*
+ * Processing side. *complete is set when the last step of a sweep has
+ * been stitched: the spectrum and the channel list are then up to date.
+ */
+SUBOOL suscan_sweep_feed(
+    suscan_sweep_t *sweep,
+    unsigned int seq,
+    const SUCOMPLEX *data,
+    SUSCOUNT count,
+    SUBOOL *complete);
+
+#endif /* _SWEEP_H */
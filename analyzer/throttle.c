@@ -24,72 +24,74 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <time.h>
+#include <errno.h>
 
 #define SU_LOG_DOMAIN "throttle"
 
 #include <sigutils/sigutils.h>
 #include "throttle.h"
 
+SUINLINE uint64_t
+suscan_throttle_timespec_to_ns(const struct timespec *ts)
+{
+  return ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+SUPRIVATE void
+suscan_throttle_rebase(suscan_throttle_t *throttle)
+{
+  clock_gettime(CLOCK_MONOTONIC, &throttle->t0);
+  throttle->samp_count = 0;
+}
+
 void
 suscan_throttle_init(suscan_throttle_t *throttle, SUSCOUNT samp_rate)
 {
-  throttle->samp_count = 0;
   throttle->samp_rate = samp_rate;
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &throttle->t0);
+  suscan_throttle_set_speed(throttle, 1);
+}
+
+void
+suscan_throttle_set_speed(suscan_throttle_t *throttle, SUFLOAT speed)
+{
+  /* Also catches NaN */
+  if (!(speed >= SUSCAN_THROTTLE_MIN_SPEED))
+    speed = SUSCAN_THROTTLE_MIN_SPEED;
+  else if (speed > SUSCAN_THROTTLE_MAX_SPEED)
+    speed = SUSCAN_THROTTLE_MAX_SPEED;
+
+  throttle->speed = speed;
+  throttle->ns_per_samp = 1e9 / (throttle->samp_rate * (double) speed);
+
+  suscan_throttle_rebase(throttle);
 }
 
 SUSCOUNT
 suscan_throttle_get_portion(suscan_throttle_t *throttle, SUSCOUNT h)
 {
   struct timespec tn;
-  struct timespec sleep_time;
-  struct timespec sub;
-  SUSCOUNT samps;
-  SUSDIFF  nsecs;
-  SUSDIFF  avail;
-
-  if (h > 0) {
-    do {
-      clock_gettime(CLOCK_MONOTONIC_RAW, &tn);
-
-      timespecsub(&tn, &throttle->t0, &sub);
-
-      if (sub.tv_sec > 0) {
-        /* Reader is really late, get a rough estimate */
-        avail = throttle->samp_rate * sub.tv_sec - throttle->samp_count;
-      } else {
-        nsecs = sub.tv_sec * 1000000000ll + sub.tv_nsec;
-        avail = (throttle->samp_rate * nsecs) / 1000000000ll
-            - throttle->samp_count;
-      }
-
-      if (avail == 0) {
-        /*
-         * Stream exhausted. We wait a fraction of the time it would take
-         * for h samples to be available, then we try again.
-         */
-        throttle->samp_count = 0;
-        throttle->t0 = tn;
-
-        samps = SUSCAN_THROTTLE_MAX_READ_UNIT_FRAC * h;
-        nsecs = (samps * 1000000000) / throttle->samp_rate;
-
-        sleep_time.tv_sec  = nsecs / 1000000000;
-        sleep_time.tv_nsec = nsecs % 1000000000;
-
-        (void) nanosleep(&sleep_time, NULL);
-        continue;
-      } else {
-        /* Check to avoid slow readers to overflow the available counter */
-        if (avail > SUSCAN_THROTTLE_RESET_THRESHOLD) {
-          throttle->samp_count = 0;
-          throttle->t0 = tn;
-        }
-
-        h = MIN(avail, h);
-      }
-    } while (SU_FALSE);
+  struct timespec deadline;
+  uint64_t due, now;
+
+  if (h == 0)
+    return 0;
+
+  due = suscan_throttle_timespec_to_ns(&throttle->t0)
+      + (uint64_t) ((throttle->samp_count + h) * throttle->ns_per_samp);
+
+  clock_gettime(CLOCK_MONOTONIC, &tn);
+  now = suscan_throttle_timespec_to_ns(&tn);
+
+  if (now < due) {
+    deadline.tv_sec  = due / 1000000000ull;
+    deadline.tv_nsec = due % 1000000000ull;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+        == EINTR);
+  } else if (now - due > SUSCAN_THROTTLE_MAX_LAG_NS) {
+    /* Stalled (slow consumers, debugger...). Resume from here */
+    suscan_throttle_rebase(throttle);
   }
 
   return h;
@@ -24,16 +24,20 @@
 #include <sigutils/sigutils.h>
 
 /*
- * Throttle reset threshold. If the number of available samples keeps growing,
- * it means that the reader is slower than the declared sample rate. In that
- * case, we just reset t0 and set sample_count to 0.
+ * Replay clock. Read n is released at the absolute time
+ * t0 + samp_count / (samp_rate * speed), so rounding errors and sleep
+ * overshoot never accumulate. A reader that falls behind by more than
+ * SUSCAN_THROTTLE_MAX_LAG_NS rebases t0 instead of bursting to catch up.
  */
-#define SUSCAN_THROTTLE_RESET_THRESHOLD 1000000000ll
-#define SUSCAN_THROTTLE_MAX_READ_UNIT_FRAC .25
+#define SUSCAN_THROTTLE_MAX_LAG_NS 250000000ll
+#define SUSCAN_THROTTLE_MIN_SPEED  .5
+#define SUSCAN_THROTTLE_MAX_SPEED  100.
 
 struct suscan_throttle {
   SUSCOUNT samp_rate;
-  SUSCOUNT samp_count;
+  SUFLOAT  speed;      /* Replay speed, 1 is real time */
+  double   ns_per_samp;
+  SUSCOUNT samp_count; /* Since t0 */
   struct timespec t0;
 };
 
@@ -56,6 +60,10 @@ timespecsub(
 
 void suscan_throttle_init(suscan_throttle_t *throttle, SUSCOUNT samp_rate);
 
+/* Clamped to the supported range. Pacing restarts from now */
+void suscan_throttle_set_speed(suscan_throttle_t *throttle, SUFLOAT speed);
+
+/* Sleeps until the next h samples are due, and returns h */
 SUSCOUNT suscan_throttle_get_portion(suscan_throttle_t *throttle, SUSCOUNT h);
 
 void suscan_throttle_advance(suscan_throttle_t *throttle, SUSCOUNT got);
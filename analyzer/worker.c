@@ -18,6 +18,15 @@
 
 */
 
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "worker"
+
 #include "worker.h"
 
 /*
@@ -61,20 +70,77 @@ suscan_worker_ack_halt(suscan_worker_t *worker)
       worker); /* Inform which worker has just been halted */
 }
 
+/* Tell the worker thread there is something new in mq_in */
 SUPRIVATE void
-suscan_worker_wait_for_halt(suscan_worker_t *worker)
+suscan_worker_notify(suscan_worker_t *worker)
+{
+  __atomic_store_n(&worker->ctl_pending, SU_TRUE, __ATOMIC_RELEASE);
+}
+
+/* Returns SU_FALSE if the worker must halt */
+SUPRIVATE SUBOOL
+suscan_worker_dispatch(suscan_worker_t *worker, struct suscan_msg *msg)
 {
-  uint32_t type;
   struct suscan_worker_callback *cb;
 
-  for (;;) {
-    cb = suscan_mq_read(&worker->mq_in, &type);
-    if (type == SUSCAN_WORKER_MSG_TYPE_HALT) {
-      suscan_worker_ack_halt(worker);
+  switch (msg->type) {
+    case SUSCAN_WORKER_MSG_TYPE_CALLBACK:
+      cb = (struct suscan_worker_callback *) msg->private;
+      if (!(cb->func) (worker->mq_out, worker->private, cb->private)) {
+        /* Callback returns FALSE: remove from message queue */
+        suscan_worker_callback_destroy(cb);
+        suscan_msg_destroy(msg);
+      } else {
+        /* Callback returns TRUE: queue again */
+        suscan_mq_write_msg(&worker->mq_in, msg);
+        suscan_worker_notify(worker);
+      }
       break;
-    }
 
-    suscan_worker_callback_destroy(cb);
+    case SUSCAN_WORKER_MSG_TYPE_PERSISTENT:
+      cb = (struct suscan_worker_callback *) msg->private;
+      suscan_msg_destroy(msg);
+      if (PTR_LIST_APPEND_CHECK(worker->task, cb) == -1) {
+        SU_ERROR("Cannot add persistent task to worker\n");
+        suscan_worker_callback_destroy(cb);
+      }
+      break;
+
+    case SUSCAN_WORKER_MSG_TYPE_HALT:
+      suscan_msg_destroy(msg);
+      return SU_FALSE;
+
+    default:
+      SU_WARNING("Unexpected worker message type #%d\n", msg->type);
+      suscan_msg_destroy(msg); /* Destroy message anyways */
+  }
+
+  return SU_TRUE;
+}
+
+/* Run every persistent task once, dropping those that return SU_FALSE */
+SUPRIVATE void
+suscan_worker_run_tasks(suscan_worker_t *worker)
+{
+  struct suscan_worker_callback *cb;
+  unsigned int i = 0;
+
+  while (i < worker->task_count) {
+    cb = worker->task_list[i];
+
+    if ((cb->func) (worker->mq_out, worker->private, cb->private)) {
+      ++i;
+    } else {
+      suscan_worker_callback_destroy(cb);
+
+      /* Keep the remaining tasks in order */
+      memmove(
+          worker->task_list + i,
+          worker->task_list + i + 1,
+          (worker->task_count - i - 1)
+          * sizeof(struct suscan_worker_callback *));
+      --worker->task_count;
+    }
   }
 }
 
@@ -83,47 +149,30 @@ suscan_worker_thread(void *data)
 {
   suscan_worker_t *worker = (suscan_worker_t *) data;
   struct suscan_msg *msg;
-  struct suscan_worker_callback *cb;
-  SUBOOL halt_acked = SU_FALSE;
 
   for (;;) {
-    /* First read: blocking read of a message */
-    msg = suscan_mq_read_msg(&worker->mq_in);
-    do {
-      switch (msg->type) {
-        case SUSCAN_WORKER_MSG_TYPE_CALLBACK:
-          cb = (struct suscan_worker_callback *) msg->private;
-          if (!(cb->func) (worker->mq_out, worker->private, cb->private)) {
-            /* Callback returns FALSE: remove from message queue */
-            suscan_worker_callback_destroy(cb);
-            suscan_msg_destroy(msg);
-          } else {
-            /* Callback returns TRUE: queue again */
-            suscan_mq_write_msg(&worker->mq_in, msg);
-          }
-          break;
-
-        case SUSCAN_WORKER_MSG_TYPE_HALT:
-          worker->state = SUSCAN_WORKER_STATE_HALTED;
-          halt_acked = SU_TRUE;
-          suscan_msg_destroy(msg);
-          suscan_worker_ack_halt(worker);
-          goto done;
-
-        default:
-          SU_WARNING("Unexpected worker message type #%d\n", msg->type);
-          suscan_msg_destroy(msg); /* Destroy message anyways */
-      }
+    if (worker->task_count == 0) {
+      /* Nothing to run: blocking read of a message */
+      msg = suscan_mq_read_msg(&worker->mq_in);
+      if (!suscan_worker_dispatch(worker, msg))
+        goto halt;
+    }
+
+    /*
+     * Control messages. The flag is cleared before polling, so messages
+     * written while we poll are seen in the next iteration.
+     */
+    if (__atomic_exchange_n(&worker->ctl_pending, SU_FALSE, __ATOMIC_ACQUIRE))
+      while ((msg = suscan_mq_poll_msg(&worker->mq_in)) != NULL)
+        if (!suscan_worker_dispatch(worker, msg))
+          goto halt;
 
-      /* Next reads: until queue is empty */
-    } while ((msg = suscan_mq_poll_msg(&worker->mq_in)) != NULL);
+    suscan_worker_run_tasks(worker);
   }
 
-done:
+halt:
   worker->state = SUSCAN_WORKER_STATE_HALTED;
-
-  if (!halt_acked)
-    suscan_worker_wait_for_halt(worker);
+  suscan_worker_ack_halt(worker);
 
   pthread_exit(NULL);
 
@@ -149,6 +198,35 @@ suscan_worker_push(
     return SU_FALSE;
   }
 
+  suscan_worker_notify(worker);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_worker_push_persistent(
+    suscan_worker_t *worker,
+    SUBOOL (*func) (
+          struct suscan_mq *mq_out,
+          void *worker_private,
+          void *callback_private),
+    void *private)
+{
+  struct suscan_worker_callback *cb;
+
+  if ((cb = suscan_worker_callback_new(func, private)) == NULL)
+    return SU_FALSE;
+
+  if (!suscan_mq_write(
+      &worker->mq_in,
+      SUSCAN_WORKER_MSG_TYPE_PERSISTENT,
+      cb)) {
+    suscan_worker_callback_destroy(cb);
+    return SU_FALSE;
+  }
+
+  suscan_worker_notify(worker);
+
   return SU_TRUE;
 }
 
@@ -159,6 +237,8 @@ suscan_worker_req_halt(suscan_worker_t *worker)
       &worker->mq_in,
       SUSCAN_WORKER_MSG_TYPE_HALT,
       NULL);
+
+  suscan_worker_notify(worker);
 }
 
 SUBOOL
@@ -166,6 +246,7 @@ suscan_worker_destroy(suscan_worker_t *worker)
 {
   void *cb;
   uint32_t type;
+  unsigned int i;
 
   if (worker->state == SUSCAN_WORKER_STATE_RUNNING) {
     SU_ERROR("Cannot destroy worker %p: still running\n", worker);
@@ -180,9 +261,16 @@ suscan_worker_destroy(suscan_worker_t *worker)
 
   /* Thread stopped, pop all messages and release memory */
   while (suscan_mq_poll(&worker->mq_in, &type, &cb))
-    if (type == SUSCAN_WORKER_MSG_TYPE_CALLBACK)
+    if (type == SUSCAN_WORKER_MSG_TYPE_CALLBACK
+        || type == SUSCAN_WORKER_MSG_TYPE_PERSISTENT)
       suscan_worker_callback_destroy((struct suscan_worker_callback *) cb);
 
+  for (i = 0; i < worker->task_count; ++i)
+    suscan_worker_callback_destroy(worker->task_list[i]);
+
+  if (worker->task_list != NULL)
+    free(worker->task_list);
+
   suscan_mq_finalize(&worker->mq_in);
 
   free(worker);
@@ -190,12 +278,38 @@ suscan_worker_destroy(suscan_worker_t *worker)
   return SU_TRUE;
 }
 
+/* Pin thread to the CPUs in cpu_mask, through its creation attributes */
+SUBOOL
+suscan_worker_attr_set_affinity(pthread_attr_t *attr, uint64_t cpu_mask)
+{
+  cpu_set_t set;
+  unsigned int i;
+
+  CPU_ZERO(&set);
+
+  for (i = 0; i < 64; ++i)
+    if (cpu_mask & (1ull << i))
+      CPU_SET(i, &set);
+
+  if (pthread_attr_setaffinity_np(attr, sizeof (cpu_set_t), &set) != 0) {
+    SU_WARNING(
+        "Cannot set worker affinity to 0x%llx\n",
+        (unsigned long long) cpu_mask);
+    return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
 suscan_worker_t *
-suscan_worker_new(
+suscan_worker_new_with_affinity(
     struct suscan_mq *mq_out,
-    void *private)
+    void *private,
+    uint64_t cpu_mask)
 {
   suscan_worker_t *new = NULL;
+  pthread_attr_t attr;
+  SUBOOL attr_init = SU_FALSE;
 
   if ((new = calloc(1, sizeof (suscan_worker_t))) == NULL)
     goto fail;
@@ -204,23 +318,45 @@ suscan_worker_new(
   new->mq_out = mq_out;
   new->private = private;
 
-  if (!suscan_mq_init(&new->mq_in))
+  if (!suscan_mq_init_ring(&new->mq_in, SUSCAN_MQ_DEFAULT_RING_SIZE))
     goto fail;
 
+  if (pthread_attr_init(&attr) != 0)
+    goto fail;
+
+  attr_init = SU_TRUE;
+
+  /* Wrong CPU masks are not fatal: the thread just runs anywhere */
+  if (cpu_mask != 0)
+    (void) suscan_worker_attr_set_affinity(&attr, cpu_mask);
+
   if (pthread_create(
       &new->thread,
-      NULL,
+      &attr,
       suscan_worker_thread,
-      new) == -1)
+      new) != 0)
     goto fail;
 
+  pthread_attr_destroy(&attr);
+
   new->state = SUSCAN_WORKER_STATE_RUNNING;
 
   return new;
 
 fail:
+  if (attr_init)
+    pthread_attr_destroy(&attr);
+
   if (new != NULL)
     suscan_worker_destroy(new);
 
   return NULL;
 }
+
+suscan_worker_t *
+suscan_worker_new(
+    struct suscan_mq *mq_out,
+    void *private)
+{
+  return suscan_worker_new_with_affinity(mq_out, private, 0);
+}
@@ -22,12 +22,15 @@
 #define _WORKER_H
 
 #include <pthread.h>
+#include <stdint.h>
 #include <sigutils/sigutils.h>
+#include <util.h>
 
 #include "mq.h"
 
-#define SUSCAN_WORKER_MSG_TYPE_CALLBACK 0
-#define SUSCAN_WORKER_MSG_TYPE_HALT     0xffffffff
+#define SUSCAN_WORKER_MSG_TYPE_CALLBACK   0
+#define SUSCAN_WORKER_MSG_TYPE_PERSISTENT 1
+#define SUSCAN_WORKER_MSG_TYPE_HALT       0xffffffff
 
 enum suscan_worker_state {
   SUSCAN_WORKER_STATE_CREATED,
@@ -35,25 +38,33 @@ enum suscan_worker_state {
   SUSCAN_WORKER_STATE_HALTED
 };
 
+struct suscan_worker_callback {
+  SUBOOL (*func) (
+      struct suscan_mq *mq_out,
+      void *wk_private,
+      void *cb_private);
+  void *private;
+};
+
 struct suscan_worker {
   struct suscan_mq mq_in; /* Receive callbacks from here */
   struct suscan_mq *mq_out; /* Send callbacks to here */
   void *private; /* Worker private data */
 
+  /*
+   * Persistent tasks run back to back in the worker thread until they
+   * return SU_FALSE. Only the worker thread touches this list. While
+   * there are tasks, mq_in is only polled when ctl_pending is set.
+   */
+  PTR_LIST(struct suscan_worker_callback, task);
+  unsigned int ctl_pending; /* Messages written to mq_in since last poll */
+
   enum suscan_worker_state state;
   pthread_t thread;
 };
 
 typedef struct suscan_worker suscan_worker_t;
 
-struct suscan_worker_callback {
-  SUBOOL (*func) (
-      struct suscan_mq *mq_out,
-      void *wk_private,
-      void *cb_private);
-  void *private;
-};
-
 /******************************* Worker API ***********************************/
 SUBOOL suscan_worker_push(
     suscan_worker_t *worker,
@@ -62,11 +73,32 @@ SUBOOL suscan_worker_push(
         void *wk_private,
         void *cb_private),
     void *private);
+
+/*
+ * Like suscan_worker_push, but the callback is kept in the worker's task
+ * list and called over and over without going through the message queue.
+ */
+SUBOOL suscan_worker_push_persistent(
+    suscan_worker_t *worker,
+    SUBOOL (*func) (
+        struct suscan_mq *mq_out,
+        void *wk_private,
+        void *cb_private),
+    void *private);
+
 void suscan_worker_req_halt(suscan_worker_t *worker);
 SUBOOL suscan_worker_destroy(suscan_worker_t *worker);
 suscan_worker_t *suscan_worker_new(
     struct suscan_mq *mq_out,
     void *private);
 
+/* cpu_mask: bit n set means the worker may run in CPU n. 0 means any CPU */
+suscan_worker_t *suscan_worker_new_with_affinity(
+    struct suscan_mq *mq_out,
+    void *private,
+    uint64_t cpu_mask);
+
+/* Same masks, for helper threads created outside the worker API */
+SUBOOL suscan_worker_attr_set_affinity(pthread_attr_t *attr, uint64_t cpu_mask);
 
 #endif /* _WORKER_H */
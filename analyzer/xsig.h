@@ -21,36 +21,69 @@
 #ifndef _XSIG_H
 #define _XSIG_H
 
+#include <pthread.h>
 #include <sndfile.h>
 #include <sigutils/sigutils.h>
 
+#include "capture.h"
+
+#define XSIG_SOURCE_DEFAULT_PREFETCH 32 /* Windows */
+
 /* Extensible signal source object */
 struct xsig_source;
 
 struct xsig_source_params {
   SUBOOL raw_iq;
+  SUBOOL capture; /* Indexed capture. samp_rate and fc come from it */
   SUBOOL loop;
   unsigned int samp_rate;
   const char *file;
   SUSCOUNT window_size;
+  unsigned int prefetch; /* Windows decoded ahead. 0: decode on acquire */
   uint64_t fc;
+  SUFLOAT start; /* Captures only: seconds to skip when opening */
   void *private;
   void (*onacquire) (struct xsig_source *source, void *private);
 };
 
+/*
+ * With prefetch, a decoder thread fills the window ring ahead of the
+ * reader, looping included. Windows [head, head + queued) are decoded,
+ * and the first of them belongs to the reader once acquired.
+ */
 struct xsig_source {
   struct xsig_source_params params;
   SF_INFO info;
   uint64_t samp_rate;
   uint64_t fc;
   SNDFILE *sf;
+  suscan_capture_t *capture; /* Instead of sf, for captures */
+  uint64_t seek_request; /* Captures: wall clock time (ns) to go to, or 0 */
 
+  /* Current window */
   union {
     SUFLOAT *as_real;
     SUCOMPLEX *as_complex;
   };
 
-  SUSCOUNT avail;
+  SUSCOUNT size;  /* Samples in the current window */
+  SUSCOUNT avail; /* Not consumed yet */
+
+  /* Window ring */
+  SUCOMPLEX **window_list;
+  SUSCOUNT *window_avail;
+  unsigned int window_count;
+  unsigned int head;
+  unsigned int queued;
+  SUBOOL held;     /* Reader holds the window at head */
+  SUBOOL eof;      /* Decoder stopped: end of file or read error */
+  SUBOOL halt;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  SUBOOL thread_running;
+  SUBOOL sync_init;
 };
 
 void xsig_source_destroy(struct xsig_source *source);
@@ -60,5 +93,6 @@ su_block_t *xsig_source_create_block(const struct xsig_source_params *params);
 
 SUBOOL suscan_wav_source_init(void);
 SUBOOL suscan_iqfile_source_init(void);
+SUBOOL suscan_capture_source_init(void);
 
 #endif /* _XSIG_H */
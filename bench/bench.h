@@ -0,0 +1,83 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+#define SUSCAN_BENCH_DEFAULT_SAMPLES  (4 * 1024 * 1024)
+#define SUSCAN_BENCH_DEFAULT_FS       250000
+#define SUSCAN_BENCH_CHUNK_SIZE       4096 /* Like the default source bufsiz */
+#define SUSCAN_BENCH_MAX_THREADS      8
+
+struct suscan_bench_params {
+  SUSCOUNT samples;  /* Samples (or messages) per benchmark */
+  unsigned int threads; /* Largest thread count in multithreaded runs */
+  unsigned int fs;
+};
+
+#define suscan_bench_params_INITIALIZER   \
+{                                         \
+  SUSCAN_BENCH_DEFAULT_SAMPLES, /* samples */ \
+  0, /* threads (0: one per CPU) */       \
+  SUSCAN_BENCH_DEFAULT_FS, /* fs */       \
+}
+
+/* Timing and reporting */
+uint64_t suscan_bench_now_ns(void);
+
+void suscan_bench_report(
+    const char *name,
+    const char *unit,
+    uint64_t count,
+    uint64_t elapsed_ns);
+
+/*
+ * Synthetic test signals. Symbols are drawn from a fixed seed, so runs
+ * are comparable. Rectangular pulses, optional carrier offset (in
+ * normalized frequency) and additive white noise.
+ */
+void suscan_bench_gen_psk(
+    SUCOMPLEX *out,
+    SUSCOUNT count,
+    unsigned int order,
+    SUFLOAT sps,
+    SUFLOAT foff,
+    SUFLOAT noise);
+
+void suscan_bench_gen_fsk(
+    SUCOMPLEX *out,
+    SUSCOUNT count,
+    unsigned int order,
+    SUFLOAT sps,
+    SUFLOAT deviation,
+    SUFLOAT noise);
+
+/* Benchmark suites */
+SUBOOL suscan_bench_detector(const struct suscan_bench_params *params);
+SUBOOL suscan_bench_inspector(const struct suscan_bench_params *params);
+SUBOOL suscan_bench_mq(const struct suscan_bench_params *params);
+SUBOOL suscan_bench_iqconv(const struct suscan_bench_params *params);
+SUBOOL suscan_bench_xsig(const struct suscan_bench_params *params);
+SUBOOL suscan_bench_chanset(const struct suscan_bench_params *params);
+
+#endif /* _BENCH_H */
@@ -0,0 +1,165 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "bench-chanset"
+
+#include <sigutils/sigutils.h>
+
+#include "msg.h"
+#include "chanset.h"
+#include "bench.h"
+
+#define SUSCAN_BENCH_CHANSET_SLOTS    64
+#define SUSCAN_BENCH_CHANSET_SPACING  1000
+#define SUSCAN_BENCH_CHANSET_BW       200
+#define SUSCAN_BENCH_CHANSET_RETUNE   37   /* Updates between retunes */
+#define SUSCAN_BENCH_CHANSET_SEED     0x5c4a
+
+/*
+ * The receiving side must end up with exactly the channels of the last
+ * snapshot, shifted by fc. Every slot is at a fixed frequency, so each
+ * entry can be traced back to its slot.
+ */
+SUPRIVATE SUBOOL
+suscan_bench_chanset_check(
+    const struct suscan_channel_set *set,
+    const struct sigutils_channel *slot,
+    unsigned int present,
+    SUFLOAT fc)
+{
+  unsigned int i;
+  long k;
+
+  if (set->entry_count != present)
+    return SU_FALSE;
+
+  for (i = 0; i < set->entry_count; ++i) {
+    k = SU_FLOOR(
+        (set->entry_list[i].channel.fc - fc)
+        / SUSCAN_BENCH_CHANSET_SPACING + .5) - 1;
+
+    if (k < 0
+        || k >= SUSCAN_BENCH_CHANSET_SLOTS
+        || !SU_CHANNEL_IS_VALID(slot + k))
+      return SU_FALSE;
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Channels come and go and the source retunes every now and then, so
+ * incremental updates, periodic resyncs and retunes all see channels
+ * disappear. Timed from detector snapshot to rebuilt set.
+ */
+SUBOOL
+suscan_bench_chanset(const struct suscan_bench_params *params)
+{
+  struct sigutils_channel slot[SUSCAN_BENCH_CHANSET_SLOTS];
+  struct sigutils_channel *list[SUSCAN_BENCH_CHANSET_SLOTS];
+  struct suscan_channel_tracker tracker;
+  struct suscan_channel_set set;
+  struct suscan_analyzer_channel_msg *msg = NULL;
+  unsigned int seed = SUSCAN_BENCH_CHANSET_SEED;
+  unsigned int present;
+  SUSCOUNT updates, n;
+  SUFLOAT fc = 0;
+  uint64_t start;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  suscan_channel_tracker_init(&tracker);
+  suscan_channel_set_init(&set);
+
+  memset(slot, 0, sizeof(slot));
+  for (i = 0; i < SUSCAN_BENCH_CHANSET_SLOTS; ++i) {
+    slot[i].fc   = (i + 1) * SUSCAN_BENCH_CHANSET_SPACING;
+    slot[i].bw   = SUSCAN_BENCH_CHANSET_BW;
+    slot[i].f_lo = slot[i].fc - .5 * slot[i].bw;
+    slot[i].f_hi = slot[i].fc + .5 * slot[i].bw;
+    list[i] = slot + i;
+  }
+
+  /* Enough to go through a few resyncs */
+  updates = SU_MAX(
+      params->samples / SUSCAN_BENCH_CHUNK_SIZE,
+      4 * SUSCAN_CHANNEL_TRACKER_RESYNC);
+
+  start = suscan_bench_now_ns();
+
+  for (n = 0; n < updates; ++n) {
+    if (n % SUSCAN_BENCH_CHANSET_RETUNE == 0)
+      fc = (n / SUSCAN_BENCH_CHANSET_RETUNE % 2) * 1e6;
+
+    present = 0;
+    for (i = 0; i < SUSCAN_BENCH_CHANSET_SLOTS; ++i) {
+      /* One in eight channels missing, SNR jitter beyond tolerance */
+      slot[i].age = rand_r(&seed) % 8 != 0;
+      slot[i].snr = 10 + (rand_r(&seed) % 4) * .3;
+      present += slot[i].age;
+    }
+
+    SU_TRYCATCH(
+        msg = calloc(1, sizeof(struct suscan_analyzer_channel_msg)),
+        goto done);
+
+    SU_TRYCATCH(
+        suscan_channel_tracker_update(
+            &tracker,
+            list,
+            SUSCAN_BENCH_CHANSET_SLOTS,
+            fc,
+            msg),
+        goto done);
+
+    SU_TRYCATCH(suscan_channel_set_apply(&set, msg), goto done);
+
+    suscan_analyzer_channel_msg_destroy(msg);
+    msg = NULL;
+
+    if (!suscan_bench_chanset_check(&set, slot, present, fc)) {
+      SU_ERROR(
+          "Channel set out of sync after %llu updates\n",
+          (unsigned long long) n + 1);
+      goto done;
+    }
+  }
+
+  suscan_bench_report(
+      "chanset/update",
+      "update",
+      updates,
+      suscan_bench_now_ns() - start);
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_channel_msg_destroy(msg);
+
+  suscan_channel_set_finalize(&set);
+  suscan_channel_tracker_finalize(&tracker);
+
+  return ok;
+}
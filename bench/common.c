@@ -0,0 +1,142 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#include "bench.h"
+
+uint64_t
+suscan_bench_now_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+  return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void
+suscan_bench_report(
+    const char *name,
+    const char *unit,
+    uint64_t count,
+    uint64_t elapsed_ns)
+{
+  if (count == 0 || elapsed_ns == 0) {
+    printf("%-44s (no data)\n", name);
+    return;
+  }
+
+  printf(
+      "%-44s %14.0lf %s/s %10.2lf ns/%s\n",
+      name,
+      1e9 * count / (double) elapsed_ns,
+      unit,
+      elapsed_ns / (double) count,
+      unit);
+  fflush(stdout);
+}
+
+/************************** Synthetic signals ********************************/
+#define SUSCAN_BENCH_SEED 0x5c4a
+
+SUPRIVATE SUFLOAT
+suscan_bench_gaussian(unsigned int *seed)
+{
+  SUFLOAT u, v;
+
+  /* Box-Muller */
+  do
+    u = rand_r(seed) / (SUFLOAT) RAND_MAX;
+  while (u <= 0);
+
+  v = rand_r(seed) / (SUFLOAT) RAND_MAX;
+
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+SUPRIVATE SUCOMPLEX
+suscan_bench_noise(unsigned int *seed, SUFLOAT amplitude)
+{
+  if (amplitude <= 0)
+    return 0;
+
+  return amplitude * M_SQRT1_2 * (
+      suscan_bench_gaussian(seed) + I * suscan_bench_gaussian(seed));
+}
+
+void
+suscan_bench_gen_psk(
+    SUCOMPLEX *out,
+    SUSCOUNT count,
+    unsigned int order,
+    SUFLOAT sps,
+    SUFLOAT foff,
+    SUFLOAT noise)
+{
+  unsigned int seed = SUSCAN_BENCH_SEED;
+  SUCOMPLEX symbol = 1;
+  SUFLOAT next = 0;
+  SUSCOUNT i;
+
+  for (i = 0; i < count; ++i) {
+    if (i >= next) {
+      symbol = SU_C_EXP(I * 2 * M_PI * (rand_r(&seed) % order) / order);
+      next += sps;
+    }
+
+    /* Normalized frequency: 1 is half the sample rate */
+    out[i] = symbol * SU_C_EXP(I * M_PI * foff * i)
+        + suscan_bench_noise(&seed, noise);
+  }
+}
+
+void
+suscan_bench_gen_fsk(
+    SUCOMPLEX *out,
+    SUSCOUNT count,
+    unsigned int order,
+    SUFLOAT sps,
+    SUFLOAT deviation,
+    SUFLOAT noise)
+{
+  unsigned int seed = SUSCAN_BENCH_SEED;
+  SUFLOAT freq = 0;
+  SUFLOAT phase = 0;
+  SUFLOAT next = 0;
+  SUSCOUNT i;
+
+  for (i = 0; i < count; ++i) {
+    if (i >= next) {
+      /* Tones evenly spaced in [-deviation, deviation] */
+      freq = order > 1
+          ? deviation * (2. * (rand_r(&seed) % order) / (order - 1) - 1)
+          : 0;
+      next += sps;
+    }
+
+    /* Continuous phase */
+    phase = fmod(phase + M_PI * freq, 2 * M_PI);
+    out[i] = SU_C_EXP(I * phase) + suscan_bench_noise(&seed, noise);
+  }
+}
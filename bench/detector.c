@@ -0,0 +1,105 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SU_LOG_DOMAIN "bench-detector"
+
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+#include "bench.h"
+
+/*
+ * Feed the channel detector in source-sized chunks, as
+ * suscan_source_wk_cb does.
+ */
+SUPRIVATE SUBOOL
+suscan_bench_detector_run(
+    const char *name,
+    const struct suscan_bench_params *params,
+    const SUCOMPLEX *signal)
+{
+  struct sigutils_channel_detector_params det_params =
+      sigutils_channel_detector_params_INITIALIZER;
+  su_channel_detector_t *detector = NULL;
+  SUSCOUNT i, chunk;
+  uint64_t start;
+  SUBOOL ok = SU_FALSE;
+
+  det_params.mode = SU_CHANNEL_DETECTOR_MODE_DISCOVERY;
+  det_params.samp_rate = params->fs;
+  su_channel_params_adjust(&det_params);
+
+  SU_TRYCATCH(detector = su_channel_detector_new(&det_params), goto done);
+
+  start = suscan_bench_now_ns();
+
+  for (i = 0; i < params->samples; i += chunk) {
+    chunk = SU_MIN(SUSCAN_BENCH_CHUNK_SIZE, params->samples - i);
+    SU_TRYCATCH(
+        su_channel_detector_feed_bulk(detector, signal + i, chunk) == chunk,
+        goto done);
+  }
+
+  suscan_bench_report(
+      name,
+      "sample",
+      params->samples,
+      suscan_bench_now_ns() - start);
+
+  ok = SU_TRUE;
+
+done:
+  if (detector != NULL)
+    su_channel_detector_destroy(detector);
+
+  return ok;
+}
+
+SUBOOL
+suscan_bench_detector(const struct suscan_bench_params *params)
+{
+  SUCOMPLEX *signal = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      signal = malloc(params->samples * sizeof(SUCOMPLEX)),
+      goto done);
+
+  suscan_bench_gen_psk(signal, params->samples, 4, 20, .1, .1);
+  SU_TRYCATCH(
+      suscan_bench_detector_run("detector/discovery/qpsk", params, signal),
+      goto done);
+
+  suscan_bench_gen_fsk(signal, params->samples, 2, 20, .05, .1);
+  SU_TRYCATCH(
+      suscan_bench_detector_run("detector/discovery/2fsk", params, signal),
+      goto done);
+
+  ok = SU_TRUE;
+
+done:
+  if (signal != NULL)
+    free(signal);
+
+  return ok;
+}
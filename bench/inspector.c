@@ -0,0 +1,182 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "bench-inspector"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector.h"
+#include "bench.h"
+
+#define SUSCAN_BENCH_INSPECTOR_SPS     20
+#define SUSCAN_BENCH_INSPECTOR_FOFF    .1
+#define SUSCAN_BENCH_INSPECTOR_SYMBOLS 4096
+
+SUPRIVATE const struct {
+  enum suscan_inspector_carrier_control ctrl;
+  unsigned int order;
+  const char *name;
+} suscan_bench_carrier_modes[] = {
+  {SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL,   4, "manual"},
+  {SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_2, 2, "costas2"},
+  {SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_4, 4, "costas4"},
+  {SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_8, 8, "costas8"},
+};
+
+SUPRIVATE const struct {
+  enum suscan_inspector_baudrate_control ctrl;
+  const char *name;
+} suscan_bench_baud_modes[] = {
+  {SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL,  "manual"},
+  {SUSCAN_INSPECTOR_BAUDRATE_CONTROL_GARDNER, "gardner"},
+};
+
+#define SUSCAN_BENCH_COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+/* Mimics suscan_inspector_process_buffer, minus the message handling */
+SUPRIVATE SUBOOL
+suscan_bench_inspector_run(
+    const char *name,
+    const struct suscan_bench_params *params,
+    const SUCOMPLEX *signal,
+    enum suscan_inspector_carrier_control fc_ctrl,
+    enum suscan_inspector_baudrate_control br_ctrl)
+{
+  suscan_inspector_t *insp = NULL;
+  struct sigutils_channel channel;
+  struct suscan_inspector_params insp_params;
+  SUCOMPLEX *symbols = NULL;
+  unsigned int sym_count;
+  SUSCOUNT i, chunk, left;
+  uint64_t start;
+  int fed;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      symbols = malloc(SUSCAN_BENCH_INSPECTOR_SYMBOLS * sizeof(SUCOMPLEX)),
+      goto done);
+
+  memset(&channel, 0, sizeof(struct sigutils_channel));
+  channel.fc = SU_NORM2ABS_FREQ(params->fs, SUSCAN_BENCH_INSPECTOR_FOFF);
+  channel.bw = 1.5 * params->fs / SUSCAN_BENCH_INSPECTOR_SPS;
+  channel.f_lo = channel.fc - .5 * channel.bw;
+  channel.f_hi = channel.fc + .5 * channel.bw;
+
+  SU_TRYCATCH(insp = suscan_inspector_new(params->fs, &channel), goto done);
+
+  suscan_inspector_params_initialize(&insp_params);
+  insp_params.fc_ctrl = fc_ctrl;
+  insp_params.br_ctrl = br_ctrl;
+  insp_params.baud = (SUFLOAT) params->fs / SUSCAN_BENCH_INSPECTOR_SPS;
+  insp_params.mf_conf = SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL;
+
+  suscan_inspector_request_params(insp, &insp_params);
+
+  start = suscan_bench_now_ns();
+
+  for (i = 0; i < params->samples; i += chunk) {
+    chunk = SU_MIN(SUSCAN_BENCH_CHUNK_SIZE, params->samples - i);
+
+    suscan_inspector_assert_params(insp);
+    suscan_inspector_update_baud_det(insp, chunk);
+
+    for (left = chunk; left > 0; left -= fed)
+      SU_TRYCATCH(
+          (fed = suscan_inspector_feed_bulk_symbols(
+              insp,
+              signal + i + chunk - left,
+              left,
+              symbols,
+              SUSCAN_BENCH_INSPECTOR_SYMBOLS,
+              &sym_count)) >= 0,
+          goto done);
+  }
+
+  suscan_bench_report(
+      name,
+      "sample",
+      params->samples,
+      suscan_bench_now_ns() - start);
+
+  ok = SU_TRUE;
+
+done:
+  if (insp != NULL)
+    suscan_inspector_destroy(insp);
+
+  if (symbols != NULL)
+    free(symbols);
+
+  return ok;
+}
+
+SUBOOL
+suscan_bench_inspector(const struct suscan_bench_params *params)
+{
+  SUCOMPLEX *signal = NULL;
+  char name[64];
+  unsigned int i, j;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      signal = malloc(params->samples * sizeof(SUCOMPLEX)),
+      goto done);
+
+  for (i = 0; i < SUSCAN_BENCH_COUNT(suscan_bench_carrier_modes); ++i) {
+    suscan_bench_gen_psk(
+        signal,
+        params->samples,
+        suscan_bench_carrier_modes[i].order,
+        SUSCAN_BENCH_INSPECTOR_SPS,
+        SUSCAN_BENCH_INSPECTOR_FOFF,
+        .1);
+
+    for (j = 0; j < SUSCAN_BENCH_COUNT(suscan_bench_baud_modes); ++j) {
+      snprintf(
+          name,
+          sizeof(name),
+          "inspector/%upsk/%s/%s",
+          suscan_bench_carrier_modes[i].order,
+          suscan_bench_carrier_modes[i].name,
+          suscan_bench_baud_modes[j].name);
+
+      SU_TRYCATCH(
+          suscan_bench_inspector_run(
+              name,
+              params,
+              signal,
+              suscan_bench_carrier_modes[i].ctrl,
+              suscan_bench_baud_modes[j].ctrl),
+          goto done);
+    }
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (signal != NULL)
+    free(signal);
+
+  return ok;
+}
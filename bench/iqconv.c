@@ -0,0 +1,99 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define SU_LOG_DOMAIN "bench-iqconv"
+
+#include <sigutils/sigutils.h>
+
+#include "sources/iqconv.h"
+#include "bench.h"
+
+SUBOOL
+suscan_bench_iqconv(const struct suscan_bench_params *params)
+{
+  SUCOMPLEX *out = NULL;
+  uint8_t *u8 = NULL;
+  int16_t *s16 = NULL;
+  float *f32 = NULL;
+  unsigned int seed = 1;
+  SUSCOUNT i, chunk;
+  uint64_t start;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(out = malloc(params->samples * sizeof(SUCOMPLEX)), goto done);
+  SU_TRYCATCH(u8 = malloc(params->samples * 2), goto done);
+  SU_TRYCATCH(s16 = malloc(params->samples * 2 * sizeof(int16_t)), goto done);
+  SU_TRYCATCH(f32 = malloc(params->samples * 2 * sizeof(float)), goto done);
+
+  for (i = 0; i < 2 * params->samples; ++i) {
+    u8[i] = rand_r(&seed);
+    s16[i] = (int16_t) (rand_r(&seed) & 0xfff) - 2048; /* 12 bit ADC */
+    f32[i] = s16[i] / 2048.f;
+  }
+
+  /* Per-transfer sized calls, like the RX callbacks */
+#define SUSCAN_BENCH_IQCONV(name, call)                              \
+  start = suscan_bench_now_ns();                                     \
+  for (i = 0; i < params->samples; i += chunk) {                     \
+    chunk = SU_MIN(SUSCAN_BENCH_CHUNK_SIZE, params->samples - i);    \
+    call;                                                            \
+  }                                                                  \
+  suscan_bench_report(                                               \
+      name,                                                          \
+      "sample",                                                      \
+      params->samples,                                               \
+      suscan_bench_now_ns() - start)
+
+  SUSCAN_BENCH_IQCONV(
+      "iqconv/u8 (HackRF)",
+      suscan_iqconv_u8(out + i, u8 + 2 * i, chunk));
+
+  SUSCAN_BENCH_IQCONV(
+      "iqconv/s16 (bladeRF)",
+      suscan_iqconv_s16(out + i, s16 + 2 * i, chunk, 1. / 2048));
+
+  SUSCAN_BENCH_IQCONV(
+      "iqconv/cu8",
+      suscan_iqconv_cu8(out + i, u8 + 2 * i, chunk));
+
+  SUSCAN_BENCH_IQCONV(
+      "iqconv/f32",
+      suscan_iqconv_f32(out + i, f32 + 2 * i, chunk));
+
+#undef SUSCAN_BENCH_IQCONV
+
+  ok = SU_TRUE;
+
+done:
+  if (out != NULL)
+    free(out);
+  if (u8 != NULL)
+    free(u8);
+  if (s16 != NULL)
+    free(s16);
+  if (f32 != NULL)
+    free(f32);
+
+  return ok;
+}
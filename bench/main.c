@@ -0,0 +1,143 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define SU_LOG_DOMAIN "bench"
+
+#include <sigutils/sigutils.h>
+
+#include "bench.h"
+
+SUPRIVATE const struct {
+  const char *name;
+  SUBOOL (*run) (const struct suscan_bench_params *params);
+} suites[] = {
+  {"detector",  suscan_bench_detector},
+  {"inspector", suscan_bench_inspector},
+  {"mq",        suscan_bench_mq},
+  {"iqconv",    suscan_bench_iqconv},
+  {"xsig",      suscan_bench_xsig},
+  {"chanset",   suscan_bench_chanset},
+};
+
+#define SUITE_COUNT (sizeof(suites) / sizeof(suites[0]))
+
+SUPRIVATE struct option long_options[] = {
+    {"samples", required_argument, NULL, 's'},
+    {"threads", required_argument, NULL, 't'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0}
+};
+
+extern int optind;
+
+SUPRIVATE void
+help(const char *argv0)
+{
+  unsigned int i;
+
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "  %s [options] [suite1 [suite2 [...]]]\n\n", argv0);
+  fprintf(stderr, "Microbenchmarks of the suscan hot paths\n\n");
+  fprintf(stderr, "Options:\n\n");
+  fprintf(stderr, "     -s, --samples=N       Samples (or messages) per run\n");
+  fprintf(stderr, "     -t, --threads=N       Max writer threads in mq runs\n");
+  fprintf(stderr, "     -h, --help            This help\n\n");
+  fprintf(stderr, "Suites:");
+  for (i = 0; i < SUITE_COUNT; ++i)
+    fprintf(stderr, " %s", suites[i].name);
+  fprintf(stderr, " (default: all)\n");
+}
+
+SUPRIVATE SUBOOL
+run_suite(const char *name, const struct suscan_bench_params *params)
+{
+  unsigned int i;
+
+  for (i = 0; i < SUITE_COUNT; ++i)
+    if (strcmp(suites[i].name, name) == 0)
+      return (suites[i].run) (params);
+
+  fprintf(stderr, "Unknown suite `%s'\n", name);
+
+  return SU_FALSE;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct suscan_bench_params params = suscan_bench_params_INITIALIZER;
+  unsigned int i;
+  int c;
+  int index;
+
+  while ((c = getopt_long(argc, argv, "s:t:h", long_options, &index)) != -1) {
+    switch (c) {
+      case 's':
+        params.samples = strtoull(optarg, NULL, 0);
+        break;
+
+      case 't':
+        params.threads = atoi(optarg);
+        break;
+
+      case 'h':
+        help(argv[0]);
+        exit(EXIT_SUCCESS);
+        break;
+
+      case '?':
+        help(argv[0]);
+        exit(EXIT_FAILURE);
+        break;
+
+      default:
+        abort();
+    }
+  }
+
+  if (params.samples == 0) {
+    fprintf(stderr, "%s: sample count must be positive\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (!su_lib_init_ex(NULL)) {
+    fprintf(stderr, "%s: failed to initialize sigutils library\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (optind < argc) {
+    for (i = optind; i < argc; ++i)
+      if (!run_suite(argv[i], &params))
+        exit(EXIT_FAILURE);
+  } else {
+    for (i = 0; i < SUITE_COUNT; ++i)
+      if (!(suites[i].run) (&params)) {
+        fprintf(stderr, "%s: suite `%s' failed\n", argv[0], suites[i].name);
+        exit(EXIT_FAILURE);
+      }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define SU_LOG_DOMAIN "bench-mq"
+
+#include <sigutils/sigutils.h>
+
+#include "mq.h"
+#include "bench.h"
+
+struct suscan_bench_mq_producer {
+  struct suscan_mq *mq;
+  SUSCOUNT count;
+  SUBOOL ok;
+};
+
+SUPRIVATE void *
+suscan_bench_mq_producer_thread(void *data)
+{
+  struct suscan_bench_mq_producer *producer =
+      (struct suscan_bench_mq_producer *) data;
+  SUSCOUNT i;
+
+  for (i = 0; i < producer->count; ++i)
+    if (!suscan_mq_write(producer->mq, 0, (void *) (uintptr_t) (i + 1)))
+      return NULL;
+
+  producer->ok = SU_TRUE;
+
+  return NULL;
+}
+
+/* N writers, one reader: the analyzer's mq_out pattern */
+SUPRIVATE SUBOOL
+suscan_bench_mq_run(
+    const struct suscan_bench_params *params,
+    SUBOOL ring,
+    unsigned int threads)
+{
+  struct suscan_mq mq;
+  struct suscan_bench_mq_producer producer[SUSCAN_BENCH_MAX_THREADS];
+  pthread_t thread[SUSCAN_BENCH_MAX_THREADS];
+  unsigned int i, started = 0;
+  SUSCOUNT total, n;
+  uint32_t type;
+  void *private;
+  uint64_t start;
+  char name[64];
+  SUBOOL mq_init = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  if (ring) {
+    SU_TRYCATCH(
+        suscan_mq_init_ring(&mq, SUSCAN_MQ_DEFAULT_RING_SIZE),
+        goto done);
+  } else {
+    SU_TRYCATCH(suscan_mq_init(&mq), goto done);
+  }
+  mq_init = SU_TRUE;
+
+  total = (params->samples / threads) * threads;
+
+  start = suscan_bench_now_ns();
+
+  for (i = 0; i < threads; ++i) {
+    producer[i].mq = &mq;
+    producer[i].count = total / threads;
+    producer[i].ok = SU_FALSE;
+
+    SU_TRYCATCH(
+        pthread_create(
+            &thread[i],
+            NULL,
+            suscan_bench_mq_producer_thread,
+            &producer[i]) == 0,
+        goto done);
+    ++started;
+  }
+
+  for (n = 0; n < total; ++n)
+    (void) suscan_mq_read(&mq, &type);
+
+  snprintf(
+      name,
+      sizeof(name),
+      "mq/%s/%u-writer%s",
+      ring ? "ring" : "locked",
+      threads,
+      threads == 1 ? "" : "s");
+
+  suscan_bench_report(name, "msg", total, suscan_bench_now_ns() - start);
+
+  ok = SU_TRUE;
+
+done:
+  for (i = 0; i < started; ++i) {
+    pthread_join(thread[i], NULL);
+    if (!producer[i].ok)
+      ok = SU_FALSE;
+  }
+
+  if (mq_init) {
+    /* Messages carry no payload, nothing to dispose */
+    while (suscan_mq_poll(&mq, &type, &private))
+      ;
+    suscan_mq_finalize(&mq);
+  }
+
+  return ok;
+}
+
+SUBOOL
+suscan_bench_mq(const struct suscan_bench_params *params)
+{
+  unsigned int max = params->threads;
+  unsigned int threads;
+
+  if (max == 0) {
+    max = sysconf(_SC_NPROCESSORS_ONLN);
+    /* Leave one for the reader */
+    if (max > 1)
+      --max;
+  }
+
+  if (max > SUSCAN_BENCH_MAX_THREADS)
+    max = SUSCAN_BENCH_MAX_THREADS;
+
+  /* Powers of two, and the largest count */
+  for (threads = 1; threads <= max; threads = threads < max
+      ? SU_MIN(threads << 1, max)
+      : max + 1) {
+    SU_TRYCATCH(
+        suscan_bench_mq_run(params, SU_FALSE, threads),
+        return SU_FALSE);
+    SU_TRYCATCH(
+        suscan_bench_mq_run(params, SU_TRUE, threads),
+        return SU_FALSE);
+  }
+
+  return SU_TRUE;
+}
@@ -0,0 +1,194 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SU_LOG_DOMAIN "bench-xsig"
+
+#include <sigutils/sigutils.h>
+
+#include "xsig.h"
+#include "bench.h"
+
+/* Raw little endian float32 IQ, what the iqfile source expects */
+SUPRIVATE SUBOOL
+suscan_bench_xsig_write_capture(
+    const char *path,
+    const struct suscan_bench_params *params)
+{
+  SUCOMPLEX *signal = NULL;
+  float *iq = NULL;
+  FILE *fp = NULL;
+  SUSCOUNT i;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      signal = malloc(params->samples * sizeof(SUCOMPLEX)),
+      goto done);
+  SU_TRYCATCH(iq = malloc(2 * params->samples * sizeof(float)), goto done);
+
+  suscan_bench_gen_psk(signal, params->samples, 2, 20, .1, .1);
+
+  for (i = 0; i < params->samples; ++i) {
+    iq[2 * i]     = SU_C_REAL(signal[i]);
+    iq[2 * i + 1] = SU_C_IMAG(signal[i]);
+  }
+
+  SU_TRYCATCH(fp = fopen(path, "wb"), goto done);
+  SU_TRYCATCH(
+      fwrite(iq, 2 * sizeof(float), params->samples, fp) == params->samples,
+      goto done);
+
+  ok = SU_TRUE;
+
+done:
+  if (fp != NULL)
+    fclose(fp);
+  if (iq != NULL)
+    free(iq);
+  if (signal != NULL)
+    free(signal);
+
+  return ok;
+}
+
+SUPRIVATE SUBOOL
+suscan_bench_xsig_run_direct(
+    const char *path,
+    const struct suscan_bench_params *params)
+{
+  struct xsig_source_params xsig_params;
+  struct xsig_source *source = NULL;
+  uint64_t start, count = 0;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&xsig_params, 0, sizeof(struct xsig_source_params));
+  xsig_params.raw_iq = SU_TRUE;
+  xsig_params.samp_rate = params->fs;
+  xsig_params.file = path;
+  xsig_params.window_size = SUSCAN_BENCH_CHUNK_SIZE;
+
+  SU_TRYCATCH(source = xsig_source_new(&xsig_params), goto done);
+
+  start = suscan_bench_now_ns();
+
+  while (xsig_source_acquire(source))
+    count += source->avail;
+
+  suscan_bench_report(
+      "xsig/iqfile/acquire",
+      "sample",
+      count,
+      suscan_bench_now_ns() - start);
+
+  ok = SU_TRUE;
+
+done:
+  if (source != NULL)
+    xsig_source_destroy(source);
+
+  return ok;
+}
+
+/* Through the block port, as the analyzer reads it */
+SUPRIVATE SUBOOL
+suscan_bench_xsig_run_block(
+    const char *path,
+    const struct suscan_bench_params *params,
+    unsigned int prefetch)
+{
+  struct xsig_source_params xsig_params;
+  su_block_t *block = NULL;
+  su_block_port_t port = su_block_port_INITIALIZER;
+  SUCOMPLEX *buffer = NULL;
+  uint64_t start, count = 0;
+  SUSDIFF got;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&xsig_params, 0, sizeof(struct xsig_source_params));
+  xsig_params.raw_iq = SU_TRUE;
+  xsig_params.samp_rate = params->fs;
+  xsig_params.file = path;
+  xsig_params.window_size = SUSCAN_BENCH_CHUNK_SIZE;
+  xsig_params.prefetch = prefetch;
+
+  SU_TRYCATCH(
+      buffer = malloc(SUSCAN_BENCH_CHUNK_SIZE * sizeof(SUCOMPLEX)),
+      goto done);
+  SU_TRYCATCH(block = xsig_source_create_block(&xsig_params), goto done);
+  SU_TRYCATCH(su_block_port_plug(&port, block, 0), goto done);
+
+  start = suscan_bench_now_ns();
+
+  while ((got = su_block_port_read(
+      &port,
+      buffer,
+      SUSCAN_BENCH_CHUNK_SIZE)) > 0)
+    count += got;
+
+  suscan_bench_report(
+      prefetch > 0 ? "xsig/iqfile/prefetch" : "xsig/iqfile/block",
+      "sample",
+      count,
+      suscan_bench_now_ns() - start);
+
+  ok = SU_TRUE;
+
+done:
+  if (su_block_port_is_plugged(&port))
+    su_block_port_unplug(&port);
+  if (block != NULL)
+    su_block_destroy(block);
+  if (buffer != NULL)
+    free(buffer);
+
+  return ok;
+}
+
+SUBOOL
+suscan_bench_xsig(const struct suscan_bench_params *params)
+{
+  char path[] = "/tmp/suscan-bench-XXXXXX";
+  int fd;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH((fd = mkstemp(path)) != -1, return SU_FALSE);
+  close(fd);
+
+  SU_TRYCATCH(suscan_bench_xsig_write_capture(path, params), goto done);
+
+  /* First pass warms up the page cache, so we measure the reader only */
+  SU_TRYCATCH(suscan_bench_xsig_run_direct(path, params), goto done);
+  SU_TRYCATCH(suscan_bench_xsig_run_direct(path, params), goto done);
+  SU_TRYCATCH(suscan_bench_xsig_run_block(path, params, 0), goto done);
+  SU_TRYCATCH(
+      suscan_bench_xsig_run_block(path, params, XSIG_SOURCE_DEFAULT_PREFETCH),
+      goto done);
+
+  ok = SU_TRUE;
+
+done:
+  unlink(path);
+
+  return ok;
+}
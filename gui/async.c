@@ -23,40 +23,190 @@
 
 #include "gui.h"
 
-/* Asynchronous thread: take messages from analyzer and parse them */
-struct suscan_gui_msg_envelope {
-  struct suscan_gui *gui;
-  uint32_t type;
-  void *private;
-};
+/*************************** Per-frame message batch *************************/
+/*
+ * The async thread does not hand messages to the main loop one by one.
+ * They are accumulated into gui->batch, and a tick callback of the main
+ * window frame clock takes the whole batch at once: everything arrived
+ * during a frame costs one main loop iteration and one redraw per widget.
+ *
+ * Spectrum and channel updates are only meaningful until the next one
+ * arrives, so the batch keeps the latest of each and counts the older
+ * ones as dropped. The tick callback stays installed while messages keep
+ * coming, and removes itself after an empty frame.
+ */
+SUPRIVATE void
+suscan_gui_psd_msg_dispose(gpointer key, gpointer value, gpointer data)
+{
+  suscan_analyzer_dispose_message(SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD, value);
+}
+
+SUBOOL
+suscan_gui_frame_batch_init(struct suscan_gui_frame_batch *batch)
+{
+  memset(batch, 0, sizeof(struct suscan_gui_frame_batch));
+
+  SU_TRYCATCH(
+      batch->insp_psd = g_hash_table_new(g_direct_hash, g_direct_equal),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
 
 void
-suscan_gui_msg_envelope_destroy(struct suscan_gui_msg_envelope *data)
+suscan_gui_frame_batch_finalize(struct suscan_gui_frame_batch *batch)
 {
-  suscan_analyzer_dispose_message(
-      data->type,
-      data->private);
+  unsigned int i;
+
+  for (i = 0; i < batch->queue_count; ++i)
+    suscan_analyzer_dispose_message(
+        batch->queue_list[i].type,
+        batch->queue_list[i].private);
+
+  if (batch->queue_list != NULL)
+    free(batch->queue_list);
+
+  if (batch->psd != NULL)
+    suscan_analyzer_dispose_message(
+        SUSCAN_ANALYZER_MESSAGE_TYPE_PSD,
+        batch->psd);
 
-  free(data);
+  if (batch->insp_psd != NULL) {
+    g_hash_table_foreach(batch->insp_psd, suscan_gui_psd_msg_dispose, NULL);
+    g_hash_table_destroy(batch->insp_psd);
+  }
+
+  memset(batch, 0, sizeof(struct suscan_gui_frame_batch));
+}
+
+SUPRIVATE SUBOOL
+suscan_gui_frame_batch_is_empty(const struct suscan_gui_frame_batch *batch)
+{
+  return batch->queue_count == 0
+      && !batch->channels
+      && batch->psd == NULL
+      && g_hash_table_size(batch->insp_psd) == 0;
 }
 
-struct suscan_gui_msg_envelope *
-suscan_gui_msg_envelope_new(
+SUPRIVATE SUBOOL
+suscan_gui_frame_batch_append(
+    struct suscan_gui_frame_batch *batch,
+    uint32_t type,
+    void *private)
+{
+  struct suscan_gui_batch_entry *tmp;
+  unsigned int alloc;
+
+  if (batch->queue_count == batch->queue_alloc) {
+    alloc = batch->queue_alloc == 0 ? 32 : 2 * batch->queue_alloc;
+
+    SU_TRYCATCH(
+        tmp = realloc(
+            batch->queue_list,
+            alloc * sizeof(struct suscan_gui_batch_entry)),
+        return SU_FALSE);
+
+    batch->queue_list = tmp;
+    batch->queue_alloc = alloc;
+  }
+
+  batch->queue_list[batch->queue_count].type = type;
+  batch->queue_list[batch->queue_count].private = private;
+  ++batch->queue_count;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE gboolean suscan_gui_arm_frame_cb(gpointer user_data);
+
+/*
+ * Adds a message to the current batch. Called from the async thread,
+ * ownership of private is taken in every case.
+ */
+SUPRIVATE void
+suscan_gui_frame_batch_post(
     struct suscan_gui *gui,
     uint32_t type,
     void *private)
 {
-  struct suscan_gui_msg_envelope *new;
+  struct suscan_gui_frame_batch *batch = &gui->batch;
+  struct suscan_analyzer_psd_msg *psd;
+  gpointer key;
+  void *stale = NULL;
+
+  g_mutex_lock(&gui->coalesce_mutex);
+
+  switch (type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+      /* Coalescing may drop this message, but never its delta */
+      if (!suscan_channel_set_apply(
+          &gui->channel_set,
+          (const struct suscan_analyzer_channel_msg *) private))
+        SU_WARNING("Failed to update channel list\n");
+
+      if (batch->channels)
+        ++gui->coalesce_stats.channel_dropped;
+
+      batch->channels = SU_TRUE;
+      stale = private;
+      break;
 
-  SU_TRYCATCH(
-      new = malloc(sizeof (struct suscan_gui_msg_envelope)),
-      return NULL);
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+      if ((stale = batch->psd) != NULL)
+        ++gui->coalesce_stats.psd_dropped;
+
+      batch->psd = (struct suscan_analyzer_psd_msg *) private;
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
+      psd = (struct suscan_analyzer_psd_msg *) private;
+      key = GUINT_TO_POINTER(psd->inspector_id);
+
+      if ((stale = g_hash_table_lookup(batch->insp_psd, key)) != NULL)
+        ++gui->coalesce_stats.insp_psd_dropped;
+
+      g_hash_table_insert(batch->insp_psd, key, psd);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      /* Main window not drawing: don't pile up sample batches forever */
+      if (batch->sample_count >= SUSCAN_GUI_FRAME_BATCH_MAX_SAMPLES) {
+        ++gui->coalesce_stats.samples_dropped;
+        stale = private;
+        break;
+      }
+
+      if (!suscan_gui_frame_batch_append(batch, type, private))
+        stale = private;
+      else
+        ++batch->sample_count;
+      break;
+
+    default:
+      if (!suscan_gui_frame_batch_append(batch, type, private))
+        stale = private;
+  }
+
+  /* Tick callbacks can only be added from the main thread */
+  if (!batch->armed) {
+    batch->armed = SU_TRUE;
+    gui->arm_source_id = g_idle_add(suscan_gui_arm_frame_cb, gui);
+  }
 
-  new->gui = gui;
-  new->private = private;
-  new->type = type;
+  g_mutex_unlock(&gui->coalesce_mutex);
 
-  return new;
+  if (stale != NULL)
+    suscan_analyzer_dispose_message(type, stale);
+}
+
+void
+suscan_gui_get_coalesce_stats(
+    struct suscan_gui *gui,
+    struct suscan_gui_coalesce_stats *stats)
+{
+  g_mutex_lock(&gui->coalesce_mutex);
+  *stats = gui->coalesce_stats;
+  g_mutex_unlock(&gui->coalesce_mutex);
 }
 
 /************************** Update GUI state *********************************/
@@ -152,6 +302,9 @@ suscan_async_stopped_cb(gpointer user_data)
   g_thread_join(gui->async_thread);
   gui->async_thread = NULL;
 
+  /* Whatever the last frame did not take still refers to this analyzer */
+  suscan_gui_flush_frame_batch(gui);
+
   /* Destroy all inspectors */
   for (i = 0; i < gui->inspector_count; ++i)
     if (gui->inspector_list[i] != NULL)
@@ -192,32 +345,27 @@ suscan_async_stopped_cb(gpointer user_data)
   return G_SOURCE_REMOVE;
 }
 
-SUPRIVATE gboolean
-suscan_async_update_channels_cb(gpointer user_data)
+/* Takes ownership of channel_list */
+SUPRIVATE void
+suscan_async_update_channels(
+    struct suscan_gui *gui,
+    struct sigutils_channel **channel_list,
+    unsigned int channel_count)
 {
-  struct suscan_gui_msg_envelope *envelope;
-  PTR_LIST(struct sigutils_channel, channel);
   SUFLOAT cpu;
   char cpu_str[10];
   unsigned int i;
   GtkTreeIter new_element;
 
-  envelope = (struct suscan_gui_msg_envelope *) user_data;
-
-  cpu = envelope->gui->analyzer->cpu_usage;
+  cpu = gui->analyzer->cpu_usage;
 
   snprintf(cpu_str, sizeof(cpu_str), "%.1lf%%", cpu * 100);
 
-  gtk_label_set_text(envelope->gui->cpuLabel, cpu_str);
-  gtk_level_bar_set_value(envelope->gui->cpuLevelBar, cpu);
+  gtk_label_set_text(gui->cpuLabel, cpu_str);
+  gtk_level_bar_set_value(gui->cpuLevelBar, cpu);
 
-  /* Move channel list to GUI */
-  suscan_analyzer_channel_msg_take_channels(
-      (struct suscan_analyzer_channel_msg *) envelope->private,
-      &channel_list,
-      &channel_count);
   suscan_gui_spectrum_update_channels(
-      &envelope->gui->main_spectrum,
+      &gui->main_spectrum,
       channel_list,
       channel_count);
 
@@ -225,13 +373,13 @@ suscan_async_update_channels_cb(gpointer user_data)
     channel_count = SUSCAN_GUI_MAX_CHANNELS;
 
   /* Update channel list */
-  gtk_list_store_clear(envelope->gui->channelListStore);
+  gtk_list_store_clear(gui->channelListStore);
   for (i = 0; i < channel_count; ++i) {
     gtk_list_store_append(
-        envelope->gui->channelListStore,
+        gui->channelListStore,
         &new_element);
     gtk_list_store_set(
-        envelope->gui->channelListStore,
+        gui->channelListStore,
         &new_element,
         0, channel_list[i]->fc,
         1, channel_list[i]->snr,
@@ -240,98 +388,68 @@ suscan_async_update_channels_cb(gpointer user_data)
         4, channel_list[i]->bw,
         -1);
   }
-
-  suscan_gui_msg_envelope_destroy(envelope);
-
-  return G_SOURCE_REMOVE;
 }
 
-SUPRIVATE gboolean
-suscan_async_update_main_spectrum_cb(gpointer user_data)
+SUPRIVATE void
+suscan_async_update_main_spectrum(
+    struct suscan_gui *gui,
+    struct suscan_analyzer_psd_msg *msg)
 {
-  struct suscan_gui_msg_envelope *envelope;
-  struct suscan_analyzer_psd_msg *msg;
   char N0_str[20];
 
-  envelope = (struct suscan_gui_msg_envelope *) user_data;
-
-  msg = (struct suscan_analyzer_psd_msg *) envelope->private;
-
   snprintf(N0_str, sizeof(N0_str), "%.1lf dBFS", SU_POWER_DB(msg->N0));
 
-  gtk_label_set_text(envelope->gui->n0Label, N0_str);
+  gtk_label_set_text(gui->n0Label, N0_str);
   gtk_level_bar_set_value(
-      envelope->gui->n0LevelBar,
+      gui->n0LevelBar,
       1e-2 * (SU_POWER_DB(msg->N0) + 100));
 
   suscan_gui_spectrum_update(
-      &envelope->gui->main_spectrum,
+      &gui->main_spectrum,
       msg);
-
-  suscan_gui_msg_envelope_destroy(envelope);
-
-  return G_SOURCE_REMOVE;
 }
 
-SUPRIVATE gboolean
-suscan_async_update_inspector_spectrum_cb(gpointer user_data)
+SUPRIVATE void
+suscan_async_update_inspector_spectrum(
+    struct suscan_gui *gui,
+    struct suscan_analyzer_psd_msg *msg)
 {
-  struct suscan_gui_msg_envelope *envelope;
-  struct suscan_analyzer_psd_msg *msg;
   struct suscan_gui_inspector *insp = NULL;
 
-  envelope = (struct suscan_gui_msg_envelope *) user_data;
-  msg = (struct suscan_analyzer_psd_msg *) envelope->private;
-
   SU_TRYCATCH(
-      insp = suscan_gui_get_inspector(envelope->gui, msg->inspector_id),
-      goto done);
+      insp = suscan_gui_get_inspector(gui, msg->inspector_id),
+      return);
 
   msg->fc = 0; /* Frequency reference is wrt channel's carrier */
 
   suscan_gui_spectrum_update(
       &insp->spectrum,
       msg);
-
-done:
-  suscan_gui_msg_envelope_destroy(envelope);
-
-  return G_SOURCE_REMOVE;
 }
 
-SUPRIVATE gboolean
-suscan_async_parse_sample_batch_msg(gpointer user_data)
+SUPRIVATE void
+suscan_async_parse_sample_batch_msg(
+    struct suscan_gui *gui,
+    struct suscan_analyzer_sample_batch_msg *msg)
 {
-  struct suscan_gui_msg_envelope *envelope;
-  struct suscan_analyzer_sample_batch_msg *msg;
   struct suscan_gui_inspector *insp = NULL;
 
-  envelope = (struct suscan_gui_msg_envelope *) user_data;
-  msg = (struct suscan_analyzer_sample_batch_msg *) envelope->private;
-
   SU_TRYCATCH(
-      insp = suscan_gui_get_inspector(envelope->gui, msg->inspector_id),
-      goto done);
+      insp = suscan_gui_get_inspector(gui, msg->inspector_id),
+      return);
 
   /* Append all these samples to the inspector GUI */
   suscan_gui_inspector_feed_w_batch(insp, msg);
-
-done:
-  suscan_gui_msg_envelope_destroy(envelope);
-
-  return G_SOURCE_REMOVE;
 }
 
-SUPRIVATE gboolean
-suscan_async_parse_inspector_msg(gpointer user_data)
+SUPRIVATE void
+suscan_async_parse_inspector_msg(
+    struct suscan_gui *gui,
+    struct suscan_analyzer_inspector_msg *msg)
 {
-  struct suscan_gui_msg_envelope *envelope;
-  struct suscan_analyzer_inspector_msg *msg;
   struct suscan_gui_inspector *new_insp = NULL;
   struct suscan_gui_inspector *insp = NULL;
   char text[64];
-  envelope = (struct suscan_gui_msg_envelope *) user_data;
-  msg = (struct suscan_analyzer_inspector_msg *) envelope->private;
 
   /* Analyze inspector message type */
   switch (msg->kind) {
@@ -344,9 +462,7 @@ suscan_async_parse_inspector_msg(gpointer user_data)
           goto done);
 
       SU_TRYCATCH(
-          suscan_gui_add_inspector(
-              envelope->gui,
-              new_insp),
+          suscan_gui_add_inspector(gui, new_insp),
           goto done);
 
       /* TODO: Set params */
@@ -355,7 +471,7 @@ suscan_async_parse_inspector_msg(gpointer user_data)
 
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO:
       SU_TRYCATCH(
-          insp = suscan_gui_get_inspector(envelope->gui, msg->inspector_id),
+          insp = suscan_gui_get_inspector(gui, msg->inspector_id),
           goto done);
 
       if (msg->req_id == 0) {
@@ -375,7 +491,7 @@ suscan_async_parse_inspector_msg(gpointer user_data)
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_INSP_PARAMS:
       /* TODO: update GUI according to params */
       SU_TRYCATCH(
-          insp = suscan_gui_get_inspector(envelope->gui, msg->inspector_id),
+          insp = suscan_gui_get_inspector(gui, msg->inspector_id),
           goto done);
       SU_TRYCATCH(
           suscan_gui_inspector_update_sensitiveness(insp, &msg->insp_params),
@@ -384,10 +500,10 @@ suscan_async_parse_inspector_msg(gpointer user_data)
 
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE:
       SU_TRYCATCH(
-          insp = suscan_gui_get_inspector(envelope->gui, msg->inspector_id),
+          insp = suscan_gui_get_inspector(gui, msg->inspector_id),
           goto done);
       SU_TRYCATCH(
-          suscan_gui_remove_inspector(envelope->gui, insp),
+          suscan_gui_remove_inspector(gui, insp),
           goto done);
 
       new_insp = insp; /* To be deleted at cleanup */
@@ -396,14 +512,14 @@ suscan_async_parse_inspector_msg(gpointer user_data)
 
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE:
       suscan_error(
-          envelope->gui,
+          gui,
           "Suscan inspector",
           "Invalid inspector handle passed");
       break;
 
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND:
       suscan_error(
-          envelope->gui,
+          gui,
           "Suscan inspector",
           "Invalid command passed to inspector");
       break;
@@ -416,16 +532,175 @@ done:
   if (new_insp != NULL)
     suscan_gui_inspector_destroy(new_insp);
 
-  suscan_gui_msg_envelope_destroy(envelope);
+}
+
+/************************** Frame batch dispatch *****************************/
+SUPRIVATE void
+suscan_async_dispatch_entry(
+    struct suscan_gui *gui,
+    const struct suscan_gui_batch_entry *entry)
+{
+  switch (entry->type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      suscan_async_parse_inspector_msg(gui, entry->private);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      suscan_async_parse_sample_batch_msg(gui, entry->private);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_OVERVIEW:
+      suscan_gui_spectrum_load_overview(&gui->main_spectrum, entry->private);
+      break;
+  }
+
+  suscan_analyzer_dispose_message(entry->type, entry->private);
+}
+
+SUPRIVATE void
+suscan_async_dispatch_insp_psd(gpointer key, gpointer value, gpointer data)
+{
+  struct suscan_gui *gui = (struct suscan_gui *) data;
+
+  suscan_async_update_inspector_spectrum(gui, value);
+  suscan_gui_psd_msg_dispose(key, value, NULL);
+}
+
+/*
+ * Takes the current batch and handles everything in it. Returns SU_FALSE
+ * if the batch was empty, in which case it is disarmed.
+ */
+SUPRIVATE SUBOOL
+suscan_gui_dispatch_frame_batch(struct suscan_gui *gui)
+{
+  struct suscan_gui_frame_batch *batch = &gui->spare_batch;
+  struct suscan_gui_frame_batch tmp;
+  PTR_LIST(struct sigutils_channel, channel);
+  SUBOOL empty;
+  unsigned int i;
+
+  /* The async thread keeps posting into the other one meanwhile */
+  g_mutex_lock(&gui->coalesce_mutex);
+
+  tmp = gui->batch;
+  gui->batch = *batch;
+  gui->batch.armed = tmp.armed;
+  *batch = tmp;
+
+  if ((empty = suscan_gui_frame_batch_is_empty(batch)))
+    gui->batch.armed = SU_FALSE;
+
+  /* Deltas were applied by the async thread. Give the GUI a copy */
+  if (!batch->channels || !suscan_channel_set_snapshot(
+      &gui->channel_set,
+      &channel_list,
+      &channel_count)) {
+    channel_list = NULL;
+    channel_count = 0;
+  }
+
+  g_mutex_unlock(&gui->coalesce_mutex);
+
+  if (empty)
+    return SU_FALSE;
+
+  /* Ordered messages first: inspectors may be opened or closed here */
+  for (i = 0; i < batch->queue_count; ++i)
+    suscan_async_dispatch_entry(gui, batch->queue_list + i);
+
+  if (batch->channels)
+    suscan_async_update_channels(gui, channel_list, channel_count);
+
+  if (batch->psd != NULL) {
+    suscan_async_update_main_spectrum(gui, batch->psd);
+    suscan_analyzer_dispose_message(
+        SUSCAN_ANALYZER_MESSAGE_TYPE_PSD,
+        batch->psd);
+  }
+
+  g_hash_table_foreach(batch->insp_psd, suscan_async_dispatch_insp_psd, gui);
+  g_hash_table_remove_all(batch->insp_psd);
+
+  batch->queue_count = 0;
+  batch->sample_count = 0;
+  batch->channels = SU_FALSE;
+  batch->psd = NULL;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE gboolean
+suscan_gui_frame_tick_cb(
+    GtkWidget *widget,
+    GdkFrameClock *clock,
+    gpointer user_data)
+{
+  struct suscan_gui *gui = (struct suscan_gui *) user_data;
+
+  if (suscan_gui_dispatch_frame_batch(gui))
+    return G_SOURCE_CONTINUE;
+
+  gui->frame_tick_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+SUPRIVATE gboolean
+suscan_gui_arm_frame_cb(gpointer user_data)
+{
+  struct suscan_gui *gui = (struct suscan_gui *) user_data;
+
+  g_mutex_lock(&gui->coalesce_mutex);
+  gui->arm_source_id = 0;
+  g_mutex_unlock(&gui->coalesce_mutex);
+
+  if (gui->frame_tick_id != 0)
+    return G_SOURCE_REMOVE;
+
+  /* An unmapped window has no frame clock ticking */
+  if (!gtk_widget_get_mapped(GTK_WIDGET(gui->main))) {
+    suscan_gui_flush_frame_batch(gui);
+    return G_SOURCE_REMOVE;
+  }
+
+  gui->frame_tick_id = gtk_widget_add_tick_callback(
+      GTK_WIDGET(gui->main),
+      suscan_gui_frame_tick_cb,
+      gui,
+      NULL);
 
   return G_SOURCE_REMOVE;
 }
 
+void
+suscan_gui_flush_frame_batch(struct suscan_gui *gui)
+{
+  (void) suscan_gui_dispatch_frame_batch(gui);
+
+  if (gui->frame_tick_id != 0) {
+    gtk_widget_remove_tick_callback(
+        GTK_WIDGET(gui->main),
+        gui->frame_tick_id);
+    gui->frame_tick_id = 0;
+  }
+
+  /* No tick anymore: whatever arrived meanwhile needs a new callback */
+  g_mutex_lock(&gui->coalesce_mutex);
+  if (gui->arm_source_id == 0) {
+    if (suscan_gui_frame_batch_is_empty(&gui->batch))
+      gui->batch.armed = SU_FALSE;
+    else if (gui->batch.armed)
+      gui->arm_source_id = g_idle_add(suscan_gui_arm_frame_cb, gui);
+  }
+  g_mutex_unlock(&gui->coalesce_mutex);
+}
+
 SUPRIVATE gpointer
 suscan_gui_async_thread(gpointer data)
 {
   struct suscan_gui *gui = (struct suscan_gui *) data;
-  struct suscan_gui_msg_envelope *envelope;
+  struct suscan_gui_coalesce_stats stats;
+  struct suscan_analyzer_samples_lost_msg *lost_msg;
   void *private;
   uint32_t type;
 
@@ -439,63 +714,21 @@ suscan_gui_async_thread(gpointer data)
         goto done;
 
       case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
-        if ((envelope = suscan_gui_msg_envelope_new(
-            gui,
-            type,
-            private)) == NULL) {
-          suscan_analyzer_dispose_message(type, private);
-          break;
-        }
-
-        g_idle_add(suscan_async_update_channels_cb, envelope);
-        break;
-
       case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
-        if ((envelope = suscan_gui_msg_envelope_new(
-            gui,
-            type,
-            private)) == NULL) {
-          suscan_analyzer_dispose_message(type, private);
-          break;
-        }
-
-        g_idle_add(suscan_async_update_main_spectrum_cb, envelope);
-        break;
-
       case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
-        if ((envelope = suscan_gui_msg_envelope_new(
-            gui,
-            type,
-            private)) == NULL) {
-          suscan_analyzer_dispose_message(type, private);
-          break;
-        }
-
-        g_idle_add(suscan_async_parse_inspector_msg, envelope);
-        break;
-
       case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
-        if ((envelope = suscan_gui_msg_envelope_new(
-            gui,
-            type,
-            private)) == NULL) {
-          suscan_analyzer_dispose_message(type, private);
-          break;
-        }
-
-        g_idle_add(suscan_async_parse_sample_batch_msg, envelope);
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_OVERVIEW:
+        suscan_gui_frame_batch_post(gui, type, private);
         break;
 
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_INSP_PSD:
-        if ((envelope = suscan_gui_msg_envelope_new(
-            gui,
-            type,
-            private)) == NULL) {
-          suscan_analyzer_dispose_message(type, private);
-          break;
-        }
-
-        g_idle_add(suscan_async_update_inspector_spectrum_cb, envelope);
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+        lost_msg = (struct suscan_analyzer_samples_lost_msg *) private;
+        SU_WARNING(
+            "Source overrun: %llu samples lost (%llu so far)\n",
+            (unsigned long long) lost_msg->lost,
+            (unsigned long long) lost_msg->total);
+        suscan_analyzer_dispose_message(type, private);
         break;
 
       case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS: /* End of stream */
@@ -509,6 +742,21 @@ suscan_gui_async_thread(gpointer data)
   }
 
 done:
+  suscan_gui_get_coalesce_stats(gui, &stats);
+
+  if (stats.channel_dropped + stats.psd_dropped + stats.insp_psd_dropped > 0)
+    SU_INFO(
+        "Stale updates coalesced so far: %llu channel, %llu spectrum, "
+        "%llu inspector spectrum\n",
+        (unsigned long long) stats.channel_dropped,
+        (unsigned long long) stats.psd_dropped,
+        (unsigned long long) stats.insp_psd_dropped);
+
+  if (stats.samples_dropped > 0)
+    SU_WARNING(
+        "%llu sample batches dropped while the window was not drawing\n",
+        (unsigned long long) stats.samples_dropped);
+
   return NULL;
 }
 
@@ -533,6 +781,9 @@ suscan_gui_connect(struct suscan_gui *gui)
         "Existing inspectors",
         "The opened inspector tabs will remain in idle state");
 
+  /* Channels of the previous analyzer are meaningless now */
+  suscan_channel_set_clear(&gui->channel_set);
+
   if ((gui->analyzer = suscan_analyzer_new(
       &gui->analyzer_params,
       gui->analyzer_source_config,
@@ -21,8 +21,11 @@
 #include "gui.h"
 
 #include <string.h>
+#include <math.h>
 #include <sigutils/agc.h>
 
+#include "gradient.h"
+
 #define SUSCAN_CONSTELLATION_TO_SCR_X(cons, x) \
   (.5 * ((x) + 1.) * (cons)->width)
 
@@ -55,6 +58,26 @@ suscan_gui_constellation_init(struct suscan_gui_constellation *constellation)
   memset(constellation, 0, sizeof(struct suscan_gui_constellation));
 
   constellation->phase = 1.; /* Zero phase */
+  constellation->density_weight = 1.;
+}
+
+void
+suscan_gui_constellation_finalize(
+    struct suscan_gui_constellation *constellation)
+{
+  if (constellation->surface != NULL)
+    cairo_surface_destroy(constellation->surface);
+
+  if (constellation->density_surface != NULL)
+    cairo_surface_destroy(constellation->density_surface);
+}
+
+void
+suscan_gui_constellation_set_mode(
+    struct suscan_gui_constellation *constellation,
+    enum suscan_gui_constellation_mode mode)
+{
+  constellation->mode = mode;
 }
 
 void
@@ -87,6 +110,133 @@ suscan_gui_constellation_push_sample(
     constellation->p = 0;
 }
 
+SUPRIVATE void
+suscan_gui_constellation_bin_samples(
+    struct suscan_gui_constellation *constellation,
+    const SUCOMPLEX *samples,
+    unsigned int count)
+{
+  unsigned int i;
+  unsigned int j;
+  int col, row;
+  SUCOMPLEX x;
+
+  /* Older symbols fade out with the number of symbols received */
+  constellation->density_weight *=
+      exp((SUFLOAT) count / SUSCAN_GUI_CONSTELLATION_PERSISTENCE);
+
+  if (constellation->density_weight
+      > SUSCAN_GUI_CONSTELLATION_DENSITY_RENORMALIZE) {
+    for (i = 0; i < SUSCAN_GUI_CONSTELLATION_GRID; ++i)
+      for (j = 0; j < SUSCAN_GUI_CONSTELLATION_GRID; ++j)
+        constellation->density[i][j] /= constellation->density_weight;
+
+    constellation->density_weight = 1.;
+  }
+
+  for (i = 0; i < count; ++i) {
+    x = samples[i] * constellation->phase;
+
+    col = .5 * (SU_C_REAL(x) + 1) * SUSCAN_GUI_CONSTELLATION_GRID;
+    row = .5 * (1 - SU_C_IMAG(x)) * SUSCAN_GUI_CONSTELLATION_GRID;
+
+    if (col >= 0 && col < SUSCAN_GUI_CONSTELLATION_GRID
+        && row >= 0 && row < SUSCAN_GUI_CONSTELLATION_GRID)
+      constellation->density[row][col] += constellation->density_weight;
+  }
+}
+
+void
+suscan_gui_constellation_push_batch(
+    struct suscan_gui_constellation *constellation,
+    const struct suscan_analyzer_sample_batch_msg *msg)
+{
+  const SUCOMPLEX *samples;
+  unsigned int count;
+  unsigned int chunk;
+
+  suscan_gui_constellation_bin_samples(
+      constellation,
+      msg->samples,
+      msg->sample_count);
+
+  /* Only the last SUSCAN_GUI_CONSTELLATION_HISTORY will ever be shown */
+  count = MIN(msg->sample_count, SUSCAN_GUI_CONSTELLATION_HISTORY);
+  samples = msg->samples + msg->sample_count - count;
+
+  while (count > 0) {
+    chunk = MIN(count, SUSCAN_GUI_CONSTELLATION_HISTORY - constellation->p);
+
+    memcpy(
+        constellation->history + constellation->p,
+        samples,
+        chunk * sizeof(SUCOMPLEX));
+
+    constellation->p += chunk;
+    if (constellation->p == SUSCAN_GUI_CONSTELLATION_HISTORY)
+      constellation->p = 0;
+
+    samples += chunk;
+    count   -= chunk;
+  }
+}
+
+/*
+ * Render the density grid to its own small image. Its cost only depends
+ * on the grid size, the symbol rate does not matter.
+ */
+SUPRIVATE SUBOOL
+suscan_gui_constellation_render_density(
+    struct suscan_gui_constellation *constellation)
+{
+  uint32_t *pixels;
+  unsigned char *data;
+  int stride;
+  unsigned int i, j;
+  int index;
+  SUFLOAT max = 0;
+  SUFLOAT k;
+
+  if (constellation->density_surface == NULL)
+    SU_TRYCATCH(
+        constellation->density_surface = cairo_image_surface_create(
+            CAIRO_FORMAT_RGB24,
+            SUSCAN_GUI_CONSTELLATION_GRID,
+            SUSCAN_GUI_CONSTELLATION_GRID),
+        return SU_FALSE);
+
+  for (i = 0; i < SUSCAN_GUI_CONSTELLATION_GRID; ++i)
+    for (j = 0; j < SUSCAN_GUI_CONSTELLATION_GRID; ++j)
+      if (constellation->density[i][j] > max)
+        max = constellation->density[i][j];
+
+  /* Logarithmic scale, so that sparse transitions are still visible */
+  k = max > 0 ? 255. / log(1 + max) : 0;
+
+  cairo_surface_flush(constellation->density_surface);
+  data   = cairo_image_surface_get_data(constellation->density_surface);
+  stride = cairo_image_surface_get_stride(constellation->density_surface);
+
+  for (i = 0; i < SUSCAN_GUI_CONSTELLATION_GRID; ++i) {
+    pixels = (uint32_t *) (data + i * stride);
+
+    for (j = 0; j < SUSCAN_GUI_CONSTELLATION_GRID; ++j) {
+      index = k * log(1 + constellation->density[i][j]);
+      if (index > 255)
+        index = 255;
+
+      pixels[j] =
+            ((uint32_t) (wf_gradient[index][0] * 255) << 16)
+          | ((uint32_t) (wf_gradient[index][1] * 255) << 8)
+          |  (uint32_t) (wf_gradient[index][2] * 255);
+    }
+  }
+
+  cairo_surface_mark_dirty(constellation->density_surface);
+
+  return SU_TRUE;
+}
+
 void
 suscan_gui_constellation_redraw(
     struct suscan_gui_constellation *constellation,
@@ -101,6 +251,19 @@ suscan_gui_constellation_redraw(
   /* Paint in black */
   cairo_paint(cr);
 
+  if (constellation->mode == SUSCAN_GUI_CONSTELLATION_MODE_DENSITY
+      && suscan_gui_constellation_render_density(constellation)) {
+    cairo_save(cr);
+    cairo_scale(
+        cr,
+        (double) constellation->width / SUSCAN_GUI_CONSTELLATION_GRID,
+        (double) constellation->height / SUSCAN_GUI_CONSTELLATION_GRID);
+    cairo_set_source_surface(cr, constellation->density_surface, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+    cairo_paint(cr);
+    cairo_restore(cr);
+  }
+
   cairo_set_line_width(cr, 1);
 
   /* Draw axes */
@@ -128,6 +291,9 @@ suscan_gui_constellation_redraw(
 
   cairo_stroke(cr);
 
+  if (constellation->mode == SUSCAN_GUI_CONSTELLATION_MODE_DENSITY)
+    return;
+
   /* Paint points */
   for (i = 0; i < SUSCAN_GUI_CONSTELLATION_HISTORY; ++i) {
     n = (i + constellation->p) % SUSCAN_GUI_CONSTELLATION_HISTORY;
@@ -176,3 +342,28 @@ suscan_constellation_on_draw(GtkWidget *widget, cairo_t *cr, gpointer data)
 
   return FALSE;
 }
+
+gboolean
+suscan_constellation_on_button_press(
+    GtkWidget *widget,
+    GdkEventButton *ev,
+    gpointer data)
+{
+  struct suscan_gui_inspector *insp =
+      (struct suscan_gui_inspector *) data;
+
+  /* Clicking the constellation switches between points and density */
+  if (ev->type == GDK_BUTTON_PRESS && ev->button == 1) {
+    suscan_gui_constellation_set_mode(
+        &insp->constellation,
+        insp->constellation.mode == SUSCAN_GUI_CONSTELLATION_MODE_POINTS
+          ? SUSCAN_GUI_CONSTELLATION_MODE_DENSITY
+          : SUSCAN_GUI_CONSTELLATION_MODE_POINTS);
+
+    gtk_widget_queue_draw(widget);
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
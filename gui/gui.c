@@ -90,6 +90,19 @@ suscan_gui_destroy(struct suscan_gui *gui)
 
   suscan_mq_finalize(&gui->mq_out);
 
+  if (gui->frame_tick_id != 0)
+    gtk_widget_remove_tick_callback(GTK_WIDGET(gui->main), gui->frame_tick_id);
+
+  if (gui->arm_source_id != 0)
+    g_source_remove(gui->arm_source_id);
+
+  suscan_gui_frame_batch_finalize(&gui->batch);
+  suscan_gui_frame_batch_finalize(&gui->spare_batch);
+
+  suscan_channel_set_finalize(&gui->channel_set);
+
+  g_mutex_clear(&gui->coalesce_mutex);
+
   free(gui);
 }
 
@@ -1277,6 +1290,7 @@ suscan_gui_add_inspector(
    * as we received the response of this message
    */
   params.inspector_id = insp->index;
+  params.display_rate = SUSCAN_GUI_INSPECTOR_DISPLAY_RATE;
   insp->params = params;
 
   SU_TRYCATCH(
@@ -1323,6 +1337,16 @@ suscan_gui_new(int argc, char **argv)
 
   SU_TRYCATCH(gui = calloc(1, sizeof(struct suscan_gui)), goto fail);
 
+  g_mutex_init(&gui->coalesce_mutex);
+  suscan_channel_set_init(&gui->channel_set);
+
+  SU_TRYCATCH(suscan_gui_frame_batch_init(&gui->batch), goto fail);
+  SU_TRYCATCH(suscan_gui_frame_batch_init(&gui->spare_batch), goto fail);
+
+  SU_TRYCATCH(
+      suscan_mq_init_ring(&gui->mq_out, SUSCAN_MQ_DEFAULT_RING_SIZE),
+      goto fail);
+
   SU_TRYCATCH(
       gui->settings = g_settings_new(SUSCAN_GUI_SETTINGS_ID),
       goto fail);
@@ -1341,6 +1365,14 @@ suscan_gui_new(int argc, char **argv)
 
   gui->main_spectrum.auto_level = SU_TRUE;
 
+  /* OpenGL spectrum is optional, cairo is used if it cannot be enabled */
+  if (g_settings_get_boolean(gui->settings, "gl-spectrum"))
+    (void) suscan_gui_spectrum_enable_gl(
+        &gui->main_spectrum,
+        GTK_WIDGET(gtk_builder_get_object(
+            gui->builder,
+            "daMainViewsSpectrum")));
+
   g_signal_connect(
       GTK_WIDGET(gui->main),
       "destroy",
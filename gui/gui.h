@@ -53,6 +53,15 @@ enum suscan_gui_state {
 #define SUSCAN_GUI_SPECTRUM_REF_LEVEL_DEFAULT   0
 #define SUSCAN_GUI_SPECTRUM_WATERFALL_AGC_ALPHA .1
 
+#define SUSCAN_GUI_HORIZONTAL_DIVS 20
+#define SUSCAN_GUI_VERTICAL_DIVS   10
+
+#define SUSCAN_GUI_SPECTRUM_LEFT_PADDING 30
+#define SUSCAN_GUI_SPECTRUM_TOP_PADDING 5
+
+#define SUSCAN_GUI_SPECTRUM_RIGHT_PADDING 5
+#define SUSCAN_GUI_SPECTRUM_BOTTOM_PADDING 30
+
 enum suscan_gui_spectrum_param {
   SUSCAN_GUI_SPECTRUM_PARAM_FREQ_OFFSET,
   SUSCAN_GUI_SPECTRUM_PARAM_FREQ_SCALE,
@@ -65,6 +74,8 @@ enum suscan_gui_spectrum_mode {
   SUSCAN_GUI_SPECTRUM_MODE_WATERFALL,
 };
 
+struct suscan_gui_spectrum_gl;
+
 struct suscan_gui_spectrum {
   enum suscan_gui_spectrum_mode mode;
   unsigned width;
@@ -90,10 +101,19 @@ struct suscan_gui_spectrum {
   SUFLOAT last_max;
 
   /* Waterfall members */
-  SUBOOL flip;
-  cairo_surface_t *wf_surf[2];
+  cairo_surface_t *wf_surf[2]; /* Row ring and scratch copy */
+  int      wf_row;           /* Ring row holding the newest line */
+  int     *wf_bins;          /* PSD bin of each column, -1 if none */
+  float   *wf_line;          /* Scratch levels of the newest line */
+  SUBOOL   wf_bins_valid;
+  SUFLOAT  wf_bins_offset;   /* Zoom the column map was computed for */
+  SUFLOAT  wf_bins_scale;
+  SUSCOUNT wf_bins_psd_size;
   SUFLOAT last_freq_offset;
 
+  /* Optional OpenGL backend. Cairo is used if NULL or not ready */
+  struct suscan_gui_spectrum_gl *gl;
+
   /* Scroll and motion state */
   gdouble last_x;
   gdouble last_y;
@@ -118,6 +138,42 @@ struct suscan_gui_recent {
   struct suscan_source_config *config;
 };
 
+/*
+ * Updates dropped because a newer one replaced them before the main loop
+ * got to draw them.
+ */
+struct suscan_gui_coalesce_stats {
+  uint64_t channel_dropped;
+  uint64_t psd_dropped;
+  uint64_t insp_psd_dropped;
+  uint64_t samples_dropped; /* Batch full, main window not drawing */
+};
+
+/* Sample batches a frame may hold before new ones are dropped */
+#define SUSCAN_GUI_FRAME_BATCH_MAX_SAMPLES 256
+
+struct suscan_gui_batch_entry {
+  uint32_t type;
+  void *private;
+};
+
+/*
+ * Messages waiting for the next frame. Inspector messages and sample
+ * batches are kept in arrival order, the rest only until replaced.
+ */
+struct suscan_gui_frame_batch {
+  struct suscan_gui_batch_entry *queue_list;
+  unsigned int queue_count;
+  unsigned int queue_alloc;
+  unsigned int sample_count;   /* Sample batches in queue_list */
+
+  SUBOOL channels;             /* channel_set changed */
+  struct suscan_analyzer_psd_msg *psd;
+  GHashTable *insp_psd;        /* Inspector ID -> latest spectrum */
+
+  SUBOOL armed; /* A frame callback will take the batch */
+};
+
 struct suscan_gui {
   /* Application settings */
   GSettings *settings;
@@ -208,6 +264,17 @@ struct suscan_gui {
   struct suscan_mq mq_out;
   GThread *async_thread;
 
+  /* Pending updates, protected by coalesce_mutex */
+  GMutex coalesce_mutex;
+  struct suscan_gui_frame_batch batch;
+  struct suscan_gui_coalesce_stats coalesce_stats;
+  struct suscan_channel_set channel_set; /* Every delta, even if coalesced */
+
+  /* Batch being dispatched, only touched by the main thread */
+  struct suscan_gui_frame_batch spare_batch;
+  guint frame_tick_id;
+  guint arm_source_id; /* Pending arming idle, protected by coalesce_mutex */
+
   /* Main spectrum */
   SUSCOUNT current_samp_rate;
   struct sigutils_channel selected_channel;
@@ -222,14 +289,38 @@ struct suscan_gui {
 
 #define SUSCAN_GUI_CONSTELLATION_HISTORY 200
 
+/* Symbols per second the inspector tab can keep up with */
+#define SUSCAN_GUI_INSPECTOR_DISPLAY_RATE 4096
+
+/* Density mode: fixed grid over [-1, 1] x [-1, 1] */
+#define SUSCAN_GUI_CONSTELLATION_GRID                 128
+#define SUSCAN_GUI_CONSTELLATION_PERSISTENCE         2000 /* In symbols */
+#define SUSCAN_GUI_CONSTELLATION_DENSITY_RENORMALIZE  1e6
+
+enum suscan_gui_constellation_mode {
+  SUSCAN_GUI_CONSTELLATION_MODE_POINTS,
+  SUSCAN_GUI_CONSTELLATION_MODE_DENSITY
+};
+
 struct suscan_gui_constellation {
   cairo_surface_t *surface;
   unsigned width;
   unsigned height;
 
+  enum suscan_gui_constellation_mode mode;
+
   SUCOMPLEX phase;
   SUCOMPLEX history[SUSCAN_GUI_CONSTELLATION_HISTORY];
   unsigned int p;
+
+  /*
+   * Every symbol is binned in the density grid. Instead of decaying the
+   * whole grid on each batch, the weight of new symbols grows, and the
+   * grid is rescaled once in a while.
+   */
+  SUFLOAT density[SUSCAN_GUI_CONSTELLATION_GRID][SUSCAN_GUI_CONSTELLATION_GRID];
+  SUFLOAT density_weight;
+  cairo_surface_t *density_surface;
 };
 
 struct suscan_gui_inspector {
@@ -350,6 +441,18 @@ void suscan_gui_update_state(
 
 void suscan_gui_detach_all_inspectors(struct suscan_gui *gui);
 
+void suscan_gui_get_coalesce_stats(
+    struct suscan_gui *gui,
+    struct suscan_gui_coalesce_stats *stats);
+
+SUBOOL suscan_gui_frame_batch_init(struct suscan_gui_frame_batch *batch);
+
+/* Disposes whatever is still pending */
+void suscan_gui_frame_batch_finalize(struct suscan_gui_frame_batch *batch);
+
+/* Handles pending messages right away, outside the frame clock */
+void suscan_gui_flush_frame_batch(struct suscan_gui *gui);
+
 SUBOOL suscan_gui_connect(struct suscan_gui *gui);
 void suscan_gui_reconnect(struct suscan_gui *gui);
 void suscan_gui_disconnect(struct suscan_gui *gui);
@@ -364,10 +467,18 @@ void suscan_gui_spectrum_set_mode(
     struct suscan_gui_spectrum *spectrum,
     enum suscan_gui_spectrum_mode mode);
 
+SUBOOL suscan_gui_spectrum_enable_gl(
+    struct suscan_gui_spectrum *spectrum,
+    GtkWidget *area);
+
 void suscan_gui_spectrum_update(
     struct suscan_gui_spectrum *spectrum,
     struct suscan_analyzer_psd_msg *msg);
 
+void suscan_gui_spectrum_load_overview(
+    struct suscan_gui_spectrum *spectrum,
+    const struct suscan_analyzer_overview_msg *msg);
+
 void suscan_gui_spectrum_update_channels(
     struct suscan_gui_spectrum *spectrum,
     struct sigutils_channel **channel_list,
@@ -392,6 +503,18 @@ void suscan_gui_spectrum_parse_motion(
 void suscan_gui_spectrum_reset_selection(
     struct suscan_gui_spectrum *spectrum);
 
+/* OpenGL backend, used internally by the spectrum widget */
+SUBOOL suscan_gui_spectrum_gl_ready(const struct suscan_gui_spectrum_gl *gl);
+
+void suscan_gui_spectrum_gl_push_psd(
+    struct suscan_gui_spectrum_gl *gl,
+    const SUFLOAT *psd_data,
+    SUSCOUNT psd_size);
+
+void suscan_gui_spectrum_gl_queue_render(struct suscan_gui_spectrum_gl *gl);
+
+void suscan_gui_spectrum_gl_destroy(struct suscan_gui_spectrum_gl *gl);
+
 /* Constellation API */
 void suscan_gui_constellation_init(
     struct suscan_gui_constellation *constellation);
@@ -403,6 +526,17 @@ void suscan_gui_constellation_push_sample(
     struct suscan_gui_constellation *constellation,
     SUCOMPLEX sample);
 
+void suscan_gui_constellation_push_batch(
+    struct suscan_gui_constellation *constellation,
+    const struct suscan_analyzer_sample_batch_msg *msg);
+
+void suscan_gui_constellation_set_mode(
+    struct suscan_gui_constellation *constellation,
+    enum suscan_gui_constellation_mode mode);
+
+void suscan_gui_constellation_finalize(
+    struct suscan_gui_constellation *constellation);
+
 /* Some message dialogs */
 #define suscan_error(gui, title, fmt, arg...) \
     suscan_gui_msgbox(gui, GTK_MESSAGE_ERROR, title, fmt, ##arg)
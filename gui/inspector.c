@@ -43,6 +43,8 @@ suscan_gui_inspector_destroy(struct suscan_gui_inspector *inspector)
 
   suscan_gui_spectrum_init(&inspector->spectrum);
 
+  suscan_gui_constellation_finalize(&inspector->constellation);
+
   g_object_unref(G_OBJECT(inspector->builder));
 
   free(inspector);
@@ -169,19 +171,14 @@ suscan_gui_inspector_feed_w_batch(
     struct suscan_gui_inspector *inspector,
     const struct suscan_analyzer_sample_batch_msg *msg)
 {
-  unsigned int sample_count, full_samp_count;
+  unsigned int full_samp_count;
   unsigned int i;
   GtkTextIter iter;
   GtkTextMark *mark;
   char *new_buffer;
   char sym;
 
-  /*
-   * Push, at most, the last SUSCAN_GUI_CONSTELLATION_HISTORY. We do this
-   * because the previous ones will never be shown
-   */
   full_samp_count = msg->sample_count;
-  sample_count = MIN(full_samp_count, SUSCAN_GUI_CONSTELLATION_HISTORY);
 
   /* Check if recording is enabled to assert the symbol buffer */
   if (inspector->recording) {
@@ -229,11 +226,7 @@ suscan_gui_inspector_feed_w_batch(
           1);   /* yalign */
   }
 
-  for (i = 0; i < sample_count; ++i)
-    suscan_gui_constellation_push_sample(
-        &inspector->constellation,
-        msg->samples[msg->sample_count - sample_count + i]);
-
+  suscan_gui_constellation_push_batch(&inspector->constellation, msg);
 }
 
 char *
@@ -1002,6 +995,19 @@ suscan_inspector_on_toggle_record(
   struct suscan_gui_inspector *insp = (struct suscan_gui_inspector *) data;
 
   insp->recording = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
+
+  /* Symbol recording needs every symbol, not just the ones we can draw */
+  insp->params.display_rate =
+      insp->recording ? 0 : SUSCAN_GUI_INSPECTOR_DISPLAY_RATE;
+
+  if (!insp->dead)
+    SU_TRYCATCH(
+        suscan_analyzer_set_inspector_params_async(
+            insp->gui->analyzer,
+            insp->inshnd,
+            &insp->params,
+            rand()),
+        return);
 }
 
 void
@@ -112,6 +112,10 @@ suscan_gui_retrieve_analyzer_params(struct suscan_gui *gui)
       gui->settings,
       "psd-interval");
 
+  analyzer_params.replay_speed = g_settings_get_double(
+      gui->settings,
+      "replay-speed");
+
   /* TODO: send update message to analyzer */
   gui->analyzer_params = analyzer_params;
 
@@ -163,5 +167,10 @@ suscan_gui_store_analyzer_params(struct suscan_gui *gui)
       "psd-interval",
       gui->analyzer_params.psd_update_int);
 
+  g_settings_set_double(
+      gui->settings,
+      "replay-speed",
+      gui->analyzer_params.replay_speed);
+
   g_settings_sync();
 }
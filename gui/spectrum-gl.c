@@ -0,0 +1,703 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "spectrum-gl"
+
+#include "gui.h"
+
+#include <string.h>
+
+/*
+ * OpenGL backend of the spectrum widget. The GtkGLArea is placed below the
+ * original drawing area, which keeps handling input and paints levels, axes
+ * and channels on top with cairo. The GL side only takes care of the
+ * expensive parts: the PSD trace and the waterfall. Waterfall rows are kept
+ * as raw PSD lines in a ring texture, and the zoom, levels and gradient
+ * are applied by the fragment shader.
+ *
+ * If the GL context cannot be created, the backend never becomes ready and
+ * the cairo path keeps drawing everything.
+ */
+
+#ifdef HAVE_EPOXY
+
+#include <epoxy/gl.h>
+
+#include "gradient.h"
+
+/* Rows received between two frames. Older ones are dropped past this */
+#define SUSCAN_GUI_SPECTRUM_GL_MAX_PENDING 32
+
+struct suscan_gui_spectrum_gl {
+  struct suscan_gui_spectrum *spectrum;
+  GtkWidget *area; /* Weak reference to the GtkGLArea */
+  SUBOOL ready;
+
+  GLuint wf_program;
+  GLuint trace_program;
+  GLuint quad_vao;
+  GLuint quad_vbo;
+  GLuint trace_vao;
+  GLuint trace_vbo;
+  GLuint gradient_tex;
+  GLuint ring_tex;
+
+  int ring_width;  /* PSD bins per row */
+  int ring_height; /* Rows, same as graph height */
+  int ring_row;    /* Row holding the newest line */
+
+  /* Rows waiting to be uploaded on next render */
+  float *pending;
+  SUSCOUNT pending_width;
+  unsigned int pending_count;
+
+  /* Last PSD, reordered from -fs/2 to fs/2 */
+  float *trace;
+  SUSCOUNT trace_size;
+  SUBOOL trace_dirty;
+};
+
+SUPRIVATE const char *suscan_gui_spectrum_gl_quad_vs =
+    "#version 150\n"
+    "in vec2 pos;\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "  uv = vec2(.5 * pos.x, .5 - .5 * pos.y);\n"
+    "  gl_Position = vec4(pos, 0., 1.);\n"
+    "}\n";
+
+SUPRIVATE const char *suscan_gui_spectrum_gl_wf_fs =
+    "#version 150\n"
+    "uniform sampler2D ring;\n"
+    "uniform sampler2D gradient;\n"
+    "uniform float offset;\n"
+    "uniform float scale;\n"
+    "uniform float ref;\n"
+    "uniform float range;\n"
+    "uniform float row;\n"
+    "uniform float dim;\n"
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  float f = uv.x / scale + offset;\n"
+    "  if (f < -.5 || f >= .5) {\n"
+    "    color = vec4(0., 0., 0., 1.);\n"
+    "    return;\n"
+    "  }\n"
+    "  float p = texture(ring, vec2(fract(f), row + uv.y)).r;\n"
+    "  float db = 4.3429448 * log(max(p, 1e-30));\n"
+    "  float val = clamp(1. + (db - 5. - ref) / range, 0., 1.);\n"
+    "  color = vec4(\n"
+    "      dim * texture(gradient, vec2((val * 255. + .5) / 256., .5)).rgb,\n"
+    "      1.);\n"
+    "}\n";
+
+SUPRIVATE const char *suscan_gui_spectrum_gl_trace_vs =
+    "#version 150\n"
+    "in float power;\n"
+    "uniform float offset;\n"
+    "uniform float scale;\n"
+    "uniform float ref;\n"
+    "uniform float range;\n"
+    "uniform float count;\n"
+    "void main() {\n"
+    "  float x = float(gl_VertexID) / count - .5;\n"
+    "  float db = 4.3429448 * log(max(power, 1e-30));\n"
+    "  gl_Position = vec4(\n"
+    "      2. * (x - offset) * scale,\n"
+    "      2. * (db - ref) / range + 1.,\n"
+    "      0.,\n"
+    "      1.);\n"
+    "}\n";
+
+SUPRIVATE const char *suscan_gui_spectrum_gl_trace_fs =
+    "#version 150\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  color = vec4(1., 1., 0., 1.);\n"
+    "}\n";
+
+/***************************** Shader helpers ********************************/
+SUPRIVATE GLuint
+suscan_gui_spectrum_gl_compile(GLenum type, const char *source)
+{
+  GLuint shader;
+  GLint status;
+  char log[512];
+
+  shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status == GL_FALSE) {
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    SU_ERROR("Failed to compile shader: %s\n", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+SUPRIVATE GLuint
+suscan_gui_spectrum_gl_link(const char *vs_source, const char *fs_source)
+{
+  GLuint vs = 0;
+  GLuint fs = 0;
+  GLuint program = 0;
+  GLint status;
+  char log[512];
+
+  SU_TRYCATCH(
+      vs = suscan_gui_spectrum_gl_compile(GL_VERTEX_SHADER, vs_source),
+      goto done);
+
+  SU_TRYCATCH(
+      fs = suscan_gui_spectrum_gl_compile(GL_FRAGMENT_SHADER, fs_source),
+      goto done);
+
+  program = glCreateProgram();
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  glLinkProgram(program);
+
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status == GL_FALSE) {
+    glGetProgramInfoLog(program, sizeof(log), NULL, log);
+    SU_ERROR("Failed to link shader program: %s\n", log);
+    glDeleteProgram(program);
+    program = 0;
+  }
+
+done:
+  if (vs != 0)
+    glDeleteShader(vs);
+
+  if (fs != 0)
+    glDeleteShader(fs);
+
+  return program;
+}
+
+SUPRIVATE void
+suscan_gui_spectrum_gl_set_view_uniforms(
+    const struct suscan_gui_spectrum *spectrum,
+    GLuint program)
+{
+  glUniform1f(
+      glGetUniformLocation(program, "offset"),
+      spectrum->freq_offset);
+  glUniform1f(
+      glGetUniformLocation(program, "scale"),
+      spectrum->freq_scale);
+  glUniform1f(
+      glGetUniformLocation(program, "ref"),
+      spectrum->ref_level);
+  glUniform1f(
+      glGetUniformLocation(program, "range"),
+      spectrum->dbs_per_div * SUSCAN_GUI_VERTICAL_DIVS);
+}
+
+/**************************** Ring texture ***********************************/
+SUPRIVATE void
+suscan_gui_spectrum_gl_reset_ring(
+    struct suscan_gui_spectrum_gl *gl,
+    int width,
+    int height)
+{
+  float *zero = NULL;
+
+  if (gl->ring_tex == 0)
+    glGenTextures(1, &gl->ring_tex);
+
+  glBindTexture(GL_TEXTURE_2D, gl->ring_tex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  /* Start from silence, so old data is not shown as garbage */
+  SU_TRYCATCH(zero = calloc(width * height, sizeof(float)), return);
+
+  glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_R32F,
+      width,
+      height,
+      0,
+      GL_RED,
+      GL_FLOAT,
+      zero);
+
+  free(zero);
+
+  gl->ring_width  = width;
+  gl->ring_height = height;
+  gl->ring_row    = 0;
+}
+
+SUPRIVATE void
+suscan_gui_spectrum_gl_upload_pending(struct suscan_gui_spectrum_gl *gl)
+{
+  const struct suscan_gui_spectrum *spectrum = gl->spectrum;
+  unsigned int i;
+
+  if (gl->pending_count == 0)
+    return;
+
+  if (gl->ring_tex == 0
+      || gl->ring_width != gl->pending_width
+      || gl->ring_height != spectrum->g_height)
+    suscan_gui_spectrum_gl_reset_ring(
+        gl,
+        gl->pending_width,
+        spectrum->g_height);
+
+  if (gl->ring_width == 0 || gl->ring_height == 0) {
+    gl->pending_count = 0;
+    return;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, gl->ring_tex);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  /* Oldest rows first: the newest one ends up at ring_row */
+  for (i = 0; i < gl->pending_count; ++i) {
+    gl->ring_row = (gl->ring_row + gl->ring_height - 1) % gl->ring_height;
+    glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        0,
+        gl->ring_row,
+        gl->ring_width,
+        1,
+        GL_RED,
+        GL_FLOAT,
+        gl->pending + i * gl->pending_width);
+  }
+
+  gl->pending_count = 0;
+}
+
+/************************** GtkGLArea callbacks ******************************/
+SUPRIVATE void
+suscan_gui_spectrum_gl_on_realize(GtkGLArea *area, gpointer data)
+{
+  struct suscan_gui_spectrum_gl *gl = (struct suscan_gui_spectrum_gl *) data;
+  static const GLfloat quad[] = {-1, -1, 1, -1, -1, 1, 1, 1};
+  GLfloat gradient[256][3];
+  GLint loc;
+  unsigned int i;
+
+  gtk_gl_area_make_current(area);
+
+  if (gtk_gl_area_get_error(area) != NULL) {
+    SU_WARNING(
+        "Cannot create GL context (%s), spectrum falls back to cairo\n",
+        gtk_gl_area_get_error(area)->message);
+    return;
+  }
+
+  SU_TRYCATCH(
+      gl->wf_program = suscan_gui_spectrum_gl_link(
+          suscan_gui_spectrum_gl_quad_vs,
+          suscan_gui_spectrum_gl_wf_fs),
+      return);
+
+  SU_TRYCATCH(
+      gl->trace_program = suscan_gui_spectrum_gl_link(
+          suscan_gui_spectrum_gl_trace_vs,
+          suscan_gui_spectrum_gl_trace_fs),
+      return);
+
+  /* Full graph quad, for the waterfall */
+  glGenVertexArrays(1, &gl->quad_vao);
+  glBindVertexArray(gl->quad_vao);
+  glGenBuffers(1, &gl->quad_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, gl->quad_vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+  loc = glGetAttribLocation(gl->wf_program, "pos");
+  glEnableVertexAttribArray(loc);
+  glVertexAttribPointer(loc, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+
+  /* PSD trace, one power value per vertex */
+  glGenVertexArrays(1, &gl->trace_vao);
+  glBindVertexArray(gl->trace_vao);
+  glGenBuffers(1, &gl->trace_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, gl->trace_vbo);
+  loc = glGetAttribLocation(gl->trace_program, "power");
+  glEnableVertexAttribArray(loc);
+  glVertexAttribPointer(loc, 1, GL_FLOAT, GL_FALSE, 0, NULL);
+
+  glBindVertexArray(0);
+
+  /* Same gradient as the cairo waterfall */
+  for (i = 0; i < 256; ++i) {
+    gradient[i][0] = wf_gradient[i][0];
+    gradient[i][1] = wf_gradient[i][1];
+    gradient[i][2] = wf_gradient[i][2];
+  }
+
+  glGenTextures(1, &gl->gradient_tex);
+  glBindTexture(GL_TEXTURE_2D, gl->gradient_tex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_RGB8,
+      256,
+      1,
+      0,
+      GL_RGB,
+      GL_FLOAT,
+      gradient);
+
+  /* Whatever was pushed in the meantime is displayed from scratch */
+  gl->pending_count = 0;
+  gl->trace_dirty = gl->trace != NULL;
+  gl->ready = SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_gui_spectrum_gl_on_unrealize(GtkGLArea *area, gpointer data)
+{
+  struct suscan_gui_spectrum_gl *gl = (struct suscan_gui_spectrum_gl *) data;
+
+  gl->ready = SU_FALSE;
+
+  gtk_gl_area_make_current(area);
+
+  if (gtk_gl_area_get_error(area) != NULL)
+    return;
+
+  if (gl->ring_tex != 0)
+    glDeleteTextures(1, &gl->ring_tex);
+
+  if (gl->gradient_tex != 0)
+    glDeleteTextures(1, &gl->gradient_tex);
+
+  if (gl->quad_vbo != 0)
+    glDeleteBuffers(1, &gl->quad_vbo);
+
+  if (gl->trace_vbo != 0)
+    glDeleteBuffers(1, &gl->trace_vbo);
+
+  if (gl->quad_vao != 0)
+    glDeleteVertexArrays(1, &gl->quad_vao);
+
+  if (gl->trace_vao != 0)
+    glDeleteVertexArrays(1, &gl->trace_vao);
+
+  if (gl->wf_program != 0)
+    glDeleteProgram(gl->wf_program);
+
+  if (gl->trace_program != 0)
+    glDeleteProgram(gl->trace_program);
+
+  gl->ring_tex = gl->gradient_tex = 0;
+  gl->quad_vbo = gl->trace_vbo = 0;
+  gl->quad_vao = gl->trace_vao = 0;
+  gl->wf_program = gl->trace_program = 0;
+  gl->ring_width = gl->ring_height = 0;
+}
+
+SUPRIVATE gboolean
+suscan_gui_spectrum_gl_on_render(
+    GtkGLArea *area,
+    GdkGLContext *context,
+    gpointer data)
+{
+  struct suscan_gui_spectrum_gl *gl = (struct suscan_gui_spectrum_gl *) data;
+  const struct suscan_gui_spectrum *spectrum = gl->spectrum;
+  int scale;
+
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  if (!gl->ready)
+    return TRUE;
+
+  /* Same graph area as the cairo path. GL origin is at the bottom */
+  scale = gtk_widget_get_scale_factor(GTK_WIDGET(area));
+  glViewport(
+      scale * SUSCAN_GUI_SPECTRUM_LEFT_PADDING,
+      scale * (
+          (int) spectrum->height
+          - SUSCAN_GUI_SPECTRUM_TOP_PADDING
+          - spectrum->g_height),
+      scale * spectrum->g_width,
+      scale * spectrum->g_height);
+
+  if (spectrum->mode == SUSCAN_GUI_SPECTRUM_MODE_WATERFALL) {
+    suscan_gui_spectrum_gl_upload_pending(gl);
+
+    if (gl->ring_tex != 0) {
+      glUseProgram(gl->wf_program);
+      suscan_gui_spectrum_gl_set_view_uniforms(spectrum, gl->wf_program);
+      glUniform1f(
+          glGetUniformLocation(gl->wf_program, "row"),
+          (GLfloat) gl->ring_row / gl->ring_height);
+      glUniform1f(
+          glGetUniformLocation(gl->wf_program, "dim"),
+          spectrum->show_channels ? .5 : 1.);
+
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, gl->ring_tex);
+      glUniform1i(glGetUniformLocation(gl->wf_program, "ring"), 0);
+
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, gl->gradient_tex);
+      glUniform1i(glGetUniformLocation(gl->wf_program, "gradient"), 1);
+
+      glBindVertexArray(gl->quad_vao);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+  } else {
+    /* Waterfall is not shown, but its rows must not pile up */
+    gl->pending_count = 0;
+
+    if (gl->trace != NULL) {
+      glBindVertexArray(gl->trace_vao);
+
+      if (gl->trace_dirty) {
+        glBindBuffer(GL_ARRAY_BUFFER, gl->trace_vbo);
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            gl->trace_size * sizeof(float),
+            gl->trace,
+            GL_STREAM_DRAW);
+        gl->trace_dirty = SU_FALSE;
+      }
+
+      glUseProgram(gl->trace_program);
+      suscan_gui_spectrum_gl_set_view_uniforms(spectrum, gl->trace_program);
+      glUniform1f(
+          glGetUniformLocation(gl->trace_program, "count"),
+          gl->trace_size);
+
+      glDrawArrays(GL_LINE_STRIP, 0, gl->trace_size);
+    }
+  }
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+
+  return TRUE;
+}
+
+/****************************** Internal API *********************************/
+SUBOOL
+suscan_gui_spectrum_gl_ready(const struct suscan_gui_spectrum_gl *gl)
+{
+  return gl != NULL && gl->ready;
+}
+
+void
+suscan_gui_spectrum_gl_push_psd(
+    struct suscan_gui_spectrum_gl *gl,
+    const SUFLOAT *psd_data,
+    SUSCOUNT psd_size)
+{
+  float *row;
+  float *tmp;
+  SUSCOUNT i;
+  SUSCOUNT half = psd_size / 2;
+
+  if (psd_size == 0)
+    return;
+
+  /* Waterfall row, in bin order */
+  if (gl->pending_width != psd_size) {
+    SU_TRYCATCH(
+        tmp = realloc(
+            gl->pending,
+            SUSCAN_GUI_SPECTRUM_GL_MAX_PENDING * psd_size * sizeof(float)),
+        return);
+    gl->pending = tmp;
+    gl->pending_width = psd_size;
+    gl->pending_count = 0;
+  }
+
+  if (gl->pending_count == SUSCAN_GUI_SPECTRUM_GL_MAX_PENDING) {
+    memmove(
+        gl->pending,
+        gl->pending + psd_size,
+        (SUSCAN_GUI_SPECTRUM_GL_MAX_PENDING - 1) * psd_size * sizeof(float));
+    --gl->pending_count;
+  }
+
+  row = gl->pending + gl->pending_count++ * psd_size;
+  for (i = 0; i < psd_size; ++i)
+    row[i] = psd_data[i];
+
+  /* Trace, negative frequencies first */
+  if (gl->trace_size != psd_size) {
+    SU_TRYCATCH(tmp = realloc(gl->trace, psd_size * sizeof(float)), return);
+    gl->trace = tmp;
+    gl->trace_size = psd_size;
+  }
+
+  for (i = 0; i < psd_size; ++i)
+    gl->trace[i] = row[(i + psd_size - half) % psd_size];
+
+  gl->trace_dirty = SU_TRUE;
+}
+
+void
+suscan_gui_spectrum_gl_queue_render(struct suscan_gui_spectrum_gl *gl)
+{
+  if (gl != NULL && gl->area != NULL)
+    gtk_gl_area_queue_render(GTK_GL_AREA(gl->area));
+}
+
+void
+suscan_gui_spectrum_gl_destroy(struct suscan_gui_spectrum_gl *gl)
+{
+  if (gl->area != NULL) {
+    g_signal_handlers_disconnect_by_data(gl->area, gl);
+    g_object_remove_weak_pointer(G_OBJECT(gl->area), (gpointer *) &gl->area);
+  }
+
+  if (gl->pending != NULL)
+    free(gl->pending);
+
+  if (gl->trace != NULL)
+    free(gl->trace);
+
+  free(gl);
+}
+
+/******************************* Public API **********************************/
+SUBOOL
+suscan_gui_spectrum_enable_gl(
+    struct suscan_gui_spectrum *spectrum,
+    GtkWidget *area)
+{
+  struct suscan_gui_spectrum_gl *new = NULL;
+  GtkWidget *parent;
+  GtkWidget *overlay;
+  GtkWidget *gl_area;
+  gint left, top, width, height;
+
+  if (spectrum->gl != NULL)
+    return SU_TRUE;
+
+  /* The drawing area must be in a grid, so we know where to put it back */
+  SU_TRYCATCH(parent = gtk_widget_get_parent(area), return SU_FALSE);
+  SU_TRYCATCH(GTK_IS_GRID(parent), return SU_FALSE);
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_gui_spectrum_gl)),
+      return SU_FALSE);
+
+  new->spectrum = spectrum;
+
+  gl_area = gtk_gl_area_new();
+  gtk_gl_area_set_required_version(GTK_GL_AREA(gl_area), 3, 2);
+  gtk_widget_set_hexpand(gl_area, TRUE);
+  gtk_widget_set_vexpand(gl_area, TRUE);
+
+  g_signal_connect(
+      gl_area,
+      "realize",
+      G_CALLBACK(suscan_gui_spectrum_gl_on_realize),
+      new);
+  g_signal_connect(
+      gl_area,
+      "unrealize",
+      G_CALLBACK(suscan_gui_spectrum_gl_on_unrealize),
+      new);
+  g_signal_connect(
+      gl_area,
+      "render",
+      G_CALLBACK(suscan_gui_spectrum_gl_on_render),
+      new);
+
+  new->area = gl_area;
+  g_object_add_weak_pointer(G_OBJECT(gl_area), (gpointer *) &new->area);
+
+  /* Move the drawing area on top of the GL area */
+  gtk_container_child_get(
+      GTK_CONTAINER(parent),
+      area,
+      "left-attach", &left,
+      "top-attach", &top,
+      "width", &width,
+      "height", &height,
+      NULL);
+
+  g_object_ref(area);
+  gtk_container_remove(GTK_CONTAINER(parent), area);
+
+  overlay = gtk_overlay_new();
+  gtk_container_add(GTK_CONTAINER(overlay), gl_area);
+  gtk_overlay_add_overlay(GTK_OVERLAY(overlay), area);
+  g_object_unref(area);
+
+  gtk_grid_attach(GTK_GRID(parent), overlay, left, top, width, height);
+  gtk_widget_show_all(overlay);
+
+  spectrum->gl = new;
+
+  return SU_TRUE;
+}
+
+#else
+
+SUBOOL
+suscan_gui_spectrum_gl_ready(const struct suscan_gui_spectrum_gl *gl)
+{
+  return SU_FALSE;
+}
+
+void
+suscan_gui_spectrum_gl_push_psd(
+    struct suscan_gui_spectrum_gl *gl,
+    const SUFLOAT *psd_data,
+    SUSCOUNT psd_size)
+{
+}
+
+void
+suscan_gui_spectrum_gl_queue_render(struct suscan_gui_spectrum_gl *gl)
+{
+}
+
+void
+suscan_gui_spectrum_gl_destroy(struct suscan_gui_spectrum_gl *gl)
+{
+}
+
+SUBOOL
+suscan_gui_spectrum_enable_gl(
+    struct suscan_gui_spectrum *spectrum,
+    GtkWidget *area)
+{
+  SU_WARNING("Compiled without OpenGL support, using cairo for spectrum\n");
+
+  return SU_FALSE;
+}
+
+#endif /* HAVE_EPOXY */
@@ -27,20 +27,11 @@
 
 #define SUSCAN_GUI_SPECTRUM_ALPHA .01
 
-#define SUSCAN_GUI_HORIZONTAL_DIVS 20
-#define SUSCAN_GUI_VERTICAL_DIVS   10
-
 #define SUSCAN_GUI_SPECTRUM_DX (1. / SUSCAN_GUI_HORIZONTAL_DIVS)
 #define SUSCAN_GUI_SPECTRUM_DY (1. / SUSCAN_GUI_VERTICAL_DIVS)
 
 #define SUSCAN_GUI_SPECTRUM_SCALE_DELTA .1
 
-#define SUSCAN_GUI_SPECTRUM_LEFT_PADDING 30
-#define SUSCAN_GUI_SPECTRUM_TOP_PADDING 5
-
-#define SUSCAN_GUI_SPECTRUM_RIGHT_PADDING 5
-#define SUSCAN_GUI_SPECTRUM_BOTTOM_PADDING 30
-
 
 #define SUSCAN_SPECTRUM_TO_SCR(s, x, y)         \
   suscan_gui_spectrum_to_scr_x(s, x), suscan_gui_spectrum_to_scr_y(s, y)
@@ -53,6 +44,18 @@ SUPRIVATE void suscan_gui_spectrum_scale_waterfall(
 SUPRIVATE void suscan_gui_spectrum_redraw_waterfall(
     struct suscan_gui_spectrum *spectrum);
 
+SUPRIVATE void suscan_gui_spectrum_waterfall_snapshot(
+    struct suscan_gui_spectrum *spectrum);
+
+SUPRIVATE void suscan_gui_spectrum_paint_ring(
+    cairo_t *cr,
+    cairo_surface_t *ring,
+    int row,
+    int width,
+    int height,
+    double x,
+    double y);
+
 /************************ Coordinate translation *****************************/
 
 /* Graph area conversion functions */
@@ -156,6 +159,8 @@ suscan_gui_spectrum_set_mode(
     enum suscan_gui_spectrum_mode mode)
 {
   spectrum->mode = mode;
+
+  suscan_gui_spectrum_gl_queue_render(spectrum->gl);
 }
 
 void
@@ -172,11 +177,20 @@ suscan_spectrum_finalize(struct suscan_gui_spectrum *spectrum)
   if (spectrum->psd_data != NULL)
     free(spectrum->psd_data);
 
+  if (spectrum->wf_bins != NULL)
+    free(spectrum->wf_bins);
+
+  if (spectrum->wf_line != NULL)
+    free(spectrum->wf_line);
+
   if (spectrum->wf_surf[0] != NULL)
     cairo_surface_destroy(spectrum->wf_surf[0]);
 
   if (spectrum->wf_surf[1] != NULL)
     cairo_surface_destroy(spectrum->wf_surf[1]);
+
+  if (spectrum->gl != NULL)
+    suscan_gui_spectrum_gl_destroy(spectrum->gl);
 }
 
 const struct sigutils_channel *
@@ -207,10 +221,12 @@ suscan_gui_spectrum_configure(
   cairo_surface_t *old_surf0;
   cairo_surface_t *old_surf1;
   int old_g_width;
+  int old_g_height;
+  int *bins;
+  float *line;
   SUFLOAT K;
   cairo_t *cr;
 
-  /* TODO: Save previous surface */
   old_surf0 = spectrum->wf_surf[0];
   old_surf1 = spectrum->wf_surf[1];
 
@@ -219,6 +235,7 @@ suscan_gui_spectrum_configure(
 
   /* Initialize the graph dimensions */
   old_g_width = spectrum->g_width;
+  old_g_height = spectrum->g_height;
 
   spectrum->g_width =
         spectrum->width
@@ -252,8 +269,7 @@ suscan_gui_spectrum_configure(
   /* Clear new surfaces */
   suscan_gui_spectrum_clear(spectrum);
 
-  /* Reuse existing data from previous waterfall */
-
+  /* Reuse existing data from previous waterfall, newest line on top */
   K = (SUFLOAT) spectrum->g_width / (SUFLOAT) old_g_width;
 
   if (old_surf0 != NULL) {
@@ -262,23 +278,35 @@ suscan_gui_spectrum_configure(
       cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
       cairo_scale(cr, K, 1);
     }
-    cairo_set_source_surface(cr, old_surf0, 0, 0);
-    cairo_paint(cr);
+    suscan_gui_spectrum_paint_ring(
+        cr,
+        old_surf0,
+        spectrum->wf_row,
+        old_g_width,
+        old_g_height,
+        0,
+        0);
     cairo_destroy(cr);
     cairo_surface_destroy(old_surf0);
   }
 
-  if (old_surf1 != NULL) {
-    cr = cairo_create(spectrum->wf_surf[1]);
-    if (K != 1) {
-      cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
-      cairo_scale(cr, K, 1);
-    }
-    cairo_set_source_surface(cr, old_surf1, 0, 0);
-    cairo_paint(cr);
-    cairo_destroy(cr);
+  if (old_surf1 != NULL)
     cairo_surface_destroy(old_surf1);
-  }
+
+  spectrum->wf_row = 0;
+
+  /* Column to bin map must be recomputed for the new width */
+  SU_TRYCATCH(
+      bins = realloc(spectrum->wf_bins, spectrum->g_width * sizeof(int)),
+      return);
+  spectrum->wf_bins = bins;
+
+  SU_TRYCATCH(
+      line = realloc(spectrum->wf_line, spectrum->g_width * sizeof(float)),
+      return);
+  spectrum->wf_line = line;
+
+  spectrum->wf_bins_valid = SU_FALSE;
 }
 
 
@@ -328,29 +356,34 @@ suscan_gui_spectrum_update(
     struct suscan_gui_spectrum *spectrum,
     struct suscan_analyzer_psd_msg *msg)
 {
-  SUFLOAT *old_data = spectrum->psd_data;
-  SUSCOUNT old_size = spectrum->psd_size;
+  SUFLOAT *data;
   SUFLOAT  max = 0;
   SUFLOAT  range;
   unsigned int i;
   unsigned int skip;
 
+  /* Message frames belong to the analyzer, keep our own copy */
+  if (spectrum->psd_data != NULL && spectrum->psd_size == msg->psd_size) {
+    /* Average against previous update, only if sizes match */
+    for (i = 0; i < msg->psd_size; ++i)
+      spectrum->psd_data[i] = msg->psd_data[i]
+          + SUSCAN_GUI_SPECTRUM_ALPHA
+          * (spectrum->psd_data[i] - msg->psd_data[i]);
+  } else {
+    SU_TRYCATCH(
+        data = realloc(spectrum->psd_data, msg->psd_size * sizeof(SUFLOAT)),
+        return);
+
+    memcpy(data, msg->psd_data, msg->psd_size * sizeof(SUFLOAT));
+    spectrum->psd_data = data;
+  }
+
   spectrum->fc        = msg->fc;
-  spectrum->psd_data  = suscan_analyzer_psd_msg_take_psd(msg);
   spectrum->psd_size  = msg->psd_size;
   spectrum->samp_rate = msg->samp_rate;
   spectrum->N0        = msg->N0;
   ++spectrum->updates;
 
-  if (old_data != NULL) {
-    /* Average against previous update, only if sizes match */
-    if (old_size == msg->psd_size)
-      for (i = 0; i < old_size; ++i)
-        spectrum->psd_data[i] +=
-            SUSCAN_GUI_SPECTRUM_ALPHA * (old_data[i] - spectrum->psd_data[i]);
-    free(old_data);
-  }
-
   if (spectrum->auto_level) {
     skip = spectrum->psd_size / 8;
     for (i = skip; i < spectrum->psd_size - skip; ++i)
@@ -368,7 +401,64 @@ suscan_gui_spectrum_update(
         * (range - spectrum->dbs_per_div);
   }
 
-  suscan_gui_spectrum_redraw_waterfall(spectrum);
+  if (suscan_gui_spectrum_gl_ready(spectrum->gl)) {
+    suscan_gui_spectrum_gl_push_psd(
+        spectrum->gl,
+        spectrum->psd_data,
+        spectrum->psd_size);
+    suscan_gui_spectrum_gl_queue_render(spectrum->gl);
+  } else {
+    suscan_gui_spectrum_redraw_waterfall(spectrum);
+  }
+}
+
+/*
+ * Capture overviews are painted as if every line were a spectrum update,
+ * so the waterfall shows the whole recording right away. Lines that
+ * don't fit would scroll out at once, they are skipped.
+ */
+void
+suscan_gui_spectrum_load_overview(
+    struct suscan_gui_spectrum *spectrum,
+    const struct suscan_analyzer_overview_msg *msg)
+{
+  SUFLOAT *data;
+  unsigned int i, first = 0;
+
+  if (msg->line_count == 0)
+    return;
+
+  SU_TRYCATCH(
+      data = realloc(spectrum->psd_data, msg->psd_size * sizeof(SUFLOAT)),
+      return);
+  spectrum->psd_data = data;
+
+  spectrum->fc        = msg->fc;
+  spectrum->psd_size  = msg->psd_size;
+  spectrum->samp_rate = msg->samp_rate;
+
+  if (spectrum->g_height > 0
+      && msg->line_count > (unsigned int) spectrum->g_height)
+    first = msg->line_count - spectrum->g_height;
+
+  for (i = first; i < msg->line_count; ++i) {
+    memcpy(
+        spectrum->psd_data,
+        msg->lines + i * msg->psd_size,
+        msg->psd_size * sizeof(SUFLOAT));
+    ++spectrum->updates;
+
+    if (suscan_gui_spectrum_gl_ready(spectrum->gl))
+      suscan_gui_spectrum_gl_push_psd(
+          spectrum->gl,
+          spectrum->psd_data,
+          spectrum->psd_size);
+    else
+      suscan_gui_spectrum_redraw_waterfall(spectrum);
+  }
+
+  if (suscan_gui_spectrum_gl_ready(spectrum->gl))
+    suscan_gui_spectrum_gl_queue_render(spectrum->gl);
 }
 
 /******************** Channel handling methods *******************************/
@@ -491,6 +581,8 @@ suscan_gui_spectrum_update_channels(
 
   spectrum->channel_list  = channel_list;
   spectrum->channel_count = channel_count;
+
+  suscan_gui_spectrum_gl_queue_render(spectrum->gl);
 }
 
 /*************************** Waterfall methods *******************************/
@@ -501,7 +593,9 @@ suscan_gui_spectrum_move_waterfall(
 {
   cairo_t *cr;
 
-  /* Take second surface and dump it to the first with an x-offset */
+  suscan_gui_spectrum_waterfall_snapshot(spectrum);
+
+  /* Dump the copy back to the ring with an x-offset */
   cr = cairo_create(spectrum->wf_surf[0]);
   cairo_set_source_rgb(cr, 0, 0, 0);
   cairo_paint(cr);
@@ -514,13 +608,6 @@ suscan_gui_spectrum_move_waterfall(
       spectrum->g_height);
   cairo_fill(cr);
   cairo_destroy(cr);
-
-  /* Copy first surface to the second */
-  cr = cairo_create(spectrum->wf_surf[1]);
-  cairo_set_source_surface(cr, spectrum->wf_surf[0], 0, 0);
-  cairo_rectangle(cr, 0, 0, spectrum->g_width, spectrum->g_height);
-  cairo_fill(cr);
-  cairo_destroy(cr);
 }
 
 SUPRIVATE void
@@ -530,7 +617,9 @@ suscan_gui_spectrum_scale_waterfall(
 {
   cairo_t *cr;
 
-  /* Take second surface and dump it scaled */
+  suscan_gui_spectrum_waterfall_snapshot(spectrum);
+
+  /* Dump the copy back to the ring, scaled */
   cr = cairo_create(spectrum->wf_surf[0]);
   cairo_set_source_rgb(cr, 0, 0, 0);
   cairo_paint(cr);
@@ -547,64 +636,45 @@ suscan_gui_spectrum_scale_waterfall(
       spectrum->g_height);
   cairo_fill(cr);
   cairo_destroy(cr);
-
-  /* Copy first surface to the second */
-  cr = cairo_create(spectrum->wf_surf[1]);
-  cairo_set_source_surface(cr, spectrum->wf_surf[0], 0, 0);
-  cairo_rectangle(cr, 0, 0, spectrum->g_width, spectrum->g_height);
-  cairo_fill(cr);
-  cairo_destroy(cr);
 }
 
-
-SUPRIVATE cairo_t *
-suscan_gui_spectrum_waterfall_flip(struct suscan_gui_spectrum *spectrum)
+/*
+ * The waterfall is kept as a ring of rows: new lines are written over the
+ * oldest one instead of scrolling the whole image down. Painting it
+ * starts from the newest row and wraps around.
+ */
+SUPRIVATE void
+suscan_gui_spectrum_paint_ring(
+    cairo_t *cr,
+    cairo_surface_t *ring,
+    int row,
+    int width,
+    int height,
+    double x,
+    double y)
 {
-  cairo_t *cr;
-
-  cr = cairo_create(spectrum->wf_surf[spectrum->flip]);
-
-  spectrum->flip = !spectrum->flip;
-  cairo_set_source_surface(
-      cr,
-      spectrum->wf_surf[spectrum->flip],
-      0, /* x */
-      1  /* y */);
-
-  /* Scroll existing waterfall to the bottom */
-  cairo_rectangle(
-      cr,
-      0, /* x */
-      0, /* y */
-      spectrum->g_width,
-      spectrum->g_height - 1);
+  cairo_set_source_surface(cr, ring, x, y - row);
+  cairo_rectangle(cr, x, y, width, height - row);
   cairo_fill(cr);
 
-  return cr;
+  if (row > 0) {
+    cairo_set_source_surface(cr, ring, x, y + height - row);
+    cairo_rectangle(cr, x, y + height - row, width, row);
+    cairo_fill(cr);
+  }
 }
 
+/* Horizontal moves don't care about row order: work on a plain copy */
 SUPRIVATE void
-suscan_gui_spectrum_get_waterfall_limits(
-    struct suscan_gui_spectrum *spectrum,
-    int *start_pix,
-    int *end_pix)
+suscan_gui_spectrum_waterfall_snapshot(struct suscan_gui_spectrum *spectrum)
 {
-  /* Compute boundaries */
-  *start_pix =
-      suscan_gui_spectrum_to_graph_x(
-          spectrum,
-          suscan_gui_spectrum_adjust_x(spectrum, -.5));
-
-  *end_pix =
-      suscan_gui_spectrum_to_graph_x(
-          spectrum,
-          suscan_gui_spectrum_adjust_x(spectrum, .5));
-
-  if (*start_pix < 0)
-    *start_pix = 0;
+  cairo_t *cr;
 
-  if (*end_pix >= spectrum->g_width)
-    *end_pix = spectrum->g_width;
+  cr = cairo_create(spectrum->wf_surf[1]);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(cr, spectrum->wf_surf[0], 0, 0);
+  cairo_paint(cr);
+  cairo_destroy(cr);
 }
 
 SUPRIVATE void
@@ -613,21 +683,15 @@ suscan_gui_spectrum_waterfall_dump(
     cairo_t *cr)
 {
   /* Dump waterfall to screen */
-  cairo_set_source_surface(
+  suscan_gui_spectrum_paint_ring(
       cr,
-      spectrum->wf_surf[spectrum->flip],
+      spectrum->wf_surf[0],
+      spectrum->wf_row,
+      spectrum->g_width,
+      spectrum->g_height,
       SUSCAN_GUI_SPECTRUM_LEFT_PADDING,
       SUSCAN_GUI_SPECTRUM_TOP_PADDING);
 
-  cairo_rectangle(
-      cr,
-      SUSCAN_GUI_SPECTRUM_LEFT_PADDING,
-      SUSCAN_GUI_SPECTRUM_TOP_PADDING,
-      spectrum->g_width,
-      spectrum->g_height);
-
-  cairo_fill(cr);
-
   /*
    * If we are asking to overlay channels, we darken the whole waterfall
    * so that channels painted on top are more visible
@@ -639,87 +703,188 @@ suscan_gui_spectrum_waterfall_dump(
   }
 }
 
+/* Gradient as packed RGB24 pixels, built on first use */
+SUPRIVATE uint32_t wf_palette[256];
+SUPRIVATE SUBOOL   wf_palette_init = SU_FALSE;
+
 SUPRIVATE void
-suscan_gui_spectrum_redraw_waterfall(struct suscan_gui_spectrum *spectrum)
+suscan_gui_spectrum_init_palette(void)
+{
+  unsigned int i;
+
+  for (i = 0; i < 256; ++i)
+    wf_palette[i] =
+          ((uint32_t) round(wf_gradient[i][0] * 255) << 16)
+        | ((uint32_t) round(wf_gradient[i][1] * 255) << 8)
+        |  (uint32_t) round(wf_gradient[i][2] * 255);
+
+  wf_palette_init = SU_TRUE;
+}
+
+/*
+ * Approximate SU_POWER_DB, in place. The error stays below .02 dB, much
+ * finer than the gradient resolution. It is written with integer clamps
+ * and no calls so the compiler is able to vectorize it.
+ */
+SUPRIVATE void
+suscan_gui_spectrum_levels_to_db(float *levels, int count)
+{
+  union {
+    float    f;
+    uint32_t i;
+  } x, m;
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    x.f = levels[i];
+    x.i = x.i < 0x0d800000 ? 0x0d800000 : x.i; /* Floor at 2^-100 */
+    m.i = (x.i & 0x007fffff) | 0x3f800000;     /* Mantissa in [1, 2) */
+
+    levels[i] = 3.01029996f * (
+        (float) ((int) (x.i >> 23) - 128)
+        + (-0.34484843f * m.f + 2.02466578f) * m.f
+        - 0.67487759f);
+  }
+}
+
+/* Map each waterfall column to its PSD bin. Only needed on zoom changes */
+SUPRIVATE void
+suscan_gui_spectrum_update_wf_bins(struct suscan_gui_spectrum *spectrum)
 {
   float x;
   int i, j;
-  int start;
-  int end;
-  int index;
-  const SUFLOAT *psd_data;
-  SUSCOUNT psd_size;
-  cairo_t *cr_wf = NULL;
-  float val;
-
-  psd_data = spectrum->psd_data;
-  psd_size = spectrum->psd_size;
-
-  if (psd_data != NULL) {
-    if (spectrum->last_update != spectrum->updates) {
-      spectrum->last_update = spectrum->updates;
-
-      /* Flip buffers */
-      cr_wf = suscan_gui_spectrum_waterfall_flip(spectrum);
-
-      /* Get waterfall limits */
-      suscan_gui_spectrum_get_waterfall_limits(spectrum, &start, &end);
-
-      /* Set background to black */
-      cairo_set_source_rgb(cr_wf, 0, 0, 0);
-      cairo_move_to(cr_wf, 0, 0);
-      cairo_line_to(cr_wf, spectrum->g_width - 1, 0);
-      cairo_stroke(cr_wf);
-
-      /* Paint new line */
-      for (i = start + 1; i < end; ++i) {
-        /*
-         * We have to conver the pixel coordinate back to the given
-         * point in the spectrum
-         */
-        x = suscan_gui_spectrum_adjust_x_inv(
-            spectrum,
-            suscan_gui_spectrum_from_graph_x(spectrum, i));
 
-        j = x * psd_size;
+  if (spectrum->wf_bins_valid
+      && spectrum->wf_bins_offset == spectrum->freq_offset
+      && spectrum->wf_bins_scale == spectrum->freq_scale
+      && spectrum->wf_bins_psd_size == spectrum->psd_size)
+    return;
 
-        /* Adjust for negative frequencies */
-        if (j < 0)
-          j += psd_size;
+  for (i = 0; i < spectrum->g_width; ++i) {
+    /* Convert the center of this column back to a point in the spectrum */
+    x = suscan_gui_spectrum_adjust_x_inv(
+        spectrum,
+        suscan_gui_spectrum_from_graph_x(spectrum, i + .5));
 
-        if (j < 0 || j >= psd_size)
-          break;
+    if (x < -.5 || x >= .5) {
+      spectrum->wf_bins[i] = -1;
+      continue;
+    }
 
-        val = 1 + suscan_gui_spectrum_adjust_y(
-            spectrum,
-            SU_POWER_DB(psd_data[j]) - 5);
+    j = x * spectrum->psd_size;
+
+    /* Adjust for negative frequencies */
+    if (j < 0)
+      j += spectrum->psd_size;
 
-        if (val < 0)
-          val = 0;
-        else if (val > 1)
-          val = 1;
+    spectrum->wf_bins[i] = j >= 0 && j < spectrum->psd_size ? j : -1;
+  }
 
-        index = round(val * 255);
+  spectrum->wf_bins_offset   = spectrum->freq_offset;
+  spectrum->wf_bins_scale    = spectrum->freq_scale;
+  spectrum->wf_bins_psd_size = spectrum->psd_size;
+  spectrum->wf_bins_valid    = SU_TRUE;
+}
 
-        /* TODO: add more gradients */
-        cairo_set_source_rgb(
-            cr_wf,
-            wf_gradient[index][0],
-            wf_gradient[index][1],
-            wf_gradient[index][2]);
+SUPRIVATE void
+suscan_gui_spectrum_redraw_waterfall(struct suscan_gui_spectrum *spectrum)
+{
+  int i;
+  int row;
+  float k, b, val;
+  uint32_t *pixels;
 
-        cairo_move_to(cr_wf, i - 1, 0);
-        cairo_line_to(cr_wf, i, 0);
-        cairo_stroke(cr_wf);
-      }
+  if (spectrum->psd_data == NULL
+      || spectrum->wf_bins == NULL
+      || spectrum->last_update == spectrum->updates)
+    return;
+
+  spectrum->last_update = spectrum->updates;
+
+  if (!wf_palette_init)
+    suscan_gui_spectrum_init_palette();
+
+  suscan_gui_spectrum_update_wf_bins(spectrum);
+
+  /* Gather the levels of this line and convert them to dB at once */
+  for (i = 0; i < spectrum->g_width; ++i)
+    spectrum->wf_line[i] = spectrum->wf_bins[i] >= 0
+        ? spectrum->psd_data[spectrum->wf_bins[i]]
+        : 0;
+
+  suscan_gui_spectrum_levels_to_db(spectrum->wf_line, spectrum->g_width);
+
+  /* Gradient index is linear in dB */
+  k = 255. / (spectrum->dbs_per_div * SUSCAN_GUI_VERTICAL_DIVS);
+  b = 255. - (spectrum->ref_level + 5) * k;
+
+  /* The oldest row is replaced by the new line */
+  row = (spectrum->wf_row + spectrum->g_height - 1) % spectrum->g_height;
+
+  cairo_surface_flush(spectrum->wf_surf[0]);
+
+  pixels = (uint32_t *) (
+      cairo_image_surface_get_data(spectrum->wf_surf[0])
+      + row * cairo_image_surface_get_stride(spectrum->wf_surf[0]));
+
+  for (i = 0; i < spectrum->g_width; ++i) {
+    if (spectrum->wf_bins[i] < 0) {
+      pixels[i] = 0;
+    } else {
+      val = spectrum->wf_line[i] * k + b;
+
+      if (val < 0)
+        val = 0;
+      else if (val > 255)
+        val = 255;
+
+      pixels[i] = wf_palette[(int) (val + .5f)];
     }
   }
 
-  if (cr_wf != NULL)
-    cairo_destroy(cr_wf);
+  cairo_surface_mark_dirty_rectangle(
+      spectrum->wf_surf[0],
+      0,
+      row,
+      spectrum->g_width,
+      1);
+
+  spectrum->wf_row = row;
 }
 
 /************************ Spectrogram drawing ********************************/
+SUPRIVATE void
+suscan_gui_spectrum_draw_noise_level(
+    struct suscan_gui_spectrum *spectrum,
+    cairo_t *cr)
+{
+  cairo_set_dash(cr, NULL, 0, 0);
+
+  /* Draw noise level (if applicable) */
+  if (spectrum->N0 > 0) {
+    cairo_set_source_rgb(cr, 0, 1., 1.);
+    cairo_move_to(
+        cr,
+        SUSCAN_SPECTRUM_TO_SCR(
+            spectrum,
+            -.5,
+            suscan_gui_spectrum_adjust_y(
+                spectrum,
+                SU_POWER_DB(spectrum->N0))));
+
+    cairo_line_to(
+        cr,
+        SUSCAN_SPECTRUM_TO_SCR(
+            spectrum,
+            .5,
+            suscan_gui_spectrum_adjust_y(
+                spectrum,
+                SU_POWER_DB(spectrum->N0))));
+
+    cairo_stroke(cr);
+  }
+}
+
 SUPRIVATE void
 suscan_gui_spectrum_redraw_spectrogram(
     struct suscan_gui_spectrum *spectrum,
@@ -734,31 +899,7 @@ suscan_gui_spectrum_redraw_spectrogram(
   if (spectrum->psd_data != NULL) {
     x_prev = .5;
 
-    cairo_set_dash(cr, NULL, 0, 0);
-
-    /* Draw noise level (if applicable) */
-    if (spectrum->N0 > 0) {
-      cairo_set_source_rgb(cr, 0, 1., 1.);
-      cairo_move_to(
-          cr,
-          SUSCAN_SPECTRUM_TO_SCR(
-              spectrum,
-              -.5,
-              suscan_gui_spectrum_adjust_y(
-                  spectrum,
-                  SU_POWER_DB(spectrum->N0))));
-
-      cairo_line_to(
-          cr,
-          SUSCAN_SPECTRUM_TO_SCR(
-              spectrum,
-              .5,
-              suscan_gui_spectrum_adjust_y(
-                  spectrum,
-                  SU_POWER_DB(spectrum->N0))));
-
-      cairo_stroke(cr);
-    }
+    suscan_gui_spectrum_draw_noise_level(spectrum, cr);
 
     cairo_set_source_rgb(cr, 1., 1., 0);
 
@@ -898,8 +1039,9 @@ suscan_gui_spectrum_redraw_axes(
   static const double axis_pattern[] = {5.0, 5.0};
   int i;
 
-  /* Paint in black */
-  cairo_paint(cr);
+  /* Paint in black, unless the GL area below is doing the background */
+  if (!suscan_gui_spectrum_gl_ready(spectrum->gl))
+    cairo_paint(cr);
 
   cairo_set_line_width(cr, 1);
 
@@ -1070,7 +1212,12 @@ suscan_gui_spectrum_redraw(
 {
   suscan_gui_spectrum_redraw_axes(spectrum, cr);
 
-  if (spectrum->mode == SUSCAN_GUI_SPECTRUM_MODE_SPECTROGRAM) {
+  if (suscan_gui_spectrum_gl_ready(spectrum->gl)) {
+    /* Trace and waterfall are rendered by the GL area */
+    if (spectrum->mode == SUSCAN_GUI_SPECTRUM_MODE_SPECTROGRAM
+        && spectrum->psd_data != NULL)
+      suscan_gui_spectrum_draw_noise_level(spectrum, cr);
+  } else if (spectrum->mode == SUSCAN_GUI_SPECTRUM_MODE_SPECTROGRAM) {
     suscan_gui_spectrum_redraw_spectrogram(spectrum, cr);
   } else {
     suscan_gui_spectrum_waterfall_dump(spectrum, cr);
@@ -1114,6 +1261,8 @@ suscan_gui_spectrum_parse_scroll(
       }
       break;
   }
+
+  suscan_gui_spectrum_gl_queue_render(spectrum->gl);
 }
 
 void
@@ -1161,6 +1310,8 @@ suscan_gui_spectrum_parse_motion(
   }
 
   spectrum->prev_ev_x = ev_adjusted.x;
+
+  suscan_gui_spectrum_gl_queue_render(spectrum->gl);
 }
 
 void
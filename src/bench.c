@@ -0,0 +1,517 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "bench"
+
+#include "suscan.h"
+
+#define SUSCAN_BENCH_SKIP_CHANNELS  20  /* Channel updates before opening */
+#define SUSCAN_BENCH_STATS_INTERVAL .25 /* Seconds */
+
+struct suscan_bench_insp {
+  struct sigutils_channel channel;
+  SUHANDLE handle;
+  uint64_t symbols;
+  uint64_t open_ns; /* When sample batches were requested */
+};
+
+struct suscan_bench_state {
+  struct suscan_bench_insp *insp_list;
+  unsigned int insp_count;
+
+  struct suscan_analyzer_stats_msg *stats; /* Most recent stats message */
+  uint64_t samples_read;
+  uint64_t run_time_ns;
+  uint64_t end_ns;
+  uint64_t samples_lost;
+};
+
+SUPRIVATE void
+suscan_bench_state_finalize(struct suscan_bench_state *state)
+{
+  if (state->insp_list != NULL)
+    free(state->insp_list);
+
+  if (state->stats != NULL)
+    suscan_analyzer_stats_msg_destroy(state->stats);
+}
+
+/* Open inspectors on the strongest channels found so far */
+SUPRIVATE SUBOOL
+suscan_bench_open_inspectors(
+    suscan_analyzer_t *analyzer,
+    struct suscan_bench_state *state,
+    const struct suscan_channel_set *set,
+    unsigned int max)
+{
+  struct sigutils_channel **ch_list = NULL;
+  unsigned int ch_count = 0;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      suscan_channel_set_snapshot(set, &ch_list, &ch_count),
+      goto done);
+
+  suscan_channel_list_sort(ch_list, ch_count);
+
+  state->insp_count = SU_MIN(max, ch_count);
+  if (state->insp_count < max)
+    SU_WARNING(
+        "Only %d channels found, opening %d inspectors\n",
+        ch_count,
+        state->insp_count);
+
+  if (state->insp_count > 0)
+    SU_TRYCATCH(
+        state->insp_list = calloc(
+            state->insp_count,
+            sizeof(struct suscan_bench_insp)),
+        goto done);
+
+  for (i = 0; i < state->insp_count; ++i) {
+    state->insp_list[i].channel = *ch_list[i];
+    state->insp_list[i].handle = -1;
+
+    SU_TRYCATCH(
+        suscan_analyzer_open_async(analyzer, ch_list[i], i),
+        goto done);
+  }
+
+  ok = SU_TRUE;
+
+done:
+  for (i = 0; i < ch_count; ++i)
+    free(ch_list[i]);
+
+  if (ch_list != NULL)
+    free(ch_list);
+
+  return ok;
+}
+
+/* Inspector replies. Request IDs are indices in insp_list */
+SUPRIVATE SUBOOL
+suscan_bench_on_inspector(
+    suscan_analyzer_t *analyzer,
+    struct suscan_bench_state *state,
+    const struct suscan_analyzer_inspector_msg *msg)
+{
+  struct suscan_inspector_params params;
+  struct suscan_bench_insp *insp;
+
+  if (msg->req_id >= state->insp_count)
+    return SU_TRUE;
+
+  insp = state->insp_list + msg->req_id;
+
+  switch (msg->kind) {
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+      insp->handle = msg->handle;
+
+      /* Plain sampler at the channel bandwidth, every symbol delivered */
+      suscan_inspector_params_initialize(&params);
+      params.inspector_id = msg->req_id;
+      params.baud = insp->channel.bw;
+
+      SU_TRYCATCH(
+          suscan_analyzer_set_inspector_params_async(
+              analyzer,
+              insp->handle,
+              &params,
+              msg->req_id),
+          return SU_FALSE);
+
+      insp->open_ns = suscan_stats_now_ns();
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE:
+      SU_WARNING("Inspector #%d: wrong handle\n", msg->req_id + 1);
+      insp->handle = -1;
+      break;
+
+    default:
+      break;
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_bench_print_hist_text(
+    const char *name,
+    const struct suscan_stats_histogram *hist)
+{
+  printf(
+      "  %-14s %10llu %10.1lf %10.1lf %10.1lf %10.1lf\n",
+      name,
+      (unsigned long long) hist->count,
+      hist->count > 0 ? 1e-3 * hist->total_ns / hist->count : 0,
+      1e-3 * suscan_stats_histogram_get_percentile(hist, .5),
+      1e-3 * suscan_stats_histogram_get_percentile(hist, .99),
+      1e-3 * hist->max_ns);
+}
+
+SUPRIVATE void
+suscan_bench_print_text(const struct suscan_bench_state *state)
+{
+  const struct suscan_analyzer_stats_msg *stats = state->stats;
+  const struct suscan_bench_insp *insp;
+  SUFLOAT elapsed;
+  char name[16];
+  unsigned int i;
+
+  printf(
+      "Detector: %llu samples in %.3lf s, %lg samples/s\n",
+      (unsigned long long) state->samples_read,
+      1e-9 * state->run_time_ns,
+      state->run_time_ns > 0
+          ? 1e9 * state->samples_read / (SUFLOAT) state->run_time_ns
+          : 0);
+
+  printf(
+      "Samples lost by the source: %llu\n",
+      (unsigned long long) state->samples_lost);
+
+  if (stats != NULL) {
+    printf(
+        "Port desyncs: %llu, read-ahead overruns: %llu\n",
+        (unsigned long long) stats->desyncs,
+        (unsigned long long) stats->read_ahead_overruns);
+
+    printf(
+        "Message pool: %llu nodes (peak %llu), %llu mallocs, "
+        "%llu refills, %llu spills\n",
+        (unsigned long long) stats->mq_pool.pool_size,
+        (unsigned long long) stats->mq_pool.pool_peak,
+        (unsigned long long) stats->mq_pool.mallocs,
+        (unsigned long long) stats->mq_pool.refills,
+        (unsigned long long) stats->mq_pool.spills);
+
+    printf(
+        "\n  %-14s %10s %10s %10s %10s %10s\n",
+        "Stage (us)", "count", "mean", "p50", "p99", "max");
+    suscan_bench_print_hist_text("source read", &stats->source_read);
+    suscan_bench_print_hist_text("detector feed", &stats->detector_feed);
+    suscan_bench_print_hist_text("psd send", &stats->psd_send);
+
+    printf(
+        "\n  %-14s %10s %10s %10s %10s %10s\n",
+        "Consumer (us)", "tasks", "mean", "p50", "p99", "max");
+    for (i = 0; i < stats->consumer_count; ++i) {
+      snprintf(name, sizeof(name), "#%d", i);
+      suscan_bench_print_hist_text(name, &stats->consumer_list[i].process);
+    }
+  }
+
+  if (state->insp_count > 0)
+    printf(
+        "\n  %-4s %14s %12s %12s %12s\n",
+        "id", "fc (Hz)", "baud", "symbols", "symbols/s");
+
+  for (i = 0; i < state->insp_count; ++i) {
+    insp = state->insp_list + i;
+    elapsed = insp->open_ns > 0 && state->end_ns > insp->open_ns
+        ? 1e-9 * (state->end_ns - insp->open_ns)
+        : 0;
+
+    printf(
+        "  %-4d %+14.1lf %12.1lf %12llu %12.1lf\n",
+        i + 1,
+        insp->channel.fc,
+        insp->channel.bw,
+        (unsigned long long) insp->symbols,
+        elapsed > 0 ? insp->symbols / elapsed : 0);
+  }
+
+  if (stats != NULL)
+    for (i = 0; i < stats->inspector_count; ++i)
+      if (stats->inspector_list[i].samples_lost > 0)
+        printf(
+            "Inspector #%d lagged behind, %llu samples dropped\n",
+            stats->inspector_list[i].inspector_id + 1,
+            (unsigned long long) stats->inspector_list[i].samples_lost);
+}
+
+SUPRIVATE void
+suscan_bench_print_hist_json(
+    const char *name,
+    const struct suscan_stats_histogram *hist,
+    SUBOOL last)
+{
+  printf(
+      "    \"%s\": {\"count\": %llu, \"mean_ns\": %llu, \"p50_ns\": %llu, "
+      "\"p99_ns\": %llu, \"max_ns\": %llu}%s\n",
+      name,
+      (unsigned long long) hist->count,
+      (unsigned long long) (hist->count > 0
+          ? hist->total_ns / hist->count
+          : 0),
+      (unsigned long long) suscan_stats_histogram_get_percentile(hist, .5),
+      (unsigned long long) suscan_stats_histogram_get_percentile(hist, .99),
+      (unsigned long long) hist->max_ns,
+      last ? "" : ",");
+}
+
+SUPRIVATE uint64_t
+suscan_bench_get_insp_lost(
+    const struct suscan_bench_state *state,
+    unsigned int id)
+{
+  unsigned int i;
+
+  if (state->stats != NULL)
+    for (i = 0; i < state->stats->inspector_count; ++i)
+      if (state->stats->inspector_list[i].inspector_id == id)
+        return state->stats->inspector_list[i].samples_lost;
+
+  return 0;
+}
+
+SUPRIVATE void
+suscan_bench_print_json(const struct suscan_bench_state *state)
+{
+  const struct suscan_analyzer_stats_msg *stats = state->stats;
+  const struct suscan_stats_histogram *process;
+  const struct suscan_bench_insp *insp;
+  SUFLOAT elapsed;
+  unsigned int i;
+
+  printf("{\n");
+  printf(
+      "  \"samples\": %llu,\n",
+      (unsigned long long) state->samples_read);
+  printf(
+      "  \"run_time_ns\": %llu,\n",
+      (unsigned long long) state->run_time_ns);
+  printf(
+      "  \"samples_per_second\": %lg,\n",
+      state->run_time_ns > 0
+          ? 1e9 * state->samples_read / (SUFLOAT) state->run_time_ns
+          : 0);
+  printf(
+      "  \"samples_lost\": %llu,\n",
+      (unsigned long long) state->samples_lost);
+
+  if (stats != NULL) {
+    printf(
+        "  \"desyncs\": %llu,\n",
+        (unsigned long long) stats->desyncs);
+    printf(
+        "  \"read_ahead_overruns\": %llu,\n",
+        (unsigned long long) stats->read_ahead_overruns);
+    printf(
+        "  \"mq_pool\": {\"pool_size\": %llu, \"pool_peak\": %llu, "
+        "\"mallocs\": %llu, \"refills\": %llu, \"spills\": %llu, "
+        "\"thread_caches\": %llu},\n",
+        (unsigned long long) stats->mq_pool.pool_size,
+        (unsigned long long) stats->mq_pool.pool_peak,
+        (unsigned long long) stats->mq_pool.mallocs,
+        (unsigned long long) stats->mq_pool.refills,
+        (unsigned long long) stats->mq_pool.spills,
+        (unsigned long long) stats->mq_pool.thread_caches);
+
+    printf("  \"stages\": {\n");
+    suscan_bench_print_hist_json("source_read", &stats->source_read, 0);
+    suscan_bench_print_hist_json("detector_feed", &stats->detector_feed, 0);
+    suscan_bench_print_hist_json("psd_send", &stats->psd_send, 1);
+    printf("  },\n");
+
+    printf("  \"consumers\": [\n");
+    for (i = 0; i < stats->consumer_count; ++i) {
+      process = &stats->consumer_list[i].process;
+      printf(
+          "    {\"tasks_run\": %llu, \"tasks_stolen\": %llu, "
+          "\"mean_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+          "\"max_ns\": %llu}%s\n",
+          (unsigned long long) stats->consumer_list[i].tasks_run,
+          (unsigned long long) stats->consumer_list[i].tasks_stolen,
+          (unsigned long long) (process->count > 0
+              ? process->total_ns / process->count
+              : 0),
+          (unsigned long long)
+              suscan_stats_histogram_get_percentile(process, .5),
+          (unsigned long long)
+              suscan_stats_histogram_get_percentile(process, .99),
+          (unsigned long long) process->max_ns,
+          i + 1 < stats->consumer_count ? "," : "");
+    }
+    printf("  ],\n");
+  }
+
+  printf("  \"inspectors\": [\n");
+  for (i = 0; i < state->insp_count; ++i) {
+    insp = state->insp_list + i;
+    elapsed = insp->open_ns > 0 && state->end_ns > insp->open_ns
+        ? 1e-9 * (state->end_ns - insp->open_ns)
+        : 0;
+
+    printf(
+        "    {\"fc\": %lg, \"baud\": %lg, \"symbols\": %llu, "
+        "\"symbols_per_second\": %lg, \"samples_lost\": %llu}%s\n",
+        insp->channel.fc,
+        insp->channel.bw,
+        (unsigned long long) insp->symbols,
+        elapsed > 0 ? insp->symbols / elapsed : 0,
+        (unsigned long long) suscan_bench_get_insp_lost(state, i),
+        i + 1 < state->insp_count ? "," : "");
+  }
+  printf("  ]\n");
+  printf("}\n");
+}
+
+/*
+ * Headless throughput benchmark: run the source as fast as possible,
+ * open inspectors on the strongest channels and report how the pipeline
+ * kept up. Runs until the end of the stream, or for duration seconds.
+ */
+SUBOOL
+suscan_run_bench(
+    struct suscan_source_config *config,
+    unsigned int inspectors,
+    SUFLOAT duration,
+    SUBOOL json)
+{
+  struct suscan_mq mq;
+  void *private;
+  uint32_t type;
+  suscan_analyzer_t *analyzer = NULL;
+  struct suscan_analyzer_params params = suscan_analyzer_params_INITIALIZER;
+  const struct suscan_analyzer_sample_batch_msg *batch;
+  const struct suscan_analyzer_status_msg *st_msg;
+  struct suscan_bench_state state;
+  struct suscan_channel_set set;
+  unsigned int chskip = SUSCAN_BENCH_SKIP_CHANNELS;
+  uint64_t start;
+  SUBOOL opened = inspectors == 0;
+  SUBOOL running = SU_TRUE;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&state, 0, sizeof(struct suscan_bench_state));
+
+  params.unthrottled = SU_TRUE;
+  params.stats_update_int = SUSCAN_BENCH_STATS_INTERVAL;
+
+  suscan_channel_set_init(&set);
+
+  if (!suscan_mq_init_ring(&mq, SUSCAN_MQ_DEFAULT_RING_SIZE)) {
+    suscan_channel_set_finalize(&set);
+    return SU_FALSE;
+  }
+
+  SU_TRYCATCH(analyzer = suscan_analyzer_new(&params, config, &mq), goto done);
+
+  start = suscan_stats_now_ns();
+
+  while (running) {
+    private = suscan_analyzer_read(analyzer, &type);
+
+    switch (type) {
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+        SU_TRYCATCH(
+            suscan_channel_set_apply(
+                &set,
+                (struct suscan_analyzer_channel_msg *) private),
+            running = SU_FALSE);
+
+        if (!opened && chskip > 0) {
+          --chskip;
+        } else if (!opened) {
+          SU_TRYCATCH(
+              suscan_bench_open_inspectors(
+                  analyzer,
+                  &state,
+                  &set,
+                  inspectors),
+              running = SU_FALSE);
+          opened = SU_TRUE;
+        }
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+        SU_TRYCATCH(
+            suscan_bench_on_inspector(analyzer, &state, private),
+            running = SU_FALSE);
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+        batch = (struct suscan_analyzer_sample_batch_msg *) private;
+        if (batch->inspector_id < state.insp_count)
+          state.insp_list[batch->inspector_id].symbols += batch->sample_count;
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES_LOST:
+        state.samples_lost +=
+            ((struct suscan_analyzer_samples_lost_msg *) private)->lost;
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_STATS:
+        /* Keep it, dispose the previous one instead */
+        if (state.stats != NULL)
+          suscan_analyzer_stats_msg_destroy(state.stats);
+        state.stats = private;
+        private = NULL;
+        break;
+
+      case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+        st_msg = (struct suscan_analyzer_status_msg *) private;
+        if (st_msg->err_msg != NULL)
+          SU_INFO("End of stream: %s\n", st_msg->err_msg);
+        running = SU_FALSE;
+        break;
+    }
+
+    if (private != NULL)
+      suscan_analyzer_dispose_message(type, private);
+
+    if (duration > 0 && suscan_stats_now_ns() - start >= duration * 1e9)
+      running = SU_FALSE;
+  }
+
+  /* Freeze the counters before the analyzer is torn down */
+  state.end_ns = suscan_stats_now_ns();
+  state.run_time_ns = suscan_analyzer_get_run_time_ns(analyzer);
+  state.samples_read =
+      __atomic_load_n(&analyzer->samp_total, __ATOMIC_RELAXED);
+
+  if (json)
+    suscan_bench_print_json(&state);
+  else
+    suscan_bench_print_text(&state);
+
+  ok = SU_TRUE;
+
+done:
+  if (analyzer != NULL)
+    suscan_analyzer_destroy(analyzer);
+
+  suscan_analyzer_consume_mq(&mq);
+  suscan_mq_finalize(&mq);
+
+  suscan_channel_set_finalize(&set);
+
+  suscan_bench_state_finalize(&state);
+
+  return ok;
+}
@@ -87,27 +87,82 @@ fail:
   return NULL;
 }
 
+/*
+ * Inspector requests are sent in a single burst, using the channel index
+ * as request ID. Replies may arrive in any order: they are matched to
+ * their channels here.
+ */
+SUPRIVATE SUBOOL
+suscan_collect_replies(
+    suscan_analyzer_t *analyzer,
+    struct suscan_fingerprint_report *report,
+    unsigned int pending)
+{
+  struct suscan_analyzer_inspector_msg *resp;
+  struct suscan_fingerprint_chresult *result;
+  SUBOOL ok = SU_TRUE;
+
+  while (pending-- > 0) {
+    SU_TRYCATCH(
+        resp = suscan_analyzer_read_inspector_msg(analyzer),
+        return SU_FALSE);
+
+    if (resp->req_id >= report->result_count) {
+      SU_ERROR("Unmatched response received\n");
+      ok = SU_FALSE;
+    } else {
+      result = report->results + resp->req_id;
+
+      switch (resp->kind) {
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+          result->br_handle = resp->handle;
+          break;
+
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INFO:
+          result->baudrate = resp->baud;
+          break;
+
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE:
+          result->br_handle = -1;
+          break;
+
+        case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE:
+          SU_WARNING(
+              "Wrong handle passed to analyzer (channel #%d)\n",
+              resp->req_id + 1);
+          ok = SU_FALSE;
+          break;
+
+        default:
+          SU_ERROR("Unexpected message kind %d\n", resp->kind);
+          ok = SU_FALSE;
+      }
+    }
+
+    suscan_analyzer_inspector_msg_destroy(resp);
+  }
+
+  return ok;
+}
+
 SUBOOL
 suscan_open_all_channels(
     suscan_analyzer_t *analyzer,
     struct suscan_fingerprint_report *report)
 {
   unsigned int i;
-  SUHANDLE handle;
 
-  for (i = 0; i < report->result_count; ++i) {
-    handle = suscan_analyzer_open(
+  for (i = 0; i < report->result_count; ++i)
+    if (!suscan_analyzer_open_async(
         analyzer,
-        &report->results[i].channel);
-    if (handle == -1) {
+        &report->results[i].channel,
+        i)) {
       SU_ERROR("Failed to open baud inspector\n");
+      (void) suscan_collect_replies(analyzer, report, i);
       return SU_FALSE;
     }
 
-    report->results[i].br_handle = handle;
-  }
-
-  return SU_TRUE;
+  return suscan_collect_replies(analyzer, report, report->result_count);
 }
 
 void
@@ -116,13 +171,17 @@ suscan_close_all_channels(
     struct suscan_fingerprint_report *report)
 {
   unsigned int i;
-  SUHANDLE handle;
+  unsigned int pending = 0;
 
   for (i = 0; i < report->result_count; ++i)
     if (report->results[i].br_handle >= 0)
-      (void) suscan_analyzer_close(
+      if (suscan_analyzer_close_async(
           analyzer,
-          report->results[i].br_handle);
+          report->results[i].br_handle,
+          i))
+        ++pending;
+
+  (void) suscan_collect_replies(analyzer, report, pending);
 }
 
 SUBOOL
@@ -131,19 +190,18 @@ suscan_get_all_baudrates(
     struct suscan_fingerprint_report *report)
 {
   unsigned int i;
-  SUHANDLE handle;
 
-  for (i = 0; i < report->result_count; ++i) {
-    if (!suscan_analyzer_get_info(
+  for (i = 0; i < report->result_count; ++i)
+    if (!suscan_analyzer_get_info_async(
         analyzer,
         report->results[i].br_handle,
-        &report->results[i].baudrate)) {
+        i)) {
       SU_ERROR("Failed to get baudrate for channel #%d\n", i + 1);
+      (void) suscan_collect_replies(analyzer, report, i);
       return SU_FALSE;
     }
-  }
 
-  return SU_TRUE;
+  return suscan_collect_replies(analyzer, report, report->result_count);
 }
 
 void
@@ -167,8 +225,17 @@ suscan_print_report(
         round(report->results[i].baudrate.nln));
 }
 
-SUBOOL
-suscan_perform_fingerprint(struct suscan_source_config *config)
+/*
+ * Fingerprint a single capture. pool holds the consumers of the analyzer
+ * (NULL: its own). On success, *report_out is the complete report, or
+ * NULL if the stream ended before baud rates were measured.
+ */
+SUPRIVATE SUBOOL
+suscan_fingerprint_run(
+    struct suscan_source_config *config,
+    suscan_consumer_pool_t *pool,
+    struct suscan_fingerprint_report **report_out,
+    SUFLOAT *read_rate)
 {
   struct suscan_mq mq;
   void *private;
@@ -178,14 +245,28 @@ suscan_perform_fingerprint(struct suscan_source_config *config)
   const struct suscan_analyzer_channel_msg *ch_msg;
   const struct suscan_analyzer_status_msg  *st_msg;
   struct suscan_fingerprint_report *report = NULL;
+  struct suscan_channel_set set;
+  struct sigutils_channel **ch_list = NULL;
+  unsigned int ch_count = 0;
   unsigned int chskip = SUSCAN_CHLIST_SKIP_CHANNELS;
   unsigned int i;
   unsigned int n = 0;
   SUBOOL running = SU_TRUE;
+  SUBOOL complete = SU_FALSE;
   SUBOOL ok = SU_FALSE;
 
-  if (!suscan_mq_init(&mq))
+  /* This is a batch job, there's no need to pace recorded captures */
+  params.unthrottled = SU_TRUE;
+  params.consumer_pool = pool;
+
+  *report_out = NULL;
+
+  suscan_channel_set_init(&set);
+
+  if (!suscan_mq_init_ring(&mq, SUSCAN_MQ_DEFAULT_RING_SIZE)) {
+    suscan_channel_set_finalize(&set);
     return SU_FALSE;
+  }
 
   SU_TRYCATCH(analyzer = suscan_analyzer_new(&params, config, &mq), goto done);
 
@@ -195,13 +276,23 @@ suscan_perform_fingerprint(struct suscan_source_config *config)
     switch (type) {
       case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
         ch_msg = (struct suscan_analyzer_channel_msg *) private;
-        if (chskip > 0) {
+        if (!suscan_channel_set_apply(&set, ch_msg)) {
+          SU_ERROR("Failed to update channel list\n");
+          running = SU_FALSE;
+        } else if (chskip > 0) {
           --chskip;
         } else if (report == NULL) {
-          suscan_channel_list_sort(ch_msg->channel_list, ch_msg->channel_count);
-          if ((report = suscan_fingerprint_report_new(
-              ch_msg->channel_list,
-              ch_msg->channel_count)) == NULL) {
+          if (suscan_channel_set_snapshot(&set, &ch_list, &ch_count)) {
+            suscan_channel_list_sort(ch_list, ch_count);
+            report = suscan_fingerprint_report_new(ch_list, ch_count);
+
+            for (i = 0; i < ch_count; ++i)
+              free(ch_list[i]);
+            if (ch_list != NULL)
+              free(ch_list);
+          }
+
+          if (report == NULL) {
             SU_ERROR("Failed to create report\n");
             running = SU_FALSE;
           } else if (!suscan_open_all_channels(analyzer, report)) {
@@ -215,11 +306,10 @@ suscan_perform_fingerprint(struct suscan_source_config *config)
                 chskip);
           }
         } else {
-          if (!suscan_get_all_baudrates(analyzer, report)) {
+          if (!suscan_get_all_baudrates(analyzer, report))
             SU_ERROR("Failed to get all baudrates\n");
-          } else {
-            suscan_print_report(report);
-          }
+          else
+            complete = SU_TRUE;
 
           running = SU_FALSE;
         }
@@ -241,12 +331,20 @@ suscan_perform_fingerprint(struct suscan_source_config *config)
     suscan_analyzer_dispose_message(type, private);
   }
 
+  *read_rate = suscan_analyzer_get_read_rate(analyzer);
+
+  SU_INFO("Average read rate: %lg samples per second\n", *read_rate);
+
   ok = SU_TRUE;
 
 done:
   if (report != NULL) {
     suscan_close_all_channels(analyzer, report);
-    suscan_fingerprint_report_destroy(report);
+
+    if (ok && complete)
+      *report_out = report;
+    else
+      suscan_fingerprint_report_destroy(report);
   }
 
   if (analyzer != NULL)
@@ -255,5 +353,196 @@ done:
   suscan_analyzer_consume_mq(&mq);
   suscan_mq_finalize(&mq);
 
+  suscan_channel_set_finalize(&set);
+
   return ok;
 }
+
+SUBOOL
+suscan_perform_fingerprint(struct suscan_source_config *config)
+{
+  struct suscan_fingerprint_report *report;
+  SUFLOAT read_rate;
+
+  if (!suscan_fingerprint_run(config, NULL, &report, &read_rate))
+    return SU_FALSE;
+
+  if (report != NULL) {
+    suscan_print_report(report);
+    suscan_fingerprint_report_destroy(report);
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Batch fingerprinting. jobs captures are processed at once, taken in
+ * order from a shared index. All analyzers share the consumers a single
+ * analyzer would use, so the CPUs are not oversubscribed. Reports are
+ * printed as each capture completes, as JSON lines if requested.
+ */
+struct suscan_fingerprint_batch {
+  struct suscan_source_config **config_list;
+  const char **name_list;
+  unsigned int count;
+  unsigned int next;
+  suscan_consumer_pool_t *pool;
+  unsigned int failed;
+  SUBOOL json;
+  pthread_mutex_t print_mutex;
+};
+
+SUPRIVATE void
+suscan_print_json_string(const char *str)
+{
+  putchar('"');
+
+  for (; *str != '\0'; ++str)
+    if (*str == '"' || *str == '\\')
+      printf("\\%c", *str);
+    else if ((unsigned char) *str < 0x20)
+      printf("\\u%04x", (unsigned char) *str);
+    else
+      putchar(*str);
+
+  putchar('"');
+}
+
+SUPRIVATE void
+suscan_print_report_json(
+    const char *name,
+    const struct suscan_fingerprint_report *report,
+    SUFLOAT read_rate)
+{
+  unsigned int i;
+
+  printf("{\"source\": ");
+  suscan_print_json_string(name);
+
+  if (report == NULL) {
+    printf(", \"complete\": false}\n");
+    return;
+  }
+
+  printf(
+      ", \"complete\": true, \"read_rate\": %lg, \"channels\": [",
+      read_rate);
+
+  for (i = 0; i < report->result_count; ++i)
+    printf(
+        "%s{\"fc\": %lg, \"bw\": %lg, \"f_lo\": %lg, \"f_hi\": %lg, "
+        "\"snr\": %lg, \"baud_fac\": %lg, \"baud_nln\": %lg}",
+        i > 0 ? ", " : "",
+        report->results[i].channel.fc,
+        report->results[i].channel.bw,
+        report->results[i].channel.f_lo,
+        report->results[i].channel.f_hi,
+        report->results[i].channel.snr,
+        report->results[i].baudrate.fac,
+        report->results[i].baudrate.nln);
+
+  printf("]}\n");
+}
+
+SUPRIVATE void *
+suscan_fingerprint_batch_thread(void *data)
+{
+  struct suscan_fingerprint_batch *batch =
+      (struct suscan_fingerprint_batch *) data;
+  struct suscan_fingerprint_report *report;
+  SUFLOAT read_rate = 0;
+  SUBOOL ok;
+  unsigned int i;
+
+  while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED))
+      < batch->count) {
+    ok = suscan_fingerprint_run(
+        batch->config_list[i],
+        batch->pool,
+        &report,
+        &read_rate);
+
+    pthread_mutex_lock(&batch->print_mutex);
+
+    if (!ok) {
+      fprintf(stderr, "cannot fingerprint `%s'\n", batch->name_list[i]);
+      ++batch->failed;
+    } else if (batch->json) {
+      suscan_print_report_json(batch->name_list[i], report, read_rate);
+    } else {
+      printf("\n%s:\n", batch->name_list[i]);
+      if (report != NULL)
+        suscan_print_report(report);
+      else
+        printf("  (stream ended before the channels were measured)\n");
+    }
+
+    fflush(stdout);
+
+    pthread_mutex_unlock(&batch->print_mutex);
+
+    if (report != NULL)
+      suscan_fingerprint_report_destroy(report);
+  }
+
+  return NULL;
+}
+
+SUBOOL
+suscan_perform_fingerprint_batch(
+    struct suscan_source_config **config_list,
+    const char **name_list,
+    unsigned int count,
+    unsigned int jobs,
+    SUBOOL json)
+{
+  struct suscan_fingerprint_batch batch;
+  struct suscan_analyzer_params params = suscan_analyzer_params_INITIALIZER;
+  pthread_t *thread_list = NULL;
+  unsigned int started = 0;
+  unsigned int i;
+  SUBOOL ok = SU_FALSE;
+
+  memset(&batch, 0, sizeof(struct suscan_fingerprint_batch));
+
+  batch.config_list = config_list;
+  batch.name_list = name_list;
+  batch.count = count;
+  batch.json = json;
+
+  jobs = SU_MAX(SU_MIN(jobs, count), 1);
+
+  /* Same consumers as a single analyzer: one per CPU but one */
+  SU_TRYCATCH(batch.pool = suscan_consumer_pool_new(&params), return SU_FALSE);
+
+  if (pthread_mutex_init(&batch.print_mutex, NULL) != 0) {
+    suscan_consumer_pool_release(batch.pool);
+    return SU_FALSE;
+  }
+
+  SU_TRYCATCH(thread_list = calloc(jobs, sizeof(pthread_t)), goto done);
+
+  for (started = 0; started < jobs; ++started)
+    SU_TRYCATCH(
+        pthread_create(
+            thread_list + started,
+            NULL,
+            suscan_fingerprint_batch_thread,
+            &batch) == 0,
+        break);
+
+  ok = started > 0;
+
+done:
+  for (i = 0; i < started; ++i)
+    pthread_join(thread_list[i], NULL);
+
+  if (thread_list != NULL)
+    free(thread_list);
+
+  pthread_mutex_destroy(&batch.print_mutex);
+
+  suscan_consumer_pool_release(batch.pool);
+
+  return ok && batch.failed == 0;
+}
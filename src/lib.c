@@ -18,25 +18,53 @@
 
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
 #include <pthread.h>
 #include <string.h>
 #include <sigutils/sigutils.h>
 #include <util.h>
 #include "suscan.h"
 
-#define SUSCAN_MAX_MESSAGES 1024
-
-struct suscan_message {
+/*
+ * Log capture. Every thread that logs gets its own ring of preformatted
+ * records, written without locks: the only shared state is a global
+ * sequence number, used to put records from different rings back in
+ * order when they are exported. Each record is protected by a sequence
+ * lock, so readers simply skip records overwritten while copying them.
+ * Rings of finished threads are handed over to new ones.
+ */
+#define SUSCAN_LOG_RING_SIZE    128
+#define SUSCAN_LOG_RECORD_SIZE  192
+#define SUSCAN_LOG_REPEAT_TIME  1 /* Seconds between repeated messages */
+
+struct suscan_log_record {
+  unsigned int gen; /* Odd while being written, 0 if never used */
+  uint64_t seq;
   enum sigutils_log_severity severity;
   struct timeval time;
-  char *category;
-  char *message;
+  char message[SUSCAN_LOG_RECORD_SIZE];
+};
+
+struct suscan_log_ring {
+  struct suscan_log_record record[SUSCAN_LOG_RING_SIZE];
+  unsigned int ptr;
+  SUBOOL in_use; /* Owned by a running thread */
+
+  /* Repeated message suppression */
+  uint32_t last_hash;
+  struct timeval last_time;
+  unsigned int repeated;
+
+  struct suscan_log_ring *next;
 };
 
-SUPRIVATE pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
-SUPRIVATE struct suscan_message *message_ring[SUSCAN_MAX_MESSAGES];
-SUPRIVATE unsigned int message_ptr;
-SUPRIVATE unsigned int message_count;
+SUPRIVATE struct suscan_log_ring *log_ring_list;
+SUPRIVATE uint64_t log_seq;
+SUPRIVATE pthread_once_t log_once = PTHREAD_ONCE_INIT;
+SUPRIVATE pthread_key_t log_key;
+SUPRIVATE __thread struct suscan_log_ring *log_ring_self;
 
 SUPRIVATE char
 suscan_severity_to_char(enum sigutils_log_severity sev)
@@ -49,142 +77,247 @@ suscan_severity_to_char(enum sigutils_log_severity sev)
   return sevstr[sev];
 }
 
-
 SUPRIVATE SUBOOL
-suscan_log_lock(void)
+suscan_log_timeval_after(const struct timeval *a, const struct timeval *b)
 {
-  return pthread_mutex_lock(&log_mutex) != -1;
+  return a->tv_sec > b->tv_sec
+      || (a->tv_sec == b->tv_sec && a->tv_usec > b->tv_usec);
 }
 
+/* Thread is gone: the next thread that logs may take its ring */
 SUPRIVATE void
-suscan_log_unlock(void)
+suscan_log_ring_release(void *data)
 {
-  (void) pthread_mutex_unlock(&log_mutex);
+  struct suscan_log_ring *ring = (struct suscan_log_ring *) data;
+
+  __atomic_store_n(&ring->in_use, SU_FALSE, __ATOMIC_RELEASE);
 }
 
 SUPRIVATE void
-suscan_message_destroy(struct suscan_message *msg)
+suscan_log_init_key(void)
 {
-  if (msg->category != NULL)
-    free(msg->category);
-
-  if (msg->message != NULL)
-    free(msg->message);
+  (void) pthread_key_create(&log_key, suscan_log_ring_release);
 }
 
-SUPRIVATE struct suscan_message *
-suscan_message_new_from_log_message(const struct sigutils_log_message *logmsg)
+SUPRIVATE struct suscan_log_ring *
+suscan_log_get_ring(void)
 {
-  struct suscan_message *msg = NULL;
+  struct suscan_log_ring *ring;
+
+  if (log_ring_self != NULL)
+    return log_ring_self;
+
+  (void) pthread_once(&log_once, suscan_log_init_key);
+
+  ring = __atomic_load_n(&log_ring_list, __ATOMIC_ACQUIRE);
+  while (ring != NULL
+      && __atomic_exchange_n(&ring->in_use, SU_TRUE, __ATOMIC_ACQUIRE))
+    ring = ring->next;
+
+  if (ring == NULL) {
+    /* Once per thread at most */
+    if ((ring = calloc(1, sizeof(struct suscan_log_ring))) == NULL)
+      return NULL;
+
+    ring->in_use = SU_TRUE;
+    ring->next = __atomic_load_n(&log_ring_list, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(
+        &log_ring_list,
+        &ring->next,
+        ring,
+        SU_TRUE,
+        __ATOMIC_RELEASE,
+        __ATOMIC_RELAXED));
+  }
 
-  if ((msg = calloc(1, sizeof (struct suscan_message))) == NULL)
-    goto fail;
+  ring->last_hash = 0;
+  ring->repeated = 0;
 
-  if ((msg->category = strdup(logmsg->domain)) == NULL)
-    goto fail;
+  (void) pthread_setspecific(log_key, ring);
+  log_ring_self = ring;
 
-  if ((msg->message = strdup(logmsg->message)) == NULL)
-    goto fail;
+  return ring;
+}
 
-  msg->time = logmsg->time;
-  msg->severity = logmsg->severity;
+SUPRIVATE void
+suscan_log_ring_put(
+    struct suscan_log_ring *ring,
+    enum sigutils_log_severity severity,
+    const struct timeval *time,
+    const char *fmt,
+    ...)
+{
+  struct suscan_log_record *rec = ring->record + ring->ptr;
+  unsigned int gen = rec->gen;
+  va_list ap;
+  int len;
 
-  return msg;
+  __atomic_store_n(&rec->gen, gen + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
 
-fail:
-  if (msg != NULL)
-    suscan_message_destroy(msg);
+  rec->seq = __atomic_fetch_add(&log_seq, 1, __ATOMIC_RELAXED);
+  rec->severity = severity;
+  rec->time = *time;
 
-  return NULL;
-}
+  va_start(ap, fmt);
+  len = vsnprintf(rec->message, SUSCAN_LOG_RECORD_SIZE, fmt, ap);
+  va_end(ap);
 
-/* Keep a circular list of log messages */
-SUPRIVATE SUBOOL
-suscan_log_push_log_message(const struct sigutils_log_message *logmsg)
-{
-  struct suscan_message *msg;
+  /* Truncated: keep the line break */
+  if (len >= SUSCAN_LOG_RECORD_SIZE)
+    rec->message[SUSCAN_LOG_RECORD_SIZE - 2] = '\n';
 
-  if ((msg = suscan_message_new_from_log_message(logmsg)) == NULL)
-    return SU_FALSE;
+  __atomic_store_n(&rec->gen, gen + 2, __ATOMIC_RELEASE);
 
-  if (message_ring[message_ptr] != NULL)
-    suscan_message_destroy(message_ring[message_ptr]);
+  ring->ptr = (ring->ptr + 1) % SUSCAN_LOG_RING_SIZE;
+}
 
-  message_ring[message_ptr++] = msg;
+/*
+ * Messages that only differ in their numbers ("Samples lost: 1024")
+ * are the same message as far as repetition goes.
+ */
+SUPRIVATE uint32_t
+suscan_log_message_hash(const struct sigutils_log_message *logmsg)
+{
+  uint32_t hash = 2166136261u;
+  const char *p;
 
-  if (message_ptr == SUSCAN_MAX_MESSAGES)
-    message_ptr = 0;
+  for (p = logmsg->domain; *p != '\0'; ++p)
+    hash = (hash ^ (unsigned char) *p) * 16777619u;
 
-  if (message_count < SUSCAN_MAX_MESSAGES)
-    ++message_count;
+  for (p = logmsg->message; *p != '\0'; ++p)
+    if (*p < '0' || *p > '9')
+      hash = (hash ^ (unsigned char) *p) * 16777619u;
 
-  return SU_TRUE;
+  return hash | 1; /* Never 0, which means no previous message */
 }
 
 SUPRIVATE void
 suscan_log_func(void *private, const struct sigutils_log_message *logmsg)
 {
-  if (!suscan_log_lock())
+  struct suscan_log_ring *ring;
+  uint32_t hash;
+
+  if ((ring = suscan_log_get_ring()) == NULL)
     return;
 
-  (void) suscan_log_push_log_message(logmsg);
+  hash = suscan_log_message_hash(logmsg);
 
-  suscan_log_unlock();
-}
+  if (hash == ring->last_hash
+      && logmsg->time.tv_sec - ring->last_time.tv_sec
+        < SUSCAN_LOG_REPEAT_TIME) {
+    ++ring->repeated;
+    return;
+  }
 
-char *
-suscan_log_get_last_messages(struct timeval since, unsigned int max)
-{
-  char *result = NULL;
-  char *tmp = NULL;
-  unsigned int i, id;
-  unsigned int count;
-
-  if ((result = calloc(1, 1)) == NULL)
-    goto fail;
-
-  if (!suscan_log_lock())
-    goto fail;
-
-  count = MIN(message_count, max);
-
-  for (i = 0; i < count; ++i) {
-    id =
-        (SUSCAN_MAX_MESSAGES + message_ptr - count + i)
-        % SUSCAN_MAX_MESSAGES;
-
-    if (message_ring[id] != NULL)
-      if (message_ring[id]->time.tv_sec > since.tv_sec
-          || (message_ring[id]->time.tv_sec == since.tv_sec
-              && message_ring[id]->time.tv_usec > since.tv_usec)) {
-        if ((tmp = strbuild(
-            "%s(%c) %s",
-            result,
-            suscan_severity_to_char(message_ring[id]->severity),
-            message_ring[id]->message))
-            == NULL)
-          goto fail;
-
-        free(result);
-        result = tmp;
-        tmp = NULL;
-      }
+  if (ring->repeated > 0) {
+    suscan_log_ring_put(
+        ring,
+        logmsg->severity,
+        &logmsg->time,
+        "Previous message repeated %u more times\n",
+        ring->repeated);
+    ring->repeated = 0;
   }
 
-  suscan_log_unlock();
+  suscan_log_ring_put(
+      ring,
+      logmsg->severity,
+      &logmsg->time,
+      "%s",
+      logmsg->message);
 
-  return result;
+  ring->last_hash = hash;
+  ring->last_time = logmsg->time;
+}
 
-fail:
-  if (result != NULL)
-    free(result);
+SUPRIVATE int
+suscan_log_record_compare(const void *a, const void *b)
+{
+  const struct suscan_log_record *rec_a = (const struct suscan_log_record *) a;
+  const struct suscan_log_record *rec_b = (const struct suscan_log_record *) b;
 
-  if (tmp != NULL)
-    free(tmp);
+  if (rec_a->seq < rec_b->seq)
+    return -1;
+  else if (rec_a->seq > rec_b->seq)
+    return 1;
 
-  suscan_log_unlock();
+  return 0;
+}
 
-  return NULL;
+char *
+suscan_log_get_last_messages(struct timeval since, unsigned int max)
+{
+  struct suscan_log_ring *ring;
+  struct suscan_log_record *list = NULL;
+  struct suscan_log_record *rec;
+  unsigned int rings = 0;
+  unsigned int count = 0;
+  unsigned int first;
+  unsigned int gen;
+  unsigned int i;
+  size_t size = 1;
+  char *result = NULL;
+  char *p;
+
+  ring = __atomic_load_n(&log_ring_list, __ATOMIC_ACQUIRE);
+  for (; ring != NULL; ring = ring->next)
+    ++rings;
+
+  if (rings > 0)
+    if ((list = malloc(
+        rings * SUSCAN_LOG_RING_SIZE * sizeof(struct suscan_log_record)))
+        == NULL)
+      goto done;
+
+  /* Copy every consistent record newer than since */
+  ring = __atomic_load_n(&log_ring_list, __ATOMIC_ACQUIRE);
+  for (; ring != NULL && rings-- > 0; ring = ring->next)
+    for (i = 0; i < SUSCAN_LOG_RING_SIZE; ++i) {
+      rec = ring->record + i;
+      gen = __atomic_load_n(&rec->gen, __ATOMIC_ACQUIRE);
+      if (gen == 0 || (gen & 1))
+        continue;
+
+      list[count] = *rec;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&rec->gen, __ATOMIC_RELAXED) != gen)
+        continue;
+
+      if (suscan_log_timeval_after(&list[count].time, &since))
+        ++count;
+    }
+
+  qsort(
+      list,
+      count,
+      sizeof(struct suscan_log_record),
+      suscan_log_record_compare);
+
+  first = count > max ? count - max : 0;
+
+  for (i = first; i < count; ++i)
+    size += 4 + strlen(list[i].message);
+
+  if ((result = malloc(size)) == NULL)
+    goto done;
+
+  /* Single pass over the sorted records */
+  p = result;
+  for (i = first; i < count; ++i)
+    p += sprintf(
+        p,
+        "(%c) %s",
+        suscan_severity_to_char(list[i].severity),
+        list[i].message);
+
+  *p = '\0';
+
+done:
+  if (list != NULL)
+    free(list);
+
+  return result;
 }
 
 SUBOOL
@@ -193,7 +326,7 @@ suscan_sigutils_init(enum suscan_mode mode)
   struct sigutils_log_config config = sigutils_log_config_INITIALIZER;
   struct sigutils_log_config *config_p = NULL;
 
-  if (mode != SUSCAN_MODE_FINGERPRINT) {
+  if (mode == SUSCAN_MODE_GTK_UI) {
     config.exclusive = SU_FALSE; /* We handle concurrency manually */
     config.log_func = suscan_log_func;
 
@@ -15,8 +15,21 @@
 
 #include "suscan.h"
 
+#include <analyzer/remote.h>
+
 SUPRIVATE struct option long_options[] = {
     {"fingerprint", no_argument, NULL, 'f'},
+    {"server", required_argument, NULL, 's'},
+    {"speed", required_argument, NULL, 'r'},
+    {"record", required_argument, NULL, 'w'},
+    {"mcast", required_argument, NULL, 'm'},
+    {"rate-limit", required_argument, NULL, 'l'},
+    {"max-clients", required_argument, NULL, 'c'},
+    {"bench", no_argument, NULL, 'b'},
+    {"inspectors", required_argument, NULL, 'i'},
+    {"time", required_argument, NULL, 't'},
+    {"json", no_argument, NULL, 'j'},
+    {"parallel", required_argument, NULL, 'p'},
     {"help", no_argument, NULL, 'h'},
     {NULL, 0, NULL, 0}
 };
@@ -26,6 +39,9 @@ extern int optind;
 SUPRIVATE void
 help(const char *argv0)
 {
+  struct suscan_analyzer_server_params server_params =
+      suscan_analyzer_server_params_INITIALIZER;
+
   fprintf(stderr, "Usage:\n");
   fprintf(stderr, "  %s [options] [source1 [source2 [...]]]\n\n", argv0);
   fprintf(
@@ -34,6 +50,37 @@ help(const char *argv0)
   fprintf(stderr, "Options:\n\n");
   fprintf(stderr, "     -f, --fingerprint     Performs fingerprinting on all\n");
   fprintf(stderr, "                           specified sources\n");
+  fprintf(stderr, "     -s, --server PORT     Run a headless analyzer on the\n");
+  fprintf(stderr, "                           first source, for remote clients\n");
+  fprintf(stderr, "     -r, --speed FACTOR    Replay speed of recorded sources in\n");
+  fprintf(stderr, "                           server mode (0.5 to 100)\n");
+  fprintf(stderr, "     -w, --record FILE     Record the source in server mode,\n");
+  fprintf(stderr, "                           as an indexed capture\n");
+  fprintf(stderr, "     -m, --mcast GROUP[:PORT]\n");
+  fprintf(stderr, "                           Send bulk updates of the server to\n");
+  fprintf(
+      stderr,
+      "                           this multicast group (default port: %d)\n",
+      server_params.mcast_port);
+  fprintf(stderr, "     -l, --rate-limit BPS  Bulk bytes per second sent to each\n");
+  fprintf(stderr, "                           server client (default: no limit)\n");
+  fprintf(stderr, "     -c, --max-clients N   Clients served at once\n");
+  fprintf(
+      stderr,
+      "                           (default: %u)\n",
+      server_params.max_clients);
+  fprintf(stderr, "     -b, --bench           Measure pipeline throughput on the\n");
+  fprintf(stderr, "                           first source, unthrottled\n");
+  fprintf(stderr, "     -i, --inspectors N    Inspectors opened in bench mode\n");
+  fprintf(
+      stderr,
+      "                           (default: %d)\n",
+      SUSCAN_BENCH_DEFAULT_INSPECTORS);
+  fprintf(stderr, "     -t, --time SECONDS    Stop the benchmark after this time,\n");
+  fprintf(stderr, "                           instead of at the end of stream\n");
+  fprintf(stderr, "     -p, --parallel JOBS   Fingerprint this many sources at once\n");
+  fprintf(stderr, "     -j, --json            Print benchmark results as JSON, and\n");
+  fprintf(stderr, "                           fingerprints as one JSON line each\n");
   fprintf(stderr, "     -h, --help            This help\n\n");
   fprintf(stderr, "(c) 2017 Gonzalo J. Caracedo <BatchDrake@gmail.com>\n");
 }
@@ -50,17 +97,126 @@ main(int argc, char *argv[], char *envp[])
   unsigned int i;
   int c;
   int index;
+  struct suscan_analyzer_server_params server_params =
+      suscan_analyzer_server_params_INITIALIZER;
+  char *mcast_port;
+  int group_port;
+  int port = 0;
+  float speed = 1;
+  int inspectors = SUSCAN_BENCH_DEFAULT_INSPECTORS;
+  float duration = 0;
+  SUBOOL json = SU_FALSE;
+  int jobs = 1;
+  unsigned long long rate;
+  int clients;
 
 #ifdef DEBUG_WITH_MTRACE
   mtrace();
 #endif
 
-  while ((c = getopt_long(argc, argv, "fh", long_options, &index)) != -1) {
+  while ((c = getopt_long(argc, argv, "fs:r:w:m:l:c:bi:t:jp:h", long_options, &index)) != -1) {
     switch (c) {
       case 'f':
         mode = SUSCAN_MODE_FINGERPRINT;
         break;
 
+      case 's':
+        mode = SUSCAN_MODE_SERVER;
+        if (sscanf(optarg, "%i", &port) < 1 || port <= 0 || port > 65535) {
+          fprintf(stderr, "%s: invalid port `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        server_params.port = port;
+        break;
+
+      case 'r':
+        if (sscanf(optarg, "%f", &speed) < 1
+            || speed < SUSCAN_THROTTLE_MIN_SPEED
+            || speed > SUSCAN_THROTTLE_MAX_SPEED) {
+          fprintf(stderr, "%s: invalid replay speed `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      case 'w':
+        server_params.record_path = optarg;
+        break;
+
+      case 'm':
+        if ((mcast_port = strchr(optarg, ':')) != NULL) {
+          *mcast_port++ = '\0';
+          if (sscanf(mcast_port, "%i", &group_port) < 1
+              || group_port <= 0
+              || group_port > 65535) {
+            fprintf(
+                stderr,
+                "%s: invalid multicast port `%s'\n",
+                argv[0],
+                mcast_port);
+            exit(EXIT_FAILURE);
+          }
+          server_params.mcast_port = group_port;
+        }
+        server_params.mcast_addr = optarg;
+        break;
+
+      case 'l':
+        if (sscanf(optarg, "%llu", &rate) < 1) {
+          fprintf(stderr, "%s: invalid rate limit `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        server_params.client_rate = rate;
+        break;
+
+      case 'c':
+        if (sscanf(optarg, "%i", &clients) < 1 || clients < 1) {
+          fprintf(
+              stderr,
+              "%s: invalid client count `%s'\n",
+              argv[0],
+              optarg);
+          exit(EXIT_FAILURE);
+        }
+        server_params.max_clients = clients;
+        break;
+
+      case 'b':
+        mode = SUSCAN_MODE_BENCH;
+        break;
+
+      case 'i':
+        if (sscanf(optarg, "%i", &inspectors) < 1 || inspectors < 0) {
+          fprintf(
+              stderr,
+              "%s: invalid inspector count `%s'\n",
+              argv[0],
+              optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      case 't':
+        if (sscanf(optarg, "%f", &duration) < 1 || duration <= 0) {
+          fprintf(
+              stderr,
+              "%s: invalid benchmark time `%s'\n",
+              argv[0],
+              optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      case 'j':
+        json = SU_TRUE;
+        break;
+
+      case 'p':
+        if (sscanf(optarg, "%i", &jobs) < 1 || jobs < 1) {
+          fprintf(stderr, "%s: invalid job count `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
       case 'h':
         help(argv[0]);
         exit(EXIT_SUCCESS);
@@ -119,6 +275,14 @@ main(int argc, char *argv[], char *envp[])
       if (config_count == 0) {
         fprintf(stderr, "%s: no sources given for fingerprint\n", argv[0]);
         goto done;
+      } else if (jobs > 1 || json) {
+        if (suscan_perform_fingerprint_batch(
+            config_list,
+            (const char **) argv + optind,
+            config_count,
+            jobs,
+            json))
+          exit_code = EXIT_SUCCESS;
       } else {
         for (i = 0; i < config_count; ++i) {
           fprintf(
@@ -138,6 +302,26 @@ main(int argc, char *argv[], char *envp[])
       }
 
       break;
+
+    case SUSCAN_MODE_SERVER:
+      if (config_count == 0) {
+        fprintf(stderr, "%s: no source given for server\n", argv[0]);
+        goto done;
+      }
+
+      if (suscan_run_server(config_list[0], &server_params, speed))
+        exit_code = EXIT_SUCCESS;
+      break;
+
+    case SUSCAN_MODE_BENCH:
+      if (config_count == 0) {
+        fprintf(stderr, "%s: no source given for benchmark\n", argv[0]);
+        goto done;
+      }
+
+      if (suscan_run_bench(config_list[0], inspectors, duration, json))
+        exit_code = EXIT_SUCCESS;
+      break;
   }
 
 done:
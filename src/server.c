@@ -0,0 +1,52 @@
+/*
+
+  Copyright (C) 2017 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SU_LOG_DOMAIN "server"
+
+#include "suscan.h"
+
+#include <analyzer/remote.h>
+
+/* Headless mode: serve the analyzer until the source is exhausted */
+SUBOOL
+suscan_run_server(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_server_params *params,
+    SUFLOAT speed)
+{
+  struct suscan_analyzer_params analyzer_params =
+      suscan_analyzer_params_INITIALIZER;
+  suscan_analyzer_server_t *server;
+
+  analyzer_params.replay_speed = speed;
+
+  SU_TRYCATCH(
+      server = suscan_analyzer_server_new(params, &analyzer_params, config),
+      return SU_FALSE);
+
+  suscan_analyzer_server_wait(server);
+
+  suscan_analyzer_server_destroy(server);
+
+  return SU_TRUE;
+}
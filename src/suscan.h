@@ -22,6 +22,8 @@
 #define SUSCAN_SOURCE_DIALOG_Y_PADDING        7
 #define SUSCAN_SOURCE_DIALOG_FIELD_Y_OFFSET   4
 
+#define SUSCAN_BENCH_DEFAULT_INSPECTORS 4
+
 #define ARRAY_SZ(arr) ((sizeof(arr)) / sizeof(arr[0]))
 
 #define SUSCAN_SOURCE_TYPE_BLADE_RF ((void *) 1)
@@ -42,7 +44,9 @@
 
 enum suscan_mode {
   SUSCAN_MODE_GTK_UI,
-  SUSCAN_MODE_FINGERPRINT
+  SUSCAN_MODE_FINGERPRINT,
+  SUSCAN_MODE_SERVER,
+  SUSCAN_MODE_BENCH
 };
 
 SUBOOL suscan_channel_is_dc(const struct sigutils_channel *ch);
@@ -63,4 +67,24 @@ SUBOOL suscan_gui_start(
 
 SUBOOL suscan_perform_fingerprint(struct suscan_source_config *config);
 
+SUBOOL suscan_perform_fingerprint_batch(
+    struct suscan_source_config **config_list,
+    const char **name_list,
+    unsigned int count,
+    unsigned int jobs,
+    SUBOOL json);
+
+struct suscan_analyzer_server_params;
+
+SUBOOL suscan_run_server(
+    struct suscan_source_config *config,
+    const struct suscan_analyzer_server_params *params,
+    SUFLOAT speed);
+
+SUBOOL suscan_run_bench(
+    struct suscan_source_config *config,
+    unsigned int inspectors,
+    SUFLOAT duration,
+    SUBOOL json);
+
 #endif /* _MAIN_INCLUDE_H */